@@ -17,7 +17,6 @@
 
 #include <algorithm>
 #include <chrono>
-#include <queue>
 #include <map>
 #include <sstream>
 #include <iomanip>
@@ -27,6 +26,7 @@
 #include <fstream>
 #include <memcached/isotime.h>
 #include <iostream>
+#include <thread>
 
 #include "auditd.h"
 #include "audit.h"
@@ -447,35 +447,44 @@ bool Audit::add_to_filleventqueue(const uint32_t event_id,
     //       in the correct fields.. if not we should add an
     //       event to the audit trail saying it is one in an illegal
     //       format (or missing fields)
-    bool res;
     Event* new_event = new Event(event_id, payload, length);
-    cb_mutex_enter(&producer_consumer_lock);
-    if (filleventqueue->size() < max_audit_queue) {
-        filleventqueue->push(new_event);
-        cb_cond_broadcast(&events_arrived);
-        res = true;
-    } else {
+    if (!eventqueue.push(new_event)) {
         logger->log(EXTENSION_LOG_WARNING, NULL,
                     "Audit: Dropping audit event %u: %s",
                     new_event->id, new_event->payload.c_str());
         dropped_events++;
         delete new_event;
-        res = false;
+        return false;
     }
-    cb_mutex_exit(&producer_consumer_lock);
-    return res;
+
+    notify_consumer();
+    return true;
 }
 
 
 bool Audit::add_reconfigure_event(const char* configfile, const void *cookie) {
     ConfigureEvent* new_event = new ConfigureEvent(configfile, cookie);
-    cb_mutex_enter(&producer_consumer_lock);
-    filleventqueue->push(new_event);
-    cb_cond_broadcast(&events_arrived);
-    cb_mutex_exit(&producer_consumer_lock);
+    // The reconfigure event can't be dropped; wait for the consumer to
+    // make room for it
+    while (!eventqueue.push(new_event)) {
+        notify_consumer();
+        std::this_thread::yield();
+    }
+    notify_consumer();
     return true;
 }
 
+void Audit::notify_consumer() {
+    // Pairs with the fence in consume_events; either we see that the
+    // consumer is about to wait, or the consumer sees our event.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (consumer_waiting.load(std::memory_order_relaxed)) {
+        cb_mutex_enter(&producer_consumer_lock);
+        cb_cond_broadcast(&events_arrived);
+        cb_mutex_exit(&producer_consumer_lock);
+    }
+}
+
 
 void Audit::clear_events_map(void) {
     typedef std::map<uint32_t, EventDescriptor*>::iterator it_type;
@@ -487,14 +496,8 @@ void Audit::clear_events_map(void) {
 
 
 void Audit::clear_events_queues(void) {
-    while(!processeventqueue->empty()) {
-        Event *event = processeventqueue->front();
-        processeventqueue->pop();
-        delete event;
-    }
-    while(!filleventqueue->empty()) {
-        Event *event = filleventqueue->front();
-        filleventqueue->pop();
+    Event* event;
+    while (eventqueue.pop(event)) {
         delete event;
     }
 }
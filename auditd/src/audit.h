@@ -20,7 +20,6 @@
 #include <inttypes.h>
 #include <map>
 #include <memory>
-#include <queue>
 #include <atomic>
 
 #include <cJSON.h>
@@ -30,6 +29,7 @@
 #include "auditfile.h"
 #include "auditd.h"
 #include "eventdescriptor.h"
+#include "eventqueue.h"
 
 class Event;
 
@@ -38,11 +38,14 @@ public:
     AuditConfig config;
     std::map<uint32_t,EventDescriptor*> events;
 
-    // We maintain two Event queues. At any one time one will be used to accept
-    // new events, and the other will be processed. The two queues are swapped
-    // periodically.
-    std::unique_ptr<std::queue<Event*>> processeventqueue;
-    std::unique_ptr<std::queue<Event*>> filleventqueue;
+    // The front end threads add the events to the queue without locking,
+    // and the consumer thread drains it in batches.
+    EventQueue eventqueue;
+
+    // Set by the consumer thread before it waits for events_arrived (under
+    // producer_consumer_lock) so that the producers only need to grab the
+    // lock and signal the consumer when it is about to sleep.
+    std::atomic_bool consumer_waiting;
 
     bool terminate_audit_daemon;
     std::string configfile;
@@ -58,12 +61,15 @@ public:
     AuditFile auditfile;
     std::atomic<uint32_t> dropped_events;
 
+    // The buffer the consumer thread renders the events into before they
+    // are added to the audit file (kept to avoid an allocation per event)
+    std::string event_buffer;
+
     Audit()
-        : processeventqueue(new std::queue<Event*>()),
-          filleventqueue(new std::queue<Event*>()),
+        : eventqueue(max_audit_queue),
+          consumer_waiting(false),
           terminate_audit_daemon(false),
-          dropped_events(0),
-          max_audit_queue(50000) {
+          dropped_events(0) {
         consumer_thread_running.store(false);
         cb_cond_initialize(&processeventqueue_empty);
         cb_cond_initialize(&events_arrived);
@@ -91,6 +97,13 @@ public:
     }
 
     bool add_reconfigure_event(const char *configfile, const void *cookie);
+
+    /**
+     * Wake up the consumer thread if it is waiting for events to arrive.
+     * Must be called after adding an event to the queue.
+     */
+    void notify_consumer();
+
     bool create_audit_event(uint32_t event_id, cJSON *payload);
     bool terminate_consumer_thread(void);
     void clear_events_map(void);
@@ -118,7 +131,7 @@ protected:
     } event_state_listener;
 
 private:
-    size_t max_audit_queue;
+    static const size_t max_audit_queue = 65536;
 };
 
 #endif
@@ -35,6 +35,7 @@ public:
         rotate_interval(900),
         rotate_size(20 * 1024 * 1024),
         buffered(true),
+        fsync_interval(0),
         min_file_rotation_time(900), // 15 minutes
         max_file_rotation_time(604800), // 1 week
         max_rotate_file_size(500 * 1024 * 1024)
@@ -65,6 +66,8 @@ public:
     uint32_t get_rotate_interval(void) const;
     void set_buffered(bool enable);
     bool is_buffered(void) const;
+    void set_fsync_interval(uint32_t interval);
+    uint32_t get_fsync_interval(void) const;
     void set_log_directory(const std::string &directory);
     std::string get_log_directory(void) const;
     void set_descriptors_path(const std::string &directory);
@@ -106,6 +109,7 @@ protected:
     void set_rotate_interval(cJSON *obj);
     void set_auditd_enabled(cJSON *obj);
     void set_buffered(cJSON *obj);
+    void set_fsync_interval(cJSON *obj);
     void set_log_directory(cJSON *obj);
     void set_descriptors_path(cJSON *obj);
     void add_array(std::vector<uint32_t> &vec, cJSON *array, const char *name);
@@ -121,6 +125,9 @@ protected:
     Couchbase::RelaxedAtomic<uint32_t> rotate_interval;
     Couchbase::RelaxedAtomic<size_t> rotate_size;
     Couchbase::RelaxedAtomic<bool> buffered;
+    // The minimum number of seconds between each fsync of the audit
+    // file (0 means we never explicitly fsync the file)
+    Couchbase::RelaxedAtomic<uint32_t> fsync_interval;
 
     mutable std::mutex log_path_mutex;
     std::string log_path;
@@ -45,11 +45,18 @@ static void consume_events(void* arg) {
 
     cb_mutex_enter(&audit.producer_consumer_lock);
     while (!audit.terminate_audit_daemon) {
-        if (audit.filleventqueue->empty()) {
-            cb_cond_timedwait(&audit.events_arrived,
-                              &audit.producer_consumer_lock,
-                              audit.auditfile.get_seconds_to_rotation() * 1000);
-            if (audit.filleventqueue->empty()) {
+        if (audit.eventqueue.empty()) {
+            audit.consumer_waiting.store(true, std::memory_order_relaxed);
+            // Pairs with the fence in Audit::notify_consumer
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (audit.eventqueue.empty()) {
+                cb_cond_timedwait(
+                        &audit.events_arrived,
+                        &audit.producer_consumer_lock,
+                        audit.auditfile.get_seconds_to_rotation() * 1000);
+            }
+            audit.consumer_waiting.store(false, std::memory_order_relaxed);
+            if (audit.eventqueue.empty()) {
                 // We timed out, so just rotate the files
                 audit.auditfile.maybe_rotate_files();
             }
@@ -57,16 +64,18 @@ static void consume_events(void* arg) {
         /* now have producer_consumer lock!
          * event(s) have arrived or shutdown requested
          */
-        swap(audit.processeventqueue, audit.filleventqueue);
         cb_mutex_exit(&audit.producer_consumer_lock);
         // Now outside of the producer_consumer_lock
 
-        while (!audit.processeventqueue->empty()) {
-            Event* event = audit.processeventqueue->front();
+        // Drain (at most) a queue worth of events before flushing them
+        // to the file so that we write them out in large batches
+        Event* event;
+        for (size_t ii = 0; ii < audit.eventqueue.getCapacity() &&
+                            audit.eventqueue.pop(event);
+             ++ii) {
             if (!event->process(audit)) {
                 audit.dropped_events++;
             }
-            audit.processeventqueue->pop();
             delete event;
         }
         audit.auditfile.flush();
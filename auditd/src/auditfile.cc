@@ -24,6 +24,11 @@
 #include <memcached/isotime.h>
 #include <JSON_checker.h>
 #include <fstream>
+#ifdef WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
 #include "auditd.h"
 #include "audit.h"
 #include "auditfile.h"
@@ -102,14 +107,20 @@ bool AuditFile::open(void) {
         log_error(AuditErrorCode::FILE_OPEN_ERROR, open_file_name.c_str());
         return false;
     }
+    // We do our own buffering
+    setvbuf(file, NULL, _IONBF, 0);
     current_size = 0;
     open_time = auditd_time();
+    last_fsync = open_time;
     return true;
 }
 
 
 void AuditFile::close_and_rotate_log(void) {
     cb_assert(file != NULL);
+    if (write_buffer() && fsync_interval != 0) {
+        sync_file();
+    }
     fclose(file);
     file = NULL;
     if (current_size == 0) {
@@ -251,14 +262,7 @@ bool AuditFile::write_event_to_disk(cJSON *output) {
     char *content = cJSON_PrintUnformatted(output);
     bool ret = true;
     if (content) {
-        current_size += fprintf(file, "%s\n", content);
-        if (ferror(file)) {
-            log_error(AuditErrorCode::WRITING_TO_DISK_ERROR, strerror(errno));
-            ret = false;
-            close_and_rotate_log();
-        } else if (!buffered) {
-            ret = flush();
-        }
+        ret = write_event_to_disk(std::string(content));
         cJSON_Free(content);
     } else {
         log_error(AuditErrorCode::MEMORY_ALLOCATION_ERROR,
@@ -268,6 +272,49 @@ bool AuditFile::write_event_to_disk(cJSON *output) {
     return ret;
 }
 
+bool AuditFile::write_event_to_disk(const std::string& event) {
+    buffer.append(event);
+    buffer.push_back('\n');
+    current_size += event.size() + 1;
+
+    if (!buffered) {
+        return flush();
+    }
+    if (buffer.size() >= write_buffer_size && !write_buffer()) {
+        close_and_rotate_log();
+        return false;
+    }
+    return true;
+}
+
+bool AuditFile::write_buffer(void) {
+    if (buffer.empty()) {
+        return true;
+    }
+
+    const auto nw = fwrite(buffer.data(), 1, buffer.size(), file);
+    const bool success = nw == buffer.size();
+    buffer.clear();
+    if (!success) {
+        log_error(AuditErrorCode::WRITING_TO_DISK_ERROR, strerror(errno));
+    }
+    return success;
+}
+
+bool AuditFile::sync_file(void) {
+#ifdef WIN32
+    const int ret = _commit(_fileno(file));
+#else
+    const int ret = fsync(fileno(file));
+#endif
+    last_fsync = auditd_time();
+    if (ret != 0) {
+        log_error(AuditErrorCode::WRITING_TO_DISK_ERROR, strerror(errno));
+        return false;
+    }
+    return true;
+}
+
 
 void AuditFile::set_log_directory(const std::string &new_directory) {
     if (log_directory == new_directory) {
@@ -296,16 +343,25 @@ void AuditFile::reconfigure(const AuditConfig &config) {
     set_log_directory(config.get_log_directory());
     max_log_size = config.get_rotate_size();
     buffered = config.is_buffered();
+    fsync_interval = config.get_fsync_interval();
 }
 
 bool AuditFile::flush(void) {
     if (is_open()) {
+        if (!write_buffer()) {
+            close_and_rotate_log();
+            return false;
+        }
         if (fflush(file) != 0) {
             log_error(AuditErrorCode::WRITING_TO_DISK_ERROR,
                       strerror(errno));
             close_and_rotate_log();
             return false;
         }
+        if (fsync_interval != 0 &&
+            difftime(auditd_time(), last_fsync) >= fsync_interval) {
+            return sync_file();
+        }
     }
 
     return true;
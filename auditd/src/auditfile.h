@@ -34,8 +34,11 @@ public:
         current_size(0),
         max_log_size(20 * 1024 * 1024),
         rotate_interval(900),
-        buffered(true)
+        buffered(true),
+        fsync_interval(0),
+        last_fsync(0)
     {
+        buffer.reserve(write_buffer_size);
     }
 
     ~AuditFile() {
@@ -97,6 +100,17 @@ public:
      */
     bool write_event_to_disk(cJSON *output);
 
+    /**
+     * Write an (already rendered) event to the disk. The event is added
+     * to the write buffer, which is written to the file when it is full
+     * or the file is flushed (or for every event if the audit file isn't
+     * buffered).
+     *
+     * @param event the JSON representation of the event
+     * @return true if success, false otherwise
+     */
+    bool write_event_to_disk(const std::string& event);
+
     /**
      * Check for a file existence
      *
@@ -119,7 +133,8 @@ public:
     void reconfigure(const AuditConfig &config);
 
     /**
-     * Flush the buffers to the disk
+     * Flush the buffers to the disk (and fsync the file if the
+     * fsync interval has passed since the last time)
      */
     bool flush(void);
 
@@ -139,6 +154,10 @@ private:
     bool open(void);
     bool time_to_rotate_log(void) const;
     void close_and_rotate_log(void);
+    /// Write the buffered events to the file (never closes or rotates the
+    /// file, as it is also used when closing it)
+    bool write_buffer(void);
+    bool sync_file(void);
     void set_log_directory(const std::string &new_directory);
     bool is_timestamp_format_correct(std::string& str);
 
@@ -152,6 +171,13 @@ private:
     size_t max_log_size;
     uint32_t rotate_interval;
     bool buffered;
+    uint32_t fsync_interval;
+    time_t last_fsync;
+
+    /// The events not yet written to the file
+    std::string buffer;
+    /// Write the buffer to the file once it grows beyond this size
+    static const size_t write_buffer_size = 1024 * 1024;
 };
 
 #endif
@@ -15,26 +15,173 @@
  *   limitations under the License.
  */
 
+#include <cstdio>
 #include <sstream>
 #include <string>
 #include <cJSON.h>
+#include <cJSON_utils.h>
+#include <JSON_checker.h>
 #include <memcached/isotime.h>
 #include "event.h"
 #include "audit.h"
 
-bool Event::filterEventByUser(cJSON* json_payload,
+EventQueue::~EventQueue() {
+    Event* event;
+    while (pop(event)) {
+        delete event;
+    }
+}
+
+namespace {
+
+const char* skipWhitespace(const char* ptr, const char* end) {
+    while (ptr < end &&
+           (*ptr == ' ' || *ptr == '\t' || *ptr == '\n' || *ptr == '\r')) {
+        ++ptr;
+    }
+    return ptr;
+}
+
+/// Move past the string starting at ptr (pointing at the opening quote)
+const char* skipString(const char* ptr, const char* end) {
+    ++ptr;
+    while (ptr < end && *ptr != '"') {
+        if (*ptr == '\\') {
+            ++ptr;
+        }
+        ++ptr;
+    }
+    return ptr + 1;
+}
+
+/// Move past the (valid) JSON value starting at ptr
+const char* skipValue(const char* ptr, const char* end) {
+    if (*ptr == '"') {
+        return skipString(ptr, end);
+    }
+
+    if (*ptr == '{' || *ptr == '[') {
+        int depth = 0;
+        while (ptr < end) {
+            switch (*ptr) {
+            case '"':
+                ptr = skipString(ptr, end);
+                continue;
+            case '{':
+            case '[':
+                ++depth;
+                break;
+            case '}':
+            case ']':
+                if (--depth == 0) {
+                    return ptr + 1;
+                }
+                break;
+            }
+            ++ptr;
+        }
+        return ptr;
+    }
+
+    // number, true, false or null
+    while (ptr < end && *ptr != ',' && *ptr != '}' && *ptr != ']' &&
+           *ptr != ' ' && *ptr != '\t' && *ptr != '\n' && *ptr != '\r') {
+        ++ptr;
+    }
+    return ptr;
+}
+
+void appendJsonString(std::string& out, const std::string& value) {
+    out.push_back('"');
+    for (const auto c : value) {
+        switch (c) {
+        case '"':
+            out.append("\\\"");
+            break;
+        case '\\':
+            out.append("\\\\");
+            break;
+        case '\n':
+            out.append("\\n");
+            break;
+        case '\r':
+            out.append("\\r");
+            break;
+        case '\t':
+            out.append("\\t");
+            break;
+        default:
+            if (uint8_t(c) < 0x20) {
+                char escaped[8];
+                snprintf(escaped, sizeof(escaped), "\\u%04x", unsigned(c));
+                out.append(escaped);
+            } else {
+                out.push_back(c);
+            }
+        }
+    }
+    out.push_back('"');
+}
+
+} // anonymous namespace
+
+cb::const_char_buffer Event::findMember(cb::const_char_buffer object,
+                                        const std::string& name) {
+    const char* const end = object.buf + object.len;
+    const char* ptr = skipWhitespace(object.buf, end);
+    if (ptr == end || *ptr != '{') {
+        return {};
+    }
+    ptr = skipWhitespace(ptr + 1, end);
+
+    while (ptr < end && *ptr == '"') {
+        const char* key = ptr + 1;
+        ptr = skipString(ptr, end);
+        const size_t keylen = size_t(ptr - 1 - key);
+        ptr = skipWhitespace(ptr, end);
+        // skip the ':'
+        ptr = skipWhitespace(ptr + 1, end);
+        if (ptr >= end) {
+            break;
+        }
+        const char* value = ptr;
+        ptr = skipValue(ptr, end);
+        if (keylen == name.size() && name.compare(0, keylen, key, keylen) == 0) {
+            return {value, size_t(ptr - value)};
+        }
+        ptr = skipWhitespace(ptr, end);
+        if (ptr < end && *ptr == ',') {
+            ptr = skipWhitespace(ptr + 1, end);
+        }
+    }
+
+    return {};
+}
+
+bool Event::filterEventByUser(cb::const_char_buffer eventPayload,
                               const AuditConfig& config,
                               const std::string& userid_type) {
-    auto* id = cJSON_GetObjectItem(json_payload, userid_type.c_str());
-    if (id != nullptr) {
-        auto* user = cJSON_GetObjectItem(id, "user");
-        if (user != nullptr) {
-            if (user->type != cJSON_String) {
+    auto id = findMember(eventPayload, userid_type);
+    if (id.buf != nullptr) {
+        auto user = findMember(id, "user");
+        if (user.buf != nullptr) {
+            if (user.buf[0] != '"') {
                 std::stringstream ss;
                 ss << "Incorrect type for \"" << userid_type
                         << "::user\". Should be string.";
                 throw std::invalid_argument(ss.str());
-            } else if (config.is_event_filtered(user->valuestring)) {
+            }
+
+            std::string username(user.buf + 1, user.len - 2);
+            if (username.find('\\') != std::string::npos) {
+                // Let cJSON deal with the escape sequences
+                unique_cJSON_ptr json(
+                        cJSON_Parse(std::string(user.buf, user.len).c_str()));
+                if (json && json->type == cJSON_String) {
+                    username.assign(json->valuestring);
+                }
+            }
+            if (config.is_event_filtered(username)) {
                 return true;
             }
         }
@@ -43,13 +190,14 @@ bool Event::filterEventByUser(cJSON* json_payload,
     return false;
 }
 
-bool Event::filterEvent(cJSON* json_payload, const AuditConfig& config) {
+bool Event::filterEvent(cb::const_char_buffer eventPayload,
+                        const AuditConfig& config) {
     // Check to see if real_userid::user is in the filter list.
-    if (filterEventByUser(json_payload, config, "real_userid")) {
+    if (filterEventByUser(eventPayload, config, "real_userid")) {
         return true;
     } else {
         // Check to see if effective_userid::user is in the filter list.
-        return filterEventByUser(json_payload, config, "effective_userid");
+        return filterEventByUser(eventPayload, config, "effective_userid");
     }
 }
 
@@ -59,54 +207,63 @@ bool Event::process(Audit& audit) {
         return true;
     }
 
-    // convert the event.payload into JSON
-    cJSON *json_payload = cJSON_Parse(payload.c_str());
-    if (json_payload == NULL) {
+    // The payload is written to the file as is (with our fields appended),
+    // so we only need to check that it is a valid JSON object.
+    const cb::const_char_buffer json{payload.data(), payload.size()};
+    const auto begin = payload.find_first_not_of(" \t\r\n");
+    const auto end = payload.find_last_not_of(" \t\r\n");
+    if (begin == std::string::npos || payload[begin] != '{' ||
+        payload[end] != '}' ||
+        !checkUTF8JSON(reinterpret_cast<const unsigned char*>(payload.data()),
+                       payload.size())) {
         Audit::log_error(AuditErrorCode::JSON_PARSING_ERROR, payload.c_str());
         return false;
     }
-    cJSON *timestamp_ptr = cJSON_GetObjectItem(json_payload, "timestamp");
-    if (timestamp_ptr == NULL) {
-        std::string timestamp;
-        timestamp = ISOTime::generatetimestamp();
-        cJSON_AddStringToObject(json_payload, "timestamp", timestamp.c_str());
-    }
+
     auto evt = audit.events.find(id);
     if (evt == audit.events.end()) {
         // it is an unknown event
         std::ostringstream convert;
         convert << id;
         Audit::log_error(AuditErrorCode::UNKNOWN_EVENT_ERROR, convert.str().c_str());
-        cJSON_Delete(json_payload);
         return false;
     }
     if (!evt->second->isEnabled()) {
         // the event is not enabled so ignore event
-        cJSON_Delete(json_payload);
         return true;
     }
 
     if (evt->second->isFilteringPermitted() &&
-            filterEvent(json_payload, audit.config)) {
-        cJSON_Delete(json_payload);
+            filterEvent(json, audit.config)) {
         return true;
     }
 
     if (!audit.auditfile.ensure_open()) {
         Audit::log_error(AuditErrorCode::OPEN_AUDITFILE_ERROR);
-        cJSON_Delete(json_payload);
         return false;
     }
-    cJSON_AddNumberToObject(json_payload, "id", id);
-    cJSON_AddStringToObject(json_payload, "name", evt->second->getName().c_str());
-    cJSON_AddStringToObject(json_payload, "description", evt->second->getDescription().c_str());
-
-    bool success = audit.auditfile.write_event_to_disk(json_payload);
 
-    // Release allocated resources
-    cJSON_Delete(json_payload);
+    // Render the event by stripping off the closing brace of the payload
+    // and appending the fields we add
+    auto& output = audit.event_buffer;
+    output.assign(payload.data(), end);
+    if (payload.find_first_not_of(" \t\r\n", begin + 1) != end) {
+        output.push_back(',');
+    }
+    if (findMember(json, "timestamp").buf == nullptr) {
+        output.append("\"timestamp\":\"");
+        output.append(ISOTime::generatetimestamp());
+        output.append("\",");
+    }
+    output.append("\"id\":");
+    output.append(std::to_string(id));
+    output.append(",\"name\":");
+    appendJsonString(output, evt->second->getName());
+    output.append(",\"description\":");
+    appendJsonString(output, evt->second->getDescription());
+    output.push_back('}');
 
-    if (success) {
+    if (audit.auditfile.write_event_to_disk(output)) {
         return true;
     } else {
         Audit::log_error(AuditErrorCode::WRITE_EVENT_TO_DISK_ERROR);
@@ -18,11 +18,11 @@
 #define EVENT_H
 
 #include <inttypes.h>
+#include <platform/sized_buffer.h>
 #include <string>
 
 class Audit;
 class AuditConfig;
-struct cJSON;
 
 class Event {
 public:
@@ -43,23 +43,38 @@ public:
     /**
      * State whether a given event should be filtered out given the user.
      *
-     * @param eventPayload  pointer to the event payload
+     * @param eventPayload  the (validated) JSON event payload
      * @param config  reference to the audit configuration
      * @param userid  reference to the userid_type string, which will either be
      *                effective_userid or real_userid
      * @return true if event should be filtered out, else false.
      */
-    bool filterEventByUser(cJSON* json_payload, const AuditConfig& config,
+    bool filterEventByUser(cb::const_char_buffer eventPayload,
+                           const AuditConfig& config,
                            const std::string& userid_type);
 
     /**
      * State whether a given event should be filtered out.
      *
-     * @param eventPayload  pointer to the event payload
+     * @param eventPayload  the (validated) JSON event payload
      * @param config  reference to the audit configuration
      * @return true if event should be filtered out, else false.
      */
-    bool filterEvent(cJSON* eventPayload, const AuditConfig& audit);
+    bool filterEvent(cb::const_char_buffer eventPayload,
+                     const AuditConfig& audit);
+
+    /**
+     * Locate the value of the named member in a JSON object. The object
+     * must be valid JSON (as the lookup skips over the values without
+     * validating them).
+     *
+     * @param object the JSON object to search
+     * @param name the name of the member
+     * @return the JSON text of the members value (buf is nullptr if the
+     *         object doesn't contain the member)
+     */
+    static cb::const_char_buffer findMember(cb::const_char_buffer object,
+                                            const std::string& name);
 
     virtual ~Event() {}
 
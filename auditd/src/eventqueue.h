@@ -0,0 +1,148 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2018 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+class Event;
+
+/**
+ * The EventQueue is a bounded, lock-free ring buffer the front end threads
+ * use to hand over the audit events to the consumer thread.
+ *
+ * Each slot in the ring carries a sequence number telling if it is ready
+ * to be written by a producer or read by the consumer, so a producer only
+ * needs a single compare-and-swap to claim a slot (and never blocks other
+ * producers or the consumer).
+ *
+ * The queue holds the events by pointer, and ownership of the event is
+ * transferred when it is pushed (and popped).
+ */
+class EventQueue {
+public:
+    /**
+     * Create a new queue
+     *
+     * @param size the number of events the queue may hold (rounded up to
+     *             the next power of two)
+     */
+    explicit EventQueue(size_t size)
+        : capacity(roundUp(size)),
+          mask(capacity - 1),
+          cells(new Cell[capacity]) {
+        for (size_t ii = 0; ii < capacity; ++ii) {
+            cells[ii].sequence.store(ii, std::memory_order_relaxed);
+        }
+    }
+
+    ~EventQueue();
+
+    EventQueue(const EventQueue&) = delete;
+
+    /**
+     * Try to add an event to the queue
+     *
+     * @param event the event to add
+     * @return true if the queue took ownership of the event, false if the
+     *         queue is full
+     */
+    bool push(Event* event) {
+        auto pos = enqueuePos.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true) {
+            cell = &cells[pos & mask];
+            const auto seq = cell->sequence.load(std::memory_order_acquire);
+            const auto diff = intptr_t(seq) - intptr_t(pos);
+            if (diff == 0) {
+                if (enqueuePos.compare_exchange_weak(
+                            pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+
+        cell->event = event;
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Try to remove the next event from the queue. Must only be called
+     * from the consumer thread.
+     *
+     * @param event where to store the event
+     * @return true if an event was returned, false if the queue is empty
+     */
+    bool pop(Event*& event) {
+        const auto pos = dequeuePos.load(std::memory_order_relaxed);
+        Cell* cell = &cells[pos & mask];
+        const auto seq = cell->sequence.load(std::memory_order_acquire);
+        if (seq != pos + 1) {
+            return false;
+        }
+
+        event = cell->event;
+        cell->sequence.store(pos + capacity, std::memory_order_release);
+        dequeuePos.store(pos + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    /**
+     * Is the queue empty? Only meaningful when called from the consumer
+     * thread.
+     */
+    bool empty() const {
+        const auto pos = dequeuePos.load(std::memory_order_relaxed);
+        return cells[pos & mask].sequence.load(std::memory_order_acquire) !=
+               pos + 1;
+    }
+
+    size_t getCapacity() const {
+        return capacity;
+    }
+
+protected:
+    static size_t roundUp(size_t size) {
+        size_t ret = 2;
+        while (ret < size) {
+            ret <<= 1;
+        }
+        return ret;
+    }
+
+    struct Cell {
+        std::atomic<size_t> sequence;
+        Event* event;
+    };
+
+    const size_t capacity;
+    const size_t mask;
+    std::unique_ptr<Cell[]> cells;
+
+    // Keep the producer and consumer positions on separate cache lines
+    char padding0[64];
+    std::atomic<size_t> enqueuePos{0};
+    char padding1[64];
+    std::atomic<size_t> dequeuePos{0};
+};
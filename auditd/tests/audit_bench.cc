@@ -0,0 +1,135 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2018 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * Benchmarks for the throughput (audit events/s) of the audit daemon:
+ *
+ *  - AddEvents measures how fast the front end threads may submit events
+ *    to the queue (while a consumer thread drains it)
+ *  - ProcessEvents measures how fast the consumer thread renders and
+ *    writes the events to the audit trail
+ */
+
+#include "audit.h"
+#include "event.h"
+#include "eventdescriptor.h"
+#include "eventqueue.h"
+
+#include <benchmark/benchmark.h>
+#include <cJSON_utils.h>
+#include <platform/dirutils.h>
+#include <platform/platform.h>
+#include <atomic>
+#include <string>
+#include <thread>
+
+static const uint32_t event_id = 20488;
+
+static const std::string payload(
+        R"({"timestamp":"2018-03-13T02:36:00.000-07:00",)"
+        R"("real_userid":{"domain":"local","user":"myuser"},)"
+        R"("peername":"127.0.0.1:666","sockname":"127.0.0.1:555",)"
+        R"("bucket":"default","key":"user::00000001"})");
+
+/**
+ * Add events to the queue from multiple threads, with the first thread
+ * also running a consumer draining the queue.
+ */
+void AddEvents(benchmark::State& state) {
+    static EventQueue queue(65536);
+    static std::atomic_bool stop;
+    static std::thread consumer;
+
+    if (state.thread_index == 0) {
+        stop = false;
+        consumer = std::thread([]() {
+            Event* event;
+            while (!stop) {
+                while (queue.pop(event)) {
+                    delete event;
+                }
+                std::this_thread::yield();
+            }
+        });
+    }
+
+    while (state.KeepRunning()) {
+        auto* event = new Event(event_id, payload.data(), payload.size());
+        while (!queue.push(event)) {
+            std::this_thread::yield();
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+
+    if (state.thread_index == 0) {
+        stop = true;
+        consumer.join();
+        Event* event;
+        while (queue.pop(event)) {
+            delete event;
+        }
+    }
+}
+
+/**
+ * Process (render and write to the audit trail) events in the consumer
+ * thread.
+ */
+void ProcessEvents(benchmark::State& state) {
+    const std::string testdir =
+            "audit-bench-" + std::to_string(cb_getpid());
+
+    Audit audit;
+    audit.config.set_auditd_enabled(true);
+    audit.config.set_log_directory(testdir);
+    audit.config.set_rotate_size(100 * 1024 * 1024);
+    audit.auditfile.reconfigure(audit.config);
+
+    unique_cJSON_ptr descriptor(cJSON_CreateObject());
+    cJSON_AddNumberToObject(descriptor.get(), "id", event_id);
+    cJSON_AddStringToObject(descriptor.get(), "name", "document read");
+    cJSON_AddStringToObject(
+            descriptor.get(), "description", "Document was read");
+    cJSON_AddFalseToObject(descriptor.get(), "sync");
+    cJSON_AddTrueToObject(descriptor.get(), "enabled");
+    audit.events[event_id] = new EventDescriptor(descriptor.get());
+
+    Event event(event_id, payload.data(), payload.size());
+    size_t batch = 0;
+    while (state.KeepRunning()) {
+        if (!event.process(audit)) {
+            state.SkipWithError("Failed to process the event");
+            break;
+        }
+        // The consumer flushes the file every time it drains the queue
+        if (++batch == 1000) {
+            audit.auditfile.flush();
+            batch = 0;
+        }
+    }
+    audit.auditfile.close();
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * payload.size());
+
+    audit.clear_events_map();
+    cb::io::rmrf(testdir);
+}
+
+BENCHMARK(AddEvents)->ThreadRange(1, 16);
+BENCHMARK(ProcessEvents);
+
+BENCHMARK_MAIN();
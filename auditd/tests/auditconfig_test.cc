@@ -267,6 +267,27 @@ TEST_F(AuditConfigTest, TestLegalBuffered) {
     EXPECT_NO_THROW(config.initialize_config(json));
 }
 
+// fsync_interval
+
+TEST_F(AuditConfigTest, TestNoFsyncInterval) {
+    // fsync_interval is optional, and disabled unless specified
+    EXPECT_NO_THROW(config.initialize_config(json));
+    EXPECT_EQ(0, config.get_fsync_interval());
+}
+
+TEST_F(AuditConfigTest, TestIllegalFsyncInterval) {
+    cJSON_AddStringToObject(json, "fsync_interval", "foobar");
+    EXPECT_THROW(config.initialize_config(json), std::string);
+    cJSON_ReplaceItemInObject(json, "fsync_interval", cJSON_CreateNumber(-1));
+    EXPECT_THROW(config.initialize_config(json), std::string);
+}
+
+TEST_F(AuditConfigTest, TestLegalFsyncInterval) {
+    cJSON_AddNumberToObject(json, "fsync_interval", 10);
+    EXPECT_NO_THROW(config.initialize_config(json));
+    EXPECT_EQ(10, config.get_fsync_interval());
+}
+
 // log_path
 TEST_F(AuditConfigTest, TestNoLogPath) {
     cJSON *obj = cJSON_DetachItemFromObject(json, "log_path");
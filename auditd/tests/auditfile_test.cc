@@ -21,9 +21,13 @@
 #include <map>
 #include <atomic>
 #include <cstring>
+#include <fstream>
 #include <time.h>
 #include <gtest/gtest.h>
 #include <platform/platform.h>
+#ifdef __linux__
+#include <unistd.h>
+#endif
 
 using cb::io::findFilesWithPrefix;
 
@@ -133,6 +137,69 @@ TEST_F(AuditFileTest, TestSizeRotate) {
     EXPECT_EQ(10, files.size());
 }
 
+/**
+ * Test that buffered events are batched up in memory and written to the
+ * file when it is flushed
+ */
+TEST_F(AuditFileTest, TestBufferedWrite) {
+    config.set_buffered(true);
+    config.set_fsync_interval(1);
+    AuditFile auditfile;
+    auditfile.reconfigure(config);
+
+    const std::string line(R"({"timestamp":"2015-03-13T02:36:00.000-07:00"})");
+    const std::string filename = testdir + "/audit.log";
+    ASSERT_TRUE(auditfile.ensure_open());
+    for (int ii = 0; ii < 10; ++ii) {
+        EXPECT_TRUE(auditfile.write_event_to_disk(line));
+    }
+
+    auto size = [&filename]() {
+        std::ifstream file(filename, std::ios::binary | std::ios::ate);
+        return size_t(file.tellg());
+    };
+    EXPECT_EQ(0, size());
+    EXPECT_TRUE(auditfile.flush());
+    EXPECT_EQ(10 * (line.size() + 1), size());
+
+    // The pending events are written before the file is rotated
+    EXPECT_TRUE(auditfile.write_event_to_disk(line));
+    auditfile.close();
+    auto files = findFilesWithPrefix(testdir + "/testing");
+    ASSERT_EQ(1, files.size());
+    std::ifstream file(files.front(), std::ios::binary | std::ios::ate);
+    EXPECT_EQ(11 * (line.size() + 1), size_t(file.tellg()));
+}
+
+#ifdef __linux__
+/**
+ * Test that a failure to write the buffered events when the file is
+ * rotated closes the file (rather than crashing)
+ */
+TEST_F(AuditFileTest, TestWriteErrorOnRotate) {
+    config.set_buffered(true);
+    AuditFile auditfile;
+    auditfile.reconfigure(config);
+
+    // Every write to /dev/full fails with ENOSPC
+    const std::string filename = testdir + "/audit.log";
+    ASSERT_EQ(0, symlink("/dev/full", filename.c_str()));
+
+    ASSERT_TRUE(auditfile.ensure_open());
+    EXPECT_TRUE(auditfile.write_event_to_disk(event));
+    EXPECT_FALSE(auditfile.flush());
+    EXPECT_FALSE(auditfile.is_open());
+
+    // The failing file was moved to the archive; fail the next one as well,
+    // this time while closing it
+    ASSERT_EQ(0, symlink("/dev/full", filename.c_str()));
+    ASSERT_TRUE(auditfile.ensure_open());
+    EXPECT_TRUE(auditfile.write_event_to_disk(event));
+    auditfile.close();
+    EXPECT_FALSE(auditfile.is_open());
+}
+#endif
+
 /**
  * Test that the time rollover starts from the time the file was
  * opened, and not from the instance was configured
@@ -203,6 +203,48 @@ TEST_F(UserTest, TestNormalInit) {
     }
 }
 
+TEST_F(UserTest, TestScramKeys) {
+    auto u = cb::sasl::UserFactory::create(root.get());
+
+    struct {
+        Mechanism mech;
+        cb::crypto::Algorithm algorithm;
+    } mechs[] = {{Mechanism::SCRAM_SHA1, cb::crypto::Algorithm::SHA1},
+                 {Mechanism::SCRAM_SHA256, cb::crypto::Algorithm::SHA256},
+                 {Mechanism::SCRAM_SHA512, cb::crypto::Algorithm::SHA512}};
+
+    const std::string clientKey{"Client Key"};
+    const std::string serverKey{"Server Key"};
+    for (const auto& m : mechs) {
+        const auto& md = u.getPassword(m.mech);
+        const std::vector<uint8_t> salted(md.getPassword().begin(),
+                                          md.getPassword().end());
+        auto ck = cb::crypto::HMAC(
+                m.algorithm,
+                salted,
+                std::vector<uint8_t>(clientKey.begin(), clientKey.end()));
+        EXPECT_EQ(cb::crypto::digest(m.algorithm, ck), md.getStoredKey());
+        EXPECT_EQ(cb::crypto::HMAC(m.algorithm,
+                                   salted,
+                                   std::vector<uint8_t>(serverKey.begin(),
+                                                        serverKey.end())),
+                  md.getServerKey());
+    }
+
+    // We don't use SCRAM keys for PLAIN
+    EXPECT_TRUE(u.getPassword(Mechanism::PLAIN).getStoredKey().empty());
+}
+
+TEST_F(UserTest, TestDummyHasScramKeys) {
+    auto u = cb::sasl::UserFactory::createDummy("unknown",
+                                                Mechanism::SCRAM_SHA512);
+    EXPECT_TRUE(u.isDummy());
+    const auto& md = u.getPassword(Mechanism::SCRAM_SHA512);
+    EXPECT_EQ(cb::crypto::SHA512_DIGEST_SIZE, md.getPassword().size());
+    EXPECT_EQ(cb::crypto::SHA512_DIGEST_SIZE, md.getStoredKey().size());
+    EXPECT_EQ(cb::crypto::SHA512_DIGEST_SIZE, md.getServerKey().size());
+}
+
 TEST_F(UserTest, TestNoPlaintext) {
     cJSON_DeleteItemFromObject(root.get(), "plain");
     cb::sasl::User u;
@@ -18,6 +18,8 @@
 #include "password_database.h"
 #include "pwconv.h"
 
+#include <map>
+#include <memory>
 #include <mutex>
 #include <platform/processclock.h>
 #include <platform/timeutils.h>
@@ -26,23 +28,56 @@
 class PasswordDatabaseManager {
 public:
     PasswordDatabaseManager()
-        : db(new cb::sasl::PasswordDatabase) {
+        : db(std::make_shared<cb::sasl::PasswordDatabase>()) {
 
     }
 
     void swap(std::unique_ptr<cb::sasl::PasswordDatabase>& ndb) {
-        std::lock_guard<std::mutex> lock(dbmutex);
-        db.swap(ndb);
+        std::shared_ptr<cb::sasl::PasswordDatabase> next(std::move(ndb));
+        std::atomic_store(&db, next);
+
+        // The users may have been added to the new database
+        std::lock_guard<std::mutex> lock(dummymutex);
+        dummies.clear();
     }
 
     cb::sasl::User find(const std::string& username) {
-        std::lock_guard<std::mutex> lock(dbmutex);
-        return db->find(username);
+        // Look up the user in a snapshot of the database so that the
+        // authentication threads don't serialize on a lock
+        auto current = std::atomic_load(&db);
+        return current->find(username);
+    }
+
+    cb::sasl::User findDummy(const std::string& username,
+                             const Mechanism& mech) {
+        const auto key = std::make_pair(mech, username);
+        {
+            std::lock_guard<std::mutex> lock(dummymutex);
+            auto iter = dummies.find(key);
+            if (iter != dummies.end()) {
+                return iter->second;
+            }
+        }
+
+        auto user = cb::sasl::UserFactory::createDummy(username, mech);
+
+        std::lock_guard<std::mutex> lock(dummymutex);
+        if (dummies.size() >= maxDummies) {
+            dummies.clear();
+        }
+        // Another thread may have created the dummy in the meantime, and
+        // we want all of them to use the same salt
+        return dummies.emplace(key, std::move(user)).first->second;
     }
 
 private:
-    std::mutex dbmutex;
-    std::unique_ptr<cb::sasl::PasswordDatabase> db;
+    /// Don't let clients trying random usernames use up all our memory
+    static const size_t maxDummies = 10000;
+
+    std::shared_ptr<cb::sasl::PasswordDatabase> db;
+
+    std::mutex dummymutex;
+    std::map<std::pair<Mechanism, std::string>, cb::sasl::User> dummies;
 };
 
 static PasswordDatabaseManager pwmgr;
@@ -58,6 +93,11 @@ bool find_user(const std::string& username, cb::sasl::User& user) {
     return !user.isDummy();
 }
 
+cb::sasl::User find_dummy_user(const std::string& username,
+                               const Mechanism& mech) {
+    return pwmgr.findDummy(username, mech);
+}
+
 cbsasl_error_t parse_user_db(const std::string content, bool file) {
     try {
         auto start = cb::ProcessClock::now();
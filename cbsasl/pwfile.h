@@ -28,6 +28,21 @@
  */
 bool find_user(const std::string& username, cb::sasl::User &user);
 
+/**
+ * Get the dummy user entry to use for a user which doesn't exist.
+ *
+ * The dummy entries are cached (until the password database is reloaded)
+ * so that we don't have to generate new secrets for every attempt, and
+ * so that the client is given the same salt every time it tries to
+ * authenticate as the unknown user (like it would for a real user).
+ *
+ * @param username the name of the unknown user
+ * @param mech the SCRAM mechanism used
+ * @return the dummy user object
+ */
+cb::sasl::User find_dummy_user(const std::string& username,
+                               const Mechanism& mech);
+
 cbsasl_error_t load_user_db(void);
 
 void free_user_ht(void);
@@ -231,11 +231,15 @@ static std::vector<uint8_t> string2vector(const std::string& str) {
  * ServerKey       := HMAC(SaltedPassword, "Server Key")
  * ServerSignature := HMAC(ServerKey, AuthMessage)
  */
-std::string ScramShaBackend::getServerSignature() {
+std::vector<uint8_t> ScramShaBackend::getServerKey() {
     std::vector<uint8_t> saltedPassword;
     getSaltedPassword(saltedPassword);
-    auto serverKey = cb::crypto::HMAC(algorithm, saltedPassword,
-                                      string2vector("Server Key"));
+    return cb::crypto::HMAC(algorithm, saltedPassword,
+                            string2vector("Server Key"));
+}
+
+std::string ScramShaBackend::getServerSignature() {
+    auto serverKey = getServerKey();
 
     std::string authMessage = getAuthMessage();
     auto serverSignature = cb::crypto::HMAC(algorithm, serverKey,
@@ -432,7 +436,7 @@ cbsasl_error_t ScramShaServerBackend::start(const char* input,
         logging::log(conn,
                      logging::Level::Debug,
                      "User [" + username + "] doesn't exist.. using dummy");
-        user = cb::sasl::UserFactory::createDummy(username, mechanism);
+        user = find_dummy_user(username, mechanism);
     }
 
     const auto& passwordMeta = user.getPassword(mechanism);
@@ -503,14 +507,14 @@ cbsasl_error_t ScramShaServerBackend::step(const char* input,
     (*output) = server_final_message.data();
     (*outputlen) = server_final_message.length();
 
-    std::string clientproof = iter->second;
-    std::string my_clientproof = Couchbase::Base64::encode(getClientProof());
-
-    int fail = cbsasl_secure_compare(clientproof.c_str(), clientproof.length(),
-                                     my_clientproof.c_str(),
-                                     my_clientproof.length()) ^user.isDummy();
+    bool valid;
+    try {
+        valid = verifyClientProof(Couchbase::Base64::decode(iter->second));
+    } catch (const std::invalid_argument&) {
+        valid = false;
+    }
 
-    if (fail != 0) {
+    if (!valid || user.isDummy()) {
         if (user.isDummy()) {
             logging::log(conn,
                          logging::Level::Fail,
@@ -528,6 +532,27 @@ cbsasl_error_t ScramShaServerBackend::step(const char* input,
     return CBSASL_OK;
 }
 
+bool ScramShaServerBackend::verifyClientProof(const std::string& proof) {
+    const auto& storedKey = user.getPassword(mechanism).getStoredKey();
+    auto clientSignature = cb::crypto::HMAC(algorithm, storedKey,
+                                            string2vector(getAuthMessage()));
+    if (proof.size() != clientSignature.size()) {
+        return false;
+    }
+
+    // ClientKey is ClientProof XOR ClientSignature
+    std::vector<uint8_t> clientKey(proof.size());
+    for (size_t ii = 0; ii < clientKey.size(); ++ii) {
+        clientKey[ii] = uint8_t(proof[ii]) ^ clientSignature[ii];
+    }
+
+    const auto key = cb::crypto::digest(algorithm, clientKey);
+    return cbsasl_secure_compare(reinterpret_cast<const char*>(key.data()),
+                                 key.size(),
+                                 reinterpret_cast<const char*>(storedKey.data()),
+                                 storedKey.size()) == 0;
+}
+
 /********************************************************************
  * Client API
  *******************************************************************/
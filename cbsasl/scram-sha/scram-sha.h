@@ -90,6 +90,12 @@ protected:
 
     virtual void getSaltedPassword(std::vector<uint8_t>& dest) = 0;
 
+    /**
+     * Get the ServerKey (derived from the salted password unless
+     * overridden)
+     */
+    virtual std::vector<uint8_t> getServerKey();
+
     /**
      * Get the AUTH message (as specified in the RFC)
      */
@@ -138,6 +144,23 @@ public:
         std::copy(pw.begin(), pw.end(), std::back_inserter(dest));
     }
 
+    std::vector<uint8_t> getServerKey() override {
+        return user.getPassword(mechanism).getServerKey();
+    }
+
+    /**
+     * Verify the proof provided by the client by using the StoredKey
+     * in the password database:
+     *
+     *     ClientSignature := HMAC(StoredKey, AuthMessage)
+     *     ClientKey       := ClientProof XOR ClientSignature
+     *     H(ClientKey) must match StoredKey
+     *
+     * @param proof the (decoded) client proof
+     * @return true if the proof is valid
+     */
+    bool verifyClientProof(const std::string& proof);
+
     cb::sasl::User user;
 };
 
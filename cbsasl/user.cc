@@ -45,6 +45,26 @@ void generateSalt(std::vector<uint8_t>& bytes, std::string& salt) {
                               bytes.size()));
 }
 
+/**
+ * Get the algorithm used by the SCRAM mechanism
+ *
+ * @throws std::logic_error if mech isn't a SCRAM mechanism
+ */
+static cb::crypto::Algorithm toAlgorithm(const Mechanism& mech) {
+    switch (mech) {
+    case Mechanism::SCRAM_SHA512:
+        return cb::crypto::Algorithm::SHA512;
+    case Mechanism::SCRAM_SHA256:
+        return cb::crypto::Algorithm::SHA256;
+    case Mechanism::SCRAM_SHA1:
+        return cb::crypto::Algorithm::SHA1;
+    case Mechanism::PLAIN:
+    case Mechanism::UNKNOWN:
+        break;
+    }
+    throw std::logic_error("cb::cbsasl::toAlgorithm: invalid mechanism");
+}
+
 cb::sasl::User cb::sasl::UserFactory::create(const std::string& unm,
                                                const std::string& passwd) {
     User ret{unm, false};
@@ -93,7 +113,6 @@ cb::sasl::User cb::sasl::UserFactory::createDummy(const std::string& unm,
     User ret{unm};
 
     std::vector<uint8_t> salt;
-    std::string passwd;
 
     switch (mech) {
     case Mechanism::SCRAM_SHA512:
@@ -114,11 +133,24 @@ cb::sasl::User cb::sasl::UserFactory::createDummy(const std::string& unm,
         throw std::logic_error("cb::cbsasl::UserFactory::createDummy invalid algorithm");
     }
 
-    // Generate a random password
-    generateSalt(salt, passwd);
+    std::string encodedSalt;
+    generateSalt(salt, encodedSalt);
 
-    // Generate the secrets by using that random password
-    ret.generateSecrets(mech, passwd);
+    // Nobody knows the password of the dummy user, so there is no point
+    // in running PBKDF2 on a random password (it would only burn CPU
+    // and make the dummy users slower than the real users). Use a
+    // random salted password instead.
+    std::vector<uint8_t> saltedPassword(salt.size());
+    std::string unused;
+    generateSalt(saltedPassword, unused);
+
+    auto& meta = ret.password[mech];
+    meta = User::PasswordMetaData(
+            std::string(reinterpret_cast<const char*>(saltedPassword.data()),
+                        saltedPassword.size()),
+            encodedSalt,
+            IterationCount);
+    meta.generateScramKeys(toAlgorithm(mech));
 
     return ret;
 }
@@ -164,6 +196,7 @@ cb::sasl::User cb::sasl::UserFactory::create(const cJSON* obj) {
         }
     }
 
+    ret.generateScramKeys();
     return ret;
 }
 
@@ -196,20 +229,16 @@ void cb::sasl::User::generateSecrets(const Mechanism& mech,
 
     std::vector<uint8_t> salt;
     std::string encodedSalt;
-    cb::crypto::Algorithm algorithm;
 
     switch (mech) {
     case Mechanism::SCRAM_SHA512:
         salt.resize(cb::crypto::SHA512_DIGEST_SIZE);
-        algorithm = cb::crypto::Algorithm::SHA512;
         break;
     case Mechanism::SCRAM_SHA256:
         salt.resize(cb::crypto::SHA256_DIGEST_SIZE);
-        algorithm = cb::crypto::Algorithm::SHA256;
         break;
     case Mechanism::SCRAM_SHA1:
         salt.resize(cb::crypto::SHA1_DIGEST_SIZE);
-        algorithm = cb::crypto::Algorithm::SHA1;
         break;
     case Mechanism::PLAIN:
     case Mechanism::UNKNOWN:
@@ -220,12 +249,22 @@ void cb::sasl::User::generateSecrets(const Mechanism& mech,
         throw std::logic_error("cb::cbsasl::User::generateSecrets invalid algorithm");
     }
 
+    const auto algorithm = toAlgorithm(mech);
     generateSalt(salt, encodedSalt);
     auto digest = cb::crypto::PBKDF2_HMAC(algorithm, passwd, salt, IterationCount);
 
     password[mech] =
         PasswordMetaData(std::string((const char*)digest.data(), digest.size()),
                          encodedSalt, IterationCount);
+    password[mech].generateScramKeys(algorithm);
+}
+
+void cb::sasl::User::generateScramKeys() {
+    for (auto& entry : password) {
+        if (entry.first != Mechanism::PLAIN) {
+            entry.second.generateScramKeys(toAlgorithm(entry.first));
+        }
+    }
 }
 
 cb::sasl::User::PasswordMetaData::PasswordMetaData(cJSON* obj) {
@@ -274,6 +313,24 @@ cb::sasl::User::PasswordMetaData::PasswordMetaData(cJSON* obj) {
     }
 }
 
+void cb::sasl::User::PasswordMetaData::generateScramKeys(
+        cb::crypto::Algorithm algorithm) {
+    const std::vector<uint8_t> saltedPassword(password.begin(),
+                                              password.end());
+    const std::string clientKeyLabel{"Client Key"};
+    const std::string serverKeyLabel{"Server Key"};
+
+    const auto clientKey = cb::crypto::HMAC(
+            algorithm,
+            saltedPassword,
+            std::vector<uint8_t>(clientKeyLabel.begin(), clientKeyLabel.end()));
+    storedKey = cb::crypto::digest(algorithm, clientKey);
+    serverKey = cb::crypto::HMAC(
+            algorithm,
+            saltedPassword,
+            std::vector<uint8_t>(serverKeyLabel.begin(), serverKeyLabel.end()));
+}
+
 cJSON* cb::sasl::User::PasswordMetaData::to_json() const {
     auto* ret = cJSON_CreateObject();
     std::string s((char*)password.data(), password.size());
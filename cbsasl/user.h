@@ -94,6 +94,29 @@ public:
             return iteration_count;
         }
 
+        /**
+         * Derive the SCRAM keys from the (salted) password:
+         *
+         *     ClientKey := HMAC(SaltedPassword, "Client Key")
+         *     StoredKey := H(ClientKey)
+         *     ServerKey := HMAC(SaltedPassword, "Server Key")
+         *
+         * The keys only depend on the password, salt and iteration
+         * count, so we derive them once when the user is created instead
+         * of for every authentication attempt.
+         *
+         * @param algorithm the algorithm used by the SCRAM mechanism
+         */
+        void generateScramKeys(cb::crypto::Algorithm algorithm);
+
+        const std::vector<uint8_t>& getStoredKey() const {
+            return storedKey;
+        }
+
+        const std::vector<uint8_t>& getServerKey() const {
+            return serverKey;
+        }
+
     private:
         // Base 64 encoded version of the salt
         std::string salt;
@@ -103,6 +126,10 @@ public:
 
         // The iteration count used for generating the password
         int iteration_count;
+
+        // The SCRAM keys derived from the password (empty for PLAIN)
+        std::vector<uint8_t> storedKey;
+        std::vector<uint8_t> serverKey;
     };
 
     /**
@@ -162,6 +189,12 @@ protected:
 
     void generateSecrets(const Mechanism& mech, const std::string& passwd);
 
+    /**
+     * Derive the SCRAM keys for all of the SCRAM mechanisms we've got
+     * password metadata for
+     */
+    void generateScramKeys();
+
     std::map<Mechanism, PasswordMetaData> password;
 
     std::string username;
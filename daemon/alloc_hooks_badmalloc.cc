@@ -230,3 +230,23 @@ bool mc_get_allocator_property(const char* name, size_t* value) {
 bool mc_set_allocator_property(const char* name, size_t value) {
     return false;
 }
+
+allocation_utilization_t mc_get_allocation_utilization(const void* ptr) {
+    return ALLOCATION_UTILIZATION_UNKNOWN;
+}
+
+bool mc_acquire_arena(unsigned* arena) {
+    return false;
+}
+
+void mc_release_arena(unsigned arena) {
+    // empty
+}
+
+bool mc_set_thread_arena(unsigned arena, bool flush_thread_cache) {
+    return false;
+}
+
+bool mc_get_arena_allocated(unsigned arena, size_t* allocated) {
+    return false;
+}
@@ -80,3 +80,25 @@ int DummyAllocHooks::set_allocator_property(const char* name,
                                             size_t newlen) {
     return 1;
 }
+
+allocation_utilization_t DummyAllocHooks::get_allocation_utilization(
+        const void* ptr) {
+    return ALLOCATION_UTILIZATION_UNKNOWN;
+}
+
+bool DummyAllocHooks::acquire_arena(unsigned* arena) {
+    return false;
+}
+
+void DummyAllocHooks::release_arena(unsigned arena) {
+    // empty
+}
+
+bool DummyAllocHooks::set_thread_arena(unsigned arena,
+                                       bool flush_thread_cache) {
+    return false;
+}
+
+bool DummyAllocHooks::get_arena_allocated(unsigned arena, size_t* allocated) {
+    return false;
+}
@@ -33,6 +33,10 @@
 #include <malloc.h>
 #endif
 
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
 /* jemalloc checks for this symbol, and it's contents for the config to use. */
 const char* je_malloc_conf =
         /* Use just one arena, instead of the default based on number of CPUs.
@@ -47,6 +51,12 @@ static int jemalloc_get_stats_prop(const char* property, size_t* value) {
     return je_mallctl(property, value, &size, NULL, 0);
 }
 
+/* Arenas released by buckets, ready to be handed out again (jemalloc
+ * arenas created with arenas.create can't safely be destroyed while other
+ * threads' caches may still hold memory from them). */
+static std::mutex free_arenas_mutex;
+static std::vector<unsigned> free_arenas;
+
 struct write_state {
     char* buffer;
     int remaining;
@@ -204,3 +214,149 @@ int JemallocHooks::set_allocator_property(const char* name,
                                           size_t newlen) {
     return je_mallctl(name, nullptr, 0, newp, newlen);
 }
+
+allocation_utilization_t JemallocHooks::get_allocation_utilization(
+        const void* ptr) {
+    // Layout of the result of "experimental.utilization.query" (jemalloc
+    // 5.2+). Older versions don't have the query, in which case we report
+    // that we can't tell.
+    struct {
+        size_t nfree; // free regions in the slab holding ptr
+        size_t nregs; // total regions in the slab holding ptr
+        size_t size; // size of each region
+        size_t bin_nfree; // free regions in all the slabs of the bin
+        size_t bin_nregs; // total regions in all the slabs of the bin
+        void* slabcur_addr; // the slab the bin currently allocates from
+    } util;
+
+    // Looking up the MIB once saves parsing the name on every call.
+    static size_t mib[3];
+    static size_t miblen = sizeof(mib) / sizeof(mib[0]);
+    static const bool haveQuery =
+            je_mallctlnametomib("experimental.utilization.query",
+                                mib,
+                                &miblen) == 0;
+    if (!haveQuery) {
+        return ALLOCATION_UTILIZATION_UNKNOWN;
+    }
+
+    size_t sz = sizeof(util);
+    if (je_mallctlbymib(mib, miblen, &util, &sz, &ptr, sizeof(ptr)) != 0) {
+        return ALLOCATION_UTILIZATION_UNKNOWN;
+    }
+
+    // Large allocations (a single region) and allocations on full slabs
+    // wouldn't free anything by being moved.
+    if (util.nregs <= 1 || util.nfree == 0) {
+        return ALLOCATION_UTILIZATION_DENSE;
+    }
+
+    // Moving an allocation off the slab the bin is currently allocating from
+    // would just put it back on the same slab.
+    const auto* slab = static_cast<const char*>(util.slabcur_addr);
+    const auto* p = static_cast<const char*>(ptr);
+    if (slab && p >= slab && p < slab + (util.nregs * util.size)) {
+        return ALLOCATION_UTILIZATION_DENSE;
+    }
+
+    // Sparse if this slab has a greater fraction of free regions than the
+    // bin as a whole (nfree / nregs > bin_nfree / bin_nregs).
+    if (util.nfree * util.bin_nregs > util.bin_nfree * util.nregs) {
+        return ALLOCATION_UTILIZATION_SPARSE;
+    }
+    return ALLOCATION_UTILIZATION_DENSE;
+}
+
+bool JemallocHooks::acquire_arena(unsigned* arena) {
+    {
+        std::lock_guard<std::mutex> guard(free_arenas_mutex);
+        if (!free_arenas.empty()) {
+            *arena = free_arenas.back();
+            free_arenas.pop_back();
+            return true;
+        }
+    }
+
+    size_t len = sizeof(*arena);
+    int err = je_mallctl("arenas.create", arena, &len, NULL, 0);
+    if (err != 0) {
+        get_stderr_logger()->log(EXTENSION_LOG_WARNING, NULL,
+                                 "jemalloc_acquire_arena() error %d - "
+                                     "could not create arena.", err);
+        return false;
+    }
+    return true;
+}
+
+void JemallocHooks::release_arena(unsigned arena) {
+    size_t mib[3]; /* Components in "arena.0.purge" MIB. */
+    size_t miblen = sizeof(mib) / sizeof(mib[0]);
+    int err = je_mallctlnametomib("arena.0.purge", mib, &miblen);
+    if (err == 0) {
+        mib[1] = arena;
+        err = je_mallctlbymib(mib, miblen, NULL, 0, NULL, 0);
+    }
+    if (err != 0) {
+        get_stderr_logger()->log(EXTENSION_LOG_WARNING, NULL,
+                                 "jemalloc_release_arena() error %d - "
+                                     "could not purge arena %u.", err, arena);
+    }
+
+    std::lock_guard<std::mutex> guard(free_arenas_mutex);
+    free_arenas.push_back(arena);
+}
+
+bool JemallocHooks::set_thread_arena(unsigned arena, bool flush_thread_cache) {
+    // Called whenever a thread switches bucket, so look the MIB up once.
+    static size_t mib[2];
+    static size_t miblen = sizeof(mib) / sizeof(mib[0]);
+    static const bool haveMib =
+            je_mallctlnametomib("thread.arena", mib, &miblen) == 0;
+    if (!haveMib) {
+        return false;
+    }
+
+    if (flush_thread_cache) {
+        // Fails if the thread cache is disabled, in which case there's
+        // nothing to flush anyway.
+        je_mallctl("thread.tcache.flush", NULL, NULL, NULL, 0);
+    }
+    return je_mallctlbymib(mib, miblen, NULL, NULL, &arena, sizeof(arena)) ==
+           0;
+}
+
+bool JemallocHooks::get_arena_allocated(unsigned arena, size_t* allocated) {
+    static size_t smallMib[5];
+    static size_t smallMiblen = sizeof(smallMib) / sizeof(smallMib[0]);
+    static size_t largeMib[5];
+    static size_t largeMiblen = sizeof(largeMib) / sizeof(largeMib[0]);
+    static const bool haveMibs =
+            je_mallctlnametomib("stats.arenas.0.small.allocated",
+                                smallMib,
+                                &smallMiblen) == 0 &&
+            je_mallctlnametomib("stats.arenas.0.large.allocated",
+                                largeMib,
+                                &largeMiblen) == 0;
+    if (!haveMibs) {
+        return false;
+    }
+
+    // Copy the MIBs as the arena index differs between the callers
+    size_t mib[5];
+    size_t small = 0;
+    size_t large = 0;
+    size_t len = sizeof(size_t);
+    std::copy(smallMib, smallMib + smallMiblen, mib);
+    mib[2] = arena;
+    if (je_mallctlbymib(mib, smallMiblen, &small, &len, NULL, 0) != 0) {
+        return false;
+    }
+    std::copy(largeMib, largeMib + largeMiblen, mib);
+    mib[2] = arena;
+    len = sizeof(size_t);
+    if (je_mallctlbymib(mib, largeMiblen, &large, &len, NULL, 0) != 0) {
+        return false;
+    }
+    *allocated = small + large;
+    return true;
+}
@@ -151,7 +151,7 @@ public:
     /**
      * Statistics vector, one per front-end thread.
      */
-    std::vector<thread_stats> stats;
+    std::vector<cb::CachelinePadded<thread_stats>> stats;
 
     /**
      * Command timing data
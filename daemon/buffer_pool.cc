@@ -0,0 +1,77 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2018 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include "buffer_pool.h"
+
+#include <stdexcept>
+
+const std::array<size_t, PipePool::NumSizeClasses> PipePool::SizeClasses = {
+        {2048, 16 * 1024, 128 * 1024}};
+
+std::unique_ptr<cb::Pipe> PipePool::get() {
+    for (auto& pool : pools) {
+        if (!pool.empty()) {
+            auto ret = std::move(pool.back());
+            pool.pop_back();
+            count.fetch_sub(1, std::memory_order_relaxed);
+            bytes.fetch_sub(ret->capacity(), std::memory_order_relaxed);
+            return ret;
+        }
+    }
+
+    return {};
+}
+
+std::unique_ptr<cb::Pipe> PipePool::allocate() {
+    return std::make_unique<cb::Pipe>(SizeClasses.front());
+}
+
+bool PipePool::put(std::unique_ptr<cb::Pipe> pipe) {
+    if (!pipe) {
+        return false;
+    }
+
+    if (!pipe->empty()) {
+        throw std::logic_error("PipePool::put: the buffer is not empty");
+    }
+
+    const auto capacity = pipe->capacity();
+    for (size_t ii = 0; ii < SizeClasses.size(); ++ii) {
+        if (capacity <= SizeClasses[ii]) {
+            auto& pool = pools[ii];
+            if (pool.size() >= maxPerClass) {
+                return false;
+            }
+            pipe->clear();
+            pool.push_back(std::move(pipe));
+            count.fetch_add(1, std::memory_order_relaxed);
+            bytes.fetch_add(capacity, std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    // Bigger than the largest size class; let it go so that we don't
+    // keep an oversized buffer around forever
+    return false;
+}
+
+void PipePool::clear() {
+    for (auto& pool : pools) {
+        pool.clear();
+    }
+    count.store(0, std::memory_order_relaxed);
+    bytes.store(0, std::memory_order_relaxed);
+}
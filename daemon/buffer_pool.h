@@ -0,0 +1,104 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2018 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+
+#include <platform/pipe.h>
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+/**
+ * The PipePool keeps a small number of spare network buffers for a
+ * worker thread. The connections served by the thread borrow a buffer
+ * from the pool while they're running, and give it back once it is
+ * empty (see conn_loan_buffers / conn_return_buffers).
+ *
+ * The buffers are kept in size classes based on their capacity, and
+ * a buffer which has grown beyond the largest size class (or which
+ * would exceed the number of buffers we keep per class) is released
+ * when it is returned. This means that a connection which once had to
+ * receive (or send) a huge value doesn't keep the memory around once
+ * it goes idle.
+ *
+ * The pool itself is only accessed from the thread owning it, but the
+ * occupancy counters may be read from other threads (for stats).
+ */
+class PipePool {
+public:
+    /**
+     * The upper bound of the capacity for each of the size classes. The
+     * first one is the initial size of newly allocated buffers.
+     */
+    static const size_t NumSizeClasses = 3;
+    static const std::array<size_t, NumSizeClasses> SizeClasses;
+
+    /// The default number of buffers to keep in each size class
+    static const size_t DefaultMaxPerClass = 4;
+
+    struct Stats {
+        /// The number of buffers currently held by the pool
+        size_t count;
+        /// The number of bytes currently held by the pool
+        size_t bytes;
+    };
+
+    explicit PipePool(size_t maxPerClass = DefaultMaxPerClass)
+        : maxPerClass(maxPerClass) {
+    }
+
+    /**
+     * Get a buffer from the pool. The smallest available buffer is
+     * returned as it is most likely to be returned shortly.
+     *
+     * @return a buffer or nullptr if the pool is empty
+     */
+    std::unique_ptr<cb::Pipe> get();
+
+    /**
+     * Allocate a new buffer (of the smallest size class)
+     *
+     * @throws std::bad_alloc
+     */
+    static std::unique_ptr<cb::Pipe> allocate();
+
+    /**
+     * Give the buffer back to the pool. The buffer is released if
+     * it is bigger than the largest size class, or if there is no room
+     * left in its size class.
+     *
+     * @param pipe the buffer to return (must be empty)
+     * @return true if the buffer was kept in the pool, false if it
+     *         was released
+     */
+    bool put(std::unique_ptr<cb::Pipe> pipe);
+
+    /// Release all of the buffers in the pool
+    void clear();
+
+    Stats getStats() const {
+        return {count.load(std::memory_order_relaxed),
+                bytes.load(std::memory_order_relaxed)};
+    }
+
+protected:
+    const size_t maxPerClass;
+    std::array<std::vector<std::unique_ptr<cb::Pipe>>, NumSizeClasses> pools;
+    std::atomic<size_t> count{0};
+    std::atomic<size_t> bytes{0};
+};
@@ -29,6 +29,7 @@
 #include <platform/strerror.h>
 #include <platform/timeutils.h>
 #include <utilities/protocol2text.h>
+#include <algorithm>
 #include <cctype>
 #include <exception>
 
@@ -709,14 +710,18 @@ void McbpConnection::addIov(const void* buf, size_t len) {
     m->msg_iovlen++;
 }
 
-void McbpConnection::ensureIovSpace() {
-    if (iovused < iov.size()) {
+void McbpConnection::ensureIovSpace(size_t count) {
+    if (iovused + count <= iov.size()) {
         // There is still size in the list
         return;
     }
 
-    // Try to double the size of the array
-    iov.resize(iov.size() * 2);
+    // Try to double the size of the array until it fits
+    auto size = std::max(iov.size() * 2, size_t(IOV_LIST_INITIAL));
+    while (size < iovused + count) {
+        size *= 2;
+    }
+    iov.resize(size);
 
     /* Point all the msghdr structures at the new list. */
     size_t ii;
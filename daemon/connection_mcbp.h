@@ -337,6 +337,19 @@ public:
      */
     void addIov(const void* buf, size_t len);
 
+    /**
+     * Make sure that the IO vector has room for at least the requested
+     * number of additional entries so that a response built from many
+     * fragments grows the vector (and rebases the message headers)
+     * at most once.
+     *
+     * @param count the number of entries the caller is about to add
+     * @throws std::bad_alloc
+     */
+    void reserveIov(size_t count) {
+        ensureIovSpace(count);
+    }
+
     /**
      * Release all of the items we've saved a reference to
      */
@@ -706,12 +719,12 @@ protected:
     SslContext ssl;
 
     /**
-     * Ensures that there is room for another struct iovec in a connection's
-     * iov list.
+     * Ensures that there is room for another count struct iovec's in a
+     * connection's iov list.
      *
      * @throws std::bad_alloc
      */
-    void ensureIovSpace();
+    void ensureIovSpace(size_t count = 1);
 
     /**
      * Read data over the SSL connection
@@ -47,10 +47,10 @@ enum class BufferLoan {
 /** Function prototypes ******************************************************/
 
 static BufferLoan loan_single_buffer(McbpConnection& c,
-                                     std::unique_ptr<cb::Pipe>& thread_buf,
+                                     PipePool& pool,
                                      std::unique_ptr<cb::Pipe>& conn_buf);
 static void maybe_return_single_buffer(McbpConnection& c,
-                                       std::unique_ptr<cb::Pipe>& thread_buf,
+                                       PipePool& pool,
                                        std::unique_ptr<cb::Pipe>& conn_buf);
 static void conn_destructor(Connection *c);
 static Connection *allocate_connection(SOCKET sfd,
@@ -260,8 +260,7 @@ void conn_close(McbpConnection& connection) {
     connection.read->clear();
     connection.write->clear();
     /* Return any buffers back to the thread; before we disassociate the
-     * connection from the thread. Note we clear DCP status first, so
-     * conn_return_buffers() will actually free the buffers.
+     * connection from the thread.
      */
     connection.setDCP(false);
     conn_return_buffers(&connection);
@@ -360,11 +359,11 @@ void conn_return_buffers(Connection *connection) {
         return;
     }
 
-    if (c->isDCP()) {
-        // DCP work differently - let them keep their buffers once allocated.
-        return;
-    }
-
+    // DCP connections used to keep their buffers once allocated, but
+    // an idle stream has nothing in its buffers so we may give them
+    // back to the pool the same way as for any other connection. Any
+    // (partial) data still waiting to be sent or parsed keeps the buffer
+    // in the connection.
     maybe_return_single_buffer(*c, thread->read, c->read);
     maybe_return_single_buffer(*c, thread->write, c->write);
 }
@@ -453,22 +452,23 @@ static void release_connection(Connection *c) {
  * necessary.
  */
 static BufferLoan loan_single_buffer(McbpConnection& c,
-                                     std::unique_ptr<cb::Pipe>& thread_buf,
+                                     PipePool& pool,
                                      std::unique_ptr<cb::Pipe>& conn_buf) {
     /* Already have a (partial) buffer - nothing to do. */
     if (conn_buf) {
         return BufferLoan::Existing;
     }
 
-    // If the thread has a buffer, let's loan that to the connection
-    if (thread_buf) {
-        thread_buf.swap(conn_buf);
+    // If the thread has a buffer in its pool, let's loan that to the
+    // connection
+    conn_buf = pool.get();
+    if (conn_buf) {
         return BufferLoan::Loaned;
     }
 
     // Need to allocate a new buffer
     try {
-        conn_buf = std::make_unique<cb::Pipe>(DATA_BUFFER_SIZE);
+        conn_buf = PipePool::allocate();
     } catch (const std::bad_alloc&) {
         // Unable to alloc a buffer for the thread. Not much we can do here
         // other than terminate the current connection.
@@ -486,16 +486,12 @@ static BufferLoan loan_single_buffer(McbpConnection& c,
 }
 
 static void maybe_return_single_buffer(McbpConnection& c,
-                                       std::unique_ptr<cb::Pipe>& thread_buf,
+                                       PipePool& pool,
                                        std::unique_ptr<cb::Pipe>& conn_buf) {
     if (conn_buf && conn_buf->empty()) {
-        // Buffer clean, dispose of it
-        if (thread_buf) {
-            // Already got a thread buffer.. release this one
-            conn_buf.reset();
-        } else {
-            conn_buf.swap(thread_buf);
-        }
+        // Buffer clean, hand it back to the pool (which releases it if
+        // it has grown too big or the pool is already full)
+        pool.put(std::move(conn_buf));
     }
 }
 
@@ -95,7 +95,11 @@ void conn_close(McbpConnection& connection);
 
 /**
  * Return the TCP or domain socket listening_port structure that
- * has a given port number
+ * has a given port number.
+ *
+ * The caller must hold the stats_mutex while looking up the port. The
+ * returned pointer stays valid (see stats::listening_ports), so the
+ * connection counters of the port may be updated after releasing it.
  */
 ListeningPort *get_listening_port_instance(const in_port_t port);
 
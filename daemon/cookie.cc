@@ -299,6 +299,25 @@ void Cookie::sendResponse(cb::mcbp::Status status,
                           cb::const_char_buffer value,
                           cb::mcbp::Datatype datatype,
                           uint64_t cas) {
+    sendResponse(status, extras, key, value, datatype, cas, true);
+}
+
+void Cookie::sendResponseZeroCopy(cb::mcbp::Status status,
+                                  cb::const_char_buffer extras,
+                                  cb::const_char_buffer key,
+                                  cb::const_char_buffer value,
+                                  cb::mcbp::Datatype datatype,
+                                  uint64_t cas) {
+    sendResponse(status, extras, key, value, datatype, cas, false);
+}
+
+void Cookie::sendResponse(cb::mcbp::Status status,
+                          cb::const_char_buffer extras,
+                          cb::const_char_buffer key,
+                          cb::const_char_buffer value,
+                          cb::mcbp::Datatype datatype,
+                          uint64_t cas,
+                          bool copyValue) {
     if (!connection.write->empty()) {
         // We can't continue as we might already have references
         // in the IOvector stack pointing into the existing buffer!
@@ -330,8 +349,10 @@ void Cookie::sendResponse(cb::mcbp::Status status,
                                  : cb::mcbp::Datatype::JSON;
     }
 
-    const size_t needed = sizeof(cb::mcbp::Header) + value.size() + key.size() +
-                          extras.size();
+    // Note that the error JSON lives in the cookie until the next command
+    // starts, so it is safe to reference it if copyValue isn't set
+    const size_t needed = sizeof(cb::mcbp::Header) + key.size() +
+                          extras.size() + (copyValue ? value.size() : 0);
     connection.write->ensureCapacity(needed);
 
     mcbp_add_header(*this,
@@ -358,10 +379,14 @@ void Cookie::sendResponse(cb::mcbp::Status status,
     }
 
     if (!value.empty()) {
-        auto wdata = connection.write->wdata();
-        std::copy(value.begin(), value.end(), wdata.begin());
-        connection.write->produced(value.size());
-        connection.addIov(wdata.data(), value.size());
+        if (copyValue) {
+            auto wdata = connection.write->wdata();
+            std::copy(value.begin(), value.end(), wdata.begin());
+            connection.write->produced(value.size());
+            connection.addIov(wdata.data(), value.size());
+        } else {
+            connection.addIov(value.data(), value.size());
+        }
     }
 
     connection.setState(McbpStateMachine::State::send_data);
@@ -383,6 +383,29 @@ public:
                       cb::mcbp::Datatype datatype,
                       uint64_t cas);
 
+    /**
+     * Form a response packet and send back to the client, but let the
+     * IO vector reference the value instead of copying it into the
+     * connections write buffer (extras and key are still copied as
+     * they're small).
+     *
+     * The caller must ensure that the memory backing the value stays
+     * valid until the response is transmitted. Memory owned by the
+     * command context (or an item reserved through
+     * McbpConnection::reserveItem) satisfies that as the command context
+     * isn't released before we start processing the next command.
+     *
+     * @throws std::bad_alloc for memory alloction failures
+     * @throws std::runtime_error if unsupported datatypes is being used
+     * @throws std::logic_error if the write buffer contains data
+     */
+    void sendResponseZeroCopy(cb::mcbp::Status status,
+                              cb::const_char_buffer extras,
+                              cb::const_char_buffer key,
+                              cb::const_char_buffer value,
+                              cb::mcbp::Datatype datatype,
+                              uint64_t cas);
+
     /**
      * Get the command context stored for this command as
      * the given type or make it if it doesn't exist
@@ -440,12 +463,47 @@ public:
         enableTracing = enable;
     }
 
+    /**
+     * Was this request picked by the head-based sampling (see
+     * Settings::getTracingSampleRate) to record its spans? Unlike when
+     * the client enabled tracing the trace isn't returned to the client,
+     * it is only used for the slow trace log.
+     */
+    bool isTraceSampled() const {
+        return traceSampled;
+    }
+
+    void setTraceSampled(bool sampled) {
+        traceSampled = sampled;
+    }
+
+    /**
+     * Should spans be recorded for this request
+     */
+    bool isRecordingSpans() const {
+        return enableTracing || traceSampled;
+    }
+
     cb::tracing::Tracer& getTracer() {
         return tracer;
     }
 
 protected:
+    /**
+     * Build the response packet. The extras and key are always copied
+     * into the write buffer, whereas the value is only copied if
+     * copyValue is set (otherwise the IO vector references it directly)
+     */
+    void sendResponse(cb::mcbp::Status status,
+                      cb::const_char_buffer extras,
+                      cb::const_char_buffer key,
+                      cb::const_char_buffer value,
+                      cb::mcbp::Datatype datatype,
+                      uint64_t cas,
+                      bool copyValue);
+
     bool enableTracing = false;
+    bool traceSampled = false;
     cb::tracing::Tracer tracer;
 
     /**
@@ -0,0 +1,197 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2018 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "hdr_histogram.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+const double HdrHistogram::percentiles[] = {
+        50.0, 90.0, 95.0, 99.0, 99.9, 99.99, 100.0};
+
+/// Get the number of bits needed to represent the (non-zero) value
+static inline int bitLength(uint64_t value) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return int(index) + 1;
+#else
+    return 64 - __builtin_clzll(value);
+#endif
+}
+
+HdrHistogram::HdrHistogram(int significantFigures,
+                           uint64_t highestTrackableValue)
+    : significantFigures(significantFigures),
+      highestTrackableValue(highestTrackableValue),
+      total(0) {
+    if (significantFigures < 1 || significantFigures > 3) {
+        throw std::invalid_argument(
+                "HdrHistogram: significantFigures must be in the range 1-3 "
+                "(was " +
+                std::to_string(significantFigures) + ")");
+    }
+
+    // We need single unit resolution up to 2 * 10^significantFigures to
+    // keep the requested number of significant figures for all values
+    const auto singleUnitResolution =
+            uint64_t(2 * std::pow(10, significantFigures));
+    subBucketBits = bitLength(singleUnitResolution - 1);
+    subBucketMask = (uint64_t(1) << subBucketBits) - 1;
+    subBucketHalfCount = size_t(1) << (subBucketBits - 1);
+
+    if (highestTrackableValue < 2 * singleUnitResolution) {
+        throw std::invalid_argument(
+                "HdrHistogram: highestTrackableValue is too small");
+    }
+
+    const auto buckets =
+            bitLength(highestTrackableValue | subBucketMask) - subBucketBits;
+    countsLen = size_t(buckets + 2) * subBucketHalfCount;
+    counts.reset(new std::atomic<uint32_t>[countsLen]);
+    reset();
+}
+
+HdrHistogram::HdrHistogram(const HdrHistogram& other)
+    : HdrHistogram(other.significantFigures, other.highestTrackableValue) {
+    *this += other;
+}
+
+HdrHistogram& HdrHistogram::operator+=(const HdrHistogram& other) {
+    if (significantFigures != other.significantFigures ||
+        highestTrackableValue != other.highestTrackableValue) {
+        throw std::invalid_argument(
+                "HdrHistogram::operator+=: can't merge histograms with "
+                "different configuration");
+    }
+
+    for (size_t ii = 0; ii < countsLen; ++ii) {
+        const auto value = other.counts[ii].load(std::memory_order_relaxed);
+        if (value != 0) {
+            counts[ii].fetch_add(value, std::memory_order_relaxed);
+        }
+    }
+    total.fetch_add(other.getTotal(), std::memory_order_relaxed);
+    return *this;
+}
+
+void HdrHistogram::add(uint64_t value) {
+    counts[getIndex(value)].fetch_add(1, std::memory_order_relaxed);
+    total.fetch_add(1, std::memory_order_relaxed);
+}
+
+void HdrHistogram::reset() {
+    for (size_t ii = 0; ii < countsLen; ++ii) {
+        counts[ii].store(0, std::memory_order_relaxed);
+    }
+    total.store(0, std::memory_order_relaxed);
+}
+
+size_t HdrHistogram::getIndex(uint64_t value) const {
+    value = std::min(value, highestTrackableValue);
+    const int bucket = bitLength(value | subBucketMask) - subBucketBits;
+    const auto subBucket = size_t(value >> bucket);
+    return (size_t(bucket) << (subBucketBits - 1)) + subBucket;
+}
+
+uint64_t HdrHistogram::getLowestEquivalentValue(size_t index) const {
+    int bucket = int(index >> (subBucketBits - 1)) - 1;
+    auto subBucket = uint64_t(index & (subBucketHalfCount - 1)) +
+                     subBucketHalfCount;
+    if (bucket < 0) {
+        bucket = 0;
+        subBucket -= subBucketHalfCount;
+    }
+    return subBucket << bucket;
+}
+
+uint64_t HdrHistogram::getHighestEquivalentValue(size_t index) const {
+    int bucket = std::max(int(index >> (subBucketBits - 1)) - 1, 0);
+    return getLowestEquivalentValue(index) + (uint64_t(1) << bucket) - 1;
+}
+
+uint64_t HdrHistogram::getValueAtPercentile(double percentile) const {
+    // The total may not be 100% in sync with the individual counters
+    // (we don't lock while recording) so use the sum of the counters
+    uint64_t sum = 0;
+    for (size_t ii = 0; ii < countsLen; ++ii) {
+        sum += counts[ii].load(std::memory_order_relaxed);
+    }
+
+    if (sum == 0) {
+        return 0;
+    }
+
+    percentile = std::min(std::max(percentile, 0.0), 100.0);
+    const auto target =
+            std::max(uint64_t(std::ceil(percentile / 100.0 * sum)),
+                     uint64_t(1));
+    uint64_t cumulative = 0;
+    for (size_t ii = 0; ii < countsLen; ++ii) {
+        cumulative += counts[ii].load(std::memory_order_relaxed);
+        if (cumulative >= target) {
+            return getHighestEquivalentValue(ii);
+        }
+    }
+
+    return highestTrackableValue;
+}
+
+unique_cJSON_ptr HdrHistogram::to_json() const {
+    unique_cJSON_ptr json(cJSON_CreateObject());
+    if (!json) {
+        throw std::bad_alloc();
+    }
+    cJSON* root = json.get();
+
+    cJSON_AddNumberToObject(root, "precision", significantFigures);
+    cJSON_AddNumberToObject(root, "total", double(getTotal()));
+
+    cJSON* pct = cJSON_CreateObject();
+    for (const auto p : percentiles) {
+        char name[16];
+        snprintf(name, sizeof(name), "%g", p);
+        cJSON_AddNumberToObject(pct, name, double(getValueAtPercentile(p)));
+    }
+    cJSON_AddItemToObject(root, "percentiles", pct);
+
+    cJSON* array = cJSON_CreateArray();
+    for (size_t ii = 0; ii < countsLen; ++ii) {
+        const auto count = counts[ii].load(std::memory_order_relaxed);
+        if (count != 0) {
+            cJSON* bucket = cJSON_CreateArray();
+            cJSON_AddItemToArray(
+                    bucket,
+                    cJSON_CreateNumber(double(getLowestEquivalentValue(ii))));
+            cJSON_AddItemToArray(
+                    bucket,
+                    cJSON_CreateNumber(double(getHighestEquivalentValue(ii))));
+            cJSON_AddItemToArray(bucket, cJSON_CreateNumber(count));
+            cJSON_AddItemToArray(array, bucket);
+        }
+    }
+    cJSON_AddItemToObject(root, "buckets", array);
+
+    return json;
+}
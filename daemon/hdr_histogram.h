@@ -0,0 +1,126 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2018 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+
+#include <cJSON_utils.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+
+/**
+ * A High Dynamic Range histogram recording values (durations in
+ * microseconds) with a fixed number of significant decimal figures
+ * over the entire value range.
+ *
+ * The values are recorded in log-linear buckets: the value range is split
+ * into power-of-two sized buckets, and each bucket is split into a
+ * fixed number of linear sub-buckets (derived from the requested
+ * precision). With a precision of 2 significant figures the recorded
+ * value is within 1% of the real value anywhere between 1µs and an hour,
+ * compared to TimingHistogram which only has 1ms resolution between 1ms
+ * and 50ms.
+ *
+ * Recording a value is a single relaxed atomic increment (no locks), and
+ * histograms with the same configuration may be merged by using
+ * operator+= when reading them.
+ */
+class HdrHistogram {
+public:
+    /**
+     * Create a new histogram
+     *
+     * @param significantFigures the number of significant decimal figures
+     *                           to keep (1-3)
+     * @param highestTrackableValue values above this value is recorded
+     *                              as this value
+     * @throws std::invalid_argument for an invalid precision
+     */
+    explicit HdrHistogram(int significantFigures,
+                          uint64_t highestTrackableValue = 1ull << 32);
+
+    HdrHistogram(const HdrHistogram& other);
+    HdrHistogram& operator=(const HdrHistogram& other) = delete;
+
+    /**
+     * Add the samples from the other histogram to this one
+     *
+     * @throws std::invalid_argument if the histograms use a different
+     *                               configuration
+     */
+    HdrHistogram& operator+=(const HdrHistogram& other);
+
+    /// Record a single value (in microseconds)
+    void add(uint64_t value);
+
+    void add(const std::chrono::nanoseconds nsec) {
+        add(uint64_t(
+                std::chrono::duration_cast<std::chrono::microseconds>(nsec)
+                        .count()));
+    }
+
+    void reset();
+
+    uint64_t getTotal() const {
+        return total.load(std::memory_order_relaxed);
+    }
+
+    int getSignificantFigures() const {
+        return significantFigures;
+    }
+
+    /**
+     * Get the (highest equivalent) value at the given percentile
+     *
+     * @param percentile the requested percentile (0-100)
+     * @return the value or 0 if the histogram is empty
+     */
+    uint64_t getValueAtPercentile(double percentile) const;
+
+    /**
+     * Get a JSON representation of the histogram:
+     *
+     *     {
+     *       "precision" : 2,
+     *       "total" : 1234,
+     *       "percentiles" : { "50" : 120, ... "99.99" : 4500 },
+     *       "buckets" : [ [ lowest, highest, count ], ... ]
+     *     }
+     *
+     * Only the buckets with samples are included (all values in µs)
+     */
+    unique_cJSON_ptr to_json() const;
+
+    /// The percentiles included in the JSON representation
+    static const double percentiles[];
+
+protected:
+    size_t getIndex(uint64_t value) const;
+    uint64_t getLowestEquivalentValue(size_t index) const;
+    uint64_t getHighestEquivalentValue(size_t index) const;
+
+    const int significantFigures;
+    const uint64_t highestTrackableValue;
+    /// log2 of the number of linear sub-buckets per power-of-two bucket
+    int subBucketBits;
+    uint64_t subBucketMask;
+    size_t subBucketHalfCount;
+    size_t countsLen;
+    std::unique_ptr<std::atomic<uint32_t>[]> counts;
+    std::atomic<uint64_t> total;
+};
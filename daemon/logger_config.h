@@ -30,7 +30,7 @@ struct LoggerConfig {
     bool operator!=(const LoggerConfig& other) const;
 
     std::string filename;
-    size_t buffersize = 2048 * 1024; // 2 MB for the logging queue
+    size_t buffersize = 2048 * 1024; // 2 MB (1/16th per logging thread)
     size_t cyclesize = 100 * 1024 * 1024; // 100 MB per cycled file
     size_t sleeptime = 60; // time between forced flushes of the buffer
     bool unit_test = false; // if running in a unit test or not
@@ -18,8 +18,10 @@
 
 #include "debug_helpers.h"
 #include "memcached.h"
+#include "tracing.h"
 #include "xattr/utils.h"
 
+#include <mcbp/mcbp.h>
 #include <mcbp/protocol/framebuilder.h>
 #include <platform/compress.h>
 
@@ -66,6 +68,7 @@ static cb::const_byte_buffer mcbp_add_header(Cookie& cookie,
         header->response.bodylen = htonl(body_len + framing_extras_size);
 
         auto& tracer = cookie.getTracer();
+        tracer.end(cb::tracing::TraceCode::REQUEST);
         const auto val = htons(tracer.getEncodedMicros());
         auto* ptr = header->bytes + sizeof(header->bytes);
         *ptr = tracing_framing_id;
@@ -238,5 +241,23 @@ void mcbp_collect_timings(Cookie& cookie) {
     // Log operations taking longer than 0.5s
     const auto elapsed_ms =
             std::chrono::duration_cast<std::chrono::milliseconds>(elapsed_ns);
+    if (cookie.isRecordingSpans()) {
+        cookie.getTracer().end(cb::tracing::TraceCode::REQUEST);
+    }
     cookie.maybeLogSlowCommand(elapsed_ms);
+
+    // Keep the spans for the slow requests around so that they may be
+    // inspected later on
+    if (cookie.isRecordingSpans()) {
+        const auto limit = cb::mcbp::sla::getSlowOpThreshold(
+                cookie.getRequest().getClientOpcode());
+        if (elapsed_ms > limit) {
+            slowTraceLog.add(
+                    opcode,
+                    c->getId(),
+                    std::chrono::duration_cast<std::chrono::microseconds>(
+                            elapsed_ns),
+                    cookie.getTracer());
+        }
+    }
 }
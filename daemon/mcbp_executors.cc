@@ -822,6 +822,23 @@ void mcbp_execute_packet(Cookie& cookie) {
     }
 }
 
+/**
+ * Head-based sampling of the request traces: should the next request on
+ * this thread record its spans (see Settings::getTracingSampleRate)
+ */
+static bool should_sample_trace() {
+    const auto rate = settings.getTracingSampleRate();
+    if (rate == 0) {
+        return false;
+    }
+    static thread_local uint32_t counter = 0;
+    if (++counter >= rate) {
+        counter = 0;
+        return true;
+    }
+    return false;
+}
+
 void try_read_mcbp_command(McbpConnection& c) {
     auto input = c.read->rdata();
     if (input.size() < sizeof(cb::mcbp::Request)) {
@@ -879,7 +896,11 @@ void try_read_mcbp_command(McbpConnection& c) {
     c.addMsgHdr(true);
     MEMCACHED_PROCESS_COMMAND_START(
             c.getId(), input.data(), sizeof(cb::mcbp::Request));
-    c.getCookieObject().setTracingEnabled(c.isTracingEnabled());
+    cookie.setTracingEnabled(c.isTracingEnabled());
+    cookie.setTraceSampled(should_sample_trace());
+    if (cookie.isRecordingSpans()) {
+        cookie.getTracer().begin(cb::tracing::TraceCode::REQUEST);
+    }
 
     auto reason = validate_packet_execusion_constraints(cookie);
     if (reason != cb::mcbp::Status::Success) {
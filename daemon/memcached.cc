@@ -404,7 +404,7 @@ static void stats_init(void) {
 struct thread_stats *get_thread_stats(Connection *c) {
     cb_assert(c->getThread()->index < (settings.getNumWorkerThreads() + 1));
     auto& independent_stats = all_buckets[c->getBucketIndex()].stats;
-    return &independent_stats.at(c->getThread()->index);
+    return independent_stats.at(c->getThread()->index).get();
 }
 
 void stats_reset(Cookie& cookie) {
@@ -471,6 +471,7 @@ static void opcode_attributes_override_changed_listener(const std::string&,
 }
 
 static void interfaces_changed_listener(const std::string&, Settings &s) {
+    std::lock_guard<std::mutex> guard(stats_mutex);
     for (const auto& ifc : s.getInterfaces()) {
         auto* port = get_listening_port_instance(ifc.port);
         if (port != nullptr) {
@@ -567,6 +568,14 @@ static void settings_init(void) {
         }
     }
 
+    tmp = getenv("MEMCACHED_TIMINGS_PRECISION");
+    if (tmp != NULL) {
+        int precision;
+        if (safe_strtol(tmp, precision) && precision >= 1 && precision <= 3) {
+            settings.setTimingsPrecision(precision);
+        }
+    }
+
     {
         // MB-13642 Allow the user to specify the SSL cipher list
         //    If someone wants to use SSL we should try to be "secure
@@ -769,14 +778,14 @@ static protocol_binary_response_status engine_error2mcbp(
 static bool is_tracing_enabled(gsl::not_null<const void*> void_cookie) {
     auto* cookie =
             reinterpret_cast<Cookie*>(const_cast<void*>(void_cookie.get()));
-    return cookie->isTracingEnabled();
+    return cookie->isRecordingSpans();
 }
 
 static void begin_trace(gsl::not_null<const void*> void_cookie,
                         cb::tracing::TraceCode tracecode) {
     auto* cookie =
             reinterpret_cast<Cookie*>(const_cast<void*>(void_cookie.get()));
-    if (!cookie->isTracingEnabled()) {
+    if (!cookie->isRecordingSpans()) {
         return;
     }
     cookie->getTracer().begin(tracecode);
@@ -786,7 +795,7 @@ static void end_trace(gsl::not_null<const void*> void_cookie,
                       cb::tracing::TraceCode tracecode) {
     auto* cookie =
             reinterpret_cast<Cookie*>(const_cast<void*>(void_cookie.get()));
-    if (!cookie->isTracingEnabled()) {
+    if (!cookie->isRecordingSpans()) {
         return;
     }
     cookie->getTracer().end(tracecode);
@@ -911,20 +920,17 @@ bool conn_listening(ListenConnection *c)
     {
         std::lock_guard<std::mutex> guard(stats_mutex);
         port_instance = get_listening_port_instance(c->getParentPort());
-        cb_assert(port_instance);
-        port_conns = ++port_instance->curr_conns;
     }
+    cb_assert(port_instance);
+    port_conns = ++port_instance->curr_conns;
 
     if (curr_conns >= settings.getMaxconns() || port_conns >= port_instance->maxconns) {
-        {
-            std::lock_guard<std::mutex> guard(stats_mutex);
-            --port_instance->curr_conns;
-        }
+        --port_instance->curr_conns;
         stats.rejected_conns++;
         LOG_WARNING(c,
                     "Too many open connections. Current/Limit for port "
                         "%d: %d/%d; total: %d/%d", port_instance->port,
-                    port_conns, port_instance->maxconns,
+                    port_conns, port_instance->maxconns.load(),
                     curr_conns, settings.getMaxconns());
 
         safe_close(sfd);
@@ -932,10 +938,7 @@ bool conn_listening(ListenConnection *c)
     }
 
     if (evutil_make_socket_nonblocking(sfd) == -1) {
-        {
-            std::lock_guard<std::mutex> guard(stats_mutex);
-            --port_instance->curr_conns;
-        }
+        --port_instance->curr_conns;
         LOG_WARNING(c, "Failed to make socket non-blocking. closing it");
         safe_close(sfd);
         return false;
@@ -1904,6 +1907,12 @@ SERVER_HANDLE_V1* get_server_api() {
         hooks_api.release_free_memory = AllocHooks::release_free_memory;
         hooks_api.enable_thread_cache = AllocHooks::enable_thread_cache;
         hooks_api.get_allocator_property = AllocHooks::get_allocator_property;
+        hooks_api.get_allocation_utilization =
+                AllocHooks::get_allocation_utilization;
+        hooks_api.acquire_arena = AllocHooks::acquire_arena;
+        hooks_api.release_arena = AllocHooks::release_arena;
+        hooks_api.set_thread_arena = AllocHooks::set_thread_arena;
+        hooks_api.get_arena_allocated = AllocHooks::get_arena_allocated;
 
         document_api.pre_link = pre_link_document;
         document_api.pre_expiry = document_pre_expiry;
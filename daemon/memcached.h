@@ -22,8 +22,8 @@
 #include <memcached/engine.h>
 #include <memcached/engine_error.h>
 #include <memcached/extension.h>
-#include <JSON_checker.h>
 
+#include "buffer_pool.h"
 #include "dynamic_buffer.h"
 #include "executorpool.h"
 #include "log_macros.h"
@@ -133,11 +133,11 @@ struct LIBEVENT_THREAD {
     /// Type of IO this thread processes
     ThreadType type = ThreadType::GENERAL;
 
-    /// Shared read buffer for all connections serviced by this thread.
-    std::unique_ptr<cb::Pipe> read;
+    /// Pool of read buffers shared by all connections serviced by this thread.
+    PipePool read;
 
-    /// Shared write buffer for all connections serviced by this thread.
-    std::unique_ptr<cb::Pipe> write;
+    /// Pool of write buffers shared by all connections serviced by this thread.
+    PipePool write;
 
     /**
      * Shared sub-document operation for all connections serviced by this
@@ -155,12 +155,6 @@ struct LIBEVENT_THREAD {
      * client to disconnect.
      */
     int deleting_buckets = 0;
-
-    /**
-     * Shared validator used by all connections serviced by this thread
-     * when they need to validate a JSON document
-     */
-    JSON_checker::Validator validator;
 };
 
 #define LOCK_THREAD(t) t->mutex.lock();
@@ -212,7 +206,15 @@ int is_listen_thread(void);
 
 void STATS_LOCK(void);
 void STATS_UNLOCK(void);
-void threadlocal_stats_reset(std::vector<thread_stats>& thread_stats);
+void threadlocal_stats_reset(
+        std::vector<cb::CachelinePadded<thread_stats>>& thread_stats);
+
+/**
+ * Get the accumulated occupancy of the worker threads read and write
+ * buffer pools
+ */
+void threads_get_buffer_pool_stats(PipePool::Stats& read,
+                                   PipePool::Stats& write);
 
 void notify_io_complete(gsl::not_null<const void*> cookie,
                         ENGINE_ERROR_CODE status);
@@ -146,6 +146,41 @@ cb::EngineErrorCasPair bucket_store_if(Cookie& cookie,
     return ret;
 }
 
+ENGINE_ERROR_CODE bucket_update_in_place(Cookie& cookie,
+                                         const DocKey& key,
+                                         uint16_t vbucket,
+                                         uint64_t& cas,
+                                         uint32_t expiration,
+                                         cb::InPlaceMutator mutator,
+                                         mutation_descr_t& mut_info) {
+    auto& c = cookie.getConnection();
+    auto* engine = c.getBucketEngine();
+    if (engine->update_in_place == nullptr) {
+        return ENGINE_ENOTSUP;
+    }
+
+    TRACE_SCOPE(get_server_api(), &cookie, cb::tracing::TraceCode::STORE);
+    auto ret = engine->update_in_place(c.getBucketEngineAsV0(),
+                                       &cookie,
+                                       key,
+                                       vbucket,
+                                       cas,
+                                       expiration,
+                                       std::move(mutator),
+                                       mut_info);
+    if (ret == ENGINE_SUCCESS) {
+        using namespace cb::audit::document;
+        add(cookie, Operation::Modify);
+    } else if (ret == ENGINE_DISCONNECT) {
+        LOG_INFO(&c,
+                 "%u: %s bucket_update_in_place return ENGINE_DISCONNECT",
+                 c.getId(),
+                 c.getDescription().c_str());
+    }
+
+    return ret;
+}
+
 ENGINE_ERROR_CODE bucket_remove(Cookie& cookie,
                                 const DocKey& key,
                                 uint64_t& cas,
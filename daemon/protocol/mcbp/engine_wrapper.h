@@ -62,6 +62,18 @@ cb::EngineErrorCasPair bucket_store_if(
         cb::StoreIfPredicate predicate,
         DocumentState document_state = DocumentState::Alive);
 
+/**
+ * Update the document in place (see engine_interface_v1::update_in_place).
+ * Returns ENGINE_ENOTSUP if the bucket doesn't support it.
+ */
+ENGINE_ERROR_CODE bucket_update_in_place(Cookie& cookie,
+                                         const DocKey& key,
+                                         uint16_t vbucket,
+                                         uint64_t& cas,
+                                         uint32_t expiration,
+                                         cb::InPlaceMutator mutator,
+                                         mutation_descr_t& mut_info);
+
 ENGINE_ERROR_CODE bucket_remove(Cookie& cookie,
                                 const DocKey& key,
                                 uint64_t& cas,
@@ -25,6 +25,8 @@
 #include <daemon/mc_time.h>
 #include <daemon/mcbp.h>
 #include <daemon/runtime.h>
+#include <daemon/sasl_tasks.h>
+#include <daemon/tracing.h>
 #include <mcbp/protocol/framebuilder.h>
 #include <mcbp/protocol/header.h>
 #include <memcached/audit_interface.h>
@@ -149,13 +151,31 @@ static ENGINE_ERROR_CODE server_stats(ADD_STAT add_stat_callback,
     struct thread_stats thread_stats;
     thread_stats.aggregate(cookie.getConnection().getBucket().stats);
 
-    try {
+    // The stats_mutex protects the reset time and the list of listening
+    // ports; all of the other counters are (relaxed) atomics which may be
+    // read without the lock. Don't hold it while calling back into the
+    // engine with the stats.
+    std::string stat_reset;
+    struct PortConns {
+        in_port_t port;
+        int maxconns;
+        int curr_conns;
+    };
+    std::vector<PortConns> port_conns;
+    {
         std::lock_guard<std::mutex> guard(stats_mutex);
+        stat_reset.assign(reset_stats_time);
+        for (const auto& instance : stats.listening_ports) {
+            port_conns.push_back({instance.port,
+                                  instance.maxconns.load(),
+                                  instance.curr_conns.load()});
+        }
+    }
 
+    try {
         add_stat(cookie, add_stat_callback, "pid", long(cb_getpid()));
         add_stat(cookie, add_stat_callback, "uptime", now);
-        add_stat(cookie, add_stat_callback, "stat_reset",
-                 (const char*)reset_stats_time);
+        add_stat(cookie, add_stat_callback, "stat_reset", stat_reset.c_str());
         add_stat(cookie, add_stat_callback, "time",
                  mc_time_convert_to_abs_time(now));
         add_stat(cookie, add_stat_callback, "version", get_server_version());
@@ -167,12 +187,14 @@ static ENGINE_ERROR_CODE server_stats(ADD_STAT add_stat_callback,
                  stats.daemon_conns);
         add_stat(cookie, add_stat_callback, "curr_connections",
                  stats.curr_conns.load(std::memory_order_relaxed));
-        for (auto& instance : stats.listening_ports) {
+        for (const auto& instance : port_conns) {
             std::string key =
                 "max_conns_on_port_" + std::to_string(instance.port);
-            add_stat(cookie, add_stat_callback, key.c_str(), instance.maxconns);
+            add_stat(cookie, add_stat_callback, key.c_str(),
+                     instance.maxconns);
             key = "curr_conns_on_port_" + std::to_string(instance.port);
-            add_stat(cookie, add_stat_callback, key.c_str(), instance.curr_conns);
+            add_stat(cookie, add_stat_callback, key.c_str(),
+                     instance.curr_conns);
         }
         add_stat(cookie, add_stat_callback, "total_connections", stats.total_conns);
         add_stat(cookie, add_stat_callback, "connection_structures",
@@ -241,6 +263,14 @@ static ENGINE_ERROR_CODE server_stats(ADD_STAT add_stat_callback,
                  add_stat_callback,
                  "wbufs_existing",
                  thread_stats.wbufs_existing);
+
+        PipePool::Stats rpool;
+        PipePool::Stats wpool;
+        threads_get_buffer_pool_stats(rpool, wpool);
+        add_stat(cookie, add_stat_callback, "rbufs_pooled", rpool.count);
+        add_stat(cookie, add_stat_callback, "rbufs_pool_bytes", rpool.bytes);
+        add_stat(cookie, add_stat_callback, "wbufs_pooled", wpool.count);
+        add_stat(cookie, add_stat_callback, "wbufs_pool_bytes", wpool.bytes);
         add_stat(cookie, add_stat_callback, "iovused_high_watermark",
                  thread_stats.iovused_high_watermark);
         add_stat(cookie, add_stat_callback, "msgused_high_watermark",
@@ -287,6 +317,7 @@ static void process_stat_settings(ADD_STAT add_stat_callback, Cookie& cookie) {
     add_stat(cookie, add_stat_callback, "maxconns", settings.getMaxconns());
 
     try {
+        std::lock_guard<std::mutex> guard(stats_mutex);
         for (auto& ifce : stats.listening_ports) {
             char interface[1024];
             int offset;
@@ -391,6 +422,8 @@ static void process_stat_settings(ADD_STAT add_stat_callback, Cookie& cookie) {
              settings.isDedupeNmvbMaps() ? "true" : "false");
     add_stat(cookie, add_stat_callback, "max_packet_size",
              std::to_string(settings.getMaxPacketSize()).c_str());
+    add_stat(cookie, add_stat_callback, "tracing_sample_rate",
+             std::to_string(settings.getTracingSampleRate()).c_str());
     add_stat(cookie, add_stat_callback, "xattr_enabled",
             settings.isXattrEnabled());
     add_stat(cookie, add_stat_callback, "privilege_debug",
@@ -540,6 +573,79 @@ static ENGINE_ERROR_CODE stat_sched_executor(const std::string& arg,
     }
 }
 
+/**
+ * Handler for the <code>stats sasl_auth</code> used to get the
+ * histograms for the SASL authentication:
+ *
+ *   execute - the time spent in cbsasl
+ *   total   - the time until the step completed (including the time
+ *             spent waiting for the executor)
+ *
+ * @param arg - should be empty
+ * @param cookie the command context
+ */
+static ENGINE_ERROR_CODE stat_sasl_auth_executor(const std::string& arg,
+                                                 Cookie& cookie) {
+    if (arg.empty()) {
+        static const std::string execute = {"execute"};
+        static const std::string total = {"total"};
+        auto hist = sasl_auth_execute_times.to_string();
+        append_stats(execute.data(), execute.size(), hist.data(),
+                     hist.size(), &cookie);
+        hist = sasl_auth_total_times.to_string();
+        append_stats(total.data(), total.size(), hist.data(), hist.size(),
+                     &cookie);
+        return ENGINE_SUCCESS;
+    } else {
+        return ENGINE_EINVAL;
+    }
+}
+
+/**
+ * Handler for the <code>stats slow_traces</code> used to get the spans
+ * recorded for the most recent slow requests (see SlowTraceLog). Each
+ * trace is returned as a JSON object, keyed by its position in the log
+ * (oldest first).
+ *
+ * @param arg - should be empty
+ * @param cookie the command context
+ */
+static ENGINE_ERROR_CODE stat_slow_traces_executor(const std::string& arg,
+                                                   Cookie& cookie) {
+    if (!arg.empty()) {
+        return ENGINE_EINVAL;
+    }
+
+    try {
+        size_t index = 0;
+        for (const auto& entry : slowTraceLog.getEntries()) {
+            unique_cJSON_ptr json(cJSON_CreateObject());
+            const char* opcode = memcached_opcode_2_text(entry.opcode);
+            if (opcode == nullptr) {
+                cJSON_AddNumberToObject(json.get(), "opcode", entry.opcode);
+            } else {
+                cJSON_AddStringToObject(json.get(), "opcode", opcode);
+            }
+            cJSON_AddNumberToObject(
+                    json.get(), "connection_id", entry.connectionId);
+            cJSON_AddNumberToObject(
+                    json.get(), "duration_us", entry.duration.count());
+            cJSON_AddStringToObject(json.get(), "trace", entry.trace.c_str());
+
+            const auto key = std::to_string(index++);
+            const auto value = to_string(json, false);
+            append_stats(key.data(),
+                         key.size(),
+                         value.data(),
+                         value.size(),
+                         &cookie);
+        }
+        return ENGINE_SUCCESS;
+    } catch (const std::bad_alloc&) {
+        return ENGINE_ENOMEM;
+    }
+}
+
 /**
  * Handler for the <code>stats settings</code> used to get the current
  * settings.
@@ -827,6 +933,7 @@ ENGINE_ERROR_CODE StatsCommandContext::step() {
     static std::unordered_map<std::string, struct stat_handler> handlers = {
             {"reset", {true, stat_reset_executor}},
             {"worker_thread_info", {false, stat_sched_executor}},
+            {"sasl_auth", {false, stat_sasl_auth_executor}},
             {"settings", {false, stat_settings_executor}},
             {"audit", {true, stat_audit_executor}},
             {"bucket_details", {true, stat_bucket_details_executor}},
@@ -836,7 +943,8 @@ ENGINE_ERROR_CODE StatsCommandContext::step() {
             {"topkeys_json", {false, stat_topkeys_json_executor}},
             {"subdoc_execute", {false, stat_subdoc_execute_executor}},
             {"responses", {false, stat_responses_json_executor}},
-            {"tracing", {true, stat_tracing_executor}}};
+            {"tracing", {true, stat_tracing_executor}},
+            {"slow_traces", {true, stat_slow_traces_executor}}};
 
     ENGINE_ERROR_CODE ret = ENGINE_SUCCESS;
 
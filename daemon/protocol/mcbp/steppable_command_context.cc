@@ -18,6 +18,7 @@
 #include <daemon/mcbp.h>
 #include <daemon/memcached.h>
 #include <daemon/stats.h>
+#include <memcached/json_validator.h>
 
 SteppableCommandContext::SteppableCommandContext(Cookie& cookie_)
     : cookie(cookie_), connection(cookie.getConnection()) {
@@ -68,7 +69,7 @@ void SteppableCommandContext::setDatatypeJSONFromValue(
         protocol_binary_datatype_t& datatype) {
     // Determine if document is JSON or not. We do not trust what the client
     // sent - instead we check for ourselves.
-    if (connection.getThread()->validator.validate(value.buf, value.len)) {
+    if (cb::json::checkUTF8JSON(value.buf, value.len)) {
         datatype |= PROTOCOL_BINARY_DATATYPE_JSON;
     } else {
         datatype &= ~PROTOCOL_BINARY_DATATYPE_JSON;
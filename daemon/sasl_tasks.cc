@@ -20,6 +20,8 @@
 #include "mcaudit.h"
 #include <memcached/rbac.h>
 
+TimingHistogram sasl_auth_execute_times;
+TimingHistogram sasl_auth_total_times;
 
 StartSaslAuthTask::StartSaslAuthTask(Cookie& cookie_,
                                      Connection& connection_,
@@ -30,6 +32,7 @@ StartSaslAuthTask::StartSaslAuthTask(Cookie& cookie_,
 }
 
 Task::Status StartSaslAuthTask::execute() {
+    const auto start = ProcessClock::now();
     connection.restartAuthentication();
     try {
         error = cbsasl_server_start(connection.getSaslConn(),
@@ -58,6 +61,7 @@ Task::Status StartSaslAuthTask::execute() {
         error = CBSASL_FAIL;
     }
 
+    sasl_auth_execute_times.add(ProcessClock::now() - start);
     return Status::Finished;
 }
 
@@ -70,6 +74,7 @@ StepSaslAuthTask::StepSaslAuthTask(Cookie& cookie_,
 }
 
 Task::Status StepSaslAuthTask::execute() {
+    const auto start = ProcessClock::now();
     try {
         error = cbsasl_server_step(connection.getSaslConn(), challenge.data(),
                                    static_cast<unsigned int>(challenge.length()),
@@ -94,6 +99,7 @@ Task::Status StepSaslAuthTask::execute() {
         cookie.setErrorContext("An exception occurred");
         error = CBSASL_FAIL;
     }
+    sasl_auth_execute_times.add(ProcessClock::now() - start);
     return Status::Finished;
 }
 
@@ -108,11 +114,13 @@ SaslAuthTask::SaslAuthTask(Cookie& cookie_,
       challenge(challenge_),
       error(CBSASL_FAIL),
       response(nullptr),
-      response_length(0) {
+      response_length(0),
+      created(ProcessClock::now()) {
     // no more init needed
 }
 
 void SaslAuthTask::notifyExecutionComplete() {
+    sasl_auth_total_times.add(ProcessClock::now() - created);
     connection.setAuthenticated(false);
     std::pair<cb::rbac::PrivilegeContext, bool> context;
 
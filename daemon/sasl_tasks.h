@@ -17,7 +17,9 @@
 #pragma once
 
 #include "task.h"
+#include "timing_histogram.h"
 #include <cbsasl/cbsasl.h>
+#include <platform/processclock.h>
 #include <string>
 #include <platform/sized_buffer.h>
 
@@ -25,6 +27,13 @@
 class Connection;
 class Cookie;
 
+/// The time spent in cbsasl for each of the SASL authentication steps
+extern TimingHistogram sasl_auth_execute_times;
+
+/// The time from a SASL authentication step was received until it
+/// completed (including the time spent waiting for the executor)
+extern TimingHistogram sasl_auth_total_times;
+
 /**
  * The SaslAuthTask is the abstract base class used during SASL
  * authentication (which is being run by the executor service)
@@ -59,6 +68,7 @@ protected:
     cbsasl_error_t error;
     const char* response;
     unsigned int response_length;
+    const ProcessClock::time_point created;
 };
 
 /**
@@ -50,6 +50,7 @@ Settings::Settings()
       default_reqs_per_event(00),
       max_packet_size(0),
       topkeys_size(0),
+      timings_precision(2),
       maxconns(0) {
 
     verbose.store(0);
@@ -409,6 +410,22 @@ static void handle_max_packet_size(Settings& s, cJSON* obj) {
     s.setMaxPacketSize(obj->valueint * 1024 * 1024);
 }
 
+/**
+ * Handle the "tracing_sample_rate" tag in the settings
+ *
+ *  The value must be a non-negative numeric value
+ *
+ * @param s the settings object to update
+ * @param obj the object in the configuration
+ */
+static void handle_tracing_sample_rate(Settings& s, cJSON* obj) {
+    if (obj->type != cJSON_Number || obj->valueint < 0) {
+        throw std::invalid_argument(
+                "\"tracing_sample_rate\" must be a non-negative integer");
+    }
+    s.setTracingSampleRate(uint32_t(obj->valueint));
+}
+
 /**
  * Handle the "saslauthd_socketpath" tag in the settings
  *
@@ -665,7 +682,8 @@ void Settings::reconfigure(const unique_cJSON_ptr& json) {
             {"client_cert_auth", handle_client_cert_auth},
             {"collections_prototype", handle_collections_prototype},
             {"opcode_attributes_override", handle_opcode_attributes_override},
-            {"topkeys_enabled", handle_topkeys_enabled}};
+            {"topkeys_enabled", handle_topkeys_enabled},
+            {"tracing_sample_rate", handle_tracing_sample_rate}};
 
     cJSON* obj = json->child;
     while (obj != nullptr) {
@@ -1119,6 +1137,16 @@ void Settings::updateSettings(const Settings& other, bool apply) {
         }
         setTopkeysEnabled(other.isTopkeysEnabled());
     }
+
+    if (other.has.tracing_sample_rate) {
+        if (other.getTracingSampleRate() != getTracingSampleRate()) {
+            logit(EXTENSION_LOG_NOTICE,
+                  "Change tracing sample rate from %u to %u",
+                  getTracingSampleRate(),
+                  other.getTracingSampleRate());
+            setTracingSampleRate(other.getTracingSampleRate());
+        }
+    }
 }
 
 void Settings::logit(EXTENSION_LOG_LEVEL level, const char* fmt, ...) {
@@ -34,6 +34,7 @@
 #include <deque>
 #include <map>
 #include <mutex>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
@@ -554,6 +555,29 @@ public:
         has.topkeys_size = true;
     }
 
+    /**
+     * Get the number of significant figures to keep in the command
+     * timings (HDR) histograms
+     */
+    int getTimingsPrecision() const {
+        return timings_precision;
+    }
+
+    /**
+     * Set the number of significant figures to keep in the command
+     * timings histograms. Only histograms created after the change is
+     * affected, so this can't be changed dynamically.
+     *
+     * @param precision the number of significant figures (1-3)
+     */
+    void setTimingsPrecision(int precision) {
+        if (precision < 1 || precision > 3) {
+            throw std::invalid_argument(
+                    "timings_precision must be in the range 1-3");
+        }
+        Settings::timings_precision = precision;
+    }
+
     /**
      * Get the list of available SASL Mechanisms
      *
@@ -723,6 +747,24 @@ public:
         notify_changed("topkeys_enabled");
     }
 
+    /**
+     * Get the rate used for head-based sampling of the request traces.
+     * One in every N requests (per front end thread) records its spans
+     * even if the client didn't enable tracing, so that slow requests may
+     * be analysed after the fact.
+     *
+     * @return N, or 0 if sampling is disabled
+     */
+    uint32_t getTracingSampleRate() const {
+        return tracing_sample_rate.load(std::memory_order_relaxed);
+    }
+
+    void setTracingSampleRate(uint32_t rate) {
+        Settings::tracing_sample_rate.store(rate, std::memory_order_relaxed);
+        has.tracing_sample_rate = true;
+        notify_changed("tracing_sample_rate");
+    }
+
 protected:
 
     /**
@@ -833,6 +875,11 @@ protected:
      */
     int topkeys_size;
 
+    /**
+     * The number of significant figures to keep in the command timings
+     */
+    int timings_precision;
+
     /**
      * The available sasl mechanism list
      */
@@ -884,6 +931,11 @@ protected:
      */
     std::atomic_bool topkeys_enabled{false};
 
+    /**
+     * Record the spans for one in every N requests (0 = disabled)
+     */
+    std::atomic<uint32_t> tracing_sample_rate{0};
+
 public:
     /**
      * Flags for each of the above config options, indicating if they were
@@ -924,6 +976,7 @@ public:
         bool collections_prototype;
         bool opcode_attributes_override;
         bool topkeys_enabled;
+        bool tracing_sample_rate;
     } has;
 
 protected:
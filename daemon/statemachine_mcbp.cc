@@ -525,15 +525,15 @@ bool conn_immediate_close(McbpConnection& connection) {
     }
     LOG_DETAIL(&connection, "Releasing connection %p", &connection);
 
+    ListeningPort* port_instance;
     {
         std::lock_guard<std::mutex> guard(stats_mutex);
-        auto* port_instance =
-                get_listening_port_instance(connection.getParentPort());
-        if (port_instance) {
-            --port_instance->curr_conns;
-        } else {
-            throw std::logic_error("null port_instance");
-        }
+        port_instance = get_listening_port_instance(connection.getParentPort());
+    }
+    if (port_instance) {
+        --port_instance->curr_conns;
+    } else {
+        throw std::logic_error("null port_instance");
     }
 
     connection.propagateDisconnect();
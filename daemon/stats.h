@@ -17,6 +17,8 @@
 #pragma once
 
 #include <cstdint>
+#include <deque>
+#include <platform/cacheline_padded.h>
 #include <relaxed_atomic.h>
 #include <mutex>
 
@@ -24,6 +26,11 @@
 
 /**
  * Stats stored per-thread.
+ *
+ * Each front end thread only updates its own instance (relaxed atomic
+ * increments), and the readers aggregate all of the instances without
+ * any locks. The instances are stored in a vector per bucket, wrapped in
+ * cb::CachelinePadded to avoid false sharing between the threads.
  */
 struct thread_stats {
     thread_stats() {
@@ -115,9 +122,10 @@ struct thread_stats {
         return *this;
     }
 
-    void aggregate(const std::vector<thread_stats>& thread_stats) {
-        for (auto& ii : thread_stats) {
-            *this += ii;
+    void aggregate(
+            const std::vector<cb::CachelinePadded<thread_stats>>& all) {
+        for (auto& ii : all) {
+            *this += *ii;
         }
     }
 
@@ -218,11 +226,17 @@ public:
      */
     const in_port_t port;
 
-    /** The current number of connections connected to this port */
-    int curr_conns;
+    /**
+     * The current number of connections connected to this port. Updated
+     * by the front end threads without holding the stats_mutex.
+     */
+    Couchbase::RelaxedAtomic<int> curr_conns;
 
-    /** The maximum number of connections allowed for this port */
-    int maxconns;
+    /**
+     * The maximum number of connections allowed for this port (may be
+     * changed at runtime by the interfaces change listener)
+     */
+    Couchbase::RelaxedAtomic<int> maxconns;
 
     /** The hostname this port is bound to ("*" means all interfaces) */
     const std::string host;
@@ -278,7 +292,14 @@ struct stats {
     /** The number of times I reject a client */
     Couchbase::RelaxedAtomic<uint64_t> rejected_conns;
 
-    std::vector<ListeningPort> listening_ports;
+    /**
+     * The ports we're listening on. Guarded by the stats_mutex: ports may be
+     * added at runtime (e.g. when the data ports are enabled after starting
+     * in management mode). Ports are never removed, and a deque doesn't move
+     * its elements when appended to, so a ListeningPort* looked up under the
+     * lock stays valid and its (atomic) counters may be updated without it.
+     */
+    std::deque<ListeningPort> listening_ports;
 };
 
 class Connection;
@@ -24,6 +24,7 @@
 #include "protocol/mcbp/engine_wrapper.h"
 #include "subdoc/util.h"
 #include "subdocument_context.h"
+#include "subdocument_index.h"
 #include "subdocument_traits.h"
 #include "subdocument_validators.h"
 #include "timings.h"
@@ -63,8 +64,20 @@ static ENGINE_ERROR_CODE subdoc_update(SubdocCmdContext& context,
                                        ENGINE_ERROR_CODE ret,
                                        const char* key, size_t keylen,
                                        uint16_t vbucket, uint32_t expiration);
+static bool subdoc_can_update_in_place(SubdocCmdContext& context,
+                                       ENGINE_ERROR_CODE ret);
+
+static ENGINE_ERROR_CODE subdoc_update_in_place(SubdocCmdContext& context,
+                                                const char* key,
+                                                size_t keylen,
+                                                uint16_t vbucket,
+                                                uint64_t cas,
+                                                uint32_t expiration);
+
 static void subdoc_response(Cookie& cookie, SubdocCmdContext& context);
 
+static void subdoc_complete(Cookie& cookie, SubdocCmdContext& context);
+
 // Debug - print details of the specified subdocument command.
 static void subdoc_print_command(Connection& c, protocol_binary_command cmd,
                                  const char* key, const uint16_t keylen,
@@ -407,7 +420,23 @@ static void subdoc_executor(Cookie& cookie, const SubdocCmdTraits traits) {
             cookie.setCommandContext(context);
         }
 
-        // 1. Attempt to fetch from the engine the document to operate on. Only
+        // 1a. If the engine supports it, let it apply the mutation to the
+        // document while it holds the lock for the document (which saves
+        // us copying the document back and forth, and having to retry on
+        // CAS mismatch). If it can't, use the normal fetch / store.
+        if (subdoc_can_update_in_place(*context, ret)) {
+            ret = subdoc_update_in_place(
+                    *context, key, keylen, vbucket, cas, expiration);
+            if (ret == ENGINE_SUCCESS) {
+                subdoc_complete(cookie, *context);
+                return;
+            } else if (ret != ENGINE_ENOTSUP) {
+                return;
+            }
+            ret = ENGINE_SUCCESS;
+        }
+
+        // 1b. Attempt to fetch from the engine the document to operate on. Only
         // continue if it returned true, otherwise return from this function
         // (which may result in it being called again later in the EWOULDBLOCK
         // case).
@@ -440,27 +469,7 @@ static void subdoc_executor(Cookie& cookie, const SubdocCmdTraits traits) {
         }
 
         // 4. Form a response and send it back to the client.
-        subdoc_response(cookie, *context);
-
-        // Update stats. Treat all mutations as 'cmd_set', all accesses as 'cmd_get',
-        // in addition to specific subdoc counters. (This is mainly so we
-        // see subdoc commands in the GUI, which used cmd_set / cmd_get).
-        auto* thread_stats = get_thread_stats(&cookie.getConnection());
-        if (context->traits.is_mutator) {
-            thread_stats->cmd_subdoc_mutation++;
-            thread_stats->bytes_subdoc_mutation_total += context->out_doc_len;
-            thread_stats->bytes_subdoc_mutation_inserted +=
-                    context->getOperationValueBytesTotal();
-
-            SLAB_INCR(&cookie.getConnection(), cmd_set);
-        } else {
-            thread_stats->cmd_subdoc_lookup++;
-            thread_stats->bytes_subdoc_lookup_total += context->in_doc.len;
-            thread_stats->bytes_subdoc_lookup_extracted += context->response_val_len;
-
-            STATS_HIT(&cookie.getConnection(), get);
-        }
-        update_topkeys(cookie);
+        subdoc_complete(cookie, *context);
         return;
     } while (auto_retry && attempts < MAXIMUM_ATTEMPTS);
 
@@ -572,6 +581,118 @@ static bool subdoc_fetch(Cookie& cookie,
     return true;
 }
 
+// Check if the command may be performed by the engine updating the
+// document in place. That is only the case for mutations of the document
+// body which are to be applied to an existing, live document; everything
+// else (XATTRs, creating and deleting documents) needs the normal path.
+static bool subdoc_can_update_in_place(SubdocCmdContext& context,
+                                       ENGINE_ERROR_CODE ret) {
+    return ret == ENGINE_SUCCESS && context.traits.is_mutator &&
+           !context.in_place_attempted && !context.fetchedItem &&
+           !context.needs_new_doc &&
+           context.getOperations(SubdocCmdContext::Phase::XATTR).empty() &&
+           !context.do_delete_doc && !context.do_allow_deleted_docs &&
+           context.mutationSemantics != MutationSemantics::Add;
+}
+
+// Ask the engine to apply the mutation to the document in place.
+// Returns ENGINE_ENOTSUP if the engine can't (and the caller should fall back
+// to fetching and storing the document), ENGINE_SUCCESS if the caller should
+// send the response, otherwise the command is complete (the response was
+// sent, or we're blocked).
+static ENGINE_ERROR_CODE subdoc_update_in_place(SubdocCmdContext& context,
+                                                const char* key,
+                                                size_t keylen,
+                                                uint16_t vbucket,
+                                                uint64_t cas,
+                                                uint32_t expiration) {
+    auto& connection = context.connection;
+    auto& cookie = context.cookie;
+    context.in_place_attempted = true;
+
+    // The mutator is called while the engine holds the lock for the
+    // document, so just record how it went and deal with the errors once
+    // the engine returns.
+    auto fetchStatus = PROTOCOL_BINARY_RESPONSE_SUCCESS;
+    bool operateFailed = false;
+    auto mutator = [&context, &fetchStatus, &operateFailed, cas](
+                           const item_info& info,
+                           cb::const_char_buffer& value,
+                           protocol_binary_datatype_t& datatype) {
+        fetchStatus = context.get_document_for_searching(info, cas);
+        if (fetchStatus != PROTOCOL_BINARY_RESPONSE_SUCCESS) {
+            return cb::engine_errc::failed;
+        }
+        if (!subdoc_operate(context)) {
+            operateFailed = true;
+            return cb::engine_errc::failed;
+        }
+        if (context.overall_status != PROTOCOL_BINARY_RESPONSE_SUCCESS) {
+            // One of the paths in a multi-mutation failed, so the document
+            // is left untouched (but we still send the response
+            // describing the failure)
+            return cb::engine_errc::failed;
+        }
+
+        // The new document lives in the context (and any values returned
+        // to the client live in the operation results), so nothing refers
+        // to the engine's copy of the document once we return.
+        value = {context.in_doc.buf, context.in_doc.len};
+        datatype = context.in_datatype;
+        return cb::engine_errc::success;
+    };
+
+    DocKey docKey(reinterpret_cast<const uint8_t*>(key),
+                  keylen,
+                  connection.getDocNamespace());
+    uint64_t new_cas = cas;
+    mutation_descr_t mdt = {};
+    auto ret = bucket_update_in_place(
+            cookie, docKey, vbucket, new_cas, expiration, mutator, mdt);
+    if (ret == ENGINE_ENOTSUP) {
+        return ret;
+    }
+
+    if (fetchStatus != PROTOCOL_BINARY_RESPONSE_SUCCESS) {
+        cookie.sendResponse(cb::mcbp::Status(fetchStatus));
+        return ENGINE_FAILED;
+    }
+    if (operateFailed) {
+        // subdoc_operate already dealt with the client
+        return ENGINE_FAILED;
+    }
+    if (ret == ENGINE_FAILED && context.executed &&
+        context.overall_status != PROTOCOL_BINARY_RESPONSE_SUCCESS) {
+        return ENGINE_SUCCESS;
+    }
+
+    ret = connection.remapErrorCode(ret);
+    switch (ret) {
+    case ENGINE_SUCCESS:
+        if (connection.isSupportsMutationExtras()) {
+            context.vbucket_uuid = mdt.vbucket_uuid;
+            context.sequence_no = mdt.seqno;
+        }
+        context.out_doc_len = context.in_doc.len;
+        cookie.setCas(new_cas);
+        break;
+
+    case ENGINE_EWOULDBLOCK:
+        cookie.setEwouldblock(true);
+        break;
+
+    case ENGINE_DISCONNECT:
+        connection.setState(McbpStateMachine::State::closing);
+        break;
+
+    default:
+        cookie.sendResponse(cb::engine_errc(ret));
+        break;
+    }
+
+    return ret;
+}
+
 /**
  * Perform the subjson operation specified by {spec} to one path in the
  * document.
@@ -660,6 +781,54 @@ subdoc_operate_one_path(SubdocCmdContext& context, SubdocCmdContext::OperationSp
     }
 }
 
+/**
+ * Try to perform the lookup specified by {spec} by using a structural index
+ * of the document instead of having subjson parse the document.
+ *
+ * A multi-path lookup would otherwise parse the document from the start
+ * for every path. The index is built the first time it is needed, and
+ * reused for the rest of the lookups in the phase.
+ *
+ * @return true if the lookup was resolved from the index, false if the
+ *         caller should use subjson to perform the operation
+ */
+static bool subdoc_lookup_from_index(SubdocCmdContext& context,
+                                     SubdocCmdContext::OperationSpec& spec,
+                                     const cb::const_char_buffer& doc,
+                                     std::unique_ptr<SubdocIndex>& index) {
+    // The XATTR phase operates on a single (small) xattr value and the
+    // virtual attributes; there's nothing to gain there.
+    if (context.traits.path != SubdocPath::MULTI ||
+        context.traits.is_mutator ||
+        context.getCurrentPhase() != SubdocCmdContext::Phase::Body ||
+        context.getOperations().size() < 2) {
+        return false;
+    }
+
+    if (spec.traits.mcbpCommand != PROTOCOL_BINARY_CMD_SUBDOC_GET &&
+        spec.traits.mcbpCommand != PROTOCOL_BINARY_CMD_SUBDOC_EXISTS) {
+        return false;
+    }
+
+    if (!index) {
+        // If the document can't be indexed the index won't resolve any
+        // paths, and we'll use subjson for all of them
+        index.reset(new SubdocIndex);
+        index->build(doc);
+    }
+
+    cb::const_char_buffer value;
+    if (!index->lookup(spec.path, value)) {
+        return false;
+    }
+
+    if (spec.traits.mcbpCommand == PROTOCOL_BINARY_CMD_SUBDOC_GET) {
+        spec.result.set_matchloc({value.buf, value.len});
+    }
+    spec.status = PROTOCOL_BINARY_RESPONSE_SUCCESS;
+    return true;
+}
+
 /**
  * Perform the wholedoc (mcbp) operation defined by spec
  */
@@ -714,6 +883,7 @@ static bool operate_single_doc(SubdocCmdContext& context,
                                 bool& modified) {
     modified = false;
     auto& operations = context.getOperations();
+    std::unique_ptr<SubdocIndex> index;
 
     // 2. Perform each of the operations on document.
     for (auto op = operations.begin(); op != operations.end(); op++) {
@@ -721,7 +891,9 @@ static bool operate_single_doc(SubdocCmdContext& context,
         case CommandScope::SubJSON:
             if (mcbp::datatype::is_json(doc_datatype)) {
                 // Got JSON, perform the operation.
-                op->status = subdoc_operate_one_path(context, *op, doc);
+                if (!subdoc_lookup_from_index(context, *op, doc, index)) {
+                    op->status = subdoc_operate_one_path(context, *op, doc);
+                }
             } else {
                 // No good; need to have JSON.
                 op->status = PROTOCOL_BINARY_RESPONSE_SUBDOC_DOC_NOTJSON;
@@ -1444,12 +1616,16 @@ static void subdoc_single_response(Cookie& cookie, SubdocCmdContext& context) {
         status_code = cb::mcbp::Status::SubdocSuccessDeleted;
     }
 
-    cookie.sendResponse(cb::mcbp::Status(status_code),
-                        extras,
-                        {},
-                        value,
-                        context.traits.responseDatatype(context.in_datatype),
-                        cookie.getCas());
+    // The value lives in the command context (either in the fetched
+    // document or in the operation result) so we don't need to copy it
+    // into the write buffer.
+    cookie.sendResponseZeroCopy(
+            cb::mcbp::Status(status_code),
+            extras,
+            {},
+            value,
+            context.traits.responseDatatype(context.in_datatype),
+            cookie.getCas());
 }
 
 /* Construct and send a response to a multi-path mutation back to the client.
@@ -1533,6 +1709,13 @@ static void subdoc_multi_mutation_response(Cookie& cookie,
                     extlen + response_buf_needed + iov_len,
                     PROTOCOL_BINARY_RAW_BYTES);
 
+    // Make sure we don't have to grow the IO vector while appending
+    // the extras and the results (two entries per operation)
+    const size_t num_ops =
+            context.getOperations(SubdocCmdContext::Phase::XATTR).size() +
+            context.getOperations(SubdocCmdContext::Phase::Body).size();
+    connection.reserveIov(1 + 2 * num_ops);
+
     // Append extras if requested.
     if (extlen > 0) {
         connection.addIov(reinterpret_cast<void*>(extras_ptr), extlen);
@@ -1636,6 +1819,12 @@ static void subdoc_multi_lookup_response(Cookie& cookie,
                     context.response_val_len,
                     PROTOCOL_BINARY_RAW_BYTES);
 
+    // Make sure we don't have to grow the IO vector while appending
+    // the results (two entries per operation)
+    connection.reserveIov(
+            2 * (context.getOperations(SubdocCmdContext::Phase::XATTR).size() +
+                 context.getOperations(SubdocCmdContext::Phase::Body).size()));
+
     // Append the iovecs for each operation result.
     for (auto phase : phases) {
         for (auto& op : context.getOperations(phase)) {
@@ -1686,6 +1875,31 @@ static void subdoc_response(Cookie& cookie, SubdocCmdContext& context) {
     cookie.getConnection().setWriteAndGo(McbpStateMachine::State::closing);
 }
 
+// Send the response for a successful command and update the stats.
+static void subdoc_complete(Cookie& cookie, SubdocCmdContext& context) {
+    subdoc_response(cookie, context);
+
+    // Update stats. Treat all mutations as 'cmd_set', all accesses as 'cmd_get',
+    // in addition to specific subdoc counters. (This is mainly so we
+    // see subdoc commands in the GUI, which used cmd_set / cmd_get).
+    auto* thread_stats = get_thread_stats(&cookie.getConnection());
+    if (context.traits.is_mutator) {
+        thread_stats->cmd_subdoc_mutation++;
+        thread_stats->bytes_subdoc_mutation_total += context.out_doc_len;
+        thread_stats->bytes_subdoc_mutation_inserted +=
+                context.getOperationValueBytesTotal();
+
+        SLAB_INCR(&cookie.getConnection(), cmd_set);
+    } else {
+        thread_stats->cmd_subdoc_lookup++;
+        thread_stats->bytes_subdoc_lookup_total += context.in_doc.len;
+        thread_stats->bytes_subdoc_lookup_extracted += context.response_val_len;
+
+        STATS_HIT(&cookie.getConnection(), get);
+    }
+    update_topkeys(cookie);
+}
+
 void subdoc_get_executor(Cookie& cookie) {
     return subdoc_executor(cookie,
                            get_traits<PROTOCOL_BINARY_CMD_SUBDOC_GET>());
@@ -311,14 +311,27 @@ cb::const_char_buffer SubdocCmdContext::get_xtoc_vattr() {
 
 protocol_binary_response_status SubdocCmdContext::get_document_for_searching(
         uint64_t client_cas) {
-    item_info& info = getInputItemInfo();
-    auto& c = connection;
-
-    if (!bucket_get_item_info(cookie, fetchedItem.get(), &info)) {
-        LOG_WARNING(&c, "%u: Failed to get item info", c.getId());
+    if (!bucket_get_item_info(cookie, fetchedItem.get(), &input_item_info)) {
+        LOG_WARNING(&connection,
+                    "%u: Failed to get item info",
+                    connection.getId());
         return PROTOCOL_BINARY_RESPONSE_EINTERNAL;
     }
 
+    return set_input_document(client_cas);
+}
+
+protocol_binary_response_status SubdocCmdContext::get_document_for_searching(
+        const item_info& info, uint64_t client_cas) {
+    input_item_info = info;
+    return set_input_document(client_cas);
+}
+
+protocol_binary_response_status SubdocCmdContext::set_input_document(
+        uint64_t client_cas) {
+    const item_info& info = input_item_info;
+    auto& c = connection;
+
     if (info.cas == -1ull) {
         // Check that item is not locked:
         if (client_cas == 0 || client_cas == -1ull) {
@@ -189,6 +189,11 @@ public:
     // than replace) is required.
     bool needs_new_doc = false;
 
+    // [Mutations only] True if we've asked the engine to update the
+    // document in place (so we shouldn't try again if we need to fall back
+    // to fetching and storing the document).
+    bool in_place_attempted = false;
+
     // Overall status of the entire command.
     // For single-path commands this is simply the same as the first (and only)
     // opetation, for multi-path it's an aggregate status.
@@ -323,6 +328,19 @@ public:
     protocol_binary_response_status get_document_for_searching(
             uint64_t client_cas);
 
+    /**
+     * Initialize all of the internal input variables from the provided
+     * item info (used when the engine hands us the current document while
+     * updating it in place). The document referenced by the item info
+     * must stay valid for as long as the input variables are used.
+     *
+     * @param info the item info of the document to operate on
+     * @param client_cas The CAS provided by the client
+     * @return as for get_document_for_searching(uint64_t)
+     */
+    protocol_binary_response_status get_document_for_searching(
+            const item_info& info, uint64_t client_cas);
+
     /**
      * The result of subdoc_fetch.
      */
@@ -331,6 +349,12 @@ public:
     XtocSemantics xtocSemantics = XtocSemantics::None;
 
 private:
+    /**
+     * Initialize the input variables from input_item_info (see
+     * get_document_for_searching)
+     */
+    protocol_binary_response_status set_input_document(uint64_t client_cas);
+
     // The item info representing the input document
     item_info input_item_info = {};
 
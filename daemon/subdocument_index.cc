@@ -0,0 +1,416 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2018 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "subdocument_index.h"
+
+#include <cstring>
+#include <string>
+
+namespace {
+
+void skipWhitespace(const char*& ptr, const char* end) {
+    while (ptr < end &&
+           (*ptr == ' ' || *ptr == '\n' || *ptr == '\r' || *ptr == '\t')) {
+        ++ptr;
+    }
+}
+
+bool isHex(char c) {
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') ||
+           (c >= 'A' && c <= 'F');
+}
+
+/**
+ * Move past the string starting at ptr (which must point at the opening
+ * quote).
+ *
+ * @param escaped set to true if the string contains escape sequences
+ * @return true if the string is valid
+ */
+bool consumeString(const char*& ptr, const char* end, bool& escaped) {
+    escaped = false;
+    ++ptr;
+    while (ptr < end) {
+        const auto c = uint8_t(*ptr);
+        if (c == '"') {
+            ++ptr;
+            return true;
+        } else if (c == '\\') {
+            escaped = true;
+            ++ptr;
+            if (ptr == end) {
+                return false;
+            }
+            if (*ptr == 'u') {
+                if (end - ptr < 5 || !isHex(ptr[1]) || !isHex(ptr[2]) ||
+                    !isHex(ptr[3]) || !isHex(ptr[4])) {
+                    return false;
+                }
+                ptr += 5;
+            } else if (std::strchr("\"\\/bfnrt", *ptr) != nullptr) {
+                ++ptr;
+            } else {
+                return false;
+            }
+        } else if (c < 0x20) {
+            return false;
+        } else {
+            ++ptr;
+        }
+    }
+    return false;
+}
+
+bool consumeDigits(const char*& ptr, const char* end) {
+    const auto* start = ptr;
+    while (ptr < end && *ptr >= '0' && *ptr <= '9') {
+        ++ptr;
+    }
+    return ptr != start;
+}
+
+bool consumeNumber(const char*& ptr, const char* end) {
+    if (*ptr == '-') {
+        ++ptr;
+    }
+    if (ptr == end) {
+        return false;
+    }
+    if (*ptr == '0') {
+        ++ptr;
+    } else if (!consumeDigits(ptr, end)) {
+        return false;
+    }
+    if (ptr < end && *ptr == '.') {
+        ++ptr;
+        if (!consumeDigits(ptr, end)) {
+            return false;
+        }
+    }
+    if (ptr < end && (*ptr == 'e' || *ptr == 'E')) {
+        ++ptr;
+        if (ptr < end && (*ptr == '+' || *ptr == '-')) {
+            ++ptr;
+        }
+        if (!consumeDigits(ptr, end)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool consumeLiteral(const char*& ptr, const char* end, const char* literal) {
+    const auto length = std::strlen(literal);
+    if (size_t(end - ptr) < length || std::memcmp(ptr, literal, length) != 0) {
+        return false;
+    }
+    ptr += length;
+    return true;
+}
+
+bool consumeScalar(const char*& ptr, const char* end) {
+    bool escaped;
+    switch (*ptr) {
+    case '"':
+        return consumeString(ptr, end, escaped);
+    case 't':
+        return consumeLiteral(ptr, end, "true");
+    case 'f':
+        return consumeLiteral(ptr, end, "false");
+    case 'n':
+        return consumeLiteral(ptr, end, "null");
+    }
+    if (*ptr == '-' || (*ptr >= '0' && *ptr <= '9')) {
+        return consumeNumber(ptr, end);
+    }
+    return false;
+}
+
+} // anonymous namespace
+
+bool SubdocIndex::build(cb::const_char_buffer doc) {
+    document = doc;
+    nodes.clear();
+
+    if (doc.len >= None) {
+        return false;
+    }
+
+    enum class State { Value, Key, AfterValue };
+
+    const char* const begin = doc.buf;
+    const char* const end = doc.buf + doc.len;
+    const char* ptr = begin;
+
+    // The currently open containers
+    std::vector<uint32_t> stack;
+    State state = State::Value;
+
+    // The key for the next value (when we're within an object)
+    uint32_t keyBegin = 0;
+    uint32_t keyLength = 0;
+    bool keyEscaped = false;
+
+    while (true) {
+        skipWhitespace(ptr, end);
+        switch (state) {
+        case State::Value: {
+            if (ptr == end) {
+                nodes.clear();
+                return false;
+            }
+
+            const auto index = uint32_t(nodes.size());
+            if (!stack.empty()) {
+                auto& parent = nodes[stack.back()];
+                if (parent.lastChild == None) {
+                    parent.firstChild = index;
+                } else {
+                    nodes[parent.lastChild].nextSibling = index;
+                }
+                parent.lastChild = index;
+            }
+
+            Node node{uint32_t(ptr - begin), 0,    keyBegin, keyLength,
+                      None,                  None, None,     Type::Scalar,
+                      keyEscaped};
+            keyBegin = keyLength = 0;
+            keyEscaped = false;
+
+            if (*ptr == '{' || *ptr == '[') {
+                if (stack.size() == MaxDepth) {
+                    nodes.clear();
+                    return false;
+                }
+                const bool object = *ptr == '{';
+                node.type = object ? Type::Object : Type::Array;
+                ++ptr;
+                skipWhitespace(ptr, end);
+                if (ptr < end && *ptr == (object ? '}' : ']')) {
+                    ++ptr;
+                    node.end = uint32_t(ptr - begin);
+                    state = State::AfterValue;
+                } else {
+                    stack.push_back(index);
+                    state = object ? State::Key : State::Value;
+                }
+            } else {
+                if (!consumeScalar(ptr, end)) {
+                    nodes.clear();
+                    return false;
+                }
+                node.end = uint32_t(ptr - begin);
+                state = State::AfterValue;
+            }
+            nodes.push_back(node);
+            break;
+        }
+
+        case State::Key: {
+            if (ptr == end || *ptr != '"') {
+                nodes.clear();
+                return false;
+            }
+            const auto* key = ptr + 1;
+            if (!consumeString(ptr, end, keyEscaped)) {
+                nodes.clear();
+                return false;
+            }
+            keyBegin = uint32_t(key - begin);
+            keyLength = uint32_t((ptr - 1) - key);
+            skipWhitespace(ptr, end);
+            if (ptr == end || *ptr != ':') {
+                nodes.clear();
+                return false;
+            }
+            ++ptr;
+            state = State::Value;
+            break;
+        }
+
+        case State::AfterValue: {
+            if (stack.empty()) {
+                if (ptr != end) {
+                    nodes.clear();
+                    return false;
+                }
+                return true;
+            }
+
+            if (ptr == end) {
+                nodes.clear();
+                return false;
+            }
+
+            auto& container = nodes[stack.back()];
+            const bool object = container.type == Type::Object;
+            if (*ptr == ',') {
+                ++ptr;
+                state = object ? State::Key : State::Value;
+            } else if (*ptr == (object ? '}' : ']')) {
+                ++ptr;
+                container.end = uint32_t(ptr - begin);
+                stack.pop_back();
+            } else {
+                nodes.clear();
+                return false;
+            }
+            break;
+        }
+        }
+    }
+}
+
+uint32_t SubdocIndex::findMember(const Node& object,
+                                 const char* name,
+                                 size_t length) const {
+    for (auto ii = object.firstChild; ii != None; ii = nodes[ii].nextSibling) {
+        const auto& member = nodes[ii];
+        if (member.keyEscaped) {
+            // We can't tell if this key is the one we're looking for
+            return None;
+        }
+        if (member.keyLength == length &&
+            std::memcmp(document.buf + member.keyBegin, name, length) == 0) {
+            return ii;
+        }
+    }
+    return None;
+}
+
+uint32_t SubdocIndex::findElement(const Node& array, int64_t position) const {
+    if (position == -1) {
+        return array.lastChild;
+    }
+
+    auto ii = array.firstChild;
+    while (ii != None && position > 0) {
+        ii = nodes[ii].nextSibling;
+        --position;
+    }
+    return ii;
+}
+
+bool SubdocIndex::lookup(cb::const_char_buffer path,
+                         cb::const_char_buffer& value) const {
+    if (nodes.empty() || path.len == 0) {
+        return false;
+    }
+
+    const char* ptr = path.buf;
+    const char* const end = path.buf + path.len;
+    uint32_t current = 0;
+    size_t components = 0;
+    std::string quoted;
+
+    while (ptr < end) {
+        if (++components > MaxPathComponents) {
+            return false;
+        }
+        const auto& node = nodes[current];
+
+        if (*ptr == '[') {
+            // Array index: [n] or [-1]
+            ++ptr;
+            int64_t position = 0;
+            if (end - ptr >= 2 && ptr[0] == '-' && ptr[1] == '1') {
+                position = -1;
+                ptr += 2;
+            } else if (ptr < end && *ptr == '0') {
+                ++ptr;
+            } else {
+                const auto* start = ptr;
+                while (ptr < end && *ptr >= '0' && *ptr <= '9') {
+                    position = (position * 10) + (*ptr - '0');
+                    ++ptr;
+                }
+                if (ptr == start || (ptr - start) > 9) {
+                    return false;
+                }
+            }
+            if (ptr == end || *ptr != ']') {
+                return false;
+            }
+            ++ptr;
+
+            if (node.type != Type::Array) {
+                return false;
+            }
+            current = findElement(node, position);
+        } else {
+            if (components > 1) {
+                // All but the first key need a separator
+                if (*ptr != '.') {
+                    return false;
+                }
+                ++ptr;
+            }
+
+            const char* name;
+            size_t length;
+            if (ptr < end && *ptr == '`') {
+                // Quoted key, where `` is an escaped backtick
+                quoted.clear();
+                ++ptr;
+                while (true) {
+                    if (ptr == end) {
+                        return false;
+                    }
+                    if (*ptr == '`') {
+                        if ((ptr + 1) < end && ptr[1] == '`') {
+                            quoted.push_back('`');
+                            ptr += 2;
+                        } else {
+                            ++ptr;
+                            break;
+                        }
+                    } else {
+                        quoted.push_back(*ptr);
+                        ++ptr;
+                    }
+                }
+                name = quoted.data();
+                length = quoted.size();
+            } else {
+                name = ptr;
+                while (ptr < end && *ptr != '.' && *ptr != '[') {
+                    if (*ptr == '`' || *ptr == ']') {
+                        return false;
+                    }
+                    ++ptr;
+                }
+                length = size_t(ptr - name);
+                if (length == 0) {
+                    return false;
+                }
+            }
+
+            if (node.type != Type::Object) {
+                return false;
+            }
+            current = findMember(node, name, length);
+        }
+
+        if (current == None) {
+            return false;
+        }
+    }
+
+    const auto& node = nodes[current];
+    value = {document.buf + node.begin, node.end - node.begin};
+    return true;
+}
@@ -0,0 +1,113 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2018 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include <platform/sized_buffer.h>
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+/**
+ * A structural index of a JSON document used to answer the lookups in a
+ * multi-path lookup without having subjson parse the document from the
+ * start for every path.
+ *
+ * The document is tokenised once into a tree of nodes holding the offsets
+ * of every value (and the key of every object member). Paths are then
+ * resolved by walking the tree.
+ *
+ * The index only answers the questions it is sure about: lookup() returns
+ * false if the path can't be resolved (the path doesn't exist, there is a
+ * type mismatch, or the path or the keys along the way use syntax the
+ * index doesn't handle, like escape sequences). The caller should then
+ * fall back to subjson, which will generate the correct error code.
+ */
+class SubdocIndex {
+public:
+    /**
+     * Build the index for the provided document. The document must
+     * outlive the index.
+     *
+     * @return true if the document was indexed, false if the document
+     *         isn't valid JSON (or is nested deeper than we allow)
+     */
+    bool build(cb::const_char_buffer doc);
+
+    /**
+     * Look up the value at the given path.
+     *
+     * @param path the subdoc path to resolve
+     * @param value set to the location of the value in the document
+     *              (including the quotes for strings)
+     * @return true if the value was located, false if the caller needs
+     *         to fall back to subjson
+     */
+    bool lookup(cb::const_char_buffer path,
+                cb::const_char_buffer& value) const;
+
+    /// The maximum nesting level we'll index (matches subjson's limit)
+    static const size_t MaxDepth = 32;
+
+    /// The maximum number of path components we'll resolve
+    static const size_t MaxPathComponents = 32;
+
+protected:
+    enum class Type : uint8_t { Object, Array, Scalar };
+
+    static const uint32_t None = std::numeric_limits<uint32_t>::max();
+
+    struct Node {
+        /// Offset of the first byte of the value
+        uint32_t begin;
+        /// Offset of the byte following the value
+        uint32_t end;
+        /// Offset of the first byte of the key (within the quotes) for
+        /// members of an object
+        uint32_t keyBegin;
+        uint32_t keyLength;
+        /// The next member of the parent container
+        uint32_t nextSibling;
+        /// The first and last member (for objects and arrays)
+        uint32_t firstChild;
+        uint32_t lastChild;
+        Type type;
+        /// Set if the key contains escape sequences (we don't unescape
+        /// the keys, so they can't be compared with the path)
+        bool keyEscaped;
+    };
+
+    /**
+     * Find the member of the object with the given name
+     * @return the index of the node, or None if it doesn't exist (or we
+     *         couldn't compare all of the keys)
+     */
+    uint32_t findMember(const Node& object,
+                        const char* name,
+                        size_t length) const;
+
+    /**
+     * Find the element at the given position in the array (-1 is the
+     * last element)
+     * @return the index of the node, or None if it doesn't exist
+     */
+    uint32_t findElement(const Node& array, int64_t position) const;
+
+    cb::const_char_buffer document;
+    std::vector<Node> nodes;
+};
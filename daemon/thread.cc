@@ -464,9 +464,10 @@ void notify_dispatcher() {
 
 /******************************* GLOBAL STATS ******************************/
 
-void threadlocal_stats_reset(std::vector<thread_stats>& thread_stats) {
+void threadlocal_stats_reset(
+        std::vector<cb::CachelinePadded<thread_stats>>& thread_stats) {
     for (auto& ii : thread_stats) {
-        ii.reset();
+        ii->reset();
     }
 }
 
@@ -538,6 +539,20 @@ LIBEVENT_THREAD::~LIBEVENT_THREAD() {
     }
 }
 
+void threads_get_buffer_pool_stats(PipePool::Stats& read,
+                                   PipePool::Stats& write) {
+    read = {};
+    write = {};
+    for (const auto& thr : threads) {
+        const auto r = thr.read.getStats();
+        read.count += r.count;
+        read.bytes += r.bytes;
+        const auto w = thr.write.getStats();
+        write.count += w.count;
+        write.bytes += w.bytes;
+    }
+}
+
 void threads_notify_bucket_deletion() {
     for (auto& thr : threads) {
         notify_thread(thr);
@@ -141,6 +141,11 @@ void TimingHistogram::add(const std::chrono::nanoseconds nsec) {
 }
 
 std::string TimingHistogram::to_string(void) {
+    auto json = to_json();
+    return ::to_string(json, false);
+}
+
+unique_cJSON_ptr TimingHistogram::to_json(void) {
     unique_cJSON_ptr json(cJSON_CreateObject());
     cJSON* root = json.get();
 
@@ -181,11 +186,8 @@ std::string TimingHistogram::to_string(void) {
 
     // for backwards compatibility, add the old wayouts
     cJSON_AddNumberToObject(root, "wayout", aggregate_wayout());
-    char *ptr = cJSON_PrintUnformatted(root);
-    std::string ret(ptr);
-    cJSON_Free(ptr);
 
-    return ret;
+    return json;
 }
 
 /* get functions of Timings class */
@@ -16,6 +16,7 @@
  */
 #pragma once
 
+#include <cJSON_utils.h>
 #include <platform/platform.h>
 #include <relaxed_atomic.h>
 #include <array>
@@ -43,6 +44,7 @@ public:
     void reset(void);
     void add(const std::chrono::nanoseconds nsec);
     std::string to_string(void);
+    unique_cJSON_ptr to_json(void);
     uint32_t get_ns();
     uint32_t get_usec(const uint8_t index);
     uint32_t get_msec(const uint8_t index);
@@ -17,14 +17,34 @@
 #include "timings.h"
 #include <memcached/protocol_binary.h>
 #include <platform/platform.h>
+#include "settings.h"
 #include "timing_histogram.h"
 
 Timings::Timings() {
+    for (auto& h : hdr) {
+        h.store(nullptr);
+    }
     reset();
 }
 
+Timings::~Timings() {
+    for (auto& h : hdr) {
+        delete h.exchange(nullptr);
+    }
+}
+
 Timings& Timings::operator=(const Timings& other) {
     timings = other.timings;
+    for (int ii = 0; ii < MAX_NUM_OPCODES; ++ii) {
+        auto* src = other.hdr[ii].load();
+        if (src != nullptr) {
+            auto& dst = getHdrHistogram(uint8_t(ii));
+            dst.reset();
+            dst += *src;
+        } else if (hdr[ii].load() != nullptr) {
+            hdr[ii].load()->reset();
+        }
+    }
     interval_latency_lookups = other.interval_latency_lookups;
     interval_latency_mutations = other.interval_latency_mutations;
     return *this;
@@ -33,6 +53,10 @@ Timings& Timings::operator=(const Timings& other) {
 void Timings::reset(void) {
     for (int ii = 0; ii < MAX_NUM_OPCODES; ++ii) {
         timings[ii].reset();
+        auto* h = hdr[ii].load();
+        if (h != nullptr) {
+            h->reset();
+        }
     }
 
     {
@@ -45,13 +69,35 @@ void Timings::reset(void) {
 void Timings::collect(const uint8_t opcode,
                       const std::chrono::nanoseconds nsec) {
     timings[opcode].add(nsec);
+    getHdrHistogram(opcode).add(nsec);
     auto& interval = interval_counters[opcode];
     interval.count++;
     interval.duration_ns += nsec.count();
 }
 
 std::string Timings::generate(const uint8_t opcode) {
-    return timings[opcode].to_string();
+    auto json = timings[opcode].to_json();
+    auto* h = hdr[opcode].load();
+    if (h != nullptr) {
+        cJSON_AddItemToObject(json.get(), "hdr", h->to_json().release());
+    }
+    return to_string(json, false);
+}
+
+HdrHistogram& Timings::getHdrHistogram(uint8_t opcode) {
+    auto* ret = hdr[opcode].load();
+    if (ret != nullptr) {
+        return *ret;
+    }
+
+    // First time we see this opcode; try to install a new histogram
+    // (another thread may beat us to it)
+    std::unique_ptr<HdrHistogram> histogram(
+            new HdrHistogram(settings.getTimingsPrecision()));
+    if (hdr[opcode].compare_exchange_strong(ret, histogram.get())) {
+        return *histogram.release();
+    }
+    return *ret;
 }
 
 static const uint8_t timings_mutations[] = {
@@ -18,10 +18,12 @@
 
 #include <platform/platform.h>
 #include <array>
+#include <atomic>
 #include <string>
 #include <mutex>
 #include <cstdint>
 
+#include "hdr_histogram.h"
 #include "timing_histogram.h"
 #include "timing_interval.h"
 
@@ -33,6 +35,7 @@
 class Timings {
 public:
     Timings(void);
+    ~Timings();
     Timings& operator=(const Timings& other);
     Timings(const Timings&) = delete;
 
@@ -55,5 +58,15 @@ private:
     cb::sampling::IntervalSeries interval_latency_lookups;
     cb::sampling::IntervalSeries interval_latency_mutations;
     std::array<TimingHistogram, MAX_NUM_OPCODES> timings;
+
+    /**
+     * High resolution histograms for each opcode. They're allocated the
+     * first time we see the opcode (most buckets only ever see a handful
+     * of the opcodes), and never released until the Timings object
+     * is destroyed so that the recording path doesn't need any locks.
+     */
+    std::array<std::atomic<HdrHistogram*>, MAX_NUM_OPCODES> hdr;
+
+    HdrHistogram& getHdrHistogram(uint8_t opcode);
     std::array<cb::sampling::Interval, MAX_NUM_OPCODES> interval_counters;
 };
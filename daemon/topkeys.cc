@@ -18,12 +18,14 @@
 #include "config.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cstring>
 #include <sys/types.h>
 #include <stdexcept>
 #include <stdlib.h>
 #include <inttypes.h>
 #include <platform/platform.h>
+#include <unordered_map>
 
 #include "topkeys.h"
 
@@ -32,94 +34,54 @@
  *
  * === TopKeys ===
  *
- * The TopKeys class is split into NUM_SHARDS shards, each which owns
- * 1/NUM_SHARDS of the keyspace. This is to allow some level of
- * concurrent access - each shard has a mutex guarding all access.
- * Other than that the TopKeys class is pretty uninteresting - it
- * simply passes on requests to the correct Shard, and when statistics
- * are requested it aggregates information from each shard.
+ * The TopKeys class is split into a number of shards (at least one per
+ * front end thread). Each thread records its accesses in "its" shard
+ * (assigned the first time the thread records an access) so that the
+ * front end threads don't contend with each other on the hot path. Each
+ * shard still has a mutex, but it is normally only taken by the owning
+ * thread (and the thread reading the stats).
  *
- * === TopKeys::Shard ===
- *
- * This is where the action happens. Each Shard maintains an ordered
- * list of key names and related statistics, orded by when they were
- * last accessed. There is a fixed number of keys each Shard tracks.
-
- * Given we generally track only a small number of keys per shard (10
- * by default), it's highly likely that any one key access will 'miss'
- * - i.e. not find an existing topkey. Therefore this class is
- * optimized for that case, attempting to minimise memory allocation
- * in steady-state.
- *
- * Internally Shard consists of a vector of topkey_t, storing the
- * current max_keys top_keys, and a list of topkey_t pointers, used to
- * main the current most -> least recently used ordering:
-
- * max_keys elements. Each element is a tuple of
- * {hash(key), key, topkey_stats}:
+ * When statistics are requested the summaries from all of the shards
+ * are merged, and the most frequently accessed keys are reported.
  *
+ * === TopKeys::Shard ===
  *
- *       vector<topkey_t>
- *   +----------+-------------+---------------+
- *   | size_t   | std::string | topkey_item_t |
- *   +----------+-------------+---------------+
- *   | <hash 1> | <key 1>     | stats 1       | <--- Node1
- *   | <hash 2> | <key 2>     | stats 2       | <--- Node2
- *   | <hash 3> | <key 3>     | stats 3       | <--- Node3
- *   . ....                                   .
- *   | <hash N> | <key N>     | stats N       | <--- NodeN
- *   +----------------------------------------+
- *
- *   Node3 <---> Node1 <---> ... <---> Node2
- *   ^^^                               ^^^
- *   MRU                               LRU
+ * Each Shard tracks the max_keys most frequently accessed keys by using
+ * the "space saving" algorithm (Metwally et. al.):
  *
+ *   - if the key is already tracked its count is incremented.
+ *   - if there is room for another key the key is added with a count of 1.
+ *   - otherwise the key with the lowest count is replaced by the new key,
+ *     which inherits its count (+1). The inherited count is the
+ *     maximum overestimation (error) of the new keys count.
  *
- * Upon a key 'hit', TopKeys::updateKey() is called. That hashes the
- * key, and finds the Shard responsible for that
- * key. TopKeys::Shard::updateKey() is then called.
+ * Any key accessed more than (total accesses / max_keys) times is
+ * guaranteed to be tracked, and the reported count never overestimates
+ * the real count by more than the error.
  *
- * Shard::updateKey() iterates over the vector, searching for a hash
- * match with an existing element, using the actual key string to
- * validate (in case of a hash collision). If it is found, then the
- * stats are simply updated.  If it is not found, then the
- * least-recently-used element is selected as a 'victim' and it's
- * contents is replaced by the incoming key.  Finally the linked-list
- * is updated to move the updated element to the head of the list.
+ * Internally the Shard consists of a vector of counters (the hash of
+ * the key, the count, the error and the creation time) and a parallel
+ * vector holding the actual keys. An update is a single linear scan over
+ * the (small) counter vector which locates both the key (by its hash,
+ * using the actual key string to validate in case of a hash collision)
+ * and the least frequent key (the victim if the key isn't found).
  */
 
-
-TopKeys::TopKeys(int mkeys) {
+TopKeys::TopKeys(int mkeys)
+    : max_keys(size_t(mkeys) * NUM_SHARDS),
+      shards(std::max(int(NUM_SHARDS), settings.getNumWorkerThreads())) {
     for (auto& shard : shards) {
-        shard.setMaxKeys(mkeys);
+        shard.setMaxKeys(mkeys * NUM_SHARDS);
     }
 }
 
 TopKeys::~TopKeys() {
 }
 
-TopKeys::Shard& TopKeys::getShard(size_t key_hash) {
-    /* This is special-cased for 8 */
-    static_assert(NUM_SHARDS == 8,
-                  "Topkeys::getShard() special-cased for SHARDS==8");
-    return shards[key_hash & 0x7];
-}
-
-TopKeys::Shard::topkey_t*
-TopKeys::Shard::searchForKey(size_t key_hash,
-                             const cb::const_char_buffer& key) {
-
-    for (auto& topkey : storage) {
-        if (topkey.first.hash == key_hash) {
-            // Double-check with full compare
-            if (topkey.first.key.compare(0, topkey.first.key.size(),
-                                         key.buf, key.len) == 0) {
-                // Match found.
-                return &topkey;
-            }
-        }
-    }
-    return nullptr;
+TopKeys::Shard& TopKeys::getThreadShard() {
+    static std::atomic<size_t> next_thread_id{0};
+    thread_local size_t thread_id = next_thread_id++;
+    return shards[thread_id % shards.size()];
 }
 
 bool TopKeys::Shard::updateKey(const cb::const_char_buffer& key,
@@ -128,44 +90,35 @@ bool TopKeys::Shard::updateKey(const cb::const_char_buffer& key,
     try {
         std::lock_guard<std::mutex> lock(mutex);
 
-        topkey_t* found_key = searchForKey(key_hash, key);
-
-        if (found_key == NULL) {
-            // Key not found.
-            if (storage.size() == max_keys) {
-                // Re-use the lowest keys' storage.
-                found_key = list.back();
-                found_key->first.hash = key_hash;
-                found_key->first.key.assign(key.buf, key.len);
-                found_key->second = topkey_item_t(ct);
-
-                // Move back element to the front, shuffling down the
-                // rest.
-                list.splice(list.begin(), list, --list.end());
-
-            } else {
-                // add a new element to the storage array.
-
-                storage.emplace_back(
-                    std::make_pair(KeyId{key_hash,
-                                         std::string(key.buf, key.len)},
-                                   topkey_item_t(ct)));
-                found_key = &storage.back();
-
-                // Insert the new item to the front of the list
-                list.push_front(found_key);
+        size_t victim = 0;
+        for (size_t ii = 0; ii < counters.size(); ++ii) {
+            auto& counter = counters[ii];
+            if (counter.hash == key_hash &&
+                keys[ii].compare(0, keys[ii].size(), key.buf, key.len) == 0) {
+                // Match found.
+                counter.count++;
+                return true;
+            }
+            if (counter.count < counters[victim].count) {
+                victim = ii;
             }
-        } else {
-            // Found - shuffle to the front.
-            auto it = std::find(list.begin(), list.end(),
-                                found_key);
-            list.splice(list.begin(), list, it);
         }
 
-        // Increment access count.
-        found_key->second.ti_access_count++;
+        // Key not found.
+        if (counters.size() < max_keys) {
+            keys.emplace_back(key.buf, key.len);
+            counters.push_back(Counter{key_hash, 1, 0, ct});
+        } else if (!counters.empty()) {
+            // Replace the least frequently accessed key (and inherit
+            // its count)
+            auto& counter = counters[victim];
+            keys[victim].assign(key.buf, key.len);
+            counter.hash = key_hash;
+            counter.error = counter.count;
+            counter.count++;
+            counter.ctime = ct;
+        }
         return true;
-
     } catch (const std::bad_alloc&) {
         // Failed to update.
         return false;
@@ -184,7 +137,7 @@ void TopKeys::doUpdateKey(const void* key,
         std::hash<cb::const_char_buffer > hash_fn;
         const size_t key_hash = hash_fn(key_buf);
 
-        getShard(key_hash).updateKey(key_buf, key_hash, operation_time);
+        getThreadShard().updateKey(key_buf, key_hash, operation_time);
     } catch (const std::bad_alloc&) {
         // Failed to increment topkeys, continue...
     }
@@ -255,10 +208,7 @@ ENGINE_ERROR_CODE TopKeys::doStats(const void* cookie,
                                    rel_time_t current_time,
                                    ADD_STAT add_stat) {
     struct tk_context context(cookie, add_stat, current_time, nullptr);
-
-    for (auto& shard : shards) {
-        shard.accept_visitor(tk_iterfunc, &context);
-    }
+    accept_visitor(tk_iterfunc, &context);
 
     return ENGINE_SUCCESS;
 }
@@ -279,18 +229,52 @@ ENGINE_ERROR_CODE TopKeys::do_json_stats(cJSON* object,
     struct tk_context context(nullptr, nullptr, current_time, topkeys);
 
     /* Collate the topkeys JSON object */
-    for (auto& shard : shards) {
-        shard.accept_visitor(tk_jsonfunc, &context);
-    }
+    accept_visitor(tk_jsonfunc, &context);
 
     cJSON_AddItemToObject(object, "topkeys", topkeys);
     return ENGINE_SUCCESS;
 }
 
-void TopKeys::Shard::accept_visitor(iterfunc_t visitor_func,
-                                    void* visitor_ctx) {
-    std::lock_guard<std::mutex> lock(mutex);
-    for (const auto key : list) {
-        visitor_func(key->first.key, key->second, visitor_ctx);
+void TopKeys::accept_visitor(iterfunc_t visitor_func, void* visitor_ctx) {
+    // The same key may be tracked by multiple threads so we need to
+    // merge the counts before we can find the top keys.
+    struct Merged {
+        uint32_t count;
+        rel_time_t ctime;
+    };
+    std::unordered_map<std::string, Merged> merged;
+    for (auto& shard : shards) {
+        shard.forEach([&merged](const std::string& key,
+                                const Shard::Counter& counter) {
+            auto iter = merged.find(key);
+            if (iter == merged.end()) {
+                merged.emplace(key, Merged{counter.count, counter.ctime});
+            } else {
+                iter->second.count += counter.count;
+                iter->second.ctime = std::min(iter->second.ctime,
+                                              counter.ctime);
+            }
+        });
+    }
+
+    typedef std::unordered_map<std::string, Merged>::const_iterator entry_t;
+    std::vector<entry_t> entries;
+    entries.reserve(merged.size());
+    for (auto iter = merged.cbegin(); iter != merged.cend(); ++iter) {
+        entries.push_back(iter);
+    }
+
+    const auto num = std::min(max_keys, entries.size());
+    std::partial_sort(entries.begin(),
+                      entries.begin() + num,
+                      entries.end(),
+                      [](const entry_t& a, const entry_t& b) {
+                          return a->second.count > b->second.count;
+                      });
+
+    for (size_t ii = 0; ii < num; ++ii) {
+        topkey_item_t item(entries[ii]->second.ctime);
+        item.ti_access_count = int(entries[ii]->second.count);
+        visitor_func(entries[ii]->first, item, visitor_ctx);
     }
 }
@@ -18,21 +18,19 @@
 
 #include "settings.h"
 
-#include <array>
 #include <platform/sized_buffer.h>
 #include <memcached/engine.h>
 #include <cJSON.h>
 
 #include <mutex>
-#include <list>
 #include <string>
 #include <vector>
 
 /*
  * TopKeys
  *
- * Tracks the top N most recently accessed keys. The details are
- * accessible by a stats call, which is used by ns_server to print the
+ * Tracks the (approximately) N most frequently accessed keys. The details
+ * are accessible by a stats call, which is used by ns_server to print the
  * top keys list in the GUI.
  */
 
@@ -51,7 +49,7 @@ class TopKeys {
 public:
     /* Constructor.
      * @param mkeys Number of keys stored in each shard (i.e. up to
-     * mkeys * SHARDS will be tracked).
+     * mkeys * NUM_SHARDS will be reported).
      */
     explicit TopKeys(int mkeys);
     ~TopKeys();
@@ -104,79 +102,91 @@ protected:
     ENGINE_ERROR_CODE do_json_stats(cJSON* object, rel_time_t current_time);
 
 private:
-    // Number of shards the keyspace is broken into. Permits some level of
-    // concurrent update (there is one mutex per shard).
+    // The number of keys reported is mkeys * NUM_SHARDS (kept from
+    // when the keyspace was split into 8 shards)
     static const int NUM_SHARDS = 8;
 
     class Shard;
 
-    Shard& getShard(size_t key_hash);
+    /**
+     * Get the shard the calling thread should record its accesses in.
+     * Each thread is assigned a shard the first time it records
+     * an access so that the front end threads don't contend with
+     * each other.
+     */
+    Shard& getThreadShard();
+
+    typedef void (*iterfunc_t)(const std::string& key,
+                               const topkey_item_t& it,
+                               void* arg);
+
+    /**
+     * Merge the summaries from all of the shards, and invoke the
+     * callback for the (up to) max_keys most frequently accessed keys
+     * ordered by their access count.
+     */
+    void accept_visitor(iterfunc_t visitor_func, void* visitor_ctx);
 
-    // One of N Shards which the keyspace has been broken
-    // into.
-    // Responsible for tracking the top {mkeys} within it's keyspace.
+    // Records the accesses made by one (or more) threads, and tracks the
+    // {max_keys} most frequently accessed keys by using the
+    // "space saving" algorithm.
     class Shard {
     public:
 
         void setMaxKeys(int mkeys) {
             max_keys = mkeys;
-            storage.reserve(max_keys);
-            // reallocating storage invalidates the LRU list.
-            list.clear();
+            counters.reserve(max_keys);
+            keys.reserve(max_keys);
         }
 
-        // Updates the topkey 'ranking' for the specified key.
-        // If the item does not exist it will be created (with it's creation
-        // time set to operation_time), otherwise the existing item will be
-        // updated.
+        // Updates the topkey count for the specified key. If the key isn't
+        // tracked it replaces the key with the lowest count (and inherits
+        // its count), otherwise the existing count will be incremented.
         // On success returns true, If insufficient memory to create a
         // new item, returns false.
         bool updateKey(const cb::const_char_buffer& key,
                        size_t key_hash,
                        rel_time_t operation_time);
 
-        typedef void (*iterfunc_t)(const std::string& key,
-                                   const topkey_item_t& it,
-                                   void *arg);
+        struct Counter {
+            size_t hash;
+            // The (over)estimated number of accesses to the key
+            uint32_t count;
+            // The maximum overestimation of the count (the count we
+            // inherited when the key replaced another key)
+            uint32_t error;
+            rel_time_t ctime;
+        };
 
         /* For each key in this shard, invoke the given callback function.
          */
-        void accept_visitor(iterfunc_t visitor_func, void* visitor_ctx);
+        template <typename F>
+        void forEach(F callback) {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (size_t ii = 0; ii < counters.size(); ++ii) {
+                callback(keys[ii], counters[ii]);
+            }
+        }
 
     private:
-
-        struct KeyId {
-            size_t hash;
-            std::string key;
-        };
-
-        // Pair of the key's string and the statistics related to it.
-        typedef std::pair<KeyId, topkey_item_t> topkey_t;
-
-        // An ordered list of topkey_t*, used for LRU.
-        typedef std::list<topkey_t*> key_history_t;
-
-        // Vector topket_t, used for actual topke storage.
-        typedef std::vector<topkey_t> key_storage_t;
-
-        // Searches for the given key. If found returns a pointer to the
-        // topkey_t, else returns NULL.
-        topkey_t* searchForKey(size_t hash, const cb::const_char_buffer& key);
-
         // Maxumum numbers of keys to be tracked per shard.
         unsigned int max_keys;
 
-        // mutex to serial access to this shard.
+        // mutex to serial access to this shard. The shard is normally
+        // only used by a single thread so the mutex is uncontended
+        // (except when someone is reading the stats)
         std::mutex mutex;
 
-        // list of keys, ordered from most-recently used (front) to least recently
-        // used (back).
-        key_history_t list;
-
-        // Underlying topkey storage.
-        key_storage_t storage;
+        // The counters are kept separate from the keys so that the
+        // search for a key (and the least frequent key) is a linear
+        // scan over a small array.
+        std::vector<Counter> counters;
+        std::vector<std::string> keys;
     };
 
-    // array of topkey shards.
-    std::array<Shard, NUM_SHARDS> shards;
+    // The maximum number of keys to report
+    const size_t max_keys;
+
+    // The shards used by the threads
+    std::vector<Shard> shards;
 };
@@ -78,6 +78,34 @@ Task::Status StaleTraceDumpRemover::periodicExecute() {
     return Status::Continue; // always repeat
 }
 
+SlowTraceLog slowTraceLog;
+
+void SlowTraceLog::add(uint8_t opcode,
+                       uint32_t connectionId,
+                       std::chrono::microseconds duration,
+                       const cb::tracing::Tracer& tracer) {
+    // Format the spans outside the lock
+    auto trace = to_string(tracer);
+    std::lock_guard<std::mutex> lh(mutex);
+    auto& entry = entries[added % Capacity];
+    entry.opcode = opcode;
+    entry.connectionId = connectionId;
+    entry.duration = duration;
+    entry.trace = std::move(trace);
+    ++added;
+}
+
+std::vector<SlowTraceLog::Entry> SlowTraceLog::getEntries() const {
+    std::vector<Entry> ret;
+    std::lock_guard<std::mutex> lh(mutex);
+    const size_t first = added > Capacity ? added - Capacity : 0;
+    ret.reserve(added - first);
+    for (size_t ii = first; ii < added; ++ii) {
+        ret.push_back(entries[ii % Capacity]);
+    }
+    return ret;
+}
+
 static TraceDumps traceDumps;
 static std::shared_ptr<StaleTraceDumpRemover> dump_remover;
 
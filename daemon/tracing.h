@@ -23,6 +23,13 @@
 #include <phosphor/phosphor.h>
 #include <phosphor/tools/export.h>
 #include <stddef.h>
+#include <tracing/tracer.h>
+
+#include <array>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
 
 #include "memcached.h"
 #include "utilities/string_utilities.h"
@@ -147,3 +154,52 @@ ENGINE_ERROR_CODE ioctlSetTracingStart(Cookie& cookie,
 ENGINE_ERROR_CODE ioctlSetTracingStop(Cookie& cookie,
                                       const StrToStrMap& arguments,
                                       const std::string& value);
+
+/**
+ * The SlowTraceLog keeps the spans recorded for the most recent requests
+ * which exceeded the slow op threshold for their opcode (only requests
+ * with tracing enabled, or picked by the sampling, record spans). It
+ * allows for explaining the outliers after the fact, and is available
+ * through "stats slow_traces".
+ *
+ * The log is a fixed size ring buffer, so the oldest entry is replaced
+ * once it is full.
+ */
+class SlowTraceLog {
+public:
+    /// The number of traces kept in the log
+    static const size_t Capacity = 100;
+
+    struct Entry {
+        uint8_t opcode = 0;
+        uint32_t connectionId = 0;
+        std::chrono::microseconds duration{0};
+        std::string trace;
+    };
+
+    /**
+     * Add a trace to the log (replacing the oldest if the log is full)
+     *
+     * @param opcode the opcode of the request
+     * @param connectionId the id of the connection executing the request
+     * @param duration the total duration of the request
+     * @param tracer the spans recorded for the request
+     */
+    void add(uint8_t opcode,
+             uint32_t connectionId,
+             std::chrono::microseconds duration,
+             const cb::tracing::Tracer& tracer);
+
+    /**
+     * Get the traces currently in the log (oldest first)
+     */
+    std::vector<Entry> getEntries() const;
+
+protected:
+    mutable std::mutex mutex;
+    std::array<Entry, Capacity> entries;
+    /// The total number of traces added to the log
+    size_t added = 0;
+};
+
+extern SlowTraceLog slowTraceLog;
@@ -0,0 +1,177 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2018 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * Benchmarks for the PagingVisitor - comparing the eviction policies under a
+ * skewed workload, both in terms of speed and of how well they keep the
+ * frequently accessed (hot) items resident.
+ */
+
+#include "engine_fixture.h"
+
+#include "ep_bucket.h"
+#include "item_eviction.h"
+#include "kv_bucket.h"
+#include "paging_visitor.h"
+
+#include <mock/mock_synchronous_ep_engine.h>
+#include <valgrind/valgrind.h>
+
+#include <gtest/gtest.h>
+
+#include <random>
+
+class ItemPagerBench : public EngineFixture {
+protected:
+    void SetUp(const benchmark::State& state) override {
+        EngineFixture::SetUp(state);
+        engine->getKVBucket()->setVBucketState(0, vbucket_state_active, false);
+        engine->getKVBucket()->getVBucket(vbid)->ht.resize(numItems);
+    }
+
+    std::string makeKey(size_t i) {
+        return "key" + std::to_string(i);
+    }
+
+    /// (Re)store all of the items, and persist them so they can be evicted
+    void populate() {
+        const std::string value(256, 'x');
+        for (size_t i = 0; i < numItems; ++i) {
+            auto item = make_item(vbid, makeKey(i), value);
+            ASSERT_EQ(ENGINE_SUCCESS, engine->getKVBucket()->set(item, cookie));
+        }
+        auto& ep = dynamic_cast<EPBucket&>(*engine->getKVBucket());
+        ep.flushVBucket(vbid);
+    }
+
+    /**
+     * Access the items with a skewed distribution: 80% of the accesses go
+     * to the first 20% of the items (the hot items).
+     */
+    void access(std::mt19937& gen) {
+        auto vb = engine->getKVBucket()->getVBucket(vbid);
+        std::uniform_int_distribution<size_t> hot(0, numHotItems - 1);
+        std::uniform_int_distribution<size_t> cold(numHotItems, numItems - 1);
+        std::bernoulli_distribution isHot(0.8);
+        for (size_t i = 0; i < numAccesses; ++i) {
+            const auto key = makeKey(isHot(gen) ? hot(gen) : cold(gen));
+            vb->ht.find(StoredDocKey(key, DocNamespace::DefaultCollection),
+                        TrackReference::Yes,
+                        WantsDeleted::No);
+        }
+    }
+
+    /// @return the number of hot items which are still resident
+    size_t countResidentHotItems() {
+        auto vb = engine->getKVBucket()->getVBucket(vbid);
+        size_t resident = 0;
+        for (size_t i = 0; i < numHotItems; ++i) {
+            auto* v = vb->ht.find(
+                    StoredDocKey(makeKey(i), DocNamespace::DefaultCollection),
+                    TrackReference::No,
+                    WantsDeleted::No);
+            if (v && v->isResident()) {
+                ++resident;
+            }
+        }
+        return resident;
+    }
+
+    /**
+     * Set the watermarks so that the PagingVisitor will try to evict the
+     * given fraction of the items (with an activeBias of 1).
+     */
+    void setWatermarks(double fraction) {
+        auto& stats = engine->getEpStats();
+        const auto current = double(stats.getTotalMemoryUsed());
+        stats.mem_low_wat = size_t(current * (1 - fraction));
+        // Below the current usage, otherwise the active vbucket is skipped
+        stats.mem_high_wat = size_t(current * (1 - fraction / 2));
+    }
+
+    // Use a small number of items when running under Valgrind where there's
+    // no sense in measuring performance.
+    const size_t numItems = RUNNING_ON_VALGRIND ? 100 : 100000;
+    const size_t numHotItems = numItems / 5;
+    const size_t numAccesses = numItems * 2;
+};
+
+/*
+ * Visit the vbucket with a PagingVisitor trying to evict 10% of the items,
+ * after accessing the items with a skewed distribution.
+ * Variables:
+ *  - range(0) : The eviction policy (0: 2-bit_lru, 1: hifi_mfu)
+ */
+BENCHMARK_DEFINE_F(ItemPagerBench, Visit)(benchmark::State& state) {
+    EvictionPolicy policy;
+    switch (state.range(0)) {
+    case 0:
+        state.SetLabel("2-bit_lru");
+        policy = EvictionPolicy::lru2Bit;
+        break;
+    case 1:
+        state.SetLabel("hifi_mfu");
+        policy = EvictionPolicy::hifi_mfu;
+        break;
+    default:
+        FAIL() << "Invalid input param(0) value:" << state.range(0);
+    }
+
+    auto& stats = engine->getEpStats();
+    auto available = std::make_shared<std::atomic<bool>>(false);
+    // The item pager only randomly evicts referenced items (which all of
+    // the items are after populate()) in the PAGING_RANDOM phase.
+    std::atomic<item_pager_phase> phase{PAGING_RANDOM};
+    std::mt19937 gen(1);
+
+    size_t visits = 0;
+    size_t ejected = 0;
+    size_t hotResident = 0;
+    while (state.KeepRunning()) {
+        state.PauseTiming();
+        populate();
+        access(gen);
+        setWatermarks(0.1);
+        state.ResumeTiming();
+
+        PagingVisitor pv(*engine->getKVBucket(),
+                         stats,
+                         0.1,
+                         available,
+                         ITEM_PAGER,
+                         false,
+                         1.0,
+                         &phase,
+                         policy);
+        auto vb = engine->getKVBucket()->getVBucket(vbid);
+        pv.visitBucket(vb);
+
+        state.PauseTiming();
+        ++visits;
+        ejected += pv.numEjected();
+        hotResident += countResidentHotItems();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(visits * numItems);
+    state.counters["EjectedPerVisit"] = double(ejected) / visits;
+    // The fraction of the hot items still resident after the visit - the
+    // higher the better.
+    state.counters["HotResidentRatio"] =
+            double(hotResident) / (visits * numHotItems);
+}
+
+BENCHMARK_REGISTER_F(ItemPagerBench, Visit)->Arg(0)->Arg(1);
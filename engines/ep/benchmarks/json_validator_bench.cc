@@ -0,0 +1,141 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2018 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * Benchmarks for detecting if a document is JSON (which we do when the
+ * datatype needs to be determined on the write path, and when compaction
+ * upgrades documents written without a datatype). Compares JSON_checker
+ * with cb::json::checkUTF8JSON over a few typical document shapes.
+ */
+
+#include <JSON_checker.h>
+#include <benchmark/benchmark.h>
+#include <memcached/json_validator.h>
+
+#include <random>
+#include <string>
+
+enum class DocShape {
+    /// A typical user profile; mostly short keys and values
+    Profile,
+    /// Long text fields (comments, descriptions etc)
+    Text,
+    /// Arrays of numbers (time series, coordinates)
+    Numeric,
+    /// Non-ASCII text
+    Unicode,
+    /// Not JSON at all (compressed or binary data)
+    Binary
+};
+
+static std::string makeProfile(size_t id) {
+    return R"({"id":)" + std::to_string(id) +
+           R"(,"name":"Some Name","email":"some.name@example.com",)"
+           R"("active":true,"score":12.75,"address":{"street":"1 Main )"
+           R"(Street","city":"Springfield","zip":"12345"},)"
+           R"("tags":["alpha","beta","gamma"],"manager":null})";
+}
+
+static std::string makeDocument(DocShape shape, size_t size) {
+    std::string doc;
+    switch (shape) {
+    case DocShape::Profile:
+        doc = "[";
+        for (size_t ii = 0; doc.size() < size; ++ii) {
+            doc += (ii == 0 ? "" : ",") + makeProfile(ii);
+        }
+        doc += "]";
+        break;
+    case DocShape::Text:
+        doc = "[";
+        for (size_t ii = 0; doc.size() < size; ++ii) {
+            doc += (ii == 0 ? "" : ",");
+            doc += R"({"author":"someone","comment":")";
+            for (int jj = 0; jj < 20; ++jj) {
+                doc += "Lorem ipsum dolor sit amet, consectetur adipiscing "
+                       "elit, sed do eiusmod tempor incididunt. ";
+            }
+            doc += R"(\n-- \"quoted\""})";
+        }
+        doc += "]";
+        break;
+    case DocShape::Numeric:
+        doc = R"({"samples":[)";
+        for (size_t ii = 0; doc.size() < size; ++ii) {
+            doc += (ii == 0 ? "" : ",") + std::to_string(ii * 7919) + "." +
+                   std::to_string(ii % 100);
+        }
+        doc += "]}";
+        break;
+    case DocShape::Unicode:
+        doc = "[";
+        for (size_t ii = 0; doc.size() < size; ++ii) {
+            doc += (ii == 0 ? "" : ",");
+            doc += R"({"city":"Tromsø","greeting":"Привет мир, こんにちは)"
+                   R"(世界","currency":"€","emoji":"😀"})";
+        }
+        doc += "]";
+        break;
+    case DocShape::Binary: {
+        std::mt19937 gen(size);
+        std::uniform_int_distribution<int> dist(0, 255);
+        doc.resize(size);
+        for (auto& c : doc) {
+            c = char(dist(gen));
+        }
+        // Make it look like it starts as JSON so we don't reject it on
+        // the first byte
+        doc[0] = '[';
+        doc[1] = '"';
+        break;
+    }
+    }
+    return doc;
+}
+
+static void BM_JSONChecker(benchmark::State& state) {
+    const auto doc = makeDocument(DocShape(state.range(0)), state.range(1));
+    const auto* data = reinterpret_cast<const uint8_t*>(doc.data());
+    while (state.KeepRunning()) {
+        benchmark::DoNotOptimize(checkUTF8JSON(data, doc.size()));
+    }
+    state.SetBytesProcessed(state.iterations() * doc.size());
+}
+
+static void BM_JSONValidator(benchmark::State& state) {
+    const auto doc = makeDocument(DocShape(state.range(0)), state.range(1));
+    const auto* data = reinterpret_cast<const uint8_t*>(doc.data());
+    while (state.KeepRunning()) {
+        benchmark::DoNotOptimize(cb::json::checkUTF8JSON(data, doc.size()));
+    }
+    state.SetBytesProcessed(state.iterations() * doc.size());
+}
+
+static void DocumentArguments(benchmark::internal::Benchmark* b) {
+    for (auto shape : {DocShape::Profile,
+                       DocShape::Text,
+                       DocShape::Numeric,
+                       DocShape::Unicode,
+                       DocShape::Binary}) {
+        for (int size : {256, 16 * 1024, 1024 * 1024, 4 * 1024 * 1024}) {
+            b->Args({int(shape), size});
+        }
+    }
+}
+
+BENCHMARK(BM_JSONChecker)->Apply(DocumentArguments);
+BENCHMARK(BM_JSONValidator)->Apply(DocumentArguments);
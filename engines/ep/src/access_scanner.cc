@@ -30,7 +30,9 @@
 #include "stats.h"
 #include "vb_count_visitor.h"
 
+#include <algorithm>
 #include <numeric>
+#include <utility>
 
 class ItemAccessVisitor : public VBucketVisitor, public HashTableVisitor {
 public:
@@ -78,17 +80,23 @@ public:
                     "INFO: Skipping expired/deleted item: %" PRIu64,
                     v.getBySeqno());
             } else {
-                accessed.push_back(StoredDocKey(v.getKey()));
+                accessed.emplace_back(v.getBySeqno(), v.getKey());
                 return ++items_scanned < items_to_scan;
             }
         }
         return true;
     }
 
+    /**
+     * Write the keys of the current vBucket to the log in seqno order, so
+     * warmup reads the items in (roughly) the order they were written to
+     * disk.
+     */
     void update() {
         if (log != nullptr) {
-            for (auto it = accessed.begin(); it != accessed.end(); ++it) {
-                log->newItem(currentBucket->getId(), *it);
+            std::sort(accessed.begin(), accessed.end());
+            for (const auto& entry : accessed) {
+                log->newItem(currentBucket->getId(), entry.second, entry.first);
             }
         }
         accessed.clear();
@@ -103,13 +111,16 @@ public:
         }
         HashTable::Position ht_start;
         if (vBucketFilter(vb->getId())) {
+            // Pause every items_to_scan items (to release the hash table
+            // locks), but only write the keys once the whole vBucket has
+            // been visited so they can be sorted by seqno.
             while (ht_start != vb->ht.endPosition()) {
                 ht_start = vb->ht.pauseResumeVisit(*this, ht_start);
-                update();
-                log->commit1();
-                log->commit2();
                 items_scanned = 0;
             }
+            update();
+            log->commit1();
+            log->commit2();
         }
     }
 
@@ -202,7 +213,8 @@ private:
     std::string name;
     uint16_t shardID;
 
-    std::vector<StoredDocKey> accessed;
+    /// The seqno and key of the resident items of the current vBucket
+    std::vector<std::pair<int64_t, StoredDocKey>> accessed;
 
     std::unique_ptr<MutationLog> log;
     std::atomic<bool> &stateFinalizer;
@@ -79,8 +79,30 @@ size_t BgFetcher::doFetch(VBucket::id_type vbId,
                 startTime.time_since_epoch())
                 .count());
 
+    // Record the time spent waiting for (and reading from) the disk in the
+    // trace of the requests. This must be done before completing the
+    // fetches, as the cookies may be released once they're notified.
+    auto* tracing = store->getEPEngine().getServerApi()->tracing;
+    auto forEachCookie = [&itemsToFetch](auto fn) {
+        for (const auto& fetch : itemsToFetch) {
+            for (const auto& itm : fetch.second.bgfetched_list) {
+                if (itm->cookie) {
+                    fn(itm->cookie);
+                }
+            }
+        }
+    };
+    forEachCookie([tracing](const void* cookie) {
+        tracing->end_trace(cookie, cb::tracing::TraceCode::BG_WAIT);
+        tracing->begin_trace(cookie, cb::tracing::TraceCode::BGFETCH);
+    });
+
     shard->getROUnderlying()->getMulti(vbId, itemsToFetch);
 
+    forEachCookie([tracing](const void* cookie) {
+        tracing->end_trace(cookie, cb::tracing::TraceCode::BGFETCH);
+    });
+
     std::vector<bgfetched_item_t> fetchedItems;
     for (const auto& fetch : itemsToFetch) {
         auto& key = fetch.first;
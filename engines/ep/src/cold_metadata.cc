@@ -0,0 +1,268 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2018 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "cold_metadata.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+
+static void putVarint(std::vector<uint8_t>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(uint8_t(value) | 0x80);
+        value >>= 7;
+    }
+    out.push_back(uint8_t(value));
+}
+
+static uint64_t getVarint(const uint8_t*& in, const uint8_t* end) {
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (in == end) {
+            break;
+        }
+        const uint8_t byte = *in++;
+        value |= uint64_t(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            return value;
+        }
+    }
+    throw std::logic_error("ColdMetadataBlock: corrupt varint");
+}
+
+// The CAS of the records isn't necessarily increasing with the seqno (e.g.
+// after a setWithMeta), so the deltas are zigzag encoded.
+static uint64_t zigzag(int64_t value) {
+    return (uint64_t(value) << 1) ^ uint64_t(value >> 63);
+}
+
+static int64_t unzigzag(uint64_t value) {
+    return int64_t(value >> 1) ^ -int64_t(value & 1);
+}
+
+namespace {
+/**
+ * The fields of a record, with the key pointing into the block (or the
+ * Record it was taken from) rather than owned.
+ */
+struct RecordView {
+    RecordView() = default;
+
+    explicit RecordView(const ColdMetadataBlock::Record& r)
+        : bySeqno(r.bySeqno),
+          cas(r.cas),
+          revSeqno(r.revSeqno),
+          exptime(r.exptime),
+          flags(r.flags),
+          datatype(r.datatype),
+          docNamespace(r.docNamespace),
+          key(reinterpret_cast<const uint8_t*>(r.key.data())),
+          keylen(r.key.size()) {
+    }
+
+    bool hasKey(const DocKey& other) const {
+        return docNamespace == other.getDocNamespace() &&
+               keylen == other.size() &&
+               std::memcmp(key, other.data(), keylen) == 0;
+    }
+
+    void toRecord(ColdMetadataBlock::Record& r) const {
+        r.bySeqno = bySeqno;
+        r.cas = cas;
+        r.revSeqno = revSeqno;
+        r.exptime = exptime;
+        r.flags = flags;
+        r.datatype = datatype;
+        r.docNamespace = docNamespace;
+        r.key.assign(reinterpret_cast<const char*>(key), keylen);
+    }
+
+    int64_t bySeqno = 0;
+    uint64_t cas = 0;
+    uint64_t revSeqno = 0;
+    uint32_t exptime = 0;
+    uint32_t flags = 0;
+    protocol_binary_datatype_t datatype = PROTOCOL_BINARY_RAW_BYTES;
+    DocNamespace docNamespace = DocNamespace::DefaultCollection;
+    const uint8_t* key = nullptr;
+    size_t keylen = 0;
+};
+} // anonymous namespace
+
+/**
+ * Decode the record at `in` and move past it. On entry r holds the bySeqno
+ * and CAS of the previous record (or zero), which the record's are encoded
+ * against.
+ */
+static void getRecord(const uint8_t*& in, const uint8_t* end, RecordView& r) {
+    r.bySeqno += int64_t(getVarint(in, end));
+    r.cas += uint64_t(unzigzag(getVarint(in, end)));
+    r.revSeqno = getVarint(in, end);
+    r.exptime = uint32_t(getVarint(in, end));
+    r.flags = uint32_t(getVarint(in, end));
+    r.keylen = getVarint(in, end);
+    if (size_t(end - in) < r.keylen + 2) {
+        throw std::logic_error("ColdMetadataBlock: truncated record");
+    }
+    r.datatype = *in++;
+    r.docNamespace = DocNamespace(*in++);
+    r.key = in;
+    in += r.keylen;
+}
+
+/// Encode a record, with its bySeqno and CAS relative to the previous one
+static void putRecord(std::vector<uint8_t>& out,
+                      const RecordView& r,
+                      int64_t prevSeqno,
+                      uint64_t prevCas) {
+    putVarint(out, uint64_t(r.bySeqno - prevSeqno));
+    putVarint(out, zigzag(int64_t(r.cas - prevCas)));
+    putVarint(out, r.revSeqno);
+    putVarint(out, r.exptime);
+    putVarint(out, r.flags);
+    putVarint(out, r.keylen);
+    out.push_back(r.datatype);
+    out.push_back(uint8_t(r.docNamespace));
+    out.insert(out.end(), r.key, r.key + r.keylen);
+}
+
+void ColdMetadataBlock::add(Record record) {
+    const RecordView added(record);
+
+    // Find the first record with a higher seqno, which the new one goes in
+    // front of. That record has to be re-encoded against the new one, so
+    // its bytes are replaced as well.
+    const uint8_t* const begin = data.data();
+    const uint8_t* const end = begin + data.size();
+    const uint8_t* in = begin;
+    RecordView r;
+    for (size_t ii = 0; ii < fingerprints.size(); ++ii) {
+        const uint8_t* const start = in;
+        const int64_t prevSeqno = r.bySeqno;
+        const uint64_t prevCas = r.cas;
+        getRecord(in, end, r);
+        if (r.bySeqno > added.bySeqno) {
+            std::vector<uint8_t> replacement;
+            putRecord(replacement, added, prevSeqno, prevCas);
+            putRecord(replacement, r, added.bySeqno, added.cas);
+            splice(start - begin, in - start, replacement);
+            fingerprints.insert(fingerprints.begin() + ii,
+                                fingerprint(record.getKey()));
+            fingerprints.shrink_to_fit();
+            return;
+        }
+    }
+
+    std::vector<uint8_t> appended;
+    putRecord(appended, added, r.bySeqno, r.cas);
+    splice(data.size(), 0, appended);
+    fingerprints.push_back(fingerprint(record.getKey()));
+    fingerprints.shrink_to_fit();
+}
+
+void ColdMetadataBlock::add(std::vector<Record> records) {
+    auto existing = decode();
+    std::move(records.begin(), records.end(), std::back_inserter(existing));
+    std::stable_sort(existing.begin(),
+                     existing.end(),
+                     [](const Record& a, const Record& b) {
+                         return a.bySeqno < b.bySeqno;
+                     });
+    encode(existing);
+}
+
+bool ColdMetadataBlock::remove(const DocKey& key, Record& record) {
+    const auto fp = fingerprint(key);
+    if (std::find(fingerprints.begin(), fingerprints.end(), fp) ==
+        fingerprints.end()) {
+        return false;
+    }
+
+    // Only decode as far as the record, and splice it out of the encoded
+    // data. The record after it (if any) is re-encoded against the one
+    // before it.
+    const uint8_t* const begin = data.data();
+    const uint8_t* const end = begin + data.size();
+    const uint8_t* in = begin;
+    RecordView r;
+    for (size_t ii = 0; ii < fingerprints.size(); ++ii) {
+        const uint8_t* const start = in;
+        const int64_t prevSeqno = r.bySeqno;
+        const uint64_t prevCas = r.cas;
+        getRecord(in, end, r);
+        if (fingerprints[ii] != fp || !r.hasKey(key)) {
+            continue;
+        }
+
+        r.toRecord(record);
+        std::vector<uint8_t> replacement;
+        if (ii + 1 < fingerprints.size()) {
+            getRecord(in, end, r);
+            putRecord(replacement, r, prevSeqno, prevCas);
+        }
+        splice(start - begin, in - start, replacement);
+        fingerprints.erase(fingerprints.begin() + ii);
+        fingerprints.shrink_to_fit();
+        return true;
+    }
+    return false;
+}
+
+std::vector<ColdMetadataBlock::Record> ColdMetadataBlock::decode() const {
+    std::vector<Record> records(fingerprints.size());
+    const uint8_t* in = data.data();
+    const uint8_t* end = in + data.size();
+    RecordView r;
+    for (auto& record : records) {
+        getRecord(in, end, r);
+        r.toRecord(record);
+    }
+    return records;
+}
+
+void ColdMetadataBlock::encode(const std::vector<Record>& records) {
+    std::vector<uint8_t> newFingerprints;
+    std::vector<uint8_t> newData;
+    newFingerprints.reserve(records.size());
+
+    int64_t bySeqno = 0;
+    uint64_t cas = 0;
+    for (const auto& r : records) {
+        newFingerprints.push_back(fingerprint(r.getKey()));
+        putRecord(newData, RecordView(r), bySeqno, cas);
+        bySeqno = r.bySeqno;
+        cas = r.cas;
+    }
+
+    // Don't keep any slack around; the whole point is to be compact.
+    newData.shrink_to_fit();
+    fingerprints = std::move(newFingerprints);
+    data = std::move(newData);
+}
+
+void ColdMetadataBlock::splice(size_t offset,
+                               size_t length,
+                               const std::vector<uint8_t>& replacement) {
+    std::vector<uint8_t> newData;
+    newData.reserve(data.size() - length + replacement.size());
+    newData.insert(newData.end(), data.begin(), data.begin() + offset);
+    newData.insert(newData.end(), replacement.begin(), replacement.end());
+    newData.insert(
+            newData.end(), data.begin() + offset + length, data.end());
+    data = std::move(newData);
+}
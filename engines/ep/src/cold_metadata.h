@@ -0,0 +1,123 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2018 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include "config.h"
+
+#include <memcached/dockey.h>
+#include <memcached/protocol_binary.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * A compact encoding of the metadata of a set of cold items.
+ *
+ * A non-resident item in the HashTable still costs a whole StoredValue
+ * (chain pointer, CAS, seqnos, lock/expiry times, flags, the bit flags and
+ * the key). Items which stay cold are instead demoted into a
+ * ColdMetadataBlock, which stores the records sorted by seqno with:
+ *
+ *  - the bySeqno and CAS delta encoded against the previous record,
+ *  - revSeqno, expiry time, flags and the key length as varints, and
+ *  - none of the state which is implied for a cold item (it is clean,
+ *    non-resident, alive and unlocked).
+ *
+ * A one byte fingerprint of each key is kept separately, so looking up a
+ * key which isn't in the block doesn't decode the records.
+ *
+ * The block isn't thread safe; the HashTable guards each block with the
+ * lock of the hash buckets it holds the items of.
+ */
+class ColdMetadataBlock {
+public:
+    /// The metadata of a cold item
+    struct Record {
+        DocKey getKey() const {
+            return DocKey(reinterpret_cast<const uint8_t*>(key.data()),
+                          key.size(),
+                          docNamespace);
+        }
+
+        std::string key;
+        DocNamespace docNamespace = DocNamespace::DefaultCollection;
+        uint64_t cas = 0;
+        uint64_t revSeqno = 0;
+        int64_t bySeqno = 0;
+        uint32_t exptime = 0;
+        uint32_t flags = 0;
+        protocol_binary_datatype_t datatype = PROTOCOL_BINARY_RAW_BYTES;
+    };
+
+    /**
+     * Add the metadata of an item (which must not already be present). Only
+     * the records up to its position are decoded, and the new record is
+     * spliced into the encoded data.
+     */
+    void add(Record record);
+
+    /**
+     * Add the metadata of a number of items (none already present). This
+     * re-encodes the whole block once, so is cheaper than adding the items
+     * one at a time.
+     */
+    void add(std::vector<Record> records);
+
+    /**
+     * Remove the metadata of the item with the given key. Only the records
+     * up to the item are decoded, and it is spliced out of the encoded data.
+     *
+     * @param key the key to look for
+     * @param record set to the item's metadata if found
+     * @return true if the item was found (and removed)
+     */
+    bool remove(const DocKey& key, Record& record);
+
+    /// @return all of the records, in seqno order
+    std::vector<Record> decode() const;
+
+    size_t getNumRecords() const {
+        return fingerprints.size();
+    }
+
+    /// @return the memory used by the block
+    size_t memorySize() const {
+        return sizeof(*this) + fingerprints.capacity() + data.capacity();
+    }
+
+    static uint8_t fingerprint(const DocKey& key) {
+        return uint8_t(key.hash() >> 24);
+    }
+
+private:
+    /// Replace the content of the block with the given (sorted) records
+    void encode(const std::vector<Record>& records);
+
+    /**
+     * Replace `length` bytes of the encoded data at `offset` with the given
+     * bytes, leaving no spare capacity.
+     */
+    void splice(size_t offset,
+                size_t length,
+                const std::vector<uint8_t>& replacement);
+
+    std::vector<uint8_t> fingerprints;
+    std::vector<uint8_t> data;
+};
@@ -32,6 +32,7 @@ namespace VB {
 
 Manifest::Manifest(const std::string& manifest)
     : defaultCollectionExists(false),
+      defaultCollectionItr(map.end()),
       separator(DefaultSeparator),
       greatestEndSeqno(StoredValue::state_collection_open),
       nDeletingCollections(0) {
@@ -181,6 +182,8 @@ ManifestEntry& Manifest::addNewCollectionEntry(Identifier identifier,
     auto m = std::make_unique<ManifestEntry>(identifier, startSeqno, endSeqno);
     auto* newEntry = m.get();
     map.emplace(m->getCharBuffer(), std::move(m));
+    // The emplace may have rehashed the map
+    defaultCollectionItr = map.find(DefaultCollectionIdentifier);
 
     if (newEntry->isDeleting()) {
         trackEndSeqno(endSeqno);
@@ -252,6 +255,7 @@ void Manifest::completeDeletion(::VBucket& vb,
 
     if (se == SystemEvent::DeleteCollectionHard) {
         map.erase(itr); // wipe out
+        defaultCollectionItr = map.find(DefaultCollectionIdentifier);
     }
 
     nDeletingCollections--;
@@ -346,7 +350,7 @@ Manifest::container::const_iterator Manifest::getManifestEntry(
     cb::const_char_buffer identifier;
     if (defaultCollectionExists &&
         key.getDocNamespace() == DocNamespace::DefaultCollection) {
-        identifier = DefaultCollectionIdentifier;
+        return defaultCollectionItr;
     } else if (key.getDocNamespace() == DocNamespace::Collections) {
         const auto cKey = Collections::DocKey::make(key, separator);
         identifier = cKey.getCollection();
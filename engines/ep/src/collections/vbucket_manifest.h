@@ -21,6 +21,7 @@
 #include "collections/collections_types.h"
 #include "collections/manifest.h"
 #include "collections/vbucket_manifest_entry.h"
+#include "sharded_rwlock.h"
 #include "systemevent.h"
 
 #include <platform/non_negative_counter.h>
@@ -62,6 +63,10 @@ namespace VB {
  * for the entire scope of the set path to ensure no other thread can interleave
  * collection create/delete and cause an inconsistency in the checkpoint
  * ordering.
+ *
+ * As every mutation takes the read lock (while updates of the manifest are
+ * rare) the lock is a ShardedRWLock, so the front-end threads reading the
+ * manifest of the same VBucket don't contend on the lock's cache line.
  */
 class Manifest {
 public:
@@ -259,7 +264,7 @@ public:
      */
     class WriteHandle {
     public:
-        WriteHandle(Manifest& m, cb::RWLock& lock)
+        WriteHandle(Manifest& m, ShardedRWLock& lock)
             : writeLock(lock), manifest(m) {
         }
 
@@ -353,7 +358,7 @@ public:
         }
 
     private:
-        std::unique_lock<cb::WriterLock> writeLock;
+        std::unique_lock<ShardedRWLock> writeLock;
         Manifest& manifest;
     };
 
@@ -380,11 +385,11 @@ public:
     Manifest(const std::string& manifest);
 
     ReadHandle lock() const {
-        return {*this, rwlock};
+        return {*this, rwlock.getReaderShard()};
     }
 
     CachingReadHandle lock(::DocKey key) const {
-        return {*this, rwlock, key};
+        return {*this, rwlock.getReaderShard(), key};
     }
 
     WriteHandle wlock() {
@@ -802,6 +807,13 @@ protected:
      */
     bool defaultCollectionExists;
 
+    /**
+     * The entry for the default collection in the map (or map.end()). Keys
+     * in the default collection are the common case, so we look this up
+     * whenever the map changes rather than hashing the name for every key.
+     */
+    container::const_iterator defaultCollectionItr;
+
     /**
      * The collection separator
      */
@@ -825,7 +837,7 @@ protected:
     /**
      * shared lock to allow concurrent readers and safe updates
      */
-    mutable cb::RWLock rwlock;
+    mutable ShardedRWLock rwlock;
 
     friend std::ostream& operator<<(std::ostream& os, const Manifest& manifest);
 };
@@ -0,0 +1,70 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2018 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "compaction_governor.h"
+
+#include <algorithm>
+
+const std::chrono::seconds CompactionGovernor::UpdateInterval{1};
+
+CompactionGovernor::CompactionGovernor(size_t maxConcurrent)
+    : maxConcurrent(std::max(size_t(1), maxConcurrent)),
+      limit(this->maxConcurrent) {
+}
+
+void CompactionGovernor::update(ProcessClock::time_point now,
+                                const IOStats& io,
+                                bool overloaded,
+                                size_t maxConcurrent,
+                                std::chrono::microseconds latencyTarget) {
+    this->maxConcurrent = std::max(size_t(1), maxConcurrent);
+    limit = std::min(limit, this->maxConcurrent);
+
+    if (now - lastUpdate < UpdateInterval) {
+        return;
+    }
+
+    const auto ops = io.ops - lastIO.ops;
+    const auto time = io.time - lastIO.time;
+    latency = std::chrono::microseconds(ops == 0 ? 0 : time / ops);
+    lastIO = io;
+    lastUpdate = now;
+
+    if (overloaded ||
+        (latencyTarget.count() != 0 && latency > latencyTarget)) {
+        limit = std::max(size_t(1), limit / 2);
+    } else if (saturated && limit < this->maxConcurrent) {
+        ++limit;
+    }
+    saturated = running >= limit;
+}
+
+bool CompactionGovernor::tryStart() {
+    if (running >= limit) {
+        saturated = true;
+        return false;
+    }
+    ++running;
+    saturated |= running >= limit;
+    return true;
+}
+
+void CompactionGovernor::finished() {
+    if (running > 0) {
+        --running;
+    }
+}
@@ -0,0 +1,114 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2018 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include "config.h"
+
+#include <platform/processclock.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * The CompactionGovernor decides how many compactions may run at the same
+ * time, based on how the disk copes with the front end I/O (bg fetches and
+ * flushing) while the compactions run.
+ *
+ * The limit is adjusted at most once per UpdateInterval (additive increase,
+ * multiplicative decrease):
+ *
+ *  - it is halved (down to 1) if the disk write queue has grown too large
+ *    or the average latency of the front end disk reads and writes is above
+ *    the latency target, and
+ *  - it is raised by one (up to the configured maximum) if all of the
+ *    compaction slots were in use and the disk kept up.
+ *
+ * The governor is not thread safe; the caller must serialise access to it.
+ */
+class CompactionGovernor {
+public:
+    /// Cumulative counts of the disk I/O performed by the front end
+    struct IOStats {
+        /// The number of reads and writes
+        uint64_t ops = 0;
+        /// The time (in usec) spent in the reads and writes
+        uint64_t time = 0;
+    };
+
+    /// The minimum time between two adjustments of the limit
+    static const std::chrono::seconds UpdateInterval;
+
+    explicit CompactionGovernor(size_t maxConcurrent);
+
+    /**
+     * Adjust the number of concurrent compactions allowed.
+     *
+     * @param now the current time
+     * @param io the I/O performed by the front end (cumulative)
+     * @param overloaded true if the disk write queue has grown too large
+     * @param maxConcurrent the maximum number of concurrent compactions
+     * @param latencyTarget the highest average front end I/O latency
+     *                      acceptable (0 to ignore the latency)
+     */
+    void update(ProcessClock::time_point now,
+                const IOStats& io,
+                bool overloaded,
+                size_t maxConcurrent,
+                std::chrono::microseconds latencyTarget);
+
+    /**
+     * Try to start a compaction.
+     *
+     * @return true if the compaction may run (and now holds a slot)
+     */
+    bool tryStart();
+
+    /// Release the slot of a completed compaction
+    void finished();
+
+    /// @return the number of slots free for new compactions
+    size_t getFreeSlots() const {
+        return running < limit ? limit - running : 0;
+    }
+
+    size_t getLimit() const {
+        return limit;
+    }
+
+    size_t getRunning() const {
+        return running;
+    }
+
+    /// @return the average front end I/O latency at the last update
+    std::chrono::microseconds getLatency() const {
+        return latency;
+    }
+
+private:
+    size_t maxConcurrent;
+    size_t limit;
+    size_t running = 0;
+
+    /// Was every slot in use at some point since the last update?
+    bool saturated = false;
+
+    ProcessClock::time_point lastUpdate;
+    IOStats lastIO;
+    std::chrono::microseconds latency{0};
+};
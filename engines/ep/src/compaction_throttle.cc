@@ -0,0 +1,126 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2018 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "compaction_throttle.h"
+
+#include "stats.h"
+
+#include <algorithm>
+#include <thread>
+
+const std::chrono::milliseconds CompactionThrottle::PauseInterval{10};
+
+CompactionThrottle::CompactionThrottle(EPStats& stats, const Config& config)
+    : stats(stats),
+      config(config),
+      lastBgOperations(stats.bgNumOperations),
+      lastBgWait(stats.bgWait) {
+}
+
+void CompactionThrottle::addBytes(size_t bytes) {
+    if (totalBytes == 0) {
+        budgetTime = now();
+    }
+    totalBytes += bytes;
+    pendingBytes += bytes;
+    if (pendingBytes < ChunkSize) {
+        return;
+    }
+
+    const auto chunk = pendingBytes;
+    pendingBytes = 0;
+    if (config.maxBytesPerSec != 0) {
+        throttle(chunk);
+    }
+    if (config.maxPause.count() != 0) {
+        maybePause();
+    }
+}
+
+void CompactionThrottle::sleep(std::chrono::microseconds duration) {
+    std::this_thread::sleep_for(duration);
+}
+
+void CompactionThrottle::throttle(size_t bytes) {
+    budgetTime += std::chrono::microseconds(
+            (uint64_t(bytes) * 1000000) / config.maxBytesPerSec);
+
+    const auto start = now();
+    if (budgetTime > start) {
+        // Sleep in slices so a shutdown isn't held up by a long sleep
+        const std::chrono::microseconds slice{PauseInterval};
+        auto current = start;
+        do {
+            const auto remaining =
+                    std::chrono::duration_cast<std::chrono::microseconds>(
+                            budgetTime - current);
+            sleep(std::min(remaining, slice));
+            current = now();
+        } while (current < budgetTime && !stats.isShutdown);
+
+        const auto duration =
+                std::chrono::duration_cast<std::chrono::microseconds>(current -
+                                                                      start);
+        throttledTime += duration;
+        stats.compactionThrottledTime.fetch_add(duration.count());
+    } else {
+        // The compaction was slowed down for other reasons; don't let it
+        // "save up" the budget as it would then burst at full speed
+        budgetTime = start;
+    }
+}
+
+void CompactionThrottle::maybePause() {
+    if (!isContended()) {
+        return;
+    }
+
+    ++numPauses;
+    ++stats.compactionNumPauses;
+    const auto start = now();
+    const auto deadline = start + config.maxPause;
+    auto current = start;
+    do {
+        sleep(PauseInterval);
+        current = now();
+    } while (current < deadline && !stats.isShutdown && isContended());
+
+    const auto duration =
+            std::chrono::duration_cast<std::chrono::microseconds>(current -
+                                                                  start);
+    pausedTime += duration;
+    stats.compactionPausedTime.fetch_add(duration.count());
+}
+
+bool CompactionThrottle::isContended() {
+    if (config.maxBgWait.count() != 0) {
+        // Look at the bg fetches completed since the last check only, so
+        // the contention has to be ongoing to pause the compaction
+        const size_t bgOperations = stats.bgNumOperations;
+        const uint64_t bgWait = stats.bgWait;
+        const auto operations = bgOperations - lastBgOperations;
+        const auto wait = bgWait - lastBgWait;
+        lastBgOperations = bgOperations;
+        lastBgWait = bgWait;
+        if (operations != 0 &&
+            wait / operations > uint64_t(config.maxBgWait.count())) {
+            return true;
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,137 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2018 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include "config.h"
+
+#include <platform/processclock.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+class EPStats;
+
+/**
+ * The CompactionThrottle limits the rate a compaction copies the documents
+ * of a database file, and pauses the compaction when the front end
+ * operations suffer from the disk contention.
+ *
+ * The storage engine calls addBytes() for every document it has copied to
+ * the compacted file. Once a chunk of data has been copied the throttle:
+ *
+ *  - sleeps as long as needed to keep the compaction within the configured
+ *    bytes/sec budget, and
+ *  - pauses the compaction while the background fetches wait longer (on
+ *    average) than the configured threshold. A single pause never lasts
+ *    longer than maxPause, so the compaction is guaranteed to make
+ *    progress.
+ *
+ * As the throttle blocks the thread running the compaction, the compaction
+ * resumes exactly where it stopped. The compaction runs on a writer
+ * thread, so it is deliberately not paused for a large disk write queue:
+ * that would hold up one of the threads the flusher needs to drain it. The
+ * write queue is instead handled by limiting the number of concurrent
+ * compactions (see CompactionGovernor).
+ */
+class CompactionThrottle {
+public:
+    struct Config {
+        /// The maximum number of bytes to copy per second (0 = unlimited)
+        size_t maxBytesPerSec = 0;
+        /// Pause while the average bg fetch wait is above this (0 = never)
+        std::chrono::microseconds maxBgWait{0};
+        /// The longest a single pause may last (0 = never pause)
+        std::chrono::milliseconds maxPause{0};
+    };
+
+    /// The number of bytes copied between each check of the budget
+    static const size_t ChunkSize = 256 * 1024;
+
+    /// How often the pause conditions (and shutdown) are checked while
+    /// paused or throttled
+    static const std::chrono::milliseconds PauseInterval;
+
+    CompactionThrottle(EPStats& stats, const Config& config);
+
+    virtual ~CompactionThrottle() = default;
+
+    /**
+     * Account for a document copied by the compaction. May block the
+     * calling thread in order to throttle the compaction.
+     *
+     * @param bytes the size of the document on disk
+     */
+    void addBytes(size_t bytes);
+
+    /// @return the total number of bytes copied
+    uint64_t getTotalBytes() const {
+        return totalBytes;
+    }
+
+    /// @return the time spent sleeping to stay within the budget
+    std::chrono::microseconds getThrottledTime() const {
+        return throttledTime;
+    }
+
+    /// @return the time spent paused due to front end contention
+    std::chrono::microseconds getPausedTime() const {
+        return pausedTime;
+    }
+
+    /// @return the number of times the compaction was paused
+    size_t getNumPauses() const {
+        return numPauses;
+    }
+
+protected:
+    virtual ProcessClock::time_point now() {
+        return ProcessClock::now();
+    }
+
+    virtual void sleep(std::chrono::microseconds duration);
+
+    /// Sleep until the bytes copied so far are within the budget (or the
+    /// bucket is shutting down)
+    void throttle(size_t bytes);
+
+    /// Pause until there is no contention (or maxPause has passed)
+    void maybePause();
+
+    /// @return true if the front end operations suffer from contention
+    bool isContended();
+
+    EPStats& stats;
+    const Config config;
+
+    /// Bytes copied since the budget and pause conditions were checked
+    size_t pendingBytes = 0;
+    uint64_t totalBytes = 0;
+
+    /// The time the bytes copied so far are "paid for" by the budget
+    /// (initialised when the first document is copied)
+    ProcessClock::time_point budgetTime;
+
+    /// bgNumOperations and bgWait the last time they were sampled
+    size_t lastBgOperations;
+    uint64_t lastBgWait;
+
+    std::chrono::microseconds throttledTime{0};
+    std::chrono::microseconds pausedTime{0};
+    size_t numPauses = 0;
+};
@@ -45,7 +45,7 @@ public:
  */
 class SizeRangeValidator : public ValueChangedValidator {
 public:
-    SizeRangeValidator() : lower(0), upper(0) {}
+    SizeRangeValidator() : lower(0), upper(0), zeroAllowed(false) {}
 
     SizeRangeValidator *min(size_t v) {
         lower = v;
@@ -57,10 +57,20 @@ public:
         return this;
     }
 
+    /// Also accept 0 (typically meaning "disabled") outside of the range
+    SizeRangeValidator *allowZero() {
+        zeroAllowed = true;
+        return this;
+    }
+
     virtual void validateSize(const std::string& key, size_t value) {
+        if (value == 0 && zeroAllowed) {
+            return;
+        }
         if (value < lower || value > upper) {
-            std::string error = "Validation Error, " + key +
-                                " takes values between " +
+            std::string error = "Validation Error, " + key + " takes " +
+                                (zeroAllowed ? "0 or " : "") +
+                                "values between " +
                                 std::to_string(lower) + " and " +
                                 std::to_string(upper) + " (Got: " +
                                 std::to_string(value) + ")";
@@ -72,9 +82,13 @@ public:
         ssize_t s_lower = static_cast<ssize_t> (lower);
         ssize_t s_upper = static_cast<ssize_t> (upper);
 
+        if (value == 0 && zeroAllowed) {
+            return;
+        }
         if (value < s_lower || value > s_upper) {
-            std::string error = "Validation Error, " + key +
-                                " takes values between " +
+            std::string error = "Validation Error, " + key + " takes " +
+                                (zeroAllowed ? "0 or " : "") +
+                                "values between " +
                                 std::to_string(s_lower) + " and " +
                                 std::to_string(s_upper) + " (Got: " +
                                 std::to_string(value) + ")";
@@ -84,6 +98,7 @@ public:
 private:
     size_t lower;
     size_t upper;
+    bool zeroAllowed;
 };
 
 /**
@@ -22,6 +22,7 @@
 #include "kvstore.h"
 
 #include <platform/histogram.h>
+#include <platform/processclock.h>
 
 std::unique_ptr<FileOpsInterface> getCouchstoreStatsOps(
     FileStats& stats, FileOpsInterface& base_ops) {
@@ -97,9 +98,15 @@ ssize_t StatsOps::pread(couchstore_error_info_t* errinfo,
         stats.readSeekHisto.add(std::abs(off - sf->last_offs));
     }
     sf->last_offs = off;
-    BlockTimer bt(&stats.readTimeHisto);
+    const auto start = ProcessClock::now();
     ssize_t result = sf->orig_ops->pread(errinfo, sf->orig_handle, buf,
                                          sz, off);
+    const auto duration =
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                    ProcessClock::now() - start);
+    stats.readTimeHisto.add(duration);
+    ++stats.totalReads;
+    stats.totalReadTime += duration.count();
     if (result > 0) {
         stats.totalBytesRead += result;
         ++sf->read_count_since_open;
@@ -114,9 +121,15 @@ ssize_t StatsOps::pwrite(couchstore_error_info_t*errinfo,
                          cs_off_t off) {
     StatFile* sf = reinterpret_cast<StatFile*>(h);
     stats.writeSizeHisto.add(sz);
-    BlockTimer bt(&stats.writeTimeHisto);
+    const auto start = ProcessClock::now();
     ssize_t result = sf->orig_ops->pwrite(errinfo, sf->orig_handle, buf,
                                           sz, off);
+    const auto duration =
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                    ProcessClock::now() - start);
+    stats.writeTimeHisto.add(duration);
+    ++stats.totalWrites;
+    stats.totalWriteTime += duration.count();
     if (result > 0) {
         stats.totalBytesWritten += result;
         ++sf->write_count_since_open;
@@ -51,8 +51,8 @@
 #include "vbucket.h"
 #include "vbucket_bgfetch_item.h"
 
-#include <JSON_checker.h>
 #include <kvstore.h>
+#include <memcached/json_validator.h>
 #include <platform/compress.h>
 
 extern "C" {
@@ -97,7 +97,8 @@ static std::string getStrError(Db *db) {
  * @return JSON or RAW bytes
  */
 static protocol_binary_datatype_t determine_datatype(sized_buf doc) {
-    if (checkUTF8JSON(reinterpret_cast<uint8_t*>(doc.buf), doc.size)) {
+    if (cb::json::checkUTF8JSON(reinterpret_cast<uint8_t*>(doc.buf),
+                                doc.size)) {
         return PROTOCOL_BINARY_DATATYPE_JSON;
     } else {
         return PROTOCOL_BINARY_RAW_BYTES;
@@ -692,8 +693,9 @@ static int edit_docinfo_hook(DocInfo **info, const sized_buf *item) {
         }
 
         protocol_binary_datatype_t datatype = PROTOCOL_BINARY_RAW_BYTES;
-        if (checkUTF8JSON(reinterpret_cast<const uint8_t*>(data.data()),
-                          data.size())) {
+        if (cb::json::checkUTF8JSON(
+                    reinterpret_cast<const uint8_t*>(data.data()),
+                    data.size())) {
             datatype = PROTOCOL_BINARY_DATATYPE_JSON;
         }
 
@@ -803,6 +805,10 @@ static int time_purge_hook(Db* d, DocInfo* info, sized_buf item, void* ctx_p) {
         return couchstore_set_purge_seq(d, ctx->max_purged_seq[vbid]);
     }
 
+    if (ctx->throttle) {
+        ctx->throttle(info->id.size + info->rev_meta.size + info->size);
+    }
+
     DbInfo infoDb;
     auto err = couchstore_db_info(d, &infoDb);
     if (err != COUCHSTORE_SUCCESS) {
@@ -42,7 +42,9 @@ bool DefragmenterTask::run(void) {
         if (!prAdapter) {
             prAdapter = std::make_unique<PauseResumeVBAdapter>(
                     std::make_unique<DefragmentVisitor>(
-                            getAgeThreshold(), getMaxValueSize(alloc_hooks)));
+                            getAgeThreshold(),
+                            getMaxValueSize(alloc_hooks),
+                            alloc_hooks));
             epstore_position = engine->getKVBucket()->startPosition();
         }
 
@@ -82,6 +84,8 @@ bool DefragmenterTask::run(void) {
 
         // Update stats
         stats.defragNumMoved.fetch_add(visitor.getDefragCount());
+        stats.defragStoredValueNumMoved.fetch_add(
+                visitor.getStoredValueDefragCount());
         stats.defragNumVisited.fetch_add(visitor.getVisitedCount());
 
         // Release any free memory we now have in the allocator back to the OS.
@@ -107,7 +111,9 @@ bool DefragmenterTask::run(void) {
                                                                       start);
         ss << " Took " << duration.count() << " us."
            << " moved " << visitor.getDefragCount() << "/"
-           << visitor.getVisitedCount() << " visited documents."
+           << visitor.getVisitedCount() << " visited documents"
+           << " and " << visitor.getStoredValueDefragCount()
+           << " StoredValues."
            << " mem_used=" << stats.getTotalMemoryUsed()
            << ", mapped_bytes=" << getMappedBytes() << ". Sleeping for "
            << getSleepTime() << " seconds.";
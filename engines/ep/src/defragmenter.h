@@ -88,6 +88,13 @@ class PauseResumeVBAdapter;
  * 2. Document size - Skip documents which are larger than the largest
  *    size class, or are zero-sized.
  *
+ * Where the allocator supports it (jemalloc's experimental.utilization
+ * query) we don't need to infer anything: we ask the allocator how well
+ * utilised the slab holding each object is, and only move the objects on
+ * slabs which are less utilised than the average for their size class.
+ * This allows us to also move the StoredValues (and not only the values),
+ * as they are otherwise never reallocated for as long as the key exists.
+ *
  * An additional policy consideration is how to locate
  * candidate documents. In a large instance, the simple act of
  * visiting each element in the HashTable is a expensive operation -
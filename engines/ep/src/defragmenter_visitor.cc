@@ -17,13 +17,18 @@
 
 #include "defragmenter_visitor.h"
 
+#include "vbucket.h"
+
 // DegragmentVisitor implementation ///////////////////////////////////////////
 
 DefragmentVisitor::DefragmentVisitor(uint8_t age_threshold_,
-                                     size_t max_size_class)
+                                     size_t max_size_class,
+                                     ALLOCATOR_HOOKS_API* alloc_hooks)
     : max_size_class(max_size_class),
       age_threshold(age_threshold_),
+      alloc_hooks(alloc_hooks),
       defrag_count(0),
+      sv_defrag_count(0),
       visited_count(0) {
 }
 
@@ -36,35 +41,91 @@ void DefragmentVisitor::setDeadline(ProcessClock::time_point deadline) {
 
 bool DefragmentVisitor::visit(const HashTable::HashBucketLock& lh,
                               StoredValue& v) {
+    defragValue(v);
+    // Must be last, as v is no longer valid if it was moved.
+    defragStoredValue(lh, v);
+    visited_count++;
+
+    // See if we have done enough work for this chunk. If so
+    // stop visiting (for now).
+    return progressTracker.shouldContinueVisiting(visited_count);
+}
+
+void DefragmentVisitor::setCurrentVBucket(VBucket& vb) {
+    currentVb = &vb;
+}
+
+allocation_utilization_t DefragmentVisitor::getUtilization(
+        const void* ptr) const {
+    if (alloc_hooks == nullptr ||
+        alloc_hooks->get_allocation_utilization == nullptr) {
+        return ALLOCATION_UTILIZATION_UNKNOWN;
+    }
+    return alloc_hooks->get_allocation_utilization(ptr);
+}
+
+void DefragmentVisitor::defragValue(StoredValue& v) {
     const size_t value_len = v.valuelen();
 
     // value must be at least non-zero (also covers Items with null Blobs)
     // and no larger than the biggest size class the allocator
     // supports, so it can be successfully reallocated to a run with other
     // objects of the same size.
-    if (value_len > 0 && value_len <= max_size_class) {
-        // If sufficiently old and if it looks like nothing else holds a
-        // reference to the blob reallocate, otherwise increment it's age.
-        // It may be possible to add a reference to the blob without holding
-        // any locks, therefore the check is somewhat of an estimate which
-        // should be good enough.
-        if (v.getValue()->getAge() >= age_threshold &&
-            v.getValue().refCount() < 2) {
+    if (value_len == 0 || value_len > max_size_class) {
+        return;
+    }
+
+    // If it looks like something else holds a reference to the blob
+    // reallocating it would just increase memory usage. It may be possible
+    // to add a reference to the blob without holding any locks, therefore
+    // the check is somewhat of an estimate which should be good enough.
+    const bool unshared = v.getValue().refCount() < 2;
+
+    switch (getUtilization(v.getValue().get())) {
+    case ALLOCATION_UTILIZATION_SPARSE:
+        if (unshared) {
+            v.reallocate();
+            defrag_count++;
+        }
+        return;
+    case ALLOCATION_UTILIZATION_DENSE:
+        return;
+    case ALLOCATION_UTILIZATION_UNKNOWN:
+        // If sufficiently old reallocate, otherwise increment it's age.
+        if (v.getValue()->getAge() >= age_threshold && unshared) {
             v.reallocate();
             defrag_count++;
         } else {
             v.getValue()->incrementAge();
         }
+        return;
     }
-    visited_count++;
+}
 
-    // See if we have done enough work for this chunk. If so
-    // stop visiting (for now).
-    return progressTracker.shouldContinueVisiting(visited_count);
+void DefragmentVisitor::defragStoredValue(const HashTable::HashBucketLock& lh,
+                                          StoredValue& v) {
+    // OrderedStoredValues are also linked into the vbucket's sequence list,
+    // so can't simply be replaced in the HashTable.
+    if (currentVb == nullptr || v.isOrdered()) {
+        return;
+    }
+
+    // Only move StoredValues when we know they are on a sparse slab - there's
+    // no age for StoredValues to fall back on.
+    if (getUtilization(&v) != ALLOCATION_UTILIZATION_SPARSE) {
+        return;
+    }
+
+    // The copy is linked at the head of the hash bucket chain (so isn't
+    // visited again), and the original is freed when the returned
+    // UniquePtr goes out of scope.
+    currentVb->ht.unlocked_replaceByCopy(lh, v);
+    sv_defrag_count++;
 }
 
 void DefragmentVisitor::clearStats() {
     defrag_count = 0;
+    sv_defrag_count = 0;
     visited_count = 0;
 }
 
@@ -72,6 +133,10 @@ size_t DefragmentVisitor::getDefragCount() const {
     return defrag_count;
 }
 
+size_t DefragmentVisitor::getStoredValueDefragCount() const {
+    return sv_defrag_count;
+}
+
 size_t DefragmentVisitor::getVisitedCount() const {
     return visited_count;
 }
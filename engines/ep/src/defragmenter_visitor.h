@@ -23,13 +23,31 @@
 #include "progress_tracker.h"
 #include "vb_visitors.h"
 
+#include <memcached/allocator_hooks.h>
+
 /**
  * Defragmentation visitor - visit all objects in a VBucket, and defragment
- * any which have reached the specified age.
+ * them.
+ *
+ * If the allocator can tell how well utilised the slab holding an object is
+ * (see ALLOCATOR_HOOKS_API::get_allocation_utilization), both the value
+ * (Blob) and the StoredValue itself are moved if they are on a sparse slab.
+ * Otherwise we fall back to moving the values which have reached the
+ * specified age.
  */
 class DefragmentVisitor : public VBucketAwareHTVisitor {
 public:
-    DefragmentVisitor(uint8_t age_threshold_, size_t max_size_class);
+    /**
+     * @param age_threshold_ How old a blob must be to be moved when the
+     *        allocator can't report its utilisation.
+     * @param max_size_class Size of the largest size class from the
+     *        allocator.
+     * @param alloc_hooks Allocator hooks to query the utilisation of the
+     *        objects with. If null, only values are moved (based on age).
+     */
+    DefragmentVisitor(uint8_t age_threshold_,
+                      size_t max_size_class,
+                      ALLOCATOR_HOOKS_API* alloc_hooks = nullptr);
 
     ~DefragmentVisitor();
 
@@ -39,16 +57,34 @@ public:
     // Implementation of HashTableVisitor interface:
     virtual bool visit(const HashTable::HashBucketLock& lh, StoredValue& v);
 
+    void setCurrentVBucket(VBucket& vb) override;
+
     // Resets any held stats to zero.
     void clearStats();
 
     // Returns the number of documents that have been defragmented.
     size_t getDefragCount() const;
 
+    // Returns the number of StoredValues that have been defragmented.
+    size_t getStoredValueDefragCount() const;
+
     // Returns the number of documents that have been visited.
     size_t getVisitedCount() const;
 
 private:
+    /// @return the utilisation of the slab holding the given allocation
+    allocation_utilization_t getUtilization(const void* ptr) const;
+
+    /// Move the value of the given StoredValue, if it's a candidate.
+    void defragValue(StoredValue& v);
+
+    /**
+     * Move the given StoredValue itself, if it's a candidate. Note that v is
+     * freed if it is moved.
+     */
+    void defragStoredValue(const HashTable::HashBucketLock& lh,
+                           StoredValue& v);
+
     /* Configuration parameters */
 
     // Size of the largest size class from the allocator.
@@ -57,14 +93,23 @@ private:
     // How old a blob must be to consider it for defragmentation.
     const uint8_t age_threshold;
 
+    // Allocator hooks used to query the slab utilisation (may be null).
+    ALLOCATOR_HOOKS_API* const alloc_hooks;
+
     /* Runtime state */
 
+    // The VBucket currently being visited (owner of the HashTable the
+    // StoredValues are moved within).
+    VBucket* currentVb = nullptr;
+
     // Estimates how far we have got, and when we should pause.
     ProgressTracker progressTracker;
 
     /* Statistics */
     // Count of how many documents have been defrag'd.
     size_t defrag_count;
+    // Count of how many StoredValues have been defrag'd.
+    size_t sv_defrag_count;
     // How many documents have been visited.
     size_t visited_count;
 };
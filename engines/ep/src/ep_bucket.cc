@@ -19,6 +19,7 @@
 
 #include "bgfetcher.h"
 #include "checkpoint.h"
+#include "compaction_throttle.h"
 #include "ep_engine.h"
 #include "ep_time.h"
 #include "ep_vb.h"
@@ -28,6 +29,8 @@
 #include "replicationthrottle.h"
 #include "tasks.h"
 
+#include <algorithm>
+
 /**
  * Callback class used by EpStore, for adding relevant keys
  * to bloomfilter during compaction.
@@ -166,7 +169,10 @@ private:
 };
 
 EPBucket::EPBucket(EventuallyPersistentEngine& theEngine)
-    : KVBucket(theEngine) {
+    : KVBucket(theEngine),
+      compactionGovernor(static_cast<size_t>(
+              vbMap.getNumShards() *
+              engine.getConfiguration().getCompactionMaxConcurrentRatio())) {
     const std::string& policy =
             engine.getConfiguration().getItemEvictionPolicy();
     if (policy.compare("value_only") == 0) {
@@ -568,20 +574,11 @@ ENGINE_ERROR_CODE EPBucket::scheduleCompaction(uint16_t vbid,
     /* Update the compaction ctx with the previous purge seqno */
     c.max_purged_seq[vbid] = vb->getPurgeSeqno();
 
+    // The task asks the compaction governor for a slot when it runs, and
+    // snoozes until one is available (see tryStartCompaction)
     LockHolder lh(compactionLock);
     ExTask task = std::make_shared<CompactTask>(*this, c, cookie);
-    compactionTasks.push_back(std::make_pair(c.db_file_id, task));
-    if (compactionTasks.size() > 1) {
-        if ((stats.diskQueueSize > compactionWriteQueueCap &&
-             compactionTasks.size() > (vbMap.getNumShards() / 2)) ||
-            engine.getWorkLoadPolicy().getWorkLoadPattern() == READ_HEAVY) {
-            // Snooze a new compaction task.
-            // We will wake it up when one of the existing compaction tasks is
-            // done.
-            task->snooze(60);
-        }
-    }
-
+    compactionTasks.emplace_back(c.db_file_id, task);
     ExecutorPool::get()->schedule(task);
 
     LOG(EXTENSION_LOG_DEBUG,
@@ -666,11 +663,21 @@ void EPBucket::compactInternal(compaction_ctx* ctx) {
                                        std::placeholders::_1,
                                        std::placeholders::_2);
 
+    Configuration& config = getEPEngine().getConfiguration();
+    CompactionThrottle::Config throttleConfig;
+    throttleConfig.maxBytesPerSec = config.getCompactionMaxBytesPerSec();
+    throttleConfig.maxBgWait =
+            std::chrono::microseconds(config.getCompactionBgWaitThreshold());
+    throttleConfig.maxPause =
+            std::chrono::milliseconds(config.getCompactionMaxPause());
+    CompactionThrottle throttle(stats, throttleConfig);
+    ctx->throttle = [&throttle](size_t bytes) { throttle.addBytes(bytes); };
+
     KVShard* shard = vbMap.getShardByVbId(ctx->db_file_id);
     KVStore* store = shard->getRWUnderlying();
     bool result = store->compactDB(ctx);
+    ctx->throttle = nullptr;
 
-    Configuration& config = getEPEngine().getConfiguration();
     /* Iterate over all the vbucket ids set in max_purged_seq map. If there is
      * an entry
      * in the map for a vbucket id, then it was involved in compaction and thus
@@ -697,7 +704,9 @@ void EPBucket::compactInternal(compaction_ctx* ctx) {
         "tombstones_purged:%" PRIu64 ", collection_items_erased:%" PRIu64
         ", pre{size:%" PRIu64 ", items:%" PRIu64 ", deleted_items:%" PRIu64
         ", purge_seqno:%" PRIu64 "}, post{size:%" PRIu64 ", items:%" PRIu64
-        ", deleted_items:%" PRIu64 ", purge_seqno:%" PRIu64 "}",
+        ", deleted_items:%" PRIu64 ", purge_seqno:%" PRIu64
+        "}, bytes:%" PRIu64 ", throttled:%" PRId64 "ms, paused:%" PRId64
+        "ms (%" PRIu64 " times)",
         ctx->db_file_id,
         result ? "ok" : "failed",
         ctx->stats.tombstonesPurged,
@@ -709,15 +718,30 @@ void EPBucket::compactInternal(compaction_ctx* ctx) {
         ctx->stats.post.size,
         ctx->stats.post.items,
         ctx->stats.post.deletedItems,
-        ctx->stats.post.purgeSeqno);
+        ctx->stats.post.purgeSeqno,
+        throttle.getTotalBytes(),
+        int64_t(std::chrono::duration_cast<std::chrono::milliseconds>(
+                        throttle.getThrottledTime())
+                        .count()),
+        int64_t(std::chrono::duration_cast<std::chrono::milliseconds>(
+                        throttle.getPausedTime())
+                        .count()),
+        uint64_t(throttle.getNumPauses()));
 }
 
-bool EPBucket::doCompact(compaction_ctx* ctx, const void* cookie) {
+bool EPBucket::doCompact(compaction_ctx* ctx,
+                         size_t taskId,
+                         const void* cookie) {
     ENGINE_ERROR_CODE err = ENGINE_SUCCESS;
     StorageProperties storeProp = getStorageProperties();
     bool concWriteCompact = storeProp.hasConcWriteCompact();
     uint16_t vbid = ctx->db_file_id;
 
+    if (!tryStartCompaction(ctx->db_file_id, taskId)) {
+        // Snoozed until a compaction slot is available
+        return true;
+    }
+
     /**
      * Check if the underlying storage engine allows writes concurrently
      * as the database file is being compacted. If not, a lock needs to
@@ -746,7 +770,7 @@ bool EPBucket::doCompact(compaction_ctx* ctx, const void* cookie) {
         compactInternal(ctx);
     }
 
-    updateCompactionTasks(ctx->db_file_id);
+    updateCompactionTasks(taskId);
 
     if (cookie) {
         engine.notifyIOComplete(cookie, err);
@@ -755,26 +779,123 @@ bool EPBucket::doCompact(compaction_ctx* ctx, const void* cookie) {
     return false;
 }
 
-void EPBucket::updateCompactionTasks(DBFileId db_file_id) {
+void EPBucket::updateCompactionTasks(size_t taskId) {
     LockHolder lh(compactionLock);
-    bool erased = false, woke = false;
-    std::list<CompTaskEntry>::iterator it = compactionTasks.begin();
-    while (it != compactionTasks.end()) {
-        if ((*it).first == db_file_id) {
-            it = compactionTasks.erase(it);
-            erased = true;
-        } else {
-            ExTask& task = (*it).second;
-            if (task->getState() == TASK_SNOOZED) {
-                ExecutorPool::get()->wake(task->getId());
-                woke = true;
-            }
-            ++it;
+    auto it = std::find_if(compactionTasks.begin(),
+                           compactionTasks.end(),
+                           [taskId](const CompTaskEntry& entry) {
+                               return entry.task->getId() == taskId;
+                           });
+    if (it != compactionTasks.end()) {
+        if (it->running) {
+            compactionGovernor.finished();
+        }
+        compactionTasks.erase(it);
+    }
+
+    updateCompactionGovernor();
+    wakeCompactionTasks();
+}
+
+bool EPBucket::tryStartCompaction(DBFileId db_file_id, size_t taskId) {
+    // Estimate how much space the compaction would reclaim. Only done when
+    // the task is looking for a slot, as it reads the file header.
+    uint64_t reclaimable = 0;
+    try {
+        const auto info =
+                getRWUnderlying(db_file_id)->getDbFileInfo(db_file_id);
+        if (info.fileSize > info.spaceUsed) {
+            reclaimable = info.fileSize - info.spaceUsed;
+        }
+    } catch (const std::exception& e) {
+        LOG(EXTENSION_LOG_DEBUG,
+            "EPBucket::tryStartCompaction: Failed to read the file info of "
+            "db file id: %d - %s",
+            db_file_id,
+            e.what());
+    }
+
+    LockHolder lh(compactionLock);
+    auto entry = std::find_if(compactionTasks.begin(),
+                              compactionTasks.end(),
+                              [taskId](const CompTaskEntry& entry) {
+                                  return entry.task->getId() == taskId;
+                              });
+    if (entry == compactionTasks.end() || entry->running) {
+        return true;
+    }
+    entry->reclaimable = reclaimable;
+    entry->waiting = true;
+
+    updateCompactionGovernor();
+
+    // The waiting compaction reclaiming the most space goes first
+    auto best = entry;
+    for (auto it = compactionTasks.begin(); it != compactionTasks.end();
+         ++it) {
+        if (it->waiting && it->reclaimable > best->reclaimable) {
+            best = it;
+        }
+    }
+    if (best == entry && compactionGovernor.tryStart()) {
+        entry->waiting = false;
+        entry->running = true;
+        stats.compactionsRunning = compactionGovernor.getRunning();
+        return true;
+    }
+
+    // Wait until woken by wakeCompactionTasks (re-checking once a minute
+    // in case the governor raised the limit meanwhile)
+    entry->task->snooze(60);
+    wakeCompactionTasks();
+    return false;
+}
+
+void EPBucket::updateCompactionGovernor() {
+    CompactionGovernor::IOStats io;
+    for (size_t ii = 0; ii < vbMap.getNumShards(); ++ii) {
+        KVShard* shard = vbMap.getShard(ii);
+        for (auto* store :
+             {shard->getRWUnderlying(), shard->getROUnderlying()}) {
+            const auto& fsStats = store->getKVStoreStat().fsStats;
+            io.ops += fsStats.totalReads + fsStats.totalWrites;
+            io.time += fsStats.totalReadTime + fsStats.totalWriteTime;
         }
-        if (erased && woke) {
-            break;
+    }
+
+    const Configuration& config = engine.getConfiguration();
+    const size_t maxConcurrent = static_cast<size_t>(
+            vbMap.getNumShards() * config.getCompactionMaxConcurrentRatio());
+    compactionGovernor.update(
+            ProcessClock::now(),
+            io,
+            stats.diskQueueSize > compactionWriteQueueCap,
+            maxConcurrent,
+            std::chrono::microseconds(config.getCompactionIoLatencyTarget()));
+
+    stats.compactionConcurrencyLimit = compactionGovernor.getLimit();
+    stats.compactionsRunning = compactionGovernor.getRunning();
+}
+
+void EPBucket::wakeCompactionTasks() {
+    std::vector<CompTaskEntry*> waiting;
+    for (auto& entry : compactionTasks) {
+        if (entry.waiting) {
+            waiting.push_back(&entry);
         }
     }
+
+    const size_t toWake = std::min(waiting.size(),
+                                   compactionGovernor.getFreeSlots());
+    std::partial_sort(waiting.begin(),
+                      waiting.begin() + toWake,
+                      waiting.end(),
+                      [](const CompTaskEntry* a, const CompTaskEntry* b) {
+                          return a->reclaimable > b->reclaimable;
+                      });
+    for (size_t ii = 0; ii < toWake; ++ii) {
+        ExecutorPool::get()->wake(waiting[ii]->task->getId());
+    }
 }
 
 std::pair<uint64_t, bool> EPBucket::getLastPersistedCheckpointId(uint16_t vb) {
@@ -17,6 +17,7 @@
 
 #pragma once
 
+#include "compaction_governor.h"
 #include "kv_bucket.h"
 
 /**
@@ -75,12 +76,13 @@ public:
      * Compaction of a database file
      *
      * @param ctx Context for compaction hooks
+     * @param taskId the id of the CompactTask running the compaction
      * @param ck cookie used to notify connection of operation completion
      *
      * return true if the compaction needs to be rescheduled and false
      *             otherwise
      */
-    bool doCompact(compaction_ctx* ctx, const void* cookie);
+    bool doCompact(compaction_ctx* ctx, size_t taskId, const void* cookie);
 
     std::pair<uint64_t, bool> getLastPersistedCheckpointId(
             uint16_t vb) override;
@@ -146,10 +148,42 @@ protected:
     void compactInternal(compaction_ctx* ctx);
 
     /**
-     * Remove completed compaction tasks or wake snoozed tasks
+     * Remove a completed compaction task, and wake the waiting tasks which
+     * may now run
      *
-     * @param db_file_id vbucket id for couchstore or shard id in the
-     *                   case of forestdb
+     * @param taskId the id of the completed CompactTask
      */
-    void updateCompactionTasks(DBFileId db_file_id);
+    void updateCompactionTasks(size_t taskId);
+
+    /**
+     * Try to get a compaction slot for the given task. If the compaction
+     * governor doesn't allow another compaction to run, or a waiting
+     * compaction would reclaim more space, the task is snoozed until woken
+     * by wakeCompactionTasks.
+     *
+     * The task (rather than the database file) identifies the entry, as
+     * more than one compaction of the same file may be scheduled.
+     *
+     * @param db_file_id the database file to compact
+     * @param taskId the id of the CompactTask
+     * @return true if the compaction may run
+     */
+    bool tryStartCompaction(DBFileId db_file_id, size_t taskId);
+
+    /**
+     * Update the compaction governor with the front end disk I/O performed
+     * since its last update. Must be called with compactionLock held.
+     */
+    void updateCompactionGovernor();
+
+    /**
+     * Wake the waiting compaction tasks which would reclaim the most space,
+     * as many as there are free compaction slots. Must be called with
+     * compactionLock held.
+     */
+    void wakeCompactionTasks();
+
+    /// Decides how many compactions may run concurrently (guarded by
+    /// compactionLock)
+    CompactionGovernor compactionGovernor;
 };
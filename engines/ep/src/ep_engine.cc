@@ -43,10 +43,10 @@
 #include "vb_count_visitor.h"
 #include "warmup.h"
 
-#include <JSON_checker.h>
 #include <cJSON_utils.h>
 #include <memcached/engine.h>
 #include <memcached/extension.h>
+#include <memcached/json_validator.h>
 #include <memcached/protocol_binary.h>
 #include <memcached/server_api.h>
 #include <memcached/util.h>
@@ -153,7 +153,24 @@ static ENGINE_ERROR_CODE EvpInitialize(gsl::not_null<ENGINE_HANDLE*> handle,
 static void EvpDestroy(gsl::not_null<ENGINE_HANDLE*> handle, const bool force) {
     auto eng = acquireEngine(handle);
     eng->destroy(force);
+
+    auto* api = eng->getServerApi();
+    const bool ownArena = eng->getEpStats().arenaMemoryTracking;
+    const unsigned arena = eng->getEpStats().arena;
+    if (ownArena) {
+        MemoryTracker::getInstance(*api->alloc_hooks)->removeArena(arena);
+    }
+
     delete eng.get();
+
+    if (ownArena) {
+        // Everything the bucket allocated has now been freed; move this
+        // thread off the arena (returning what its cache holds) so the
+        // arena's pages can be released.
+        ObjectRegistry::onSwitchThread(nullptr);
+        ObjectRegistry::useDefaultArena();
+        api->alloc_hooks->release_arena(arena);
+    }
 }
 
 static cb::EngineErrorItemPair EvpItemAllocate(
@@ -349,6 +366,18 @@ static cb::EngineErrorCasPair EvpStoreIf(gsl::not_null<ENGINE_HANDLE*> handle,
     return engine->store_if(cookie, item, cas, operation, predicate);
 }
 
+static ENGINE_ERROR_CODE EvpUpdateInPlace(gsl::not_null<ENGINE_HANDLE*> handle,
+                                          gsl::not_null<const void*> cookie,
+                                          const DocKey& key,
+                                          uint16_t vbucket,
+                                          uint64_t& cas,
+                                          uint32_t expiration,
+                                          cb::InPlaceMutator mutator,
+                                          mutation_descr_t& mut_info) {
+    return acquireEngine(handle)->updateInPlace(
+            cookie, key, vbucket, cas, expiration, mutator, mut_info);
+}
+
 static ENGINE_ERROR_CODE EvpFlush(gsl::not_null<ENGINE_HANDLE*> handle,
                                   gsl::not_null<const void*> cookie) {
     return acquireEngine(handle)->flush(cookie);
@@ -507,6 +536,8 @@ protocol_binary_response_status EventuallyPersistentEngine::setFlushParam(
             getConfiguration().setExpPagerStime(std::stoull(valz));
         } else if (strcmp(keyz, "exp_pager_initial_run_time") == 0) {
             getConfiguration().setExpPagerInitialRunTime(std::stoll(valz));
+        } else if (strcmp(keyz, "exp_pager_use_index") == 0) {
+            getConfiguration().setExpPagerUseIndex(cb_stob(valz));
         } else if (strcmp(keyz, "access_scanner_enabled") == 0) {
             getConfiguration().requirementsMetOrThrow("access_scanner_enabled");
             getConfiguration().setAccessScannerEnabled(cb_stob(valz));
@@ -518,6 +549,8 @@ protocol_binary_response_status EventuallyPersistentEngine::setFlushParam(
             getConfiguration().setAlogTaskTime(std::stoull(valz));
         } else if (strcmp(keyz, "pager_active_vb_pcnt") == 0) {
             getConfiguration().setPagerActiveVbPcnt(std::stoull(valz));
+        } else if (strcmp(keyz, "ht_eviction_policy") == 0) {
+            getConfiguration().setHtEvictionPolicy(valz);
         } else if (strcmp(keyz, "warmup_min_memory_threshold") == 0) {
             getConfiguration().setWarmupMinMemoryThreshold(std::stoull(valz));
         } else if (strcmp(keyz, "warmup_min_items_threshold") == 0) {
@@ -546,6 +579,8 @@ protocol_binary_response_status EventuallyPersistentEngine::setFlushParam(
             getConfiguration().setBfilterEnabled(cb_stob(valz));
         } else if (strcmp(keyz, "bfilter_residency_threshold") == 0) {
             getConfiguration().setBfilterResidencyThreshold(std::stof(valz));
+        } else if (strcmp(keyz, "cold_metadata_enabled") == 0) {
+            getConfiguration().setColdMetadataEnabled(cb_stob(valz));
         } else if (strcmp(keyz, "defragmenter_enabled") == 0) {
             getConfiguration().setDefragmenterEnabled(cb_stob(valz));
         } else if (strcmp(keyz, "defragmenter_interval") == 0) {
@@ -562,6 +597,16 @@ protocol_binary_response_status EventuallyPersistentEngine::setFlushParam(
             runDefragmenterTask();
         } else if (strcmp(keyz, "compaction_write_queue_cap") == 0) {
             getConfiguration().setCompactionWriteQueueCap(std::stoull(valz));
+        } else if (strcmp(keyz, "compaction_max_bytes_per_sec") == 0) {
+            getConfiguration().setCompactionMaxBytesPerSec(std::stoull(valz));
+        } else if (strcmp(keyz, "compaction_max_pause") == 0) {
+            getConfiguration().setCompactionMaxPause(std::stoull(valz));
+        } else if (strcmp(keyz, "compaction_bg_wait_threshold") == 0) {
+            getConfiguration().setCompactionBgWaitThreshold(std::stoull(valz));
+        } else if (strcmp(keyz, "compaction_max_concurrent_ratio") == 0) {
+            getConfiguration().setCompactionMaxConcurrentRatio(std::stof(valz));
+        } else if (strcmp(keyz, "compaction_io_latency_target") == 0) {
+            getConfiguration().setCompactionIoLatencyTarget(std::stoull(valz));
         } else if (strcmp(keyz, "dcp_min_compression_ratio") == 0) {
             getConfiguration().setDcpMinCompressionRatio(std::stof(valz));
         } else if (strcmp(keyz, "dcp_noop_mandatory_for_v5_features") == 0) {
@@ -1621,7 +1666,8 @@ ENGINE_ERROR_CODE create_instance(uint64_t interface,
     Logger::setLoggerAPI(api->log);
 
     MemoryTracker::getInstance(*api->alloc_hooks);
-    ObjectRegistry::initialize(api->alloc_hooks->get_allocation_size);
+    ObjectRegistry::initialize(api->alloc_hooks->get_allocation_size,
+                               api->alloc_hooks->set_thread_arena);
 
     std::atomic<size_t>* inital_tracking = new std::atomic<size_t>();
 
@@ -1737,6 +1783,7 @@ EventuallyPersistentEngine::EventuallyPersistentEngine(
     ENGINE_HANDLE_V1::reset_stats = EvpResetStats;
     ENGINE_HANDLE_V1::store = EvpStore;
     ENGINE_HANDLE_V1::store_if = EvpStoreIf;
+    ENGINE_HANDLE_V1::update_in_place = EvpUpdateInPlace;
     ENGINE_HANDLE_V1::flush = EvpFlush;
     ENGINE_HANDLE_V1::unknown_command = EvpUnknownCommand;
     ENGINE_HANDLE_V1::item_set_cas = EvpItemSetCas;
@@ -1955,6 +2002,10 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::initialize(const char* config) {
 
     maxFailoverEntries = configuration.getMaxFailoverEntries();
 
+    if (configuration.isAllocatorArenaPerBucket()) {
+        acquireArena();
+    }
+
     // Start updating the variables from the config!
     VBucket::setMutationMemoryThreshold(
             configuration.getMutationMemThreshold());
@@ -2062,6 +2113,30 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::initialize(const char* config) {
     return ENGINE_SUCCESS;
 }
 
+void EventuallyPersistentEngine::acquireArena() {
+    auto* hooks = serverApi->alloc_hooks;
+    unsigned arena;
+    if (!MemoryTracker::trackingMemoryAllocations() ||
+        hooks->acquire_arena == nullptr || !hooks->acquire_arena(&arena)) {
+        LOG(EXTENSION_LOG_WARNING,
+            "EPEngine::acquireArena: The allocator doesn't support "
+            "per-bucket arenas, tracking every allocation instead");
+        return;
+    }
+
+    stats.arena = arena;
+    MemoryTracker::getInstance(*hooks)->addArena(arena, stats.arenaMemory);
+    stats.arenaMemoryTracking = true;
+
+    // Everything the bucket allocates from now on (on this thread, and
+    // any other thread working on its behalf) comes from the arena.
+    ObjectRegistry::onSwitchThread(this);
+    LOG(EXTENSION_LOG_NOTICE,
+        "EPEngine::acquireArena: Bucket '%s' allocates from arena %u",
+        name.c_str(),
+        arena);
+}
+
 void EventuallyPersistentEngine::destroy(bool force) {
     stats.forceShutdown = force;
     stats.isShutdown = true;
@@ -2426,6 +2501,66 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::store(
     return ENGINE_ERROR_CODE(rv.status);
 }
 
+ENGINE_ERROR_CODE EventuallyPersistentEngine::updateInPlace(
+        const void* cookie,
+        const DocKey& key,
+        uint16_t vbucket,
+        uint64_t& cas,
+        rel_time_t exptime,
+        const cb::InPlaceMutator& mutator,
+        mutation_descr_t& mut_info) {
+    BlockTimer timer(&stats.storeCmdHisto);
+    if (isDegradedMode()) {
+        return ENGINE_TMPFAIL;
+    }
+
+    cb::ExpiryLimit expiryLimit;
+    std::tie(expiryLimit, exptime) = getExpiryParameters(exptime);
+    const time_t expiretime =
+            (exptime == 0) ? 0 : ep_abs_time(ep_reltime(exptime, expiryLimit));
+
+    // Apply the same limits to the new value as itemAllocate would have
+    // if the value was stored through the normal path
+    auto checkedMutator = [this, &key, &mutator](
+                                  const item_info& current,
+                                  cb::const_char_buffer& value,
+                                  protocol_binary_datatype_t& datatype) {
+        auto status = mutator(current, value, datatype);
+        if (status != cb::engine_errc::success) {
+            return status;
+        }
+
+        const auto priv_nbytes = cb::xattr::get_system_xattr_size(
+                datatype, {value.data(), value.size()});
+        if (priv_nbytes > maxItemPrivilegedBytes ||
+            (value.size() - priv_nbytes) > maxItemSize) {
+            return cb::engine_errc::too_big;
+        }
+
+        if (!hasMemoryForItemAllocation(sizeof(Item) + sizeof(Blob) +
+                                        key.size() + value.size())) {
+            return cb::engine_errc::no_memory;
+        }
+        return cb::engine_errc::success;
+    };
+
+    auto status = kvBucket->updateInPlace(
+            cookie, key, vbucket, cas, expiretime, checkedMutator, mut_info);
+    switch (status) {
+    case ENGINE_SUCCESS:
+        ++stats.numOpsStore;
+        // If success - check if we're now in need of some memory freeing
+        kvBucket->checkAndMaybeFreeMemory();
+        break;
+    case ENGINE_ENOMEM:
+        status = memoryCondition();
+        break;
+    default:
+        break;
+    }
+    return status;
+}
+
 void EventuallyPersistentEngine::initializeEngineCallbacks() {
     // Register the ON_DISCONNECT callback
     registerEngineCallback(ON_DISCONNECT, EvpHandleDisconnect, this);
@@ -2436,7 +2571,7 @@ void EventuallyPersistentEngine::initializeEngineCallbacks() {
 ENGINE_ERROR_CODE EventuallyPersistentEngine::memoryCondition() {
     // Do we think it's possible we could free something?
     bool haveEvidenceWeCanFreeMemory =
-        (stats.getMaxDataSize() > stats.memOverhead->load());
+        (stats.getMaxDataSize() > stats.memOverhead.load());
     if (haveEvidenceWeCanFreeMemory) {
         // Look for more evidence by seeing if we have resident items.
         VBucketCountVisitor countVisitor(vbucket_state_active);
@@ -2618,6 +2753,19 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::doEngineStats(const void *cookie,
 
     add_casted_stat("ep_pending_compactions", epstats.pendingCompactions,
                     add_stat, cookie);
+    add_casted_stat("ep_compaction_throttled_time",
+                    epstats.compactionThrottledTime,
+                    add_stat, cookie);
+    add_casted_stat("ep_compaction_paused_time",
+                    epstats.compactionPausedTime,
+                    add_stat, cookie);
+    add_casted_stat("ep_compaction_num_pauses", epstats.compactionNumPauses,
+                    add_stat, cookie);
+    add_casted_stat("ep_compactions_running", epstats.compactionsRunning,
+                    add_stat, cookie);
+    add_casted_stat("ep_compaction_concurrency_limit",
+                    epstats.compactionConcurrencyLimit,
+                    add_stat, cookie);
     add_casted_stat("ep_rollback_count", epstats.rollbackCount,
                     add_stat, cookie);
 
@@ -2756,6 +2904,9 @@ ENGINE_ERROR_CODE EventuallyPersistentEngine::doEngineStats(const void *cookie,
                     add_stat, cookie);
     add_casted_stat("ep_defragmenter_num_moved", epstats.defragNumMoved,
                     add_stat, cookie);
+    add_casted_stat("ep_defragmenter_sv_num_moved",
+                    epstats.defragStoredValueNumMoved,
+                    add_stat, cookie);
 
     add_casted_stat("ep_cursor_dropping_lower_threshold",
                     epstats.cursorDroppingLThreshold, add_stat, cookie);
@@ -4444,8 +4595,9 @@ protocol_binary_datatype_t EventuallyPersistentEngine::checkForDatatypeJson(
             body = cb::xattr::get_body(body);
         }
 
-        if (checkUTF8JSON(reinterpret_cast<const uint8_t*>(body.data()),
-                          body.size())) {
+        if (cb::json::checkUTF8JSON(
+                    reinterpret_cast<const uint8_t*>(body.data()),
+                    body.size())) {
             datatype |= PROTOCOL_BINARY_DATATYPE_JSON;
         }
     }
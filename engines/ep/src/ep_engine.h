@@ -206,6 +206,14 @@ public:
                                     ENGINE_STORE_OPERATION operation,
                                     cb::StoreIfPredicate predicate);
 
+    ENGINE_ERROR_CODE updateInPlace(const void* cookie,
+                                    const DocKey& key,
+                                    uint16_t vbucket,
+                                    uint64_t& cas,
+                                    rel_time_t exptime,
+                                    const cb::InPlaceMutator& mutator,
+                                    mutation_descr_t& mut_info);
+
     ENGINE_ERROR_CODE flush(const void *cookie);
 
     ENGINE_ERROR_CODE dcpOpen(const void* cookie,
@@ -599,6 +607,12 @@ protected:
     // server.
     void initializeEngineCallbacks();
 
+    /**
+     * Give the bucket an allocator arena of its own (if configured and
+     * supported by the allocator), and read mem_used from the arena stats.
+     */
+    void acquireArena();
+
     /*
      * Private helper method for decoding the options on set/del_with_meta.
      * Tighly coupled to the logic of both those functions, it will
@@ -433,6 +433,11 @@ bool EPVBucket::pageOut(const HashTable::HashBucketLock& lh, StoredValue*& v) {
     return ht.unlocked_ejectItem(v, eviction);
 }
 
+bool EPVBucket::eligibleToPageOut(const HashTable::HashBucketLock& lh,
+                                  const StoredValue& v) const {
+    return v.eligibleForEviction(eviction);
+}
+
 void EPVBucket::queueBackfillItem(queued_item& qi,
                                   const GenerateBySeqno generateBySeqno) {
     LockHolder lh(backfill.mutex);
@@ -446,7 +451,7 @@ void EPVBucket::queueBackfillItem(queued_item& qi,
     ++stats.vbBackfillQueueSize;
     ++stats.totalEnqueued;
     doStatsForQueueing(*qi, qi->size());
-    stats.memOverhead->fetch_add(sizeof(queued_item));
+    stats.memOverhead.fetch_add(sizeof(queued_item));
 }
 
 size_t EPVBucket::queueBGFetchItem(const DocKey& key,
@@ -521,6 +526,12 @@ void EPVBucket::bgFetch(const DocKey& key,
                         EventuallyPersistentEngine& engine,
                         const int bgFetchDelay,
                         const bool isMeta) {
+    // The span is ended by the BG fetcher once it starts reading the
+    // item from disk
+    if (cookie) {
+        engine.getServerApi()->tracing->begin_trace(
+                cookie, cb::tracing::TraceCode::BG_WAIT);
+    }
     if (multiBGFetchEnabled) {
         // schedule to the current batch of background fetch of the given
         // vbucket
@@ -85,21 +85,29 @@ void EphemeralVBucket::completeStatsVKey(const DocKey& key,
             std::string(reinterpret_cast<const char*>(key.data()), key.size()));
 }
 
-bool EphemeralVBucket::pageOut(const HashTable::HashBucketLock& lh,
-                               StoredValue*& v) {
+bool EphemeralVBucket::eligibleToPageOut(const HashTable::HashBucketLock& lh,
+                                         const StoredValue& v) const {
     // We only delete from active vBuckets to ensure that replicas stay in
     // sync with the active (the delete from active is sent via DCP to the
     // the replicas as an explicit delete).
     if (getState() != vbucket_state_active) {
         return false;
     }
-    if (v->isDeleted() && !v->getValue()) {
+    if (v.isDeleted() && !v.getValue()) {
         // If the item has already been deleted (and doesn't have a value
         // associated with it) then there's no further deletion possible,
         // until the deletion marker (tombstone) is later purged at the
         // metadata purge internal.
         return false;
     }
+    return true;
+}
+
+bool EphemeralVBucket::pageOut(const HashTable::HashBucketLock& lh,
+                               StoredValue*& v) {
+    if (!eligibleToPageOut(lh, *v)) {
+        return false;
+    }
     VBQueueItemCtx queueCtx(GenerateBySeqno::Yes,
                             GenerateCas::Yes,
                             TrackCasDrift::No,
@@ -302,7 +310,7 @@ void EphemeralVBucket::queueBackfillItem(
         checkpointManager->setBySeqno(qi->getBySeqno());
     }
     ++stats.totalEnqueued;
-    stats.memOverhead->fetch_add(sizeof(queued_item));
+    stats.memOverhead.fetch_add(sizeof(queued_item));
 }
 
 size_t EphemeralVBucket::purgeStaleItems(std::function<bool()> shouldPauseCbk) {
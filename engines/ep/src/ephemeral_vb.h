@@ -99,6 +99,9 @@ public:
 
     bool pageOut(const HashTable::HashBucketLock& lh, StoredValue*& v) override;
 
+    bool eligibleToPageOut(const HashTable::HashBucketLock& lh,
+                           const StoredValue& v) const override;
+
     bool areDeletedItemsAlwaysResident() const override;
 
     void addStats(bool details, ADD_STAT add_stat, const void* c) override;
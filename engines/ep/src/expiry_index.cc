@@ -0,0 +1,82 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2018 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "expiry_index.h"
+
+bool ExpiryIndex::add(time_t exptime, const DocKey& key) {
+    auto result = timeByKey.emplace(key, exptime);
+    const StoredDocKey* storedKey = &result.first->first;
+    if (!result.second) {
+        const time_t previous = result.first->second;
+        if (previous == exptime) {
+            return false;
+        }
+        auto it = keysByTime.find(previous);
+        it->second.erase(storedKey);
+        if (it->second.empty()) {
+            keysByTime.erase(it);
+        }
+        result.first->second = exptime;
+    }
+    keysByTime[exptime].insert(storedKey);
+    return result.second;
+}
+
+bool ExpiryIndex::remove(const DocKey& key) {
+    if (timeByKey.empty()) {
+        return false;
+    }
+    auto found = timeByKey.find(StoredDocKey(key));
+    if (found == timeByKey.end()) {
+        return false;
+    }
+    auto it = keysByTime.find(found->second);
+    it->second.erase(&found->first);
+    if (it->second.empty()) {
+        keysByTime.erase(it);
+    }
+    timeByKey.erase(found);
+    return true;
+}
+
+std::vector<StoredDocKey> ExpiryIndex::takeDue(time_t now) {
+    std::vector<StoredDocKey> due;
+    const auto end = keysByTime.lower_bound(now);
+    for (auto it = keysByTime.begin(); it != end; ++it) {
+        for (const auto* key : it->second) {
+            due.push_back(*key);
+            timeByKey.erase(*key);
+        }
+    }
+    keysByTime.erase(keysByTime.begin(), end);
+    return due;
+}
+
+std::vector<std::pair<time_t, StoredDocKey>> ExpiryIndex::takeAll() {
+    std::vector<std::pair<time_t, StoredDocKey>> all;
+    all.reserve(timeByKey.size());
+    for (const auto& entry : timeByKey) {
+        all.emplace_back(entry.second, entry.first);
+    }
+    clear();
+    return all;
+}
+
+void ExpiryIndex::clear() {
+    keysByTime.clear();
+    timeByKey.clear();
+}
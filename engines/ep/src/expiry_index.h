@@ -0,0 +1,91 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2018 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include "config.h"
+
+#include "storeddockey.h"
+
+#include <ctime>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+/**
+ * An index of the keys of a HashTable by the time they are due to expire,
+ * so the expiry pager only needs to look at the items which may actually
+ * have expired instead of visiting every item.
+ *
+ * The index holds (at most) one entry per key: setting a new expiry time
+ * for a key replaces its previous entry, so items whose expiry keeps being
+ * pushed back (e.g. touched sessions) don't accumulate entries, and the
+ * entry is removed when the item is deleted or loses its expiry time.
+ *
+ * Not thread-safe: the HashTable keeps one index per lock, holding the keys
+ * of the hash buckets guarded by that lock, and only accesses it with the
+ * lock held.
+ */
+class ExpiryIndex {
+public:
+    /**
+     * Record that the item with the given key is due to expire at the given
+     * time, replacing any previous entry for the key.
+     *
+     * @return true if the key wasn't already in the index
+     */
+    bool add(time_t exptime, const DocKey& key);
+
+    /**
+     * Remove the entry for the given key (if any).
+     *
+     * @return true if the key was in the index
+     */
+    bool remove(const DocKey& key);
+
+    /**
+     * Remove and return the keys which are due to expire before the given
+     * time (i.e. those an item with the key would be expired as of `now`).
+     */
+    std::vector<StoredDocKey> takeDue(time_t now);
+
+    /**
+     * Remove and return all the entries (as {exptime, key} pairs), e.g. to
+     * move them to another index.
+     */
+    std::vector<std::pair<time_t, StoredDocKey>> takeAll();
+
+    void clear();
+
+    bool empty() const {
+        return timeByKey.empty();
+    }
+
+    /// @return the number of entries in the index
+    size_t size() const {
+        return timeByKey.size();
+    }
+
+private:
+    /// The time each key is due; owns the keys
+    std::unordered_map<StoredDocKey, time_t> timeByKey;
+    /// The keys due at each time (pointing into timeByKey, whose keys don't
+    /// move when it is rehashed)
+    std::map<time_t, std::unordered_set<const StoredDocKey*>> keysByTime;
+};
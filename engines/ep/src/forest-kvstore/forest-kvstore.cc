@@ -23,7 +23,7 @@
 #include <platform/cb_malloc.h>
 #include <platform/dirutils.h>
 #include <vbucket.h>
-#include <JSON_checker.h>
+#include <memcached/json_validator.h>
 #include <locks.h>
 #include "statwriter.h"
 
@@ -820,7 +820,8 @@ GetValue ForestKVStore::docToItem(fdb_kvs_handle* kvsHandle, fdb_doc* rdoc,
         void* valuePtr = rdoc->body;
         uint8_t ext_meta[EXT_META_LEN];
 
-        if (checkUTF8JSON((const unsigned char *)valuePtr, valuelen)) {
+        if (cb::json::checkUTF8JSON((const unsigned char*)valuePtr,
+                                    valuelen)) {
             ext_meta[0] = PROTOCOL_BINARY_DATATYPE_JSON;
         } else {
             ext_meta[0] = PROTOCOL_BINARY_RAW_BYTES;
@@ -17,13 +17,18 @@
 
 #include "hash_table.h"
 
+#include "ep_time.h"
 #include "item.h"
+#include "statistical_counter.h"
 #include "stats.h"
 #include "stored_value_factories.h"
 
 #include <phosphor/phosphor.h>
+#include <platform/make_unique.h>
 
+#include <algorithm>
 #include <cstring>
+#include <iterator>
 
 static const ssize_t prime_size_table[] = {
     3, 7, 13, 23, 47, 97, 193, 383, 769, 1531, 3079, 6143, 12289, 24571, 49157,
@@ -58,8 +63,14 @@ HashTable::HashTable(EPStats& st,
       numResizes(0),
       numTempItems(0),
       memSize(0),
-      maxDeletedRevSeqno(0) {
+      maxDeletedRevSeqno(0),
+      numColdItems(0),
+      coldMetaDataMemory(0),
+      expiryIndexes(locks),
+      expiryIndexSize(0),
+      expiryIndexEnabled(false) {
     values.resize(size);
+    coldBlocks.resize(numColdBlocksFor(size));
     activeState = true;
 }
 
@@ -115,6 +126,17 @@ void HashTable::clear_UNLOCKED(bool deactivate) {
 
     stats.currentSize.fetch_sub(clearedMemSize - clearedValSize);
 
+    for (auto& block : coldBlocks) {
+        block.reset();
+    }
+    reduceMetaDataSize(stats, coldMetaDataMemory);
+    coldMetaDataMemory.store(0);
+    numColdItems.store(0);
+    for (auto& index : expiryIndexes) {
+        index.clear();
+    }
+    expiryIndexSize.store(0);
+
     datatypeCounts.fill(0);
     numItems.store(0);
     numTempItems.store(0);
@@ -137,7 +159,21 @@ static bool isCurrently(size_t size, ssize_t a, ssize_t b) {
 }
 
 void HashTable::resize() {
-    size_t ni = getNumInMemoryItems();
+    resizeForItemCount(getNumInMemoryItems());
+}
+
+void HashTable::resizeForItemCount(size_t ni) {
+    resize(getPreferredSize(ni));
+}
+
+void HashTable::grow() {
+    const auto newSize = getPreferredSize(getNumInMemoryItems());
+    if (newSize > size) {
+        resize(newSize);
+    }
+}
+
+size_t HashTable::getPreferredSize(size_t ni) const {
     int i(0);
     size_t new_size(0);
 
@@ -164,7 +200,7 @@ void HashTable::resize() {
         new_size = nearest(ni, prime_size_table[i-1], prime_size_table[i]);
     }
 
-    resize(new_size);
+    return new_size;
 }
 
 void HashTable::resize(size_t newSize) {
@@ -199,7 +235,7 @@ void HashTable::resize(size_t newSize) {
     // Get a place for the new items.
     table_type newValues(newSize);
 
-    stats.memOverhead->fetch_sub(memorySize());
+    stats.memOverhead.fetch_sub(memorySize());
     ++numResizes;
 
     // Set the new size so all the hashy stuff works.
@@ -223,7 +259,48 @@ void HashTable::resize(size_t newSize) {
     // Finally assign the new table to values.
     values = std::move(newValues);
 
-    stats.memOverhead->fetch_add(memorySize());
+    // Regroup the cold metadata according to the new bucket numbers.
+    std::vector<std::unique_ptr<ColdMetadataBlock>> newColdBlocks(
+            numColdBlocksFor(newSize));
+    if (numColdItems != 0) {
+        std::vector<std::vector<ColdMetadataBlock::Record>> regrouped(
+                newColdBlocks.size());
+        for (const auto& block : coldBlocks) {
+            if (!block) {
+                continue;
+            }
+            for (auto& record : block->decode()) {
+                const int newBucket = getBucketForHash(record.getKey().hash());
+                regrouped[coldBlockForBucket(newBucket)].push_back(
+                        std::move(record));
+            }
+        }
+
+        size_t newColdMemory = 0;
+        for (size_t i = 0; i < regrouped.size(); ++i) {
+            if (!regrouped[i].empty()) {
+                newColdBlocks[i] = std::make_unique<ColdMetadataBlock>();
+                newColdBlocks[i]->add(std::move(regrouped[i]));
+                newColdMemory += newColdBlocks[i]->memorySize();
+            }
+        }
+        updateColdMetaDataSize(coldMetaDataMemory, newColdMemory);
+    }
+    coldBlocks = std::move(newColdBlocks);
+
+    // Move the expiry index entries to the indexes of their new buckets.
+    if (expiryIndexSize != 0) {
+        std::vector<std::pair<time_t, StoredDocKey>> entries;
+        for (auto& index : expiryIndexes) {
+            auto taken = index.takeAll();
+            std::move(taken.begin(), taken.end(), std::back_inserter(entries));
+        }
+        for (const auto& entry : entries) {
+            expiryIndexFor(entry.second).add(entry.first, entry.second);
+        }
+    }
+
+    stats.memOverhead.fetch_add(memorySize());
 }
 
 StoredValue* HashTable::find(const DocKey& key,
@@ -359,6 +436,31 @@ void HashTable::statsEpilogue(const StoredValue& v) {
             ++datatypeCounts[v.getDatatype()];
         }
     }
+
+    updateExpiryIndex(v);
+}
+
+void HashTable::updateExpiryIndex(const StoredValue& v) {
+    if (!expiryIndexEnabled) {
+        return;
+    }
+    if (v.isTempItem()) {
+        if (expiryIndexFor(v.getKey()).add(ep_real_time(), v.getKey())) {
+            ++expiryIndexSize;
+        }
+    } else if (v.getExptime() != 0 && !v.isDeleted()) {
+        if (expiryIndexFor(v.getKey()).add(v.getExptime(), v.getKey())) {
+            ++expiryIndexSize;
+        }
+    } else {
+        removeFromExpiryIndex(v.getKey());
+    }
+}
+
+void HashTable::removeFromExpiryIndex(const DocKey& key) {
+    if (expiryIndexSize != 0 && expiryIndexFor(key).remove(key)) {
+        --expiryIndexSize;
+    }
 }
 
 std::pair<StoredValue*, StoredValue::UniquePtr>
@@ -404,26 +506,90 @@ void HashTable::unlocked_softDelete(const std::unique_lock<std::mutex>& htLock,
     statsEpilogue(v);
 }
 
+/**
+ * Increment the frequency counter of the given item. The counter is
+ * statistical, so it only increments with a probability which decreases as
+ * the counter grows (allowing 8 bits to track ~65k references).
+ */
+static void updateFreqCounter(StoredValue& v) {
+    // The StatisticalCounter owns a random number generator (which isn't
+    // thread-safe), so give each thread its own counter.
+    static thread_local StatisticalCounter<uint8_t> counter(2.0);
+    v.setFreqCounterValue(
+            counter.generateCounterValue(v.getFreqCounterValue()));
+}
+
 StoredValue* HashTable::unlocked_find(const DocKey& key,
                                       int bucket_num,
                                       WantsDeleted wantsDeleted,
                                       TrackReference trackReference) {
-    for (StoredValue* v = values[bucket_num].get().get(); v;
-            v = v->getNext().get().get()) {
-        if (v->hasKey(key)) {
-            if (trackReference == TrackReference::Yes && !v->isDeleted()) {
-                v->referenced();
-            }
-            if (wantsDeleted == WantsDeleted::Yes || !v->isDeleted()) {
-                return v;
-            } else {
-                return NULL;
-            }
-        }
+    StoredValue* v = values[bucket_num].get().get();
+    while (v && !v->hasKey(key)) {
+        v = v->getNext().get().get();
+    }
+
+    if (v == NULL && numColdItems != 0) {
+        v = unlocked_promote(key, bucket_num);
+    }
+
+    if (v == NULL) {
+        return NULL;
+    }
+
+    if (trackReference == TrackReference::Yes && !v->isDeleted()) {
+        v->referenced();
+        updateFreqCounter(*v);
+    }
+    if (wantsDeleted == WantsDeleted::Yes || !v->isDeleted()) {
+        return v;
     }
     return NULL;
 }
 
+StoredValue* HashTable::unlocked_promote(const DocKey& key, int bucket_num) {
+    auto& block = coldBlocks[coldBlockForBucket(bucket_num)];
+    if (!block) {
+        return nullptr;
+    }
+
+    const size_t before = block->memorySize();
+    ColdMetadataBlock::Record record;
+    if (!block->remove(key, record)) {
+        return nullptr;
+    }
+
+    if (block->getNumRecords() == 0) {
+        block.reset();
+        updateColdMetaDataSize(before, 0);
+    } else {
+        updateColdMetaDataSize(before, block->memorySize());
+    }
+    --numColdItems;
+
+    // Recreate the StoredValue as it was when demoted: clean, non-resident
+    // and not a new cache item. The item is still counted in numItems,
+    // numNonResidentItems and datatypeCounts, so only the sizes change.
+    Item itm(record.getKey(),
+             record.flags,
+             record.exptime,
+             value_t{},
+             record.datatype,
+             record.cas,
+             record.bySeqno,
+             0,
+             record.revSeqno);
+    auto v = (*valFact)(itm, std::move(values[bucket_num]));
+    v->markNotResident();
+    v->markClean();
+    v->setNewCacheItem(false);
+
+    increaseMetaDataSize(stats, v->metaDataSize());
+    increaseCacheSize(v->size());
+
+    values[bucket_num] = std::move(v);
+    return values[bucket_num].get().get();
+}
+
 void HashTable::unlocked_del(const HashBucketLock& hbl, const DocKey& key) {
     unlocked_release(hbl, key).reset();
 }
@@ -457,6 +623,7 @@ StoredValue::UniquePtr HashTable::unlocked_release(
 
     // Update statistics for the item which is now gone.
     statsPrologue(*released.get());
+    removeFromExpiryIndex(key);
 
     return released;
 }
@@ -558,6 +725,84 @@ void HashTable::visit(HashTableVisitor &visitor) {
     }
 }
 
+void HashTable::setExpiryIndexEnabled(bool enabled) {
+    if (expiryIndexEnabled.exchange(enabled) == enabled) {
+        return;
+    }
+
+    const size_t locks = mutexes.size();
+    if (!enabled) {
+        for (size_t l = 0; l < locks; ++l) {
+            std::lock_guard<std::mutex> guard(mutexes[l]);
+            expiryIndexSize.fetch_sub(expiryIndexes[l].size());
+            expiryIndexes[l].clear();
+        }
+        return;
+    }
+
+    if (!isActive()) {
+        return;
+    }
+
+    // Items modified from now on are added as they change; add all of the
+    // existing items. Register as a visitor so the table isn't resized (and
+    // the cold blocks aren't regrouped) underneath us.
+    std::unique_lock<std::mutex> lh(mutexes[0]);
+    VisitorTracker vt(&visitors);
+    lh.unlock();
+
+    for (size_t l = 0; isActive() && l < locks; ++l) {
+        for (size_t i = l; i < size; i += locks) {
+            HashBucketLock hbl(i, mutexes[l]);
+            for (StoredValue* v = values[i].get().get(); v;
+                 v = v->getNext().get().get()) {
+                updateExpiryIndex(*v);
+            }
+        }
+
+        // The cold blocks of the buckets covered by lock l
+        for (size_t i = l; i < coldBlocks.size(); i += locks) {
+            std::lock_guard<std::mutex> guard(mutexes[l]);
+            if (!coldBlocks[i]) {
+                continue;
+            }
+            for (const auto& record : coldBlocks[i]->decode()) {
+                if (record.exptime != 0 &&
+                    expiryIndexes[l].add(record.exptime, record.getKey())) {
+                    ++expiryIndexSize;
+                }
+            }
+        }
+    }
+}
+
+void HashTable::visitExpired(HashTableVisitor& visitor, time_t now) {
+    for (size_t l = 0; l < mutexes.size(); ++l) {
+        std::vector<StoredDocKey> due;
+        {
+            std::lock_guard<std::mutex> guard(mutexes[l]);
+            due = expiryIndexes[l].takeDue(now);
+            expiryIndexSize.fetch_sub(due.size());
+        }
+
+        for (const auto& key : due) {
+            if (!isActive()) {
+                return;
+            }
+            auto hbl = getLockedBucket(key);
+            StoredValue* v = unlocked_find(key,
+                                           hbl.getBucketNum(),
+                                           WantsDeleted::Yes,
+                                           TrackReference::No);
+            // Items which have been ejected (full eviction) since their
+            // entry was added are simply skipped.
+            if (v) {
+                visitor.visit(hbl, *v);
+            }
+        }
+    }
+}
+
 void HashTable::visitDepth(HashTableDepthVisitor &visitor) {
     if (numItems.load() == 0 || !isActive()) {
         return;
@@ -716,6 +961,138 @@ bool HashTable::unlocked_ejectItem(StoredValue*& vptr,
     }
 }
 
+bool HashTable::unlocked_demote(const HashBucketLock& hbl, StoredValue& v) {
+    if (!hbl.getHTLock()) {
+        throw std::invalid_argument(
+                "HashTable::unlocked_demote: htLock not held");
+    }
+
+    if (!isActive()) {
+        throw std::logic_error(
+                "HashTable::unlocked_demote: Cannot call on a "
+                "non-active object");
+    }
+
+    std::vector<ColdMetadataBlock::Record> records;
+    if (!unlocked_detachCold(hbl.getBucketNum(), v, records)) {
+        return false;
+    }
+    unlocked_addCold(coldBlockForBucket(hbl.getBucketNum()),
+                     std::move(records));
+    return true;
+}
+
+size_t HashTable::demote(const std::vector<StoredDocKey>& keys) {
+    if (!isActive()) {
+        throw std::logic_error(
+                "HashTable::demote: Cannot call on a non-active object");
+    }
+
+    // Register as a visitor so the table isn't resized (changing the
+    // bucket and block of the keys) underneath us.
+    std::unique_lock<std::mutex> lh(mutexes[0]);
+    VisitorTracker vt(&visitors);
+    lh.unlock();
+
+    // Group the keys by cold metadata block; all the buckets of a block
+    // share a lock.
+    std::vector<std::pair<size_t, const StoredDocKey*>> byBlock;
+    byBlock.reserve(keys.size());
+    for (const auto& key : keys) {
+        byBlock.emplace_back(
+                coldBlockForBucket(getBucketForHash(key.hash())), &key);
+    }
+    std::sort(byBlock.begin(),
+              byBlock.end(),
+              [](const std::pair<size_t, const StoredDocKey*>& a,
+                 const std::pair<size_t, const StoredDocKey*>& b) {
+                  return a.first < b.first;
+              });
+
+    size_t demoted = 0;
+    for (auto group = byBlock.begin(); isActive() && group != byBlock.end();) {
+        const size_t block = group->first;
+        std::vector<ColdMetadataBlock::Record> records;
+        std::lock_guard<std::mutex> guard(mutexes[block % mutexes.size()]);
+        for (; group != byBlock.end() && group->first == block; ++group) {
+            const DocKey key = *group->second;
+            const int bucket = getBucketForHash(key.hash());
+            // Look in the hash chain only; the item may already be cold.
+            for (StoredValue* v = values[bucket].get().get(); v;
+                 v = v->getNext().get().get()) {
+                if (v->hasKey(key)) {
+                    unlocked_detachCold(bucket, *v, records);
+                    break;
+                }
+            }
+        }
+        if (!records.empty()) {
+            demoted += records.size();
+            unlocked_addCold(block, std::move(records));
+        }
+    }
+    return demoted;
+}
+
+bool HashTable::unlocked_detachCold(
+        int bucket_num,
+        StoredValue& v,
+        std::vector<ColdMetadataBlock::Record>& records) {
+    if (v.isOrdered() || v.isResident() || v.isDirty() || v.isDeleted() ||
+        v.isTempItem() || v.isLocked(ep_current_time()) ||
+        v.getBySeqno() <= 0) {
+        return false;
+    }
+
+    ColdMetadataBlock::Record record;
+    const DocKey key = v.getKey();
+    record.key.assign(reinterpret_cast<const char*>(key.data()), key.size());
+    record.docNamespace = key.getDocNamespace();
+    record.cas = v.getCas();
+    record.revSeqno = v.getRevSeqno();
+    record.bySeqno = v.getBySeqno();
+    record.exptime = v.getExptime();
+    record.flags = v.getFlags();
+    record.datatype = v.getDatatype();
+
+    auto removed = hashChainRemoveFirst(
+            values[bucket_num],
+            [&v](const StoredValue* sv) { return sv == &v; });
+    if (!removed) {
+        throw std::logic_error(
+                "HashTable::unlocked_detachCold: StoredValue to be demoted "
+                "not found in HashTable");
+    }
+
+    // The item stays counted as a (non-resident) item; only the memory
+    // used to hold its metadata changes.
+    reduceMetaDataSize(stats, removed->metaDataSize());
+    reduceCacheSize(removed->size());
+    removed.reset();
+
+    records.push_back(std::move(record));
+    return true;
+}
+
+void HashTable::unlocked_addCold(
+        size_t block_num, std::vector<ColdMetadataBlock::Record> records) {
+    auto& block = coldBlocks[block_num];
+    size_t before = 0;
+    if (block) {
+        before = block->memorySize();
+    } else {
+        block = std::make_unique<ColdMetadataBlock>();
+    }
+    const size_t added = records.size();
+    if (added == 1) {
+        block->add(std::move(records.front()));
+    } else {
+        block->add(std::move(records));
+    }
+    updateColdMetaDataSize(before, block->memorySize());
+    numColdItems.fetch_add(added);
+}
+
 std::unique_ptr<Item> HashTable::getRandomKeyFromSlot(int slot) {
     auto lh = getLockedBucket(slot);
     for (StoredValue* v = values[slot].get().get(); v;
@@ -752,6 +1129,7 @@ bool HashTable::unlocked_restoreValue(
     if (v.isDeleted()) {
         ++numDeletedItems;
     }
+    updateExpiryIndex(v);
 
     increaseCacheSize(v.getValue()->valueSize());
     return true;
@@ -779,6 +1157,7 @@ void HashTable::unlocked_restoreMeta(const std::unique_lock<std::mutex>& htLock,
         ++numNonResidentItems;
         ++datatypeCounts[v.getDatatype()];
     }
+    updateExpiryIndex(v);
 }
 
 void HashTable::increaseCacheSize(size_t by) {
@@ -801,6 +1180,16 @@ void HashTable::reduceMetaDataSize(EPStats &st, size_t by) {
     st.currentSize.fetch_sub(by);
 }
 
+void HashTable::updateColdMetaDataSize(size_t before, size_t after) {
+    if (after > before) {
+        coldMetaDataMemory.fetch_add(after - before);
+        increaseMetaDataSize(stats, after - before);
+    } else {
+        coldMetaDataMemory.fetch_sub(before - after);
+        reduceMetaDataSize(stats, before - after);
+    }
+}
+
 std::ostream& operator<<(std::ostream& os, const HashTable& ht) {
     os << "HashTable[" << &ht << "] with"
        << " numItems:" << ht.getNumItems()
@@ -18,6 +18,8 @@
 #pragma once
 
 #include "config.h"
+#include "cold_metadata.h"
+#include "expiry_index.h"
 #include "storeddockey.h"
 #include "stored-value.h"
 
@@ -192,7 +194,8 @@ public:
     size_t memorySize() {
         return sizeof(HashTable)
             + (size * sizeof(StoredValue*))
-            + (mutexes.size() * sizeof(std::mutex));
+            + (mutexes.size() * sizeof(std::mutex))
+            + (coldBlocks.size() * sizeof(ColdMetadataBlock*));
     }
 
     /**
@@ -229,6 +232,54 @@ public:
      */
     size_t getNumInMemoryNonResItems() const { return numNonResidentItems; }
 
+    /**
+     * Get the number of (non-resident) items whose metadata has been demoted
+     * to the cold metadata blocks. These are included in getNumItems() and
+     * getNumInMemoryNonResItems().
+     */
+    size_t getNumColdItems() const {
+        return numColdItems;
+    }
+
+    /**
+     * Get the memory used by the cold metadata blocks (included in the
+     * metadata memory).
+     */
+    size_t getColdMetaDataMemory() const {
+        return coldMetaDataMemory;
+    }
+
+    /**
+     * Get the number of entries in the expiry index (which may include
+     * entries for items which have since been ejected under full eviction).
+     */
+    size_t getExpiryIndexSize() const {
+        return expiryIndexSize;
+    }
+
+    /**
+     * Update the expiry index entry of the given item according to its
+     * expiry time: add or replace it if the item has an expiry time, remove
+     * it if not (or if the item is deleted). This is done for every item
+     * added, modified or removed through the HashTable; it only needs to be
+     * called directly when changing an item's expiry time in place.
+     *
+     * Temporary items are recorded as due immediately, so the next run of
+     * the expiry pager will look at (and remove) them.
+     *
+     * Does nothing unless the expiry index is enabled. The lock of the
+     * item's hash bucket must be held.
+     */
+    void updateExpiryIndex(const StoredValue& v);
+
+    /**
+     * Enable or disable the expiry index. The index is only maintained
+     * while it is enabled (i.e. while the expiry pager uses it), so it is
+     * cleared when disabled, and rebuilt from the items in memory (including
+     * the cold ones) when enabled.
+     */
+    void setExpiryIndexEnabled(bool enabled);
+
     /**
      * Get the number of non-resident and resident items managed by
      * this hash table. Includes items marked as deleted.
@@ -289,6 +340,23 @@ public:
      */
     void resize();
 
+    /**
+     * Resize to fit the given number of items (using the same sizing policy
+     * as resize()). Used to pre-size the table before bulk loading items
+     * (e.g. during warmup), instead of repeatedly growing it as the items
+     * are added.
+     *
+     * @param numItems the number of items the table is expected to hold
+     */
+    void resizeForItemCount(size_t numItems);
+
+    /**
+     * Like resize(), but only ever grows the table. Used while warmup is
+     * loading the items the table was pre-sized for, when the table is
+     * expected to look (temporarily) oversized.
+     */
+    void grow();
+
     /**
      * Resize to the specified size.
      */
@@ -460,6 +528,16 @@ public:
      */
     void visit(HashTableVisitor &visitor);
 
+    /**
+     * Visit the items which the expiry index has as due to expire before
+     * the given time (and the temporary items recorded in the index). The
+     * entries visited are removed from the index.
+     *
+     * @param visitor the visitor to call for each item
+     * @param now the time to compare the expiry times against
+     */
+    void visitExpired(HashTableVisitor& visitor, time_t now);
+
     /**
      * Visit all items within this call with a depth visitor.
      */
@@ -543,6 +621,31 @@ public:
      */
     bool unlocked_ejectItem(StoredValue*& vptr, item_eviction_policy_t policy);
 
+    /**
+     * Demote the metadata of a non-resident item to the cold metadata block
+     * for its hash bucket, freeing its StoredValue. The item is promoted
+     * back to a (non-resident) StoredValue the next time it is looked up.
+     *
+     * Only clean, alive, unlocked, non-resident items of an unordered
+     * HashTable can be demoted.
+     *
+     * @param hbl HashBucketLock that must be held
+     * @param v the StoredValue to demote
+     * @return true if the item was demoted, in which case v has been deleted
+     */
+    bool unlocked_demote(const HashBucketLock& hbl, StoredValue& v);
+
+    /**
+     * Demote the metadata of the items with the given keys (as
+     * unlocked_demote), taking each lock and updating each cold metadata
+     * block only once per group of hash buckets sharing a block. Items
+     * which can't be demoted (any more) are skipped.
+     *
+     * @param keys the keys of the items to demote
+     * @return the number of items demoted
+     */
+    size_t demote(const std::vector<StoredDocKey>& keys);
+
     /**
      * Restore the value for the item.
      * Assumes that HT bucket lock is grabbed.
@@ -654,6 +757,9 @@ private:
      */
     void statsEpilogue(const StoredValue& sv);
 
+    /// @return the size resize() picks for the given number of items
+    size_t getPreferredSize(size_t numItems) const;
+
     // The container for actually holding the StoredValues.
     using table_type = std::vector<StoredValue::UniquePtr>;
 
@@ -692,6 +798,26 @@ private:
     std::atomic<uint64_t> maxDeletedRevSeqno;
     bool                 activeState;
 
+    /**
+     * The metadata of demoted items. Each block holds the items of
+     * ColdBlockBuckets hash buckets which share the same lock, so a block is
+     * guarded by the lock of the buckets it holds. Blocks are allocated when
+     * the first item is demoted to them, and freed when they become empty.
+     */
+    std::vector<std::unique_ptr<ColdMetadataBlock>> coldBlocks;
+    cb::NonNegativeCounter<size_t> numColdItems;
+    std::atomic<size_t> coldMetaDataMemory;
+
+    /// The number of hash buckets whose items share a cold metadata block
+    static const size_t ColdBlockBuckets = 16;
+
+    /// The keys of the items with an expiry time, by expiry time. There is
+    /// one index per lock, holding the keys of the hash buckets guarded by
+    /// that lock, so they are maintained under the lock already held.
+    std::vector<ExpiryIndex> expiryIndexes;
+    std::atomic<size_t> expiryIndexSize;
+    std::atomic<bool> expiryIndexEnabled;
+
     int getBucketForHash(int h) {
         return abs(h % static_cast<int>(size));
     }
@@ -704,6 +830,50 @@ private:
         return bucket_num % mutexes.size();
     }
 
+    /// The expiry index holding the given key (guarded by the key's lock)
+    ExpiryIndex& expiryIndexFor(const DocKey& key) {
+        return expiryIndexes[mutexForBucket(getBucketForHash(key.hash()))];
+    }
+
+    /// Remove the entry of the given key from its expiry index (if any)
+    void removeFromExpiryIndex(const DocKey& key);
+
+    size_t coldBlockForBucket(size_t bucket_num) const {
+        const size_t locks = mutexes.size();
+        return (bucket_num / locks / ColdBlockBuckets) * locks +
+               (bucket_num % locks);
+    }
+
+    size_t numColdBlocksFor(size_t tableSize) const {
+        const size_t locks = mutexes.size();
+        return ((tableSize / locks) / ColdBlockBuckets + 1) * locks;
+    }
+
+    /**
+     * Look for the given key in the cold metadata, and if found promote it
+     * to a (non-resident) StoredValue at the head of its hash chain.
+     *
+     * @return the promoted StoredValue, or nullptr if the key isn't cold
+     */
+    StoredValue* unlocked_promote(const DocKey& key, int bucket_num);
+
+    /**
+     * If the given item can be demoted, remove it from its hash chain
+     * (deleting it) and append its metadata to records.
+     *
+     * @return true if the item was removed
+     */
+    bool unlocked_detachCold(int bucket_num,
+                             StoredValue& v,
+                             std::vector<ColdMetadataBlock::Record>& records);
+
+    /// Add the metadata of demoted items to the cold metadata block
+    void unlocked_addCold(size_t block_num,
+                          std::vector<ColdMetadataBlock::Record> records);
+
+    /// Account for a change of the memory used by a cold metadata block
+    void updateColdMetaDataSize(size_t before, size_t after);
+
     std::unique_ptr<Item> getRandomKeyFromSlot(int slot);
 
     /** Searches for the first element in the specified hashChain which matches
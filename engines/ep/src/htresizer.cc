@@ -28,14 +28,27 @@
 
 /**
  * Look at all the hash tables and make sure they're sized appropriately.
+ *
+ * While warmup is running the hash tables are only grown: warmup pre-sizes
+ * them for the items it is about to load, which must not be undone (only to
+ * rehash every item as they arrive) just because they haven't been loaded
+ * yet.
  */
 class ResizingVisitor : public VBucketVisitor {
 public:
-    ResizingVisitor() { }
+    explicit ResizingVisitor(bool growOnly) : growOnly(growOnly) {
+    }
 
     void visitBucket(VBucketPtr &vb) override {
-        vb->ht.resize();
+        if (growOnly) {
+            vb->ht.grow();
+        } else {
+            vb->ht.resize();
+        }
     }
+
+private:
+    const bool growOnly;
 };
 
 HashtableResizerTask::HashtableResizerTask(KVBucketIface* s, double sleepTime)
@@ -48,7 +61,7 @@ HashtableResizerTask::HashtableResizerTask(KVBucketIface* s, double sleepTime)
 
 bool HashtableResizerTask::run(void) {
     TRACE_EVENT0("ep-engine/task", "HashtableResizerTask");
-    auto pv = std::make_unique<ResizingVisitor>();
+    auto pv = std::make_unique<ResizingVisitor>(store->isWarmingUp());
 
     // [per-VBucket Task] While a Hashtable is resizing no user
     // requests can be performed (the resizing process needs to
@@ -0,0 +1,58 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2018 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "item_eviction.h"
+
+const uint8_t ItemEviction::initialFreqCount;
+const size_t ItemEviction::learningPopulation;
+const size_t ItemEviction::requiredToUpdateInterval;
+
+void ItemEviction::updateThreshold(double percentage) {
+    freqThreshold = 0;
+    thresholdProbability = 0.0;
+    if (percentage <= 0.0 || valueCount == 0) {
+        return;
+    }
+
+    // Walk the histogram until we've covered the number of items we want
+    // to evict. The items with a lower counter are all evicted, and the
+    // ones at the threshold with the probability needed to make up the
+    // remainder.
+    const double target = percentage * valueCount;
+    double cumulative = 0;
+    for (size_t ii = 0; ii < freqHistogram.size(); ++ii) {
+        const auto count = freqHistogram[ii];
+        if (count == 0) {
+            continue;
+        }
+        freqThreshold = uint8_t(ii);
+        if (cumulative + count >= target) {
+            thresholdProbability = (target - cumulative) / count;
+            return;
+        }
+        cumulative += count;
+    }
+    // Evict everything
+    thresholdProbability = 1.0;
+}
+
+void ItemEviction::reset() {
+    freqHistogram.fill(0);
+    valueCount = 0;
+    freqThreshold = 0;
+    thresholdProbability = 0.0;
+}
@@ -0,0 +1,120 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2018 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+/**
+ * Eviction policy used by the ItemPager to select which items to evict
+ */
+enum class EvictionPolicy {
+    /// Evict items based on the 2-bit NRU value (and randomly once all items
+    /// have been referenced)
+    lru2Bit,
+    /// Evict the items with the lowest frequency counter first
+    hifi_mfu
+};
+
+/**
+ * ItemEviction tracks the distribution of the frequency counters of the items
+ * visited by the ItemPager (when using the hifi_mfu eviction policy), and
+ * uses it to decide which items to evict so that (roughly) the requested
+ * percentage of the items, starting with the least frequently used, is
+ * evicted.
+ *
+ * The frequency counters are only 8 bits, so the distribution is kept as an
+ * exact histogram with one bucket per counter value. This makes the
+ * threshold cheap to compute, and allows for the items *at* the threshold to
+ * be evicted with the probability needed to evict the requested percentage
+ * (otherwise we would evict all of the items when they all have the same
+ * counter value, e.g. just after a warmup).
+ */
+class ItemEviction {
+public:
+    /// The frequency counter value new items start at, so that they're not
+    /// the first to be evicted.
+    static const uint8_t initialFreqCount = 4;
+
+    /// The number of values added before the threshold is only recomputed
+    /// every requiredToUpdateInterval values.
+    static const size_t learningPopulation = 100;
+
+    /// How often (in values added) the threshold is recomputed once the
+    /// learning population is reached.
+    static const size_t requiredToUpdateInterval = 100;
+
+    /// Add the frequency counter of a visited item to the histogram
+    void addValueToFreqHistogram(uint8_t value) {
+        ++freqHistogram[value];
+        ++valueCount;
+    }
+
+    /// @return the number of values added to the histogram
+    uint64_t getFreqHistogramValueCount() const {
+        return valueCount;
+    }
+
+    /**
+     * Is it time to recompute the threshold (as values have been added to
+     * the histogram since it was last computed)
+     */
+    bool isUpdateRequired() const {
+        return valueCount <= learningPopulation ||
+               (valueCount % requiredToUpdateInterval) == 0;
+    }
+
+    /**
+     * Recompute the threshold to use to evict the given percentage of the
+     * items seen so far.
+     *
+     * @param percentage the fraction (0-1) of items to evict
+     */
+    void updateThreshold(double percentage);
+
+    /**
+     * Should an item with the given frequency counter be evicted, based on
+     * the last computed threshold. Items below the threshold are always
+     * evicted, and items at the threshold are evicted with the probability
+     * needed to hit the requested percentage.
+     *
+     * @param value the frequency counter of the item
+     * @param random a random number in the range [0, 1)
+     */
+    bool shouldEvict(uint8_t value, double random) const {
+        return value < freqThreshold ||
+               (value == freqThreshold && random < thresholdProbability);
+    }
+
+    /// @return the last computed threshold
+    uint8_t getFreqThreshold() const {
+        return freqThreshold;
+    }
+
+    /// Clear the histogram (and the threshold)
+    void reset();
+
+private:
+    std::array<uint64_t, std::numeric_limits<uint8_t>::max() + 1>
+            freqHistogram{};
+    uint64_t valueCount = 0;
+    uint8_t freqThreshold = 0;
+    double thresholdProbability = 0.0;
+};
@@ -170,6 +170,8 @@ public:
             } else {
                 store.disableExpiryPager();
             }
+        } else if (key.compare("exp_pager_use_index") == 0) {
+            store.setExpiryIndexEnabled(value);
         } else if (key.compare("xattr_enabled") == 0) {
             store.setXattrEnabled(value);
         }
@@ -258,7 +260,7 @@ KVBucket::KVBucket(EventuallyPersistentEngine& theEngine)
 
     ExecutorPool::get()->registerTaskable(ObjectRegistry::getCurrentEngine()->getTaskable());
 
-    *stats.memOverhead = sizeof(KVBucket);
+    stats.memOverhead = sizeof(KVBucket);
 
     stats.setMaxDataSize(config.getMaxSize());
     config.addValueChangedListener("max_size",
@@ -664,6 +666,51 @@ ENGINE_ERROR_CODE KVBucket::replace(Item& itm,
     }
 }
 
+ENGINE_ERROR_CODE KVBucket::updateInPlace(const void* cookie,
+                                          const DocKey& key,
+                                          uint16_t vbucket,
+                                          uint64_t& cas,
+                                          time_t exptime,
+                                          const cb::InPlaceMutator& mutator,
+                                          mutation_descr_t& mut_info) {
+    VBucketPtr vb = getVBucket(vbucket);
+    if (!vb) {
+        ++stats.numNotMyVBuckets;
+        return ENGINE_NOT_MY_VBUCKET;
+    }
+
+    // Obtain read-lock on VB state to ensure VB state changes are interlocked
+    // with this update
+    ReaderLockHolder rlh(vb->getStateLock());
+    if (vb->getState() == vbucket_state_dead ||
+        vb->getState() == vbucket_state_replica) {
+        ++stats.numNotMyVBuckets;
+        return ENGINE_NOT_MY_VBUCKET;
+    } else if (vb->getState() == vbucket_state_pending) {
+        if (vb->addPendingOp(cookie)) {
+            return ENGINE_EWOULDBLOCK;
+        }
+    } else if (vb->isTakeoverBackedUp()) {
+        return ENGINE_TMPFAIL;
+    }
+
+    { // collections read-lock scope
+        auto collectionsRHandle = vb->lockCollections(key);
+        if (!collectionsRHandle.valid()) {
+            return ENGINE_UNKNOWN_COLLECTION;
+        } // now hold collections read access for the duration of the update
+
+        return vb->updateInPlace(key,
+                                 cas,
+                                 exptime,
+                                 mutator,
+                                 cookie,
+                                 engine,
+                                 mut_info,
+                                 collectionsRHandle);
+    }
+}
+
 ENGINE_ERROR_CODE KVBucket::addBackfillItem(Item& itm,
                                             GenerateBySeqno genBySeqno,
                                             ExtendedMetaData* emd) {
@@ -1188,10 +1235,19 @@ void KVBucket::completeBGFetch(const DocKey& key,
                                const void* cookie,
                                ProcessClock::time_point init,
                                bool isMeta) {
-    TRACE_SCOPE(engine.serverApi, cookie, cb::tracing::TraceCode::BGFETCH);
     ProcessClock::time_point startTime(ProcessClock::now());
-    // Go find the data
-    GetValue gcb = getROUnderlying(vbucket)->get(key, vbucket, isMeta);
+    // Go find the data (the trace spans must be ended before the cookie
+    // is notified)
+    if (cookie) {
+        engine.serverApi->tracing->end_trace(cookie,
+                                             cb::tracing::TraceCode::BG_WAIT);
+    }
+    GetValue gcb;
+    {
+        TRACE_SCOPE(
+                engine.serverApi, cookie, cb::tracing::TraceCode::BGFETCH);
+        gcb = getROUnderlying(vbucket)->get(key, vbucket, isMeta);
+    }
 
     {
       // Lock to prevent a race condition between a fetch for restore and delete
@@ -2026,6 +2082,15 @@ void KVBucket::resetAccessScannerStartTime() {
     }
 }
 
+void KVBucket::setExpiryIndexEnabled(bool enabled) {
+    for (VBucketMap::id_type vbid = 0; vbid < vbMap.getSize(); vbid++) {
+        VBucketPtr vb = vbMap.getBucket(vbid);
+        if (vb) {
+            vb->ht.setExpiryIndexEnabled(enabled);
+        }
+    }
+}
+
 void KVBucket::setAllBloomFilters(bool to) {
     for (VBucketMap::id_type vbid = 0; vbid < vbMap.getSize(); vbid++) {
         VBucketPtr vb = vbMap.getBucket(vbid);
@@ -2359,6 +2424,8 @@ void KVBucket::initializeExpiryPager(Configuration& config) {
                                    new EPStoreValueChangeListener(*this));
     config.addValueChangedListener("exp_pager_initial_run_time",
                                    new EPStoreValueChangeListener(*this));
+    config.addValueChangedListener("exp_pager_use_index",
+                                   new EPStoreValueChangeListener(*this));
 }
 
 cb::engine_error KVBucket::setCollections(cb::const_char_buffer json) {
@@ -86,7 +86,23 @@ private:
 const uint16_t EP_PRIMARY_SHARD = 0;
 class KVShard;
 
-typedef std::pair<uint16_t, ExTask> CompTaskEntry;
+/**
+ * A scheduled compaction task, and its state in the compaction scheduler
+ */
+struct CompTaskEntry {
+    CompTaskEntry(uint16_t dbFileId, ExTask task)
+        : dbFileId(dbFileId), task(std::move(task)) {
+    }
+
+    uint16_t dbFileId;
+    ExTask task;
+    /// The number of bytes the compaction is expected to reclaim
+    uint64_t reclaimable = 0;
+    /// Is the task waiting for a compaction slot?
+    bool waiting = false;
+    /// Is the task holding a compaction slot?
+    bool running = false;
+};
 
 
 /**
@@ -160,6 +176,28 @@ public:
                               const void* cookie,
                               cb::StoreIfPredicate predicate = {});
 
+    /**
+     * Update an existing item in place, generating the new value with the
+     * mutator while holding the lock for the item.
+     * @param cookie the cookie representing the client to update the item
+     * @param key the key of the item to update
+     * @param vbucket the vbucket the item lives in
+     * @param cas the CAS the item must have (0 for any). Set to the CAS of
+     *            the new item upon success
+     * @param exptime the (absolute) expiry time for the new item
+     * @param mutator the function generating the new value
+     * @param mut_info upon success, the seqno and vbucket uuid of the update
+     * @return the result of the operation (ENGINE_ENOTSUP if the item
+     *         can't be updated in place)
+     */
+    ENGINE_ERROR_CODE updateInPlace(const void* cookie,
+                                    const DocKey& key,
+                                    uint16_t vbucket,
+                                    uint64_t& cas,
+                                    time_t exptime,
+                                    const cb::InPlaceMutator& mutator,
+                                    mutation_descr_t& mut_info) override;
+
     /**
      * Add a DCP backfill item into its corresponding vbucket
      * @param item the item to be added
@@ -630,6 +668,9 @@ public:
 
     void setAllBloomFilters(bool to);
 
+    /// Enable or disable the expiry index of all of the vbuckets
+    void setExpiryIndexEnabled(bool enabled);
+
     float getBfiltersResidencyThreshold() {
         return bfilterResidencyThreshold;
     }
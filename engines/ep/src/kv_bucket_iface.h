@@ -121,6 +121,28 @@ public:
                                       const void* cookie,
                                       cb::StoreIfPredicate predicate = {}) = 0;
 
+    /**
+     * Update an existing item in place, generating the new value with the
+     * mutator while holding the lock for the item.
+     * @param cookie the cookie representing the client to update the item
+     * @param key the key of the item to update
+     * @param vbucket the vbucket the item lives in
+     * @param cas the CAS the item must have (0 for any). Set to the CAS of
+     *            the new item upon success
+     * @param exptime the (absolute) expiry time for the new item
+     * @param mutator the function generating the new value
+     * @param mut_info upon success, the seqno and vbucket uuid of the update
+     * @return the result of the operation (ENGINE_ENOTSUP if the item
+     *         can't be updated in place)
+     */
+    virtual ENGINE_ERROR_CODE updateInPlace(const void* cookie,
+                                            const DocKey& key,
+                                            uint16_t vbucket,
+                                            uint64_t& cas,
+                                            time_t exptime,
+                                            const cb::InPlaceMutator& mutator,
+                                            mutation_descr_t& mut_info) = 0;
+
     /**
      * Add a DCP backfill item into its corresponding vbucket
      * @param item the item to be added
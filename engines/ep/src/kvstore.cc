@@ -74,6 +74,10 @@ void FileStats::reset() {
     writeCountHisto.reset();
     totalBytesRead = 0;
     totalBytesWritten = 0;
+    totalReads = 0;
+    totalReadTime = 0;
+    totalWrites = 0;
+    totalWriteTime = 0;
 }
 
 KVStoreRWRO KVStoreFactory::create(KVStoreConfig& config) {
@@ -105,6 +105,9 @@ typedef struct {
     BloomFilterCBPtr bloomFilterCallback;
     ExpiredItemsCBPtr expiryCallback;
     std::function<bool(const DocKey, int64_t)> collectionsEraser;
+    // Called with the size of every document visited; may block in order
+    // to throttle the compaction
+    std::function<void(size_t)> throttle;
     struct CompactionStats stats;
 } compaction_ctx;
 
@@ -261,6 +264,12 @@ struct FileStats {
     std::atomic<size_t> totalBytesRead{0};
     // Total bytes written to disk.
     std::atomic<size_t> totalBytesWritten{0};
+    // Number of reads and the total time (usec) spent in them
+    std::atomic<size_t> totalReads{0};
+    std::atomic<uint64_t> totalReadTime{0};
+    // Number of writes and the total time (usec) spent in them
+    std::atomic<size_t> totalWrites{0};
+    std::atomic<uint64_t> totalWriteTime{0};
 
     void reset();
 };
@@ -170,7 +170,32 @@ void MemoryTracker::getDetailedStats(char* buffer, int size) {
 }
 
 void MemoryTracker::updateStats() {
+    // Also refreshes the allocator's (per arena) stats
     hooks_api.get_allocator_stats(&stats);
+
+    std::lock_guard<std::mutex> lh(arenasMutex);
+    for (auto& arena : arenas) {
+        size_t allocated;
+        if (hooks_api.get_arena_allocated(arena.first, &allocated)) {
+            arena.second->store(allocated);
+        }
+    }
+}
+
+void MemoryTracker::addArena(unsigned arena, std::atomic<size_t>& allocated) {
+    // Sample the arena straight away; updateStats() writes `stats`, so
+    // exclude the stats thread while doing so.
+    std::lock_guard<std::mutex> lock(mutex);
+    {
+        std::lock_guard<std::mutex> lh(arenasMutex);
+        arenas[arena] = &allocated;
+    }
+    updateStats();
+}
+
+void MemoryTracker::removeArena(unsigned arena) {
+    std::lock_guard<std::mutex> lh(arenasMutex);
+    arenas.erase(arena);
 }
 
 size_t MemoryTracker::getFragmentation() {
@@ -54,6 +54,15 @@ public:
 
     void updateStats();
 
+    /**
+     * Sample the bytes allocated from the given allocator arena into
+     * `allocated` every time the stats are updated, until removeArena()
+     * is called.
+     */
+    void addArena(unsigned arena, std::atomic<size_t>& allocated);
+
+    void removeArena(unsigned arena);
+
     void getDetailedStats(char* buffer, int size);
 
     size_t getFragmentation();
@@ -84,7 +93,7 @@ private:
     cb_thread_t statsThreadId;
     allocator_stats stats;
 
-    // Mutex guarding the shutdown condvar.
+    // Mutex guarding the shutdown condvar, and held while updating stats.
     std::mutex mutex;
     // Condition variable used to signal shutdown to the stats thread.
     std::condition_variable shutdown_cv;
@@ -92,6 +101,11 @@ private:
     // Memory allocator hooks API to use (needed by New / Delete hook
     // functions)
     ALLOCATOR_HOOKS_API hooks_api;
+
+    // Mutex guarding arenas.
+    std::mutex arenasMutex;
+    // The arenas to sample, and where to store their allocated bytes.
+    std::map<unsigned, std::atomic<size_t>*> arenas;
 };
 
 #endif  // SRC_MEMORY_TRACKER_H_
@@ -265,7 +265,8 @@ MutationLog::MutationLog(const std::string &path,
     entryBuffer(new uint8_t[MutationLogEntry::len(256)]()),
     blockBuffer(new uint8_t[bs]()),
     syncConfig(DEFAULT_SYNC_CONF),
-    readOnly(false)
+    readOnly(false),
+    lastKey("", DocNamespace::DefaultCollection)
 {
     for (int ii = 0; ii < int(MutationLogType::NumberOfTypes); ++ii) {
         itemsLogged[ii].store(0);
@@ -295,10 +296,12 @@ void MutationLog::disable() {
     }
 }
 
-void MutationLog::newItem(uint16_t vbucket, const DocKey& key) {
+void MutationLog::newItem(uint16_t vbucket,
+                          const DocKey& key,
+                          uint64_t seqno) {
     if (isEnabled()) {
         MutationLogEntry* mle = MutationLogEntry::newEntry(
-                entryBuffer.get(), MutationLogType::New, vbucket, key);
+                entryBuffer.get(), MutationLogType::New, vbucket, key, seqno);
         writeEntry(mle);
     }
 }
@@ -399,10 +402,11 @@ void MutationLog::readInitialBlock() {
 
     headerBlock.set(buf);
 
-    // Check the version is one we can handle, V1 and V2.
+    // Check the version is one we can handle, V1, V2 and V3.
     switch (headerBlock.version()) {
     case MutationLogVersion::V1:
     case MutationLogVersion::V2:
+    case MutationLogVersion::V3:
         break;
     default: {
         std::stringstream ss;
@@ -681,6 +685,8 @@ bool MutationLog::flush() {
             logSize.fetch_add(blockSize);
             blockPos = HEADER_RESERVED;
             entries = 0;
+            // Each block is compressed on its own
+            lastKey = StoredDocKey("", DocNamespace::DefaultCollection);
         } else {
             /* write to the mutation log failed. Disable the log */
             disabled = true;
@@ -715,8 +721,33 @@ void MutationLog::writeEntry(MutationLogEntry *mle) {
         flush();
     }
 
-    memcpy(blockBuffer.get() + blockPos, mle, len);
-    blockPos += len;
+    if (mle->type() == MutationLogType::New) {
+        // Only store the part of the key following the prefix it shares
+        // with the previous key in the block.
+        const auto& key = mle->key();
+        size_t prefixLen = 0;
+        if (key.getDocNamespace() == lastKey.getDocNamespace()) {
+            const size_t maxLen = std::min(key.size(), lastKey.size());
+            while (prefixLen < maxLen &&
+                   key.data()[prefixLen] == lastKey.data()[prefixLen]) {
+                ++prefixLen;
+            }
+        }
+        const auto* written = MutationLogEntry::newEntry(
+                blockBuffer.get() + blockPos,
+                mle->type(),
+                mle->vbucket(),
+                {key.data() + prefixLen,
+                 key.size() - prefixLen,
+                 key.getDocNamespace()},
+                mle->seqno(),
+                uint8_t(prefixLen));
+        blockPos += written->len();
+        lastKey = StoredDocKey(key);
+    } else {
+        memcpy(blockBuffer.get() + blockPos, mle, len);
+        blockPos += len;
+    }
     ++entries;
 
     ++itemsLogged[int(mle->type())];
@@ -733,7 +764,9 @@ MutationLog::iterator::iterator(const MutationLog* l, bool e)
       p(buf.begin()),
       offset(l->header().blockSize() * l->header().blockCount()),
       items(0),
-      isEnd(e) {
+      isEnd(e),
+      entryLen(0),
+      prevKey("", DocNamespace::DefaultCollection) {
 }
 
 MutationLog::iterator::iterator(const MutationLog::iterator& mit)
@@ -743,7 +776,9 @@ MutationLog::iterator::iterator(const MutationLog::iterator& mit)
       p(buf.begin() + (mit.p - mit.buf.begin())),
       offset(mit.offset),
       items(mit.items),
-      isEnd(mit.isEnd) {
+      isEnd(mit.isEnd),
+      entryLen(mit.entryLen),
+      prevKey(mit.prevKey) {
 }
 
 MutationLog::iterator& MutationLog::iterator::operator=(const MutationLog::iterator& other)
@@ -755,6 +790,8 @@ MutationLog::iterator& MutationLog::iterator::operator=(const MutationLog::itera
     offset = other.offset;
     items = other.items;
     isEnd = other.isEnd;
+    entryLen = other.entryLen;
+    prevKey = other.prevKey;
 
     return *this;
 }
@@ -778,11 +815,44 @@ void MutationLog::iterator::prepItem() {
                 MutationLogEntryV2::newEntry(p, bufferBytesRemaining())->len();
         break;
     }
+    case MutationLogVersion::V3: {
+        const auto* mle =
+                MutationLogEntryV3::newEntry(p, bufferBytesRemaining());
+        entryLen = mle->len();
+        expandEntry(*mle);
+        return;
+    }
     }
 
     std::copy_n(p, copyLen, entryBuf.begin());
 }
 
+void MutationLog::iterator::expandEntry(const MutationLogEntryV3& mle) {
+    const auto& suffix = mle.key();
+    const size_t prefixLen = mle.getPrefixLen();
+    if (prefixLen > prevKey.size() ||
+        (prefixLen != 0 &&
+         prevKey.getDocNamespace() != suffix.getDocNamespace())) {
+        throw ReadException("Invalid key prefix length " +
+                            std::to_string(prefixLen));
+    }
+
+    std::string key(reinterpret_cast<const char*>(prevKey.data()), prefixLen);
+    key.append(reinterpret_cast<const char*>(suffix.data()), suffix.size());
+    if (MutationLogEntryV3::len(key.size()) > entryBuf.size()) {
+        throw ReadException("Key too long: " + std::to_string(key.size()));
+    }
+
+    MutationLogEntryV3::newEntry(entryBuf.data(),
+                                 mle.type(),
+                                 mle.vbucket(),
+                                 {key, suffix.getDocNamespace()},
+                                 mle.seqno());
+    if (mle.type() == MutationLogType::New) {
+        prevKey = StoredDocKey(key, suffix.getDocNamespace());
+    }
+}
+
 size_t MutationLog::iterator::getCurrentEntryLen() const {
     switch (log->headerBlock.version()) {
     case MutationLogVersion::V1: {
@@ -793,6 +863,10 @@ size_t MutationLog::iterator::getCurrentEntryLen() const {
         return MutationLogEntryV2::newEntry(entryBuf.begin(), entryBuf.size())
                 ->len();
     }
+    case MutationLogVersion::V3: {
+        // entryBuf holds the expanded entry, we need the on-disk length
+        return entryLen;
+    }
     }
     throw std::logic_error(
             "MutationLog::iterator::getCurrentEntryLen unknown version " +
@@ -832,22 +906,20 @@ MutationLog::MutationLogEntryHolder MutationLog::iterator::upgradeEntry()
     // The addition of more source versions would mean adding more const
     // pointers here.
     const MutationLogEntryV1* mleV1 = nullptr;
+    const MutationLogEntryV2* mleV2 = nullptr;
+    std::unique_ptr<uint8_t[]> allocatedV2;
     std::unique_ptr<uint8_t[]> allocated;
 
-    // With only two versions this code is a little unnecessary but will
-    // cause the addition of V3 to fail compile. The aim is that the addition of
-    // V3 should now be obvious. I.e. we can step V1->V2->V3 or V2->V3
+    // We can step V1->V2->V3 or V2->V3
     switch (log->headerBlock.version()) {
     case MutationLogVersion::V1: {
         mleV1 = MutationLogEntryV1::newEntry(entryBuf.begin(), entryBuf.size());
         break;
     }
-    /* If V3 exists then add a case for V2, for example:
     case MutationLogVersion::V2: {
         mleV2 = MutationLogEntryV2::newEntry(entryBuf.begin(), entryBuf.size());
         break;
     }
-    */
     case MutationLogVersion::Current: {
         throw std::invalid_argument(
                 "MutationLog::iterator::upgradeEntry cannot"
@@ -867,28 +939,27 @@ MutationLog::MutationLogEntryHolder MutationLog::iterator::upgradeEntry()
     case MutationLogVersion::V2: {
         // Upgrade V1 to V2.
         // Alloc a buffer using the length read from V1 as input to V2::len
-        allocated = std::make_unique<uint8_t[]>(
+        allocatedV2 = std::make_unique<uint8_t[]>(
                 MutationLogEntryV2::len(mleV1->getKeylen()));
 
         // Now in-place construct into the buffer
-        (void) new (allocated.get()) MutationLogEntryV2(*mleV1);
-        // If adding more cases, we should assign the above "new" pointer to a
-        // mleV2 and allow the next case to read it.
+        mleV2 = new (allocatedV2.get()) MutationLogEntryV2(*mleV1);
 
         // fall through
     }
-    /* If V3 exists then add a case (which is hit by V2 falling through)
     case MutationLogVersion::V3: {
         // Upgrade V2 to V3
         // Alloc a buffer using the length read from V2 as input to V3::len
         allocated = std::make_unique<uint8_t[]>(
-                MutationLogEntryV3::len(mleV2->getKeylen()));
+                MutationLogEntryV3::len(mleV2->key().size()));
+
+        // Now in-place construct into the new buffer
+        (void) new (allocated.get()) MutationLogEntryV3(*mleV2);
+        // If adding more cases, we should assign the above "new" pointer to a
+        // mleV3 and allow the next case to read it.
 
-        // Now in-place construct into the new buffer and assign to mleV3
-        mleV3 = new (allocated.get()) MutationLogEntryV3(*mleV3);
         // fall through
     }
-    */
     }
 
     // transfer ownership to the MutationLogEntryHolder and mark that it's
@@ -947,6 +1018,9 @@ void MutationLog::iterator::nextBlock() {
     // the first item.
     p = buf.begin() + sizeof(uint16_t) + sizeof(uint16_t);
 
+    // Keys are only prefix compressed against keys in the same block
+    prevKey = StoredDocKey("", DocNamespace::DefaultCollection);
+
     prepItem();
 }
 
@@ -970,7 +1044,7 @@ bool MutationLogHarvester::load() {
         switch (le->type()) {
         case MutationLogType::New:
             if (vbid_set.find(le->vbucket()) != vbid_set.end()) {
-                loading[le->vbucket()].emplace(le->key());
+                loading[le->vbucket()].emplace(le->seqno(), le->key());
             }
             break;
         case MutationLogType::Commit2:
@@ -1012,7 +1086,7 @@ MutationLog::iterator MutationLogHarvester::loadBatch(
         switch (le->type()) {
         case MutationLogType::New:
             if (vbid_set.find(le->vbucket()) != vbid_set.end()) {
-                committed[le->vbucket()].emplace(le->key());
+                committed[le->vbucket()].emplace(le->seqno(), le->key());
                 count++;
             }
             break;
@@ -1032,8 +1106,8 @@ MutationLog::iterator MutationLogHarvester::loadBatch(
 
 void MutationLogHarvester::apply(void *arg, mlCallback mlc) {
     for (const uint16_t vb : vbid_set) {
-        for (const auto& key : committed[vb]) {
-            if (!mlc(arg, vb, key)) { // Stop loading from an access log
+        for (const auto& entry : committed[vb]) {
+            if (!mlc(arg, vb, entry.second)) { // Stop loading from an access log
                 return;
             }
         }
@@ -1051,26 +1125,27 @@ void MutationLogHarvester::apply(void *arg, mlCallbackWithQueue mlc) {
             continue;
         }
 
-        // Remove any items which are no longer valid in the VBucket.
-        for (auto it = committed[vb].begin(); it != committed[vb].end(); ) {
-            if ((vbucket->ht.find(*it, TrackReference::No, WantsDeleted::No) ==
-                 nullptr)) {
-                it = committed[vb].erase(it);
-            }
-            else {
-                ++it;
+        // Skip any items which are no longer valid in the VBucket. As the
+        // batch was loaded in seqno order its keys are close together on
+        // disk.
+        std::set<StoredDocKey> fetches;
+        for (const auto& entry : committed[vb]) {
+            if (vbucket->ht.find(entry.second,
+                                 TrackReference::No,
+                                 WantsDeleted::No) != nullptr) {
+                fetches.insert(entry.second);
             }
         }
+        committed[vb].clear();
 
-        if (committed[vb].empty()) {
+        if (fetches.empty()) {
             // No valid items for this vBucket; move to next.
             continue;
         }
 
-        if (!mlc(vb, committed[vb], arg)) {
+        if (!mlc(vb, fetches, arg)) {
             return;
         }
-        committed[vb].clear();
     }
 }
 
@@ -36,6 +36,10 @@
  * during warmup there's no guarantee that the keys listed still exist - the
  * contents of the Access log is essentially just a hint / suggestion.
  *
+ * Since V3 each entry records the seqno of the item, and the AccessScanner
+ * writes the keys of each vBucket in seqno order so that warmup reads the
+ * documents roughly in the order they are laid out on disk. The keys are
+ * prefix compressed within each block.
  */
 
 #include "config.h"
@@ -48,6 +52,7 @@
 #include <set>
 #include <string>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include <atomic>
@@ -73,7 +78,7 @@ const int MUTATION_LOG_COMPACTOR_FREQ(3600);
 const size_t MIN_LOG_HEADER_SIZE(4096);
 const size_t HEADER_RESERVED(4);
 
-enum class MutationLogVersion { V1 = 1, V2 = 2, Current = V2 };
+enum class MutationLogVersion { V1 = 1, V2 = 2, V3 = 3, Current = V3 };
 
 const size_t LOG_ENTRY_BUF_SIZE(512);
 
@@ -210,7 +215,14 @@ public:
 
     ~MutationLog();
 
-    void newItem(uint16_t vbucket, const DocKey& key);
+    /**
+     * Log the given key.
+     *
+     * @param vbucket the vbucket the key belongs to
+     * @param key the key
+     * @param seqno the seqno of the item (zero if not known)
+     */
+    void newItem(uint16_t vbucket, const DocKey& key, uint64_t seqno = 0);
 
     void commit1();
 
@@ -402,6 +414,12 @@ public:
         size_t bufferBytesRemaining();
         void prepItem();
 
+        /**
+         * Expand the given (prefix compressed) entry into entryBuf, taking
+         * the shared prefix from the previous key in the block.
+         */
+        void expandEntry(const MutationLogEntryV3& mle);
+
         /**
          * Upgrades the entry the iterator is currently at and returns it
          * via a MutationLogEntryHolder
@@ -415,6 +433,11 @@ public:
         off_t              offset;
         uint16_t           items;
         bool               isEnd;
+        // The on-disk length of the current (V3) entry, which differs from
+        // the length of the expanded entry in entryBuf
+        size_t             entryLen;
+        // The key of the previous entry in the block (V3)
+        StoredDocKey       prevKey;
     };
 
     /**
@@ -471,6 +494,9 @@ private:
     std::unique_ptr<uint8_t[]> blockBuffer;
     uint8_t            syncConfig;
     bool               readOnly;
+    // The key of the last entry written to the current block, the next
+    // key is prefix compressed against it
+    StoredDocKey       lastKey;
 
     friend std::ostream& operator<<(std::ostream& os, const MutationLog& mlog);
 
@@ -546,7 +572,9 @@ public:
                                         size_t limit);
 
     /**
-     * Apply the processed log entries through the given function.
+     * Apply the processed log entries through the given function. The keys
+     * of each vBucket are applied in seqno order, so the items are read
+     * in (roughly) the order they were written to disk.
      */
     void apply(void *arg, mlCallback mlc);
     void apply(void *arg, mlCallbackWithQueue mlc);
@@ -569,7 +597,11 @@ private:
     EventuallyPersistentEngine *engine;
     std::set<uint16_t> vbid_set;
 
-    std::unordered_map<uint16_t, std::set<StoredDocKey>> committed;
-    std::unordered_map<uint16_t, std::set<StoredDocKey>> loading;
+    /// The keys loaded for each vBucket, ordered by seqno (and then key for
+    /// entries without a seqno)
+    using SeqnoOrderedKeys = std::set<std::pair<uint64_t, StoredDocKey>>;
+
+    std::unordered_map<uint16_t, SeqnoOrderedKeys> committed;
+    std::unordered_map<uint16_t, SeqnoOrderedKeys> loading;
     size_t itemsSeen[int(MutationLogType::NumberOfTypes)];
 };
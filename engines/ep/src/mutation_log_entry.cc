@@ -56,3 +56,13 @@ std::ostream& operator<<(std::ostream& out, const MutationLogEntryV2& mle) {
         << "''";
     return out;
 }
+
+std::ostream& operator<<(std::ostream& out, const MutationLogEntryV3& mle) {
+    out << "{MutationLogEntryV3"
+        << " vbucket=" << mle.vbucket() << ", magic=0x" << std::hex
+        << static_cast<uint16_t>(mle.magic) << std::dec
+        << ", type=" << to_string(mle.type()) << ", seqno=" << mle.seqno()
+        << ", prefixLen=" << int(mle.getPrefixLen()) << ", key=``"
+        << mle.key().data() << "''";
+    return out;
+}
@@ -34,6 +34,7 @@ enum class MutationLogType : uint8_t {
 std::string to_string(MutationLogType t);
 
 class MutationLogEntryV2;
+class MutationLogEntryV3;
 
 /**
  * An entry in the MutationLog.
@@ -305,6 +306,8 @@ public:
     }
 
 private:
+    friend MutationLogEntryV3;
+
     friend std::ostream& operator<<(std::ostream& out,
                                     const MutationLogEntryV2& e);
 
@@ -335,6 +338,206 @@ private:
                   "_type must be a uint8_t");
 };
 
-using MutationLogEntry = MutationLogEntryV2;
-
 std::ostream& operator<<(std::ostream& out, const MutationLogEntryV2& mle);
+
+/**
+ * An entry in the MutationLog.
+ * This is the V3 layout which adds the seqno of the item (so the access log
+ * can be loaded in the order the items were written to disk) and prefix
+ * compresses the keys; an entry only stores the part of its key following
+ * the prefixLen bytes it shares with the previous entry in the block.
+ *
+ * Entries handed out by the MutationLog::iterator are always expanded (the
+ * key is complete and prefixLen is zero).
+ */
+class MutationLogEntryV3 {
+public:
+    static const uint8_t MagicMarker = 0x47;
+
+    /**
+     * Construct a V3 from V2, the seqno of the item is not known (zero).
+     * No constructor delegation, copy the values raw (so no byte swaps occur)
+     */
+    MutationLogEntryV3(const MutationLogEntryV2& mleV2)
+        : _seqno(0),
+          _vbucket(mleV2._vbucket),
+          magic(MagicMarker),
+          _type(mleV2._type),
+          _prefixLen(0),
+          _key({mleV2._key.data(),
+                mleV2._key.size(),
+                mleV2._key.getDocNamespace()}) {
+    }
+
+    /**
+     * Initialize a new entry inside the given buffer.
+     *
+     * @param t the type of log entry
+     * @param vb the vbucket
+     * @param k the key (or the part of it following the shared prefix)
+     * @param seqno the seqno of the item (zero if not known)
+     * @param prefixLen the number of bytes of the key shared with the key of
+     *        the previous entry in the block (and not included in k)
+     */
+    static MutationLogEntryV3* newEntry(uint8_t* buf,
+                                        MutationLogType t,
+                                        uint16_t vb,
+                                        const DocKey& k,
+                                        uint64_t seqno,
+                                        uint8_t prefixLen = 0) {
+        return new (buf) MutationLogEntryV3(t, vb, k, seqno, prefixLen);
+    }
+
+    static MutationLogEntryV3* newEntry(uint8_t* buf,
+                                        MutationLogType t,
+                                        uint16_t vb) {
+        if (MutationLogType::Commit1 != t && MutationLogType::Commit2 != t) {
+            throw std::invalid_argument(
+                    "MutationLogEntryV3::newEntry: invalid type");
+        }
+        return new (buf) MutationLogEntryV3(t, vb);
+    }
+
+    /**
+     * Initialize a new entry using the contents of the given buffer.
+     *
+     * @param buf a chunk of memory thought to contain a valid
+     *        MutationLogEntryV3
+     * @param buflen the length of said buf
+     */
+    static const MutationLogEntryV3* newEntry(
+            std::vector<uint8_t>::const_iterator itr, size_t buflen) {
+        if (buflen < len(0)) {
+            throw std::invalid_argument(
+                    "MutationLogEntryV3::newEntry: buflen "
+                    "(which is " +
+                    std::to_string(buflen) +
+                    ") is less than minimum required (which is " +
+                    std::to_string(len(0)) + ")");
+        }
+
+        const auto* me = reinterpret_cast<const MutationLogEntryV3*>(&(*itr));
+
+        if (me->magic != MagicMarker) {
+            throw std::invalid_argument(
+                    "MutationLogEntryV3::newEntry: "
+                    "magic (which is " +
+                    std::to_string(me->magic) + ") is not equal to " +
+                    std::to_string(MagicMarker));
+        }
+        if (me->len() > buflen) {
+            throw std::invalid_argument(
+                    "MutationLogEntryV3::newEntry: "
+                    "entry length (which is " +
+                    std::to_string(me->len()) +
+                    ") is greater than available buflen (which is " +
+                    std::to_string(buflen) + ")");
+        }
+        return me;
+    }
+
+    void operator delete(void*) {
+        // Statically buffered.  There is no delete.
+        throw std::logic_error("MutationLogEntryV3 delete is not allowed");
+    }
+
+    /**
+     * The size of a MutationLogEntryV3, in bytes, containing a key of
+     * the specified length.
+     */
+    static size_t len(size_t klen) {
+        // the exact empty record size as will be packed into the layout
+        return sizeof(MutationLogEntryV3) + (klen - 1);
+    }
+
+    /**
+     * The number of bytes of the serialized form of this
+     * MutationLogEntryV3.
+     */
+    size_t len() const {
+        return len(_key.size());
+    }
+
+    /**
+     * This entry's key (only the part following the shared prefix if the
+     * entry is prefix compressed).
+     */
+    const SerialisedDocKey& key() const {
+        return _key;
+    }
+
+    /**
+     * This entry's vbucket.
+     */
+    uint16_t vbucket() const {
+        return ntohs(_vbucket);
+    }
+
+    /**
+     * The type of this log entry.
+     */
+    MutationLogType type() const {
+        return _type;
+    }
+
+    /**
+     * The seqno of the item when it was logged (zero if not known).
+     */
+    uint64_t seqno() const {
+        return ntohll(_seqno);
+    }
+
+    /**
+     * The number of bytes the key shares with the key of the previous entry
+     * in the block.
+     */
+    uint8_t getPrefixLen() const {
+        return _prefixLen;
+    }
+
+private:
+    friend std::ostream& operator<<(std::ostream& out,
+                                    const MutationLogEntryV3& e);
+
+    MutationLogEntryV3(MutationLogType t,
+                       uint16_t vb,
+                       const DocKey& k,
+                       uint64_t seqno,
+                       uint8_t prefixLen)
+        : _seqno(htonll(seqno)),
+          _vbucket(htons(vb)),
+          magic(MagicMarker),
+          _type(t),
+          _prefixLen(prefixLen),
+          _key(k) {
+        // Assert that _key is the final member
+        static_assert(
+                offsetof(MutationLogEntryV3, _key) ==
+                        (sizeof(MutationLogEntryV3) - sizeof(SerialisedDocKey)),
+                "_key must be the final member of MutationLogEntryV3");
+    }
+
+    MutationLogEntryV3(MutationLogType t, uint16_t vb)
+        : MutationLogEntryV3(t,
+                             vb,
+                             {nullptr, 0, DocNamespace::DefaultCollection},
+                             0,
+                             0) {
+    }
+
+    const uint64_t _seqno;
+    const uint16_t _vbucket;
+    const uint8_t magic;
+    const MutationLogType _type;
+    const uint8_t _prefixLen;
+    const SerialisedDocKey _key;
+
+    DISALLOW_COPY_AND_ASSIGN(MutationLogEntryV3);
+
+    static_assert(sizeof(MutationLogType) == sizeof(uint8_t),
+                  "_type must be a uint8_t");
+};
+
+using MutationLogEntry = MutationLogEntryV3;
+
+std::ostream& operator<<(std::ostream& out, const MutationLogEntryV3& mle);
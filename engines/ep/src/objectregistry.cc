@@ -24,6 +24,8 @@
 #include "stored-value.h"
 #include "threadlocal.h"
 
+#include <memcached/allocator_hooks.h>
+
 #if 1
 static ThreadLocal<EventuallyPersistentEngine*> *th;
 static ThreadLocal<std::atomic<size_t>*> *initial_track;
@@ -35,6 +37,17 @@ extern "C" {
 }
 
 static get_allocation_size getAllocSize = defaultGetAllocSize;
+static set_thread_arena setThreadArena = nullptr;
+
+/**
+ * The allocator arena the thread currently allocates from, and the last
+ * bucket arena it allocated from.
+ */
+struct ThreadArena {
+    unsigned current = ALLOCATOR_DEFAULT_ARENA;
+    unsigned lastBucket = ALLOCATOR_DEFAULT_ARENA;
+};
+static thread_local ThreadArena threadArena;
 
 
 
@@ -69,12 +82,57 @@ static bool verifyEngine(EventuallyPersistentEngine *engine)
    return true;
 }
 
-void ObjectRegistry::initialize(get_allocation_size func) {
+static void switchArena(EventuallyPersistentEngine* engine) {
+    if (setThreadArena == nullptr) {
+        return;
+    }
+
+    // A thread returning to the daemon goes back to the default arena, so
+    // neither daemon (connection buffers etc) nor other buckets' memory is
+    // accounted to (or left behind in) the bucket's arena.
+    unsigned arena = ALLOCATOR_DEFAULT_ARENA;
+    if (engine != nullptr && engine->getEpStats().arenaMemoryTracking) {
+        arena = engine->getEpStats().arena;
+    }
+    if (arena == threadArena.current) {
+        return;
+    }
+
+    // Memory cached by the thread from one bucket's arena must not be handed
+    // out to another bucket. Switching back and forth between a bucket and
+    // the default arena (which happens for every request) doesn't flush the
+    // cache, so up to a thread cache worth of memory may be accounted to the
+    // wrong one of the two.
+    const bool flush = arena != ALLOCATOR_DEFAULT_ARENA &&
+                       arena != threadArena.lastBucket;
+    if (setThreadArena(arena, flush)) {
+        threadArena.current = arena;
+        if (arena != ALLOCATOR_DEFAULT_ARENA) {
+            threadArena.lastBucket = arena;
+        }
+    }
+}
+
+void ObjectRegistry::useDefaultArena() {
+    if (setThreadArena == nullptr ||
+        (threadArena.current == ALLOCATOR_DEFAULT_ARENA &&
+         threadArena.lastBucket == ALLOCATOR_DEFAULT_ARENA)) {
+        return;
+    }
+    if (setThreadArena(ALLOCATOR_DEFAULT_ARENA, true)) {
+        threadArena = ThreadArena();
+    }
+}
+
+void ObjectRegistry::initialize(get_allocation_size func,
+                                set_thread_arena arenaFunc) {
     getAllocSize = func;
+    setThreadArena = arenaFunc;
 }
 
 void ObjectRegistry::reset() {
     getAllocSize = defaultGetAllocSize;
+    setThreadArena = nullptr;
 }
 
 void ObjectRegistry::onCreateBlob(const Blob *blob)
@@ -149,8 +207,8 @@ void ObjectRegistry::onCreateItem(const Item *pItem)
    EventuallyPersistentEngine *engine = th->get();
    if (verifyEngine(engine)) {
        EPStats &stats = engine->getEpStats();
-       stats.memOverhead->fetch_add(pItem->size() - pItem->getValMemSize());
-       ++(*stats.numItem);
+       stats.memOverhead.fetch_add(pItem->size() - pItem->getValMemSize());
+       ++stats.numItem;
    }
 }
 
@@ -159,8 +217,8 @@ void ObjectRegistry::onDeleteItem(const Item *pItem)
    EventuallyPersistentEngine *engine = th->get();
    if (verifyEngine(engine)) {
        EPStats &stats = engine->getEpStats();
-       stats.memOverhead->fetch_sub(pItem->size() - pItem->getValMemSize());
-       --(*stats.numItem);
+       stats.memOverhead.fetch_sub(pItem->size() - pItem->getValMemSize());
+       --stats.numItem;
    }
 }
 
@@ -178,6 +236,7 @@ EventuallyPersistentEngine *ObjectRegistry::onSwitchThread(
     }
 
     th->set(engine);
+    switchArena(engine);
     return old_engine;
 }
 
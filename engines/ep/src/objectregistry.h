@@ -28,13 +28,20 @@ class StoredValue;
 
 extern "C" {
     typedef size_t (*get_allocation_size)(const void *ptr);
+    typedef bool (*set_thread_arena)(unsigned arena, bool flush_thread_cache);
 }
 
 class StoredValue;
 
 class ObjectRegistry {
 public:
-    static void initialize(get_allocation_size func);
+    /**
+     * @param func returns the size of an allocation
+     * @param arenaFunc selects the allocator arena of the calling thread
+     *                  (nullptr if arenas aren't supported)
+     */
+    static void initialize(get_allocation_size func,
+                           set_thread_arena arenaFunc = nullptr);
 
     /**
      * Resets the ObjectRegistry back to initial state (before initialize()
@@ -54,9 +61,21 @@ public:
 
     static EventuallyPersistentEngine *getCurrentEngine();
 
+    /**
+     * Set the engine the calling thread is working on behalf of, and make
+     * the thread allocate from the engine's arena (or the default arena if
+     * the engine doesn't have one of its own, or engine is nullptr).
+     */
     static EventuallyPersistentEngine *onSwitchThread(EventuallyPersistentEngine *engine,
                                                       bool want_old_thread_local = false);
 
+    /**
+     * Move the calling thread onto the default allocator arena, returning
+     * what its cache holds to the bucket arena it was last on (e.g. before
+     * that arena is released).
+     */
+    static void useDefaultArena();
+
     static void setStats(std::atomic<size_t>* init_track);
     static bool memoryAllocated(size_t mem);
     static bool memoryDeallocated(size_t mem);
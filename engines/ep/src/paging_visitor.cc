@@ -0,0 +1,312 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2018 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "paging_visitor.h"
+
+#include "checkpoint.h"
+#include "connmap.h"
+#include "dcp/dcpconnmap.h"
+#include "ep_engine.h"
+#include "ep_time.h"
+#include "kv_bucket.h"
+#include "kv_bucket_iface.h"
+
+#include <cstdlib>
+
+static const size_t MAX_PERSISTENCE_QUEUE_SIZE = 1000000;
+
+PagingVisitor::PagingVisitor(KVBucket& s,
+                             EPStats& st,
+                             double pcnt,
+                             std::shared_ptr<std::atomic<bool>>& sfin,
+                             pager_type_t caller,
+                             bool pause,
+                             double bias,
+                             std::atomic<item_pager_phase>* phase,
+                             EvictionPolicy policy)
+    : store(s),
+      stats(st),
+      percent(pcnt),
+      activeBias(bias),
+      ejected(0),
+      startTime(ep_real_time()),
+      stateFinalizer(sfin),
+      owner(caller),
+      canPause(pause),
+      completePhase(true),
+      wasHighMemoryUsage(s.isMemoryUsageTooHigh()),
+      taskStart(ProcessClock::now()),
+      pager_phase(phase),
+      evictionPolicy(policy),
+      demoteColdMetadata(
+              s.getEPEngine().getConfiguration().isColdMetadataEnabled()),
+      useExpiryIndex(
+              caller == EXPIRY_PAGER &&
+              s.getEPEngine().getConfiguration().isExpPagerUseIndex()) {
+}
+
+bool PagingVisitor::visit(const HashTable::HashBucketLock& lh,
+                          StoredValue& v) {
+    // Delete expired items for an active vbucket.
+    bool isExpired = (currentBucket->getState() == vbucket_state_active) &&
+                     v.isExpired(startTime) && !v.isDeleted();
+    if (isExpired || v.isTempNonExistentItem() || v.isTempDeletedItem()) {
+        std::unique_ptr<Item> it = v.toItem(false, currentBucket->getId());
+        expired.push_back(*it.get());
+        return true;
+    }
+
+    // The entries visited have been taken out of the expiry index; put back
+    // those which can't be dealt with yet (expired items of non-active
+    // vbuckets, and temporary items waiting for a bg fetch) so the next run
+    // looks at them again.
+    if (useExpiryIndex &&
+        (v.isTempItem() || (v.isExpired(startTime) && !v.isDeleted()))) {
+        currentBucket->ht.updateExpiryIndex(v);
+    }
+
+    // return if not ItemPager, which uses valid eviction percentage
+    if (percent <= 0 || !pager_phase) {
+        return true;
+    }
+
+    switch (evictionPolicy) {
+    case EvictionPolicy::lru2Bit:
+        visitLru2Bit(lh, v);
+        break;
+    case EvictionPolicy::hifi_mfu:
+        visitHifiMfu(lh, v);
+        break;
+    }
+
+    return true;
+}
+
+void PagingVisitor::visitLru2Bit(const HashTable::HashBucketLock& lh,
+                                 StoredValue& v) {
+    // always evict unreferenced items, or randomly evict referenced item
+    double r = *pager_phase == PAGING_UNREFERENCED ?
+        1 :
+        static_cast<double>(std::rand()) / static_cast<double>(RAND_MAX);
+
+    if (*pager_phase == PAGING_UNREFERENCED &&
+        v.getNRUValue() == MAX_NRU_VALUE) {
+        doEviction(lh, &v);
+    } else if (*pager_phase == PAGING_RANDOM &&
+               v.incrNRUValue() == MAX_NRU_VALUE && r <= percent) {
+        doEviction(lh, &v);
+    }
+}
+
+void PagingVisitor::visitHifiMfu(const HashTable::HashBucketLock& lh,
+                                 StoredValue& v) {
+    // Non-resident items don't take part in the distribution; those which
+    // keep not being accessed have their metadata demoted instead.
+    if (demoteColdMetadata && !v.isResident()) {
+        const uint8_t freq = v.getFreqCounterValue();
+        if (freq == 0) {
+            doEviction(lh, &v);
+        } else {
+            v.setFreqCounterValue(freq - 1);
+        }
+        return;
+    }
+
+    // Items which can't be evicted must not skew the distribution of the
+    // frequency counters.
+    if (!currentBucket->eligibleToPageOut(lh, v)) {
+        return;
+    }
+
+    const uint8_t freq = v.getFreqCounterValue();
+    itemEviction.addValueToFreqHistogram(freq);
+    if (itemEviction.isUpdateRequired()) {
+        itemEviction.updateThreshold(percent);
+    }
+
+    const double r =
+            static_cast<double>(std::rand()) / (double(RAND_MAX) + 1.0);
+    if (itemEviction.shouldEvict(freq, r)) {
+        doEviction(lh, &v);
+    } else if (freq > 0) {
+        // Age the items we keep so that items which used to be hot (but
+        // are no longer accessed) eventually become candidates for eviction.
+        v.setFreqCounterValue(freq - 1);
+    }
+}
+
+void PagingVisitor::visitBucket(VBucketPtr& vb) {
+    update();
+
+    bool newCheckpointCreated = false;
+    size_t removed = vb->checkpointManager->removeClosedUnrefCheckpoints(
+            *vb, newCheckpointCreated);
+    stats.itemsRemovedFromCheckpoints.fetch_add(removed);
+    // If the new checkpoint is created, notify this event to the
+    // corresponding paused DCP connections.
+    if (newCheckpointCreated) {
+        store.getEPEngine().getDcpConnMap().notifyVBConnections(
+                vb->getId(), vb->checkpointManager->getHighSeqno());
+    }
+
+    // fast path for expiry item pager
+    if (percent <= 0 || !pager_phase) {
+        if (vBucketFilter(vb->getId())) {
+            currentBucket = vb;
+            if (useExpiryIndex) {
+                vb->ht.visitExpired(*this, startTime);
+            } else {
+                vb->ht.visit(*this);
+            }
+        }
+        return;
+    }
+
+    // skip active vbuckets if active resident ratio is lower than replica
+    double current = static_cast<double>(stats.getTotalMemoryUsed());
+    double lower = static_cast<double>(stats.mem_low_wat);
+    double high = static_cast<double>(stats.mem_high_wat);
+    if (vb->getState() == vbucket_state_active && current < high &&
+        store.getActiveResidentRatio() <
+        store.getReplicaResidentRatio())
+    {
+        return;
+    }
+
+    if (current > lower) {
+        double p = (current - static_cast<double>(lower)) / current;
+        adjustPercent(p, vb->getState());
+        if (evictionPolicy == EvictionPolicy::hifi_mfu) {
+            // The percentage differs between active and replica vbuckets,
+            // so recalculate the threshold from the distribution seen so far
+            itemEviction.updateThreshold(percent);
+        }
+        if (vBucketFilter(vb->getId())) {
+            currentBucket = vb;
+            vb->ht.visit(*this);
+            // Demote the items selected while visiting in one go, so each
+            // cold metadata block is only re-encoded once.
+            if (!coldKeys.empty()) {
+                vb->ht.demote(coldKeys);
+                coldKeys.clear();
+            }
+        }
+
+    } else { // stop eviction whenever memory usage is below low watermark
+        completePhase = false;
+    }
+}
+
+void PagingVisitor::update() {
+    store.deleteExpiredItems(expired, ExpireBy::Pager);
+
+    if (numEjected() > 0) {
+        LOG(EXTENSION_LOG_INFO, "Paged out %ld values", numEjected());
+    }
+
+    size_t num_expired = expired.size();
+    if (num_expired > 0) {
+        LOG(EXTENSION_LOG_INFO, "Purged %ld expired items", num_expired);
+    }
+
+    ejected = 0;
+    expired.clear();
+}
+
+bool PagingVisitor::pauseVisitor() {
+    size_t queueSize = stats.diskQueueSize.load();
+    return canPause && queueSize >= MAX_PERSISTENCE_QUEUE_SIZE;
+}
+
+void PagingVisitor::complete() {
+    update();
+
+    auto elapsed_time =
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                    ProcessClock::now() - taskStart);
+    if (owner == ITEM_PAGER) {
+        stats.itemPagerHisto.add(elapsed_time);
+    } else if (owner == EXPIRY_PAGER) {
+        stats.expiryPagerHisto.add(elapsed_time);
+    }
+
+    bool inverse = false;
+    (*stateFinalizer).compare_exchange_strong(inverse, true);
+
+    if (pager_phase && completePhase) {
+        if (*pager_phase == PAGING_UNREFERENCED) {
+            *pager_phase = PAGING_RANDOM;
+        } else {
+            *pager_phase = PAGING_UNREFERENCED;
+        }
+    }
+
+    // Wake up any sleeping backfill tasks if the memory usage is lowered
+    // below the high watermark as a result of checkpoint removal.
+    if (wasHighMemoryUsage && !store.isMemoryUsageTooHigh()) {
+        store.getEPEngine().getDcpConnMap().notifyBackfillManagerTasks();
+    }
+
+    if (ITEM_PAGER == owner) {
+        // Re-check memory which may wake up the ItemPager and schedule
+        // a new PagingVisitor with the next phase/memory target etc...
+        // This is done after we've signalled 'completion' by clearing
+        // the stateFinalizer, which ensures the ItemPager doesn't just
+        // ignore a request.
+        store.checkAndMaybeFreeMemory();
+    }
+}
+
+void PagingVisitor::adjustPercent(double prob, vbucket_state_t state) {
+    if (state == vbucket_state_replica ||
+        state == vbucket_state_dead)
+    {
+        // replica items should have higher eviction probability
+        double p = prob*(2 - activeBias);
+        percent = p < 0.9 ? p : 0.9;
+    } else {
+        // active items have lower eviction probability
+        percent = prob*activeBias;
+    }
+}
+
+void PagingVisitor::doEviction(const HashTable::HashBucketLock& lh,
+                               StoredValue* v) {
+    item_eviction_policy_t policy = store.getItemEvictionPolicy();
+
+    // An item whose value has already been ejected is selected again if it
+    // has stayed cold; demote its metadata as well (once the whole vbucket
+    // has been visited).
+    if (demoteColdMetadata && policy == VALUE_ONLY && !v->isResident()) {
+        coldKeys.emplace_back(v->getKey());
+        return;
+    }
+
+    StoredDocKey key(v->getKey());
+
+    if (currentBucket->pageOut(lh, v)) {
+        ++ejected;
+
+        /**
+         * For FULL EVICTION MODE, add all items that are being
+         * evicted to the corresponding bloomfilter.
+         */
+        if (policy == FULL_EVICTION) {
+            currentBucket->addToFilter(key);
+        }
+    }
+}
@@ -0,0 +1,135 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2018 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include "config.h"
+
+#include "hash_table.h"
+#include "item.h"
+#include "item_eviction.h"
+#include "item_pager.h"
+#include "vb_visitors.h"
+
+#include <platform/processclock.h>
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <vector>
+
+class EPStats;
+class KVBucket;
+
+enum pager_type_t {
+    ITEM_PAGER,
+    EXPIRY_PAGER
+};
+
+/**
+ * As part of the ItemPager, visit all of the objects in memory and
+ * eject some within a constrained probability
+ */
+class PagingVisitor : public VBucketVisitor,
+                      public HashTableVisitor {
+public:
+
+    /**
+     * Construct a PagingVisitor that will attempt to evict the given
+     * percentage of objects.
+     *
+     * @param s the store that will handle the bulk removal
+     * @param st the stats where we'll track what we've done
+     * @param pcnt percentage of objects to attempt to evict (0-1)
+     * @param sfin pointer to a bool to be set to true after run completes
+     * @param pause flag indicating if PagingVisitor can pause between vbucket
+     *              visits
+     * @param bias active vbuckets eviction probability bias multiplier (0-1)
+     * @param phase pointer to an item_pager_phase to be set
+     * @param policy the policy used to select the items to evict
+     */
+    PagingVisitor(KVBucket& s,
+                  EPStats& st,
+                  double pcnt,
+                  std::shared_ptr<std::atomic<bool>>& sfin,
+                  pager_type_t caller,
+                  bool pause,
+                  double bias,
+                  std::atomic<item_pager_phase>* phase,
+                  EvictionPolicy policy = EvictionPolicy::lru2Bit);
+
+    bool visit(const HashTable::HashBucketLock& lh, StoredValue& v) override;
+
+    void visitBucket(VBucketPtr& vb) override;
+
+    void update();
+
+    bool pauseVisitor() override;
+
+    void complete() override;
+
+    /**
+     * Get the number of items ejected during the visit.
+     */
+    size_t numEjected() { return ejected; }
+
+private:
+    void adjustPercent(double prob, vbucket_state_t state);
+
+    /**
+     * Visit an item using the 2-bit NRU eviction policy: always evict
+     * unreferenced items in the PAGING_UNREFERENCED phase, and randomly
+     * evict (aged) items in the PAGING_RANDOM phase.
+     */
+    void visitLru2Bit(const HashTable::HashBucketLock& lh, StoredValue& v);
+
+    /**
+     * Visit an item using the hifi_mfu eviction policy: evict the items
+     * with the lowest frequency counters (based on the distribution of the
+     * counters of the items visited so far), and age the counters of the
+     * items which are kept.
+     */
+    void visitHifiMfu(const HashTable::HashBucketLock& lh, StoredValue& v);
+
+    void doEviction(const HashTable::HashBucketLock& lh, StoredValue* v);
+
+    std::list<Item> expired;
+
+    KVBucket& store;
+    EPStats &stats;
+    double percent;
+    double activeBias;
+    size_t ejected;
+    time_t startTime;
+    std::shared_ptr<std::atomic<bool>> stateFinalizer;
+    pager_type_t owner;
+    bool canPause;
+    bool completePhase;
+    bool wasHighMemoryUsage;
+    ProcessClock::time_point taskStart;
+    std::atomic<item_pager_phase>* pager_phase;
+    VBucketPtr currentBucket;
+    const EvictionPolicy evictionPolicy;
+    /// Demote the metadata of non-resident items selected for eviction
+    const bool demoteColdMetadata;
+    /// The non-resident items of the current vbucket selected for demotion
+    std::vector<StoredDocKey> coldKeys;
+    /// Only visit the items due to expire according to the expiry index
+    const bool useExpiryIndex;
+    /// Distribution of the frequency counters (hifi_mfu only)
+    ItemEviction itemEviction;
+};
@@ -0,0 +1,128 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2018 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * A counter for values which are modified very frequently (typically on
+ * every allocation) from many threads, but only read occasionally.
+ *
+ * Updating a single atomic counter from all of the front end threads
+ * makes the cache line holding it bounce between the cores. The
+ * ShardedCounter spreads the updates over a number of (signed) counters,
+ * each on its own cache line: a thread only updates the shard assigned to
+ * it, while reading the value sums all of the shards.
+ *
+ * As an object may be allocated by one thread and freed by another, an
+ * individual shard may go negative; only the sum is meaningful (and is
+ * never reported as less than zero).
+ *
+ * The interface mirrors the subset of Couchbase::RelaxedAtomic used by
+ * EPStats, so it can be used as a drop-in replacement.
+ */
+class ShardedCounter {
+public:
+    /// The number of shards the updates are spread over
+    static const size_t NumShards = 16;
+
+    ShardedCounter(size_t initial = 0) {
+        store(initial);
+    }
+
+    ShardedCounter(const ShardedCounter&) = delete;
+
+    void fetch_add(size_t value) {
+        shards[getThreadShard()].value.fetch_add(int64_t(value),
+                                                 std::memory_order_relaxed);
+    }
+
+    void fetch_sub(size_t value) {
+        shards[getThreadShard()].value.fetch_sub(int64_t(value),
+                                                 std::memory_order_relaxed);
+    }
+
+    ShardedCounter& operator++() {
+        fetch_add(1);
+        return *this;
+    }
+
+    void operator++(int) {
+        fetch_add(1);
+    }
+
+    ShardedCounter& operator--() {
+        fetch_sub(1);
+        return *this;
+    }
+
+    void operator--(int) {
+        fetch_sub(1);
+    }
+
+    /// @return the sum of all of the shards
+    size_t load() const {
+        int64_t sum = 0;
+        for (const auto& shard : shards) {
+            sum += shard.value.load(std::memory_order_relaxed);
+        }
+        return sum < 0 ? 0 : size_t(sum);
+    }
+
+    operator size_t() const {
+        return load();
+    }
+
+    /**
+     * Set the counter to the given value. Not atomic with respect to
+     * concurrent updates; only intended for initialisation and resetting.
+     */
+    void store(size_t value) {
+        for (auto& shard : shards) {
+            shard.value.store(0, std::memory_order_relaxed);
+        }
+        shards[0].value.store(int64_t(value), std::memory_order_relaxed);
+    }
+
+    ShardedCounter& operator=(size_t value) {
+        store(value);
+        return *this;
+    }
+
+protected:
+    /**
+     * Threads are assigned a shard (round robin) the first time they
+     * update any ShardedCounter
+     */
+    static size_t getThreadShard() {
+        static std::atomic<size_t> nextShard{0};
+        thread_local size_t shard = nextShard++ % NumShards;
+        return shard;
+    }
+
+    struct Shard {
+        std::atomic<int64_t> value{0};
+        // Keep the shards on separate cache lines
+        char padding[64 - sizeof(std::atomic<int64_t>)];
+    };
+
+    std::array<Shard, NumShards> shards;
+};
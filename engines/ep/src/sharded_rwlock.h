@@ -0,0 +1,90 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2018 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#pragma once
+
+#include <platform/rwlock.h>
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+/**
+ * A reader/writer lock for data which is read on every operation but very
+ * rarely modified.
+ *
+ * Taking a read lock on a cb::RWLock writes to the lock, so with many
+ * threads reading the cache line holding the lock bounces between the
+ * cores even though the readers never block each other. The ShardedRWLock
+ * spreads the readers over a number of locks (each on its own cache line):
+ * a reader only locks the shard assigned to its thread, while a writer has
+ * to lock all of the shards.
+ *
+ * Readers:
+ *     std::unique_lock<cb::ReaderLock> rlh(lock.getReaderShard());
+ *
+ * Writers:
+ *     std::unique_lock<ShardedRWLock> wlh(lock);
+ */
+class ShardedRWLock {
+public:
+    /// The number of shards the readers are spread over
+    static const size_t NumShards = 8;
+
+    /**
+     * @return the lock the calling thread should take a read lock on
+     */
+    cb::RWLock& getReaderShard() {
+        return shards[getThreadShard()].lock;
+    }
+
+    /// Lock all of the shards for writing
+    void lock() {
+        for (auto& shard : shards) {
+            cb::WriterLock& writer = shard.lock;
+            writer.lock();
+        }
+    }
+
+    /// Release the write lock on all of the shards
+    void unlock() {
+        for (auto shard = shards.rbegin(); shard != shards.rend(); ++shard) {
+            cb::WriterLock& writer = shard->lock;
+            writer.unlock();
+        }
+    }
+
+protected:
+    /**
+     * Threads are assigned a shard the first time they access any
+     * ShardedRWLock (round robin, so the front-end threads end up with a
+     * shard each)
+     */
+    static size_t getThreadShard() {
+        static std::atomic<size_t> nextShard{0};
+        thread_local size_t shard = nextShard++ % NumShards;
+        return shard;
+    }
+
+    struct Shard {
+        cb::RWLock lock;
+        // Keep the locks on separate cache lines
+        char padding[64];
+    };
+
+    std::array<Shard, NumShards> shards;
+};
@@ -79,6 +79,9 @@ EPStats::EPStats()
       numItem(0),
       totalMemory(0),
       memoryTrackerEnabled(false),
+      arenaMemoryTracking(false),
+      arena(0),
+      arenaMemory(0),
       forceShutdown(false),
       oom_errors(0),
       tmp_oom_errors(0),
@@ -87,6 +90,11 @@ EPStats::EPStats()
       pendingOpsMax(0),
       pendingOpsMaxDuration(0),
       pendingCompactions(0),
+      compactionThrottledTime(0),
+      compactionPausedTime(0),
+      compactionNumPauses(0),
+      compactionsRunning(0),
+      compactionConcurrencyLimit(0),
       bg_fetched(0),
       bg_meta_fetched(0),
       numRemainingBgItems(0),
@@ -123,6 +131,7 @@ EPStats::EPStats()
       rollbackCount(0),
       defragNumVisited(0),
       defragNumMoved(0),
+      defragStoredValueNumMoved(0),
       dirtyAgeHisto(),
       diskCommitHisto(),
       timingLog(NULL),
@@ -130,11 +139,17 @@ EPStats::EPStats()
       mem_merge_bytes_threshold(0),
       localMemCounter([](void* ptr) -> void {
           if (ptr != nullptr) {
+              auto* counter = static_cast<TLMemCounter*>(ptr);
+              // Don't lose whatever the thread hadn't merged yet. The
+              // owning EPStats is still alive; its thread-local key (and
+              // hence this destructor) goes away with it.
+              counter->owner.totalMemory->fetch_add(counter->used);
+
               // This HAS to be a non-bucket deallocation
               // or else the callbacks could try to update counters
               // that no longer exist
               SystemAllocationGuard system_alloc_guard;
-              delete (TLMemCounter*)ptr;
+              delete counter;
           }
       }),
       maxDataSize(DEFAULT_MAX_DATA_SIZE) {
@@ -145,53 +160,57 @@ EPStats::~EPStats() {
 }
 
 void EPStats::memAllocated(size_t sz) {
-    if (isShutdown) {
+    if (isShutdown || arenaMemoryTracking) {
         return;
     }
 
-    if (localMemCounter.get() == nullptr) {
-        // this HAS to be a non-bucket allocation
-        // or else the callbacks would try to call this
-        // function again & it would become an infinite loop
-        SystemAllocationGuard system_alloc_guard;
-        localMemCounter.set(new TLMemCounter());
-    }
-
+    auto& counter = getLocalMemCounter();
     if (0 == sz) {
         return;
     }
 
-    localMemCounter.get()->used += sz;
+    counter.used += sz;
     mergeMemCounter();
 }
 
 void EPStats::memDeallocated(size_t sz) {
-    if (isShutdown) {
+    if (isShutdown || arenaMemoryTracking) {
         return;
     }
 
-    if (localMemCounter.get() == nullptr) {
-        // this HAS to be a non-bucket allocation
-        // or else the callbacks would try to call this
-        // function again & it would become an infinite loop
-        SystemAllocationGuard system_alloc_guard;
-        localMemCounter.set(new TLMemCounter());
-    }
-
+    auto& counter = getLocalMemCounter();
     if (0 == sz) {
         return;
     }
 
-    localMemCounter.get()->used -= sz;
+    counter.used -= sz;
     mergeMemCounter();
 }
 
+EPStats::TLMemCounter& EPStats::getLocalMemCounter() {
+    auto* counter = localMemCounter.get();
+    if (counter == nullptr) {
+        // this HAS to be a non-bucket allocation
+        // or else the callbacks would try to call this
+        // function again & it would become an infinite loop
+        SystemAllocationGuard system_alloc_guard;
+        counter = new TLMemCounter(*this);
+        localMemCounter.set(counter);
+    }
+    return *counter;
+}
+
 void EPStats::mergeMemCounter(bool force) {
     auto& counter = *(localMemCounter.get());
-    counter.count++;
-    if (force || counter.count % mem_merge_count_threshold == 0 ||
+    // Count down rather than taking the modulo of an ever increasing
+    // count; this is called on every allocation.
+    if (counter.countdown > 0) {
+        --counter.countdown;
+    }
+    if (force || counter.countdown == 0 ||
         std::abs(counter.used) > (long)mem_merge_bytes_threshold) {
         totalMemory->fetch_add(counter.used);
         counter.used = 0;
+        counter.countdown = mem_merge_count_threshold;
     }
 }
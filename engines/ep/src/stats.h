@@ -19,6 +19,7 @@
 
 #include "config.h"
 
+#include "sharded_counter.h"
 #include "threadlocal.h"
 
 #include <memcached/types.h>
@@ -57,12 +58,25 @@ public:
         }
     }
 
+    /**
+     * @return the memory used by the bucket.
+     *
+     * With arenaMemoryTracking this is the arena's allocated bytes as last
+     * sampled by the MemoryTracker (every 250ms), so it lags behind the
+     * actual usage: a burst of allocations isn't seen by the memory checks
+     * on the front end operations (or by the item pager) until the next
+     * sample. The high watermark needs to leave enough headroom below the
+     * quota for what the bucket may allocate in that time.
+     */
     size_t getTotalMemoryUsed() {
+        if (arenaMemoryTracking.load()) {
+            return arenaMemory.load();
+        }
         if (memoryTrackerEnabled.load()) {
             auto val = totalMemory->load();
             return val >= 0 ? val : 0;
         }
-        return currentSize.load() + memOverhead->load();
+        return currentSize.load() + memOverhead.load();
     }
 
     // account for allocated mem
@@ -177,30 +191,46 @@ public:
     Counter numFailedEjects;
     //! Number of times "Not my bucket" happened
     Counter numNotMyVBuckets;
+
+    // The following are updated (by the ObjectRegistry) whenever a Blob,
+    // StoredValue or Item is created or destroyed, so are sharded to
+    // avoid all of the front end threads contending on the same cache
+    // lines.
+
     //! Total size of stored objects.
-    Counter currentSize;
+    ShardedCounter currentSize;
     //! Total number of blob objects
-    Counter numBlob;
+    ShardedCounter numBlob;
     //! Total size of blob memory overhead
-    Counter blobOverhead;
+    ShardedCounter blobOverhead;
     //! Total memory overhead to store values for resident keys.
-    Counter totalValueSize;
+    ShardedCounter totalValueSize;
     //! The number of storedVal object
-    Counter numStoredVal;
+    ShardedCounter numStoredVal;
     //! Total memory for stored values
-    Counter totalStoredValSize;
+    ShardedCounter totalStoredValSize;
     //! Total size of StoredVal memory overhead
-    Counter storedValOverhead;
+    ShardedCounter storedValOverhead;
     //! Amount of memory used to track items and what-not.
-    cb::CachelinePadded<Counter> memOverhead;
+    ShardedCounter memOverhead;
     //! Total number of Item objects
-    cb::CachelinePadded<Counter> numItem;
+    ShardedCounter numItem;
+
     //! The total amount of memory used by this bucket (From memory tracking)
     // This is a signed variable as depdending on how/when the thread-local
     // counters merge their info, this could be negative
     cb::CachelinePadded<Couchbase::RelaxedAtomic<long long> > totalMemory;
     //! True if the memory usage tracker is enabled.
     std::atomic<bool> memoryTrackerEnabled;
+    //! True if the bucket allocates from its own arena, and the memory
+    //  used is read from the arena stats instead of tracking every
+    //  allocation (totalMemory is no longer updated).
+    std::atomic<bool> arenaMemoryTracking;
+    //! The allocator arena dedicated to the bucket (if arenaMemoryTracking)
+    unsigned arena;
+    //! The bytes allocated from the bucket's arena (sampled periodically
+    //  by the MemoryTracker)
+    std::atomic<size_t> arenaMemory;
     //! Whether or not to force engine shutdown.
     std::atomic<bool> forceShutdown;
     //! Number of times unrecoverable oom errors happened while processing operations.
@@ -222,6 +252,16 @@ public:
 
     //! Number of pending vbucket compaction requests
     Counter pendingCompactions;
+    //! Time (in usec) compactions slept to stay within the I/O budget
+    Counter compactionThrottledTime;
+    //! Time (in usec) compactions were paused due to front end contention
+    Counter compactionPausedTime;
+    //! Number of times a compaction was paused
+    Counter compactionNumPauses;
+    //! Number of compactions currently running
+    Counter compactionsRunning;
+    //! Number of compactions the compaction governor allows to run
+    Counter compactionConcurrencyLimit;
 
     //! Number of times background fetches occurred.
     Counter bg_fetched;
@@ -332,6 +372,11 @@ public:
      */
     Counter defragNumMoved;
 
+    /** The number of StoredValues that have been moved (defragmented) by the
+     * defragmenter task.
+     */
+    Counter defragStoredValueNumMoved;
+
     //! Histogram of queue processing dirty age.
     MicrosecondHistogram dirtyAgeHisto;
 
@@ -434,13 +479,17 @@ public:
         pendingOpsTotal.store(0);
         pendingOpsMax.store(0);
         pendingOpsMaxDuration.store(0);
+        compactionThrottledTime.store(0);
+        compactionPausedTime.store(0);
+        compactionNumPauses.store(0);
         vbucketDelMaxWalltime.store(0);
         vbucketDelTotWalltime.store(0);
 
         alogRuns.store(0);
         accessScannerSkips.store(0),
         defragNumVisited.store(0),
-        defragNumMoved.store(0);
+        defragNumMoved.store(0),
+        defragStoredValueNumMoved.store(0);
 
         pendingOpsHisto.reset();
         bgWaitHisto.reset();
@@ -476,19 +525,30 @@ public:
     std::ostream *timingLog;
 
     //! These 2 thresholds define when the thread local
-    //  mem counters are merged to the bucket counter
+    //  mem counters are merged to the bucket counter. totalMemory lags
+    //  behind the real usage by at most mem_merge_bytes_threshold per
+    //  thread.
     size_t mem_merge_count_threshold;
     size_t mem_merge_bytes_threshold;
 
 private:
     struct TLMemCounter {
+        TLMemCounter(EPStats& owner) : owner(owner) {
+        }
+
+        // the bucket the memory is accounted to
+        EPStats& owner;
+
         // accumulated mem
         long long used = 0;
 
-        // no.of times mem accounting has happened
-        size_t count = 0;
+        // no.of mem accounting operations left before merging
+        size_t countdown = 0;
     };
 
+    //! @return the calling thread's TLMemCounter (creating it if needed)
+    TLMemCounter& getLocalMemCounter();
+
     ThreadLocalPtr<TLMemCounter> localMemCounter;
 
     //! Max allowable memory size.
@@ -21,6 +21,7 @@
 
 #include "ep_time.h"
 #include "item.h"
+#include "item_eviction.h"
 #include "objectregistry.h"
 #include "stats.h"
 
@@ -44,7 +45,8 @@ StoredValue::StoredValue(const Item& itm,
       lock_expiry_or_delete_time(0),
       exptime(itm.getExptime()),
       flags(itm.getFlags()),
-      datatype(itm.getDataType()) {
+      datatype(itm.getDataType()),
+      freqCounter(ItemEviction::initialFreqCount) {
     // Initialise bit fields
     setDeletedPriv(itm.isDeleted());
     setNewCacheItem(true);
@@ -84,7 +86,8 @@ StoredValue::StoredValue(const StoredValue& other, UniquePtr n, EPStats& stats)
       lock_expiry_or_delete_time(other.lock_expiry_or_delete_time),
       exptime(other.exptime),
       flags(other.flags),
-      datatype(other.datatype) {
+      datatype(other.datatype),
+      freqCounter(other.freqCounter) {
     setDirty(other.isDirty());
     setDeletedPriv(other.isDeleted());
     setNewCacheItem(other.isNewCacheItem());
@@ -147,6 +150,7 @@ void StoredValue::restoreValue(const Item& itm) {
         revSeqno = itm.getRevSeqno();
         bySeqno = itm.getBySeqno();
         setNru(INITIAL_NRU_VALUE);
+        setFreqCounterValue(ItemEviction::initialFreqCount);
     }
     datatype = itm.getDataType();
     setDeletedPriv(itm.isDeleted());
@@ -43,8 +43,9 @@ class OrderedStoredValue;
  * value of the item is not currently resident (for example it's been evicted to
  * save memory) or if the item has no value (deleted item has value as null)
  * Additionally it contains flags to help HashTable manage the state of the
- * item - such as dirty flag, NRU bits, and a `next` pointer to support
- * chaining of StoredValues which hash to the same hash bucket.
+ * item - such as dirty flag, NRU bits, frequency counter and a `next`
+ * pointer to support chaining of StoredValues which hash to the same hash
+ * bucket.
  *
  * The key of the item is of variable length (from 1 to ~256 bytes). As an
  * optimization, we allocate the key directly after the fixed size of
@@ -151,6 +152,19 @@ public:
 
     void referenced();
 
+    /**
+     * Get the frequency counter of the item, which is incremented
+     * (probabilistically) every time the item is referenced, and used by
+     * the hifi_mfu eviction policy. Should be accessed with the HBL held.
+     */
+    uint8_t getFreqCounterValue() const {
+        return freqCounter;
+    }
+
+    void setFreqCounterValue(uint8_t value) {
+        freqCounter = value;
+    }
+
     /**
      * Mark this item as needing to be persisted.
      */
@@ -172,7 +186,7 @@ public:
         return bits.test(dirtyIndex);
     }
 
-    bool eligibleForEviction(item_eviction_policy_t policy) {
+    bool eligibleForEviction(item_eviction_policy_t policy) const {
         if (policy == VALUE_ONLY) {
             return isResident() && !isDirty() && !isDeleted();
         } else {
@@ -605,6 +619,11 @@ public:
      */
     void reallocate();
 
+    /// Is this an instance of OrderedStoredValue?
+    bool isOrdered() const {
+        return bits.test(orderedIndex);
+    }
+
     /**
      * Returns pointer to the subclass OrderedStoredValue if it the object is
      * of the type, if not throws a bad_cast.
@@ -692,10 +711,6 @@ protected:
         bits.set(staleIndex, value);
     }
 
-    bool isOrdered() const {
-        return bits.test(orderedIndex);
-    }
-
     void setOrdered(bool value) {
         bits.set(orderedIndex, value);
     }
@@ -763,6 +778,10 @@ protected:
 
     folly::AtomicBitSet<sizeof(uint8_t)> bits;
 
+    /// Frequency counter (see getFreqCounterValue). Lives in what would
+    /// otherwise be padding, so doesn't increase the size of StoredValue.
+    uint8_t freqCounter;
+
     friend std::ostream& operator<<(std::ostream& os, const StoredValue& sv);
 };
 
@@ -237,6 +237,7 @@ protected:
      * and construct this object so are allowed access to the constructor.
      */
     friend class MutationLogEntryV2;
+    friend class MutationLogEntryV3;
     friend class StoredValue;
 
     SerialisedDocKey() : length(0), docNamespace(), bytes() {
@@ -53,7 +53,7 @@ CompactTask::CompactTask(EPBucket& bucket,
 bool CompactTask::run() {
     TRACE_EVENT1(
             "ep-engine/task", "CompactTask", "file_id", compactCtx.db_file_id);
-    return bucket.doCompact(&compactCtx, cookie);
+    return bucket.doCompact(&compactCtx, getId(), cookie);
 }
 
 bool StatSnap::run() {
@@ -29,6 +29,7 @@
 #include "pre_link_document_context.h"
 #include "statwriter.h"
 #include "stored_value_factories.h"
+#include "trace_helpers.h"
 #include "vbucket.h"
 #include "vbucketdeletiontask.h"
 
@@ -202,9 +203,11 @@ VBucket::VBucket(id_type i,
         conflictResolver.reset(new RevisionSeqnoResolution());
     }
 
+    ht.setExpiryIndexEnabled(config.isExpPagerUseIndex());
+
     backfill.isBackfillPhase = false;
     pendingOpsStart = ProcessClock::time_point();
-    stats.memOverhead->fetch_add(sizeof(VBucket)
+    stats.memOverhead.fetch_add(sizeof(VBucket)
                                 + ht.memorySize() + sizeof(CheckpointManager));
     LOG(EXTENSION_LOG_NOTICE,
         "VBucket: created vbucket:%" PRIu16
@@ -238,7 +241,7 @@ VBucket::~VBucket() {
     // Clear out the bloomfilter(s)
     clearFilter();
 
-    stats.memOverhead->fetch_sub(sizeof(VBucket) + ht.memorySize() +
+    stats.memOverhead.fetch_sub(sizeof(VBucket) + ht.memorySize() +
                                 sizeof(CheckpointManager));
 
     LOG(EXTENSION_LOG_INFO, "Destroying vbucket %d\n", id);
@@ -311,7 +314,7 @@ void VBucket::getBackfillItems(std::vector<queued_item>& items) {
         backfill.items.pop();
     }
     stats.vbBackfillQueueSize.fetch_sub(num_items);
-    stats.memOverhead->fetch_sub(num_items * sizeof(queued_item));
+    stats.memOverhead.fetch_sub(num_items * sizeof(queued_item));
 }
 
 void VBucket::setState(vbucket_state_t to) {
@@ -974,6 +977,97 @@ ENGINE_ERROR_CODE VBucket::replace(
     }
 }
 
+ENGINE_ERROR_CODE VBucket::updateInPlace(
+        const DocKey& key,
+        uint64_t& cas,
+        time_t exptime,
+        const cb::InPlaceMutator& mutator,
+        const void* cookie,
+        EventuallyPersistentEngine& engine,
+        mutation_descr_t& mut_info,
+        const Collections::VB::Manifest::CachingReadHandle& readHandle) {
+    auto hbl = ht.getLockedBucket(key);
+    StoredValue* v = ht.unlocked_find(
+            key, hbl.getBucketNum(), WantsDeleted::No, TrackReference::No);
+
+    // Leave everything but the simple case (the current value is in
+    // memory and may be modified) to the regular get / store path, which
+    // knows how to deal with background fetches, expiry, locked items etc.
+    if (v == nullptr || v->isTempItem() || !v->isResident() ||
+        v->getValue() == nullptr ||
+        mcbp::datatype::is_snappy(v->getDatatype()) ||
+        v->isLocked(ep_current_time()) || v->isExpired(ep_real_time()) ||
+        isLogicallyNonExistent(*v, readHandle)) {
+        return ENGINE_ENOTSUP;
+    }
+
+    if (cas != 0 && cas != v->getCas()) {
+        return ENGINE_KEY_EEXISTS;
+    }
+
+    // The value pointed to by the item_info stays valid as we hold the
+    // hash bucket lock until the new value is linked in
+    auto info = v->getItemInfo(failovers->getLatestUUID());
+    cb::const_char_buffer value;
+    protocol_binary_datatype_t datatype = v->getDatatype();
+    const auto status = mutator(*info, value, datatype);
+    if (status != cb::engine_errc::success) {
+        return ENGINE_ERROR_CODE(status);
+    }
+
+    Item itm(key,
+             v->getFlags(),
+             exptime,
+             value.data(),
+             value.size(),
+             datatype,
+             cas,
+             -1,
+             getId());
+
+    PreLinkDocumentContext preLinkDocumentContext(engine, cookie, &itm);
+    VBQueueItemCtx queueItmCtx(GenerateBySeqno::Yes,
+                               GenerateCas::Yes,
+                               TrackCasDrift::No,
+                               /*isBackfillItem*/ false,
+                               &preLinkDocumentContext);
+
+    MutationStatus mtype;
+    boost::optional<VBNotifyCtx> notifyCtx;
+    std::tie(mtype, notifyCtx) = processSet(hbl,
+                                            v,
+                                            itm,
+                                            cas,
+                                            /*allowExisting*/ true,
+                                            /*hasMetaData*/ false,
+                                            queueItmCtx,
+                                            cb::StoreIfStatus::Continue);
+
+    switch (mtype) {
+    case MutationStatus::NoMem:
+        return ENGINE_ENOMEM;
+    case MutationStatus::InvalidCas:
+        return ENGINE_KEY_EEXISTS;
+    case MutationStatus::IsLocked:
+        return ENGINE_LOCKED;
+    case MutationStatus::WasDirty:
+    case MutationStatus::WasClean:
+        cas = v->getCas();
+        mut_info.seqno = v->getBySeqno();
+        mut_info.vbucket_uuid = failovers->getLatestUUID();
+        hbl.getHTLock().unlock();
+        notifyNewSeqno(*notifyCtx);
+        return ENGINE_SUCCESS;
+    case MutationStatus::NotFound:
+    case MutationStatus::NeedBgFetch:
+        break;
+    }
+
+    throw std::logic_error(
+            "VBucket::updateInPlace: unexpected MutationStatus:" +
+            std::to_string(static_cast<int>(mtype)));
+}
+
 ENGINE_ERROR_CODE VBucket::addBackfillItem(Item& itm,
                                            const GenerateBySeqno genBySeqno) {
     auto hbl = ht.getLockedBucket(itm.getKey());
@@ -1606,6 +1700,7 @@ std::pair<MutationStatus, GetValue> VBucket::processGetAndUpdateTtl(
             v->markDirty();
             v->setExptime(exptime);
             v->setRevSeqno(v->getRevSeqno() + 1);
+            ht.updateExpiryIndex(*v);
         }
 
         GetValue rv(v->toItem(v->isLocked(ep_current_time()), getId()),
@@ -1692,12 +1787,19 @@ GetValue VBucket::getInternal(
     const bool metadataOnly = (options & ALLOW_META_ONLY);
     const bool getDeletedValue = (options & GET_DELETED_VALUE);
     const bool bgFetchRequired = (options & QUEUE_BG_FETCH);
-    auto hbl = ht.getLockedBucket(readHandle.getKey());
-    StoredValue* v = fetchValidValue(hbl,
-                                     readHandle.getKey(),
-                                     WantsDeleted::Yes,
-                                     trackReference,
-                                     QueueExpired::Yes);
+    StoredValue* v = nullptr;
+    auto hbl = [&]() {
+        TRACE_SCOPE(engine.getServerApi(),
+                    cookie,
+                    cb::tracing::TraceCode::HASH_LOOKUP);
+        auto hbl = ht.getLockedBucket(readHandle.getKey());
+        v = fetchValidValue(hbl,
+                            readHandle.getKey(),
+                            WantsDeleted::Yes,
+                            trackReference,
+                            QueueExpired::Yes);
+        return hbl;
+    }();
     if (v) {
         // 1 If SV is deleted and user didn't request deleted items
         // 2 (or) If collection says this key is gone.
@@ -2079,6 +2181,9 @@ void VBucket::_addStats(bool details, ADD_STAT add_stat, const void* c) {
         addStat("ht_memory", ht.memorySize(), add_stat, c);
         addStat("ht_item_memory", ht.getItemMemory(), add_stat, c);
         addStat("ht_cache_size", ht.cacheSize.load(), add_stat, c);
+        addStat("ht_cold_items", ht.getNumColdItems(), add_stat, c);
+        addStat("ht_cold_memory", ht.getColdMetaDataMemory(), add_stat, c);
+        addStat("ht_expiry_index_size", ht.getExpiryIndexSize(), add_stat, c);
         addStat("ht_size", ht.getSize(), add_stat, c);
         addStat("num_ejects", ht.getNumEjects(), add_stat, c);
         addStat("ops_create", opsCreate.load(), add_stat, c);
@@ -790,6 +790,37 @@ public:
             cb::StoreIfPredicate predicate,
             const Collections::VB::Manifest::CachingReadHandle& readHandle);
 
+    /**
+     * Update an existing item in the vbucket by calling the mutator with
+     * the current value while holding the hash bucket lock, and storing
+     * the value it generates.
+     *
+     * Only resident, uncompressed, unlocked items are updated in place;
+     * ENGINE_ENOTSUP is returned (without calling the mutator) for
+     * anything else so the caller may fall back to a get / CAS store.
+     *
+     * @param key the key of the item to update
+     * @param cas the CAS the item must have (0 for any). Upon success set
+     *            to the CAS of the new item
+     * @param exptime the (absolute) expiry time for the new item
+     * @param mutator the function generating the new value
+     * @param cookie the connection cookie
+     * @param engine Reference to ep engine
+     * @param mut_info upon success, the seqno and vbucket uuid of the update
+     * @param readHandle Reader access to the Item's collection data.
+     *
+     * @return ENGINE_ERROR_CODE status notified to be to the front end
+     */
+    ENGINE_ERROR_CODE updateInPlace(
+            const DocKey& key,
+            uint64_t& cas,
+            time_t exptime,
+            const cb::InPlaceMutator& mutator,
+            const void* cookie,
+            EventuallyPersistentEngine& engine,
+            mutation_descr_t& mut_info,
+            const Collections::VB::Manifest::CachingReadHandle& readHandle);
+
     /**
      * Add an item directly into its vbucket rather than putting it on a
      * checkpoint (backfill the item). The can happen during DCP or when a
@@ -943,6 +974,18 @@ public:
     virtual bool pageOut(const HashTable::HashBucketLock& lh,
                          StoredValue*& v) = 0;
 
+    /**
+     * Check if the given StoredValue may currently be paged out (see
+     * pageOut).
+     *
+     * @param lh Bucket lock associated with the StoredValue.
+     * @param v the StoredValue to check
+     *
+     * @return true if pageOut would eject the item
+     */
+    virtual bool eligibleToPageOut(const HashTable::HashBucketLock& lh,
+                                   const StoredValue& v) const = 0;
+
     /**
      * Add an item in the store
      *
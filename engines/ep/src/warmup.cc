@@ -32,12 +32,28 @@
 #include <platform/make_unique.h>
 #include <platform/timeutils.h>
 
+#include <algorithm>
 #include <limits>
 #include <string>
 #include <utility>
 #include <array>
 #include <random>
 
+/**
+ * Description of a warmup task scanning (part of) a shard. The task number
+ * is only included when the shard is split over multiple tasks.
+ */
+static std::string shardTaskDescription(const std::string& prefix,
+                                        uint16_t shardId,
+                                        uint16_t taskIdx,
+                                        uint16_t numTasks) {
+    std::string ret = prefix + ": shard " + std::to_string(shardId);
+    if (numTasks > 1) {
+        ret += " task " + std::to_string(taskIdx);
+    }
+    return ret;
+}
+
 struct WarmupCookie {
     WarmupCookie(KVBucket* s, StatusCallback<GetValue>& c)
         : cb(c), epstore(s), loaded(0), skipped(0), error(0) { /* EMPTY */
@@ -49,6 +65,24 @@ struct WarmupCookie {
     size_t error;
 };
 
+/// Names of the phases tracked in Warmup::phaseProgress (used in the stats)
+static const std::array<const char*, 4> phaseNames = {
+        {"key_dump", "loading_access_log", "loading_kv_pairs", "loading_data"}};
+
+/// @return the index of the given state in phaseProgress, or -1
+static int getPhaseIndex(int warmupState) {
+    if (warmupState == WarmupState::KeyDump) {
+        return 0;
+    } else if (warmupState == WarmupState::LoadingAccessLog) {
+        return 1;
+    } else if (warmupState == WarmupState::LoadingKVPairs) {
+        return 2;
+    } else if (warmupState == WarmupState::LoadingData) {
+        return 3;
+    }
+    return -1;
+}
+
 // Warmup Tasks ///////////////////////////////////////////////////////////////
 
 class WarmupInitialize : public GlobalTask {
@@ -151,11 +185,17 @@ private:
 
 class WarmupKeyDump : public GlobalTask {
 public:
-    WarmupKeyDump(KVBucket& st, uint16_t sh, Warmup* w)
+    WarmupKeyDump(KVBucket& st,
+                  uint16_t sh,
+                  uint16_t taskIdx,
+                  uint16_t numTasks,
+                  Warmup* w)
         : GlobalTask(&st.getEPEngine(), TaskId::WarmupKeyDump, 0, false),
           _shardId(sh),
+          _taskIdx(taskIdx),
           _warmup(w),
-          _description("Warmup - key dump: shard " + std::to_string(_shardId)) {
+          _description(shardTaskDescription(
+                  "Warmup - key dump", sh, taskIdx, numTasks)) {
         _warmup->addToTaskSet(uid);
     }
 
@@ -173,13 +213,14 @@ public:
 
     bool run() {
         TRACE_EVENT1("ep-engine/task", "WarmupKeyDump", "shard", _shardId);
-        _warmup->keyDumpforShard(_shardId);
+        _warmup->keyDumpforShard(_shardId, _taskIdx);
         _warmup->removeFromTaskSet(uid);
         return false;
     }
 
 private:
     uint16_t _shardId;
+    uint16_t _taskIdx;
     Warmup* _warmup;
     const std::string _description;
 };
@@ -253,12 +294,17 @@ private:
 
 class WarmupLoadingKVPairs : public GlobalTask {
 public:
-    WarmupLoadingKVPairs(KVBucket& st, uint16_t sh, Warmup* w)
+    WarmupLoadingKVPairs(KVBucket& st,
+                         uint16_t sh,
+                         uint16_t taskIdx,
+                         uint16_t numTasks,
+                         Warmup* w)
         : GlobalTask(&st.getEPEngine(), TaskId::WarmupLoadingKVPairs, 0, false),
           _shardId(sh),
+          _taskIdx(taskIdx),
           _warmup(w),
-          _description("Warmup - loading KV Pairs: shard " +
-                       std::to_string(_shardId)) {
+          _description(shardTaskDescription(
+                  "Warmup - loading KV Pairs", sh, taskIdx, numTasks)) {
         _warmup->addToTaskSet(uid);
     }
 
@@ -277,25 +323,31 @@ public:
 
     bool run() {
         TRACE_EVENT0("ep-engine/task", "WarmupLoadingKVPairs");
-        _warmup->loadKVPairsforShard(_shardId);
+        _warmup->loadKVPairsforShard(_shardId, _taskIdx);
         _warmup->removeFromTaskSet(uid);
         return false;
     }
 
 private:
     uint16_t _shardId;
+    uint16_t _taskIdx;
     Warmup* _warmup;
     const std::string _description;
 };
 
 class WarmupLoadingData : public GlobalTask {
 public:
-    WarmupLoadingData(KVBucket& st, uint16_t sh, Warmup* w) :
-        GlobalTask(&st.getEPEngine(), TaskId::WarmupLoadingData, 0, false),
-        _shardId(sh),
-        _warmup(w),
-        _description("Warmup - loading data: shard " +
-                     std::to_string(_shardId)) {
+    WarmupLoadingData(KVBucket& st,
+                      uint16_t sh,
+                      uint16_t taskIdx,
+                      uint16_t numTasks,
+                      Warmup* w)
+        : GlobalTask(&st.getEPEngine(), TaskId::WarmupLoadingData, 0, false),
+          _shardId(sh),
+          _taskIdx(taskIdx),
+          _warmup(w),
+          _description(shardTaskDescription(
+                  "Warmup - loading data", sh, taskIdx, numTasks)) {
         _warmup->addToTaskSet(uid);
     }
 
@@ -314,13 +366,14 @@ public:
 
     bool run() {
         TRACE_EVENT0("ep-engine/task", "WarmupLoadingData");
-        _warmup->loadDataforShard(_shardId);
+        _warmup->loadDataforShard(_shardId, _taskIdx);
         _warmup->removeFromTaskSet(uid);
         return false;
     }
 
 private:
     uint16_t _shardId;
+    uint16_t _taskIdx;
     Warmup* _warmup;
     const std::string _description;
 };
@@ -537,7 +590,9 @@ LoadStorageKVPairCallback::LoadStorageKVPairCallback(KVBucket& ep,
       startTime(ep_real_time()),
       hasPurged(false),
       maybeEnableTraffic(_maybeEnableTraffic),
-      warmupState(_warmupState) {
+      warmupState(_warmupState),
+      itemsLoaded(0),
+      bytesLoaded(0) {
 }
 
 void LoadStorageKVPairCallback::callback(GetValue &val) {
@@ -551,6 +606,9 @@ void LoadStorageKVPairCallback::callback(GetValue &val) {
 
     bool stopLoading = false;
     if (i != NULL && !epstore.getWarmup()->isComplete()) {
+        ++itemsLoaded;
+        bytesLoaded += i->getKey().size() + i->getNBytes();
+
         VBucketPtr vb = vbuckets.getBucket(i->getVBucketId());
         if (!vb) {
             setStatus(ENGINE_NOT_MY_VBUCKET);
@@ -660,6 +718,12 @@ void LoadStorageKVPairCallback::callback(GetValue &val) {
     }
 }
 
+void LoadStorageKVPairCallback::flushProgress(WarmupPhaseProgress& progress) {
+    progress.addLoaded(itemsLoaded, bytesLoaded);
+    itemsLoaded = 0;
+    bytesLoaded = 0;
+}
+
 bool LoadStorageKVPairCallback::shouldEject() const {
     return stats.getTotalMemoryUsed() >= stats.mem_low_wat;
 }
@@ -724,6 +788,32 @@ void LoadValueCallback::callback(CacheLookup &lookup)
     setStatus(ENGINE_SUCCESS);
 }
 
+void WarmupPhaseProgress::start() {
+    std::lock_guard<std::mutex> lh(mutex);
+    startTime = ProcessClock::now();
+    started = true;
+    finished = false;
+}
+
+void WarmupPhaseProgress::finish() {
+    std::lock_guard<std::mutex> lh(mutex);
+    finishTime = ProcessClock::now();
+    finished = true;
+}
+
+bool WarmupPhaseProgress::hasStarted() const {
+    std::lock_guard<std::mutex> lh(mutex);
+    return started;
+}
+
+ProcessClock::duration WarmupPhaseProgress::getDuration() const {
+    std::lock_guard<std::mutex> lh(mutex);
+    if (!started) {
+        return ProcessClock::duration::zero();
+    }
+    return (finished ? finishTime : ProcessClock::now()) - startTime;
+}
+
 //////////////////////////////////////////////////////////////////////////////
 //                                                                          //
 //    Implementation of the warmup class                                    //
@@ -736,6 +826,8 @@ Warmup::Warmup(KVBucket& st, Configuration& config_)
       config(config_),
       shardVbStates(store.vbMap.getNumShards()),
       threadtask_count(0),
+      expectedTaskCount(0),
+      tasksPerShard(config_.getWarmupTasksPerShard()),
       shardKeyDumpStatus(store.vbMap.getNumShards()),
       shardVbIds(store.vbMap.getNumShards()),
       estimatedItemCount(std::numeric_limits<size_t>::max()),
@@ -942,6 +1034,20 @@ void Warmup::estimateDatabaseItemCount(uint16_t shardId)
         VBucketPtr vb = store.getVBucket(vbid);
         if (vb) {
             vb->setNumTotalItems(vbItemCount);
+            // Size the hash table for the items we're about to load up front
+            // rather than growing it (rehashing every item) as they arrive.
+            // Under full eviction only the items warmup loads are in the
+            // hash table, and it stops loading once warmup_min_items_threshold
+            // of them are resident.
+            size_t expectedItems = vbItemCount;
+            if (store.getItemEvictionPolicy() == FULL_EVICTION) {
+                const double readCap = store.getEPEngine()
+                                               .getEpStats()
+                                               .warmupNumReadCap;
+                expectedItems = static_cast<size_t>(vbItemCount *
+                                                    std::min(1.0, readCap));
+            }
+            vb->ht.resizeForItemCount(expectedItems);
         }
         item_count += vbItemCount;
     }
@@ -958,17 +1064,30 @@ void Warmup::estimateDatabaseItemCount(uint16_t shardId)
     }
 }
 
-void Warmup::scheduleKeyDump()
-{
+template <class Task>
+void Warmup::scheduleShardTasks() {
     threadtask_count = 0;
+    expectedTaskCount = 0;
     for (size_t i = 0; i < store.vbMap.shards.size(); i++) {
-        ExTask task = std::make_shared<WarmupKeyDump>(store, i, this);
-        ExecutorPool::get()->schedule(task);
+        expectedTaskCount += getNumTasksForShard(i);
+    }
+    for (size_t i = 0; i < store.vbMap.shards.size(); i++) {
+        const auto numTasks = getNumTasksForShard(i);
+        for (uint16_t t = 0; t < numTasks; t++) {
+            ExTask task = std::make_shared<Task>(store, i, t, numTasks, this);
+            ExecutorPool::get()->schedule(task);
+        }
     }
+}
+
+void Warmup::scheduleKeyDump()
+{
+    startPhase(WarmupState::KeyDump);
+    scheduleShardTasks<WarmupKeyDump>();
 
 }
 
-void Warmup::keyDumpforShard(uint16_t shardId)
+void Warmup::keyDumpforShard(uint16_t shardId, uint16_t taskIdx)
 {
     KVStore* kvstore = store.getROUnderlyingByShard(shardId);
     auto cb = std::make_shared<LoadStorageKVPairCallback>(
@@ -976,13 +1095,15 @@ void Warmup::keyDumpforShard(uint16_t shardId)
     auto cl =
             std::make_shared<Collections::VB::LogicallyDeletedCallback>(store);
 
-    for (const auto vbid : shardVbIds[shardId]) {
+    auto& progress = *getPhaseProgress(WarmupState::KeyDump);
+    for (const auto vbid : getVbIdsForTask(shardId, taskIdx)) {
         ScanContext* ctx = kvstore->initScanContext(cb, cl, vbid, 0,
                                                     DocumentFilter::NO_DELETES,
                                                     ValueFilter::KEYS_ONLY);
         if (ctx) {
             auto errorCode = kvstore->scan(ctx);
             kvstore->destroyScanContext(ctx);
+            cb->flushProgress(progress);
             if (errorCode == scan_again) { // ENGINE_ENOMEM
                 // skip loading remaining VBuckets as memory limit was reached
                 break;
@@ -992,7 +1113,8 @@ void Warmup::keyDumpforShard(uint16_t shardId)
 
     shardKeyDumpStatus[shardId] = true;
 
-    if (++threadtask_count == store.vbMap.getNumShards()) {
+    if (++threadtask_count == expectedTaskCount) {
+        finishPhase(WarmupState::KeyDump);
         bool success = false;
         for (size_t i = 0; i < store.vbMap.getNumShards(); i++) {
             if (shardKeyDumpStatus[i]) {
@@ -1057,6 +1179,7 @@ void Warmup::checkForAccessLog()
 void Warmup::scheduleLoadingAccessLog()
 {
     threadtask_count = 0;
+    startPhase(WarmupState::LoadingAccessLog);
     for (size_t i = 0; i < store.vbMap.shards.size(); i++) {
         ExTask task = std::make_shared<WarmupLoadAccessLog>(store, i, this);
         ExecutorPool::get()->schedule(task);
@@ -1103,6 +1226,8 @@ void Warmup::loadingAccessLog(uint16_t shardId)
         }
     }
 
+    load_cb.flushProgress(*getPhaseProgress(WarmupState::LoadingAccessLog));
+
     size_t numItems = store.getEPEngine().getEpStats().warmedUpValues;
     if (success && numItems) {
         LOG(EXTENSION_LOG_NOTICE,
@@ -1115,6 +1240,7 @@ void Warmup::loadingAccessLog(uint16_t shardId)
     }
 
     if (++threadtask_count == store.vbMap.getNumShards()) {
+        finishPhase(WarmupState::LoadingAccessLog);
         if (!store.maybeEnableTraffic()) {
             transition(WarmupState::LoadingData);
         } else {
@@ -1178,15 +1304,12 @@ void Warmup::scheduleLoadingKVPairs()
     // keys have been warmed up at this point.
     setEstimatedWarmupCount(estimatedItemCount);
 
-    threadtask_count = 0;
-    for (size_t i = 0; i < store.vbMap.shards.size(); i++) {
-        ExTask task = std::make_shared<WarmupLoadingKVPairs>(store, i, this);
-        ExecutorPool::get()->schedule(task);
-    }
+    startPhase(WarmupState::LoadingKVPairs);
+    scheduleShardTasks<WarmupLoadingKVPairs>();
 
 }
 
-void Warmup::loadKVPairsforShard(uint16_t shardId)
+void Warmup::loadKVPairsforShard(uint16_t shardId, uint16_t taskIdx)
 {
     bool maybe_enable_traffic = false;
     scan_error_t errorCode = scan_success;
@@ -1201,20 +1324,23 @@ void Warmup::loadKVPairsforShard(uint16_t shardId)
     auto cl =
             std::make_shared<LoadValueCallback>(store.vbMap, state.getState());
 
-    for (const auto vbid : shardVbIds[shardId]) {
+    auto& progress = *getPhaseProgress(WarmupState::LoadingKVPairs);
+    for (const auto vbid : getVbIdsForTask(shardId, taskIdx)) {
         ScanContext* ctx = kvstore->initScanContext(cb, cl, vbid, 0,
                                                     DocumentFilter::NO_DELETES,
                                                     ValueFilter::VALUES_DECOMPRESSED);
         if (ctx) {
             errorCode = kvstore->scan(ctx);
             kvstore->destroyScanContext(ctx);
+            cb->flushProgress(progress);
             if (errorCode == scan_again) { // ENGINE_ENOMEM
                 // skip loading remaining VBuckets as memory limit was reached
                 break;
             }
         }
     }
-    if (++threadtask_count == store.vbMap.getNumShards()) {
+    if (++threadtask_count == expectedTaskCount) {
+        finishPhase(WarmupState::LoadingKVPairs);
         transition(WarmupState::Done);
     }
 }
@@ -1224,14 +1350,11 @@ void Warmup::scheduleLoadingData()
     size_t estimatedCount = store.getEPEngine().getEpStats().warmedUpKeys;
     setEstimatedWarmupCount(estimatedCount);
 
-    threadtask_count = 0;
-    for (size_t i = 0; i < store.vbMap.shards.size(); i++) {
-        ExTask task = std::make_shared<WarmupLoadingData>(store, i, this);
-        ExecutorPool::get()->schedule(task);
-    }
+    startPhase(WarmupState::LoadingData);
+    scheduleShardTasks<WarmupLoadingData>();
 }
 
-void Warmup::loadDataforShard(uint16_t shardId)
+void Warmup::loadDataforShard(uint16_t shardId, uint16_t taskIdx)
 {
     scan_error_t errorCode = scan_success;
 
@@ -1241,13 +1364,15 @@ void Warmup::loadDataforShard(uint16_t shardId)
     auto cl =
             std::make_shared<LoadValueCallback>(store.vbMap, state.getState());
 
-    for (const auto vbid : shardVbIds[shardId]) {
+    auto& progress = *getPhaseProgress(WarmupState::LoadingData);
+    for (const auto vbid : getVbIdsForTask(shardId, taskIdx)) {
         ScanContext* ctx = kvstore->initScanContext(cb, cl, vbid, 0,
                                                     DocumentFilter::NO_DELETES,
                                                     ValueFilter::VALUES_DECOMPRESSED);
         if (ctx) {
             errorCode = kvstore->scan(ctx);
             kvstore->destroyScanContext(ctx);
+            cb->flushProgress(progress);
             if (errorCode == scan_again) { // ENGINE_ENOMEM
                 // skip loading remaining VBuckets as memory limit was reached
                 break;
@@ -1255,7 +1380,8 @@ void Warmup::loadDataforShard(uint16_t shardId)
         }
     }
 
-    if (++threadtask_count == store.vbMap.getNumShards()) {
+    if (++threadtask_count == expectedTaskCount) {
+        finishPhase(WarmupState::LoadingData);
         transition(WarmupState::Done);
     }
 }
@@ -1395,6 +1521,28 @@ void Warmup::addStats(ADD_STAT add_stat, const void *c) const
     } else {
         addStat("estimated_value_count", warmupCount, add_stat, c);
     }
+    for (size_t ii = 0; ii < phaseProgress.size(); ++ii) {
+        const auto& progress = phaseProgress[ii];
+        if (!progress.hasStarted()) {
+            continue;
+        }
+        const std::string prefix = phaseNames[ii];
+        const auto duration = progress.getDuration();
+        const auto usec = duration_cast<microseconds>(duration).count();
+        addStat((prefix + "_items").c_str(), progress.getItems(), add_stat, c);
+        addStat((prefix + "_bytes").c_str(), progress.getBytes(), add_stat, c);
+        addStat((prefix + "_time").c_str(), usec, add_stat, c);
+        if (usec > 0) {
+            addStat((prefix + "_items_per_sec").c_str(),
+                    uint64_t(progress.getItems() * 1000000.0 / usec),
+                    add_stat,
+                    c);
+            addStat((prefix + "_bytes_per_sec").c_str(),
+                    uint64_t(progress.getBytes() * 1000000.0 / usec),
+                    add_stat,
+                    c);
+        }
+    }
 }
 
 /* In the case of CouchKVStore, all vbucket states of all the shards are stored
@@ -1483,3 +1631,51 @@ void Warmup::populateShardVbStates()
         }
     }
 }
+
+uint16_t Warmup::getNumTasksForShard(uint16_t shardId) const {
+    return uint16_t(std::max(
+            size_t(1), std::min(tasksPerShard, shardVbIds[shardId].size())));
+}
+
+std::vector<uint16_t> Warmup::getVbIdsForTask(uint16_t shardId,
+                                              uint16_t taskIdx) const {
+    const auto numTasks = getNumTasksForShard(shardId);
+    std::vector<uint16_t> ret;
+    const auto& vbids = shardVbIds[shardId];
+    for (size_t ii = taskIdx; ii < vbids.size(); ii += numTasks) {
+        ret.push_back(vbids[ii]);
+    }
+    return ret;
+}
+
+WarmupPhaseProgress* Warmup::getPhaseProgress(int warmupState) {
+    const int idx = getPhaseIndex(warmupState);
+    if (idx < 0) {
+        return nullptr;
+    }
+    return &phaseProgress[idx];
+}
+
+void Warmup::startPhase(int warmupState) {
+    getPhaseProgress(warmupState)->start();
+}
+
+void Warmup::finishPhase(int warmupState) {
+    auto& progress = *getPhaseProgress(warmupState);
+    progress.finish();
+
+    const auto duration = progress.getDuration();
+    const double seconds =
+            std::chrono::duration_cast<std::chrono::duration<double>>(duration)
+                    .count();
+    const double mb = progress.getBytes() / (1024.0 * 1024.0);
+    LOG(EXTENSION_LOG_NOTICE,
+        "Warmup %s: loaded %" PRIu64 " items (%.2f MB) in %s "
+        "(%.0f items/s, %.2f MB/s)",
+        phaseNames[getPhaseIndex(warmupState)],
+        uint64_t(progress.getItems()),
+        mb,
+        cb::time2text(duration).c_str(),
+        seconds > 0 ? progress.getItems() / seconds : 0.0,
+        seconds > 0 ? mb / seconds : 0.0);
+}
@@ -22,9 +22,11 @@
 #include "callbacks.h"
 #include "utility.h"
 
+#include <array>
 #include <atomic>
 #include <deque>
 #include <map>
+#include <mutex>
 #include <ostream>
 #include <string>
 #include <unordered_set>
@@ -42,6 +44,8 @@ class VBucketMap;
 
 struct vbucket_state;
 
+class WarmupPhaseProgress;
+
 class WarmupState {
 public:
     static const int Initialize;
@@ -88,6 +92,14 @@ public:
 
     void callback(GetValue &val);
 
+    /**
+     * Add the number of items (and bytes) read since the last call to the
+     * given progress, and reset the local counters. The counters are kept
+     * locally so the tasks loading items in parallel don't contend on the
+     * progress for every item.
+     */
+    void flushProgress(WarmupPhaseProgress& progress);
+
 private:
     bool shouldEject() const;
 
@@ -100,6 +112,8 @@ private:
     bool        hasPurged;
     bool        maybeEnableTraffic;
     int         warmupState;
+    size_t      itemsLoaded;
+    size_t      bytesLoaded;
 };
 
 class LoadValueCallback : public StatusCallback<CacheLookup> {
@@ -114,6 +128,45 @@ private:
     int         warmupState;
 };
 
+/**
+ * Progress of one of the warmup phases loading items from disk; the number
+ * of items (and bytes) read and how long the phase took, so we can report
+ * the throughput of each phase.
+ */
+class WarmupPhaseProgress {
+public:
+    void start();
+
+    void finish();
+
+    void addLoaded(size_t numItems, size_t numBytes) {
+        items.fetch_add(numItems);
+        bytes.fetch_add(numBytes);
+    }
+
+    bool hasStarted() const;
+
+    size_t getItems() const {
+        return items.load();
+    }
+
+    size_t getBytes() const {
+        return bytes.load();
+    }
+
+    /// @return the time spent in the phase so far (or in total once finished)
+    ProcessClock::duration getDuration() const;
+
+private:
+    std::atomic<size_t> items{0};
+    std::atomic<size_t> bytes{0};
+
+    mutable std::mutex mutex;
+    ProcessClock::time_point startTime;
+    ProcessClock::time_point finishTime;
+    bool started = false;
+    bool finished = false;
+};
 
 class Warmup {
 public:
@@ -183,11 +236,11 @@ public:
     void initialize();
     void createVBuckets(uint16_t shardId);
     void estimateDatabaseItemCount(uint16_t shardId);
-    void keyDumpforShard(uint16_t shardId);
+    void keyDumpforShard(uint16_t shardId, uint16_t taskIdx);
     void checkForAccessLog();
     void loadingAccessLog(uint16_t shardId);
-    void loadKVPairsforShard(uint16_t shardId);
-    void loadDataforShard(uint16_t shardId);
+    void loadKVPairsforShard(uint16_t shardId, uint16_t taskIdx);
+    void loadDataforShard(uint16_t shardId, uint16_t taskIdx);
     void done();
 
 private:
@@ -201,6 +254,39 @@ private:
 
     void populateShardVbStates();
 
+    /**
+     * @return the number of tasks used to scan the vBuckets of the given
+     *         shard (warmup_tasks_per_shard, but never more tasks than there
+     *         are vBuckets)
+     */
+    uint16_t getNumTasksForShard(uint16_t shardId) const;
+
+    /**
+     * @return the vBuckets of the given shard to be scanned by the given
+     *         task; the shard's vBuckets are dealt out round robin so the
+     *         active vBuckets loaded first are spread over all of the tasks.
+     */
+    std::vector<uint16_t> getVbIdsForTask(uint16_t shardId,
+                                          uint16_t taskIdx) const;
+
+    /**
+     * @return the progress of the given warmup state, or nullptr if the
+     *         state doesn't load any items
+     */
+    WarmupPhaseProgress* getPhaseProgress(int warmupState);
+
+    void startPhase(int warmupState);
+
+    /// Mark the phase as finished and log how fast the items were loaded
+    void finishPhase(int warmupState);
+
+    /**
+     * Schedule the tasks scanning the shards for the current phase; each
+     * shard is split over getNumTasksForShard() tasks of the given type.
+     */
+    template <class Task>
+    void scheduleShardTasks();
+
     void scheduleInitialize();
     void scheduleCreateVBuckets();
     void scheduleEstimateDatabaseItemCount();
@@ -236,12 +322,21 @@ private:
 
     std::vector<std::map<uint16_t, vbucket_state>> shardVbStates;
     std::atomic<size_t> threadtask_count;
+    /// The number of tasks the current phase is split into
+    std::atomic<size_t> expectedTaskCount;
+    /// The number of tasks to scan each shard with during the key dump
+    /// and data loading phases
+    const size_t tasksPerShard;
     std::vector<std::atomic<bool>> shardKeyDumpStatus;
 
     /// vector of vectors of VBucket IDs (one vector per shard). Each vector
     /// contains all vBucket IDs which are present for the given shard.
     std::vector<std::vector<uint16_t>> shardVbIds;
 
+    /// Progress of the phases loading items (key dump, access log, kv pairs
+    /// and data)
+    std::array<WarmupPhaseProgress, 4> phaseProgress;
+
     cb::AtomicDuration estimateTime;
     std::atomic<size_t> estimatedItemCount;
     bool cleanShutdown;
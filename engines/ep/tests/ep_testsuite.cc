@@ -6213,6 +6213,9 @@ static enum test_result test_mb19687_fixed(ENGINE_HANDLE* h,
                                    "vb_0:drift_behind_threshold_exceeded",
                                    "vb_0:high_seqno",
                                    "vb_0:ht_cache_size",
+                                   "vb_0:ht_cold_items",
+                                   "vb_0:ht_cold_memory",
+                                   "vb_0:ht_expiry_index_size",
                                    "vb_0:ht_item_memory",
                                    "vb_0:ht_memory",
                                    "vb_0:ht_size",
@@ -6284,7 +6287,8 @@ static enum test_result test_mb19687_fixed(ENGINE_HANDLE* h,
             {"kvstore", kvstats},
             {"info", {"info"}},
             {"allocator", {"detailed"}},
-            {"config", {"ep_backend",
+            {"config", {"ep_allocator_arena_per_bucket",
+                        "ep_backend",
                         "ep_backfill_mem_threshold",
                         "ep_bfilter_enabled",
                         "ep_bfilter_fp_prob",
@@ -6296,9 +6300,15 @@ static enum test_result test_mb19687_fixed(ENGINE_HANDLE* h,
                         "ep_chk_max_items",
                         "ep_chk_period",
                         "ep_chk_remover_stime",
+                        "ep_cold_metadata_enabled",
                         "ep_collections_prototype_enabled",
                         "ep_collections_max_size",
+                        "ep_compaction_bg_wait_threshold",
                         "ep_compaction_exp_mem_threshold",
+                        "ep_compaction_io_latency_target",
+                        "ep_compaction_max_bytes_per_sec",
+                        "ep_compaction_max_concurrent_ratio",
+                        "ep_compaction_max_pause",
                         "ep_compaction_write_queue_cap",
                         "ep_compression_mode",
                         "ep_config_file",
@@ -6338,12 +6348,14 @@ static enum test_result test_mb19687_fixed(ENGINE_HANDLE* h,
                         "ep_exp_pager_enabled",
                         "ep_exp_pager_initial_run_time",
                         "ep_exp_pager_stime",
+                        "ep_exp_pager_use_index",
                         "ep_failpartialwarmup",
                         "ep_fsync_after_every_n_bytes_written",
                         "ep_getl_default_timeout",
                         "ep_getl_max_timeout",
                         "ep_hlc_drift_ahead_threshold_us",
                         "ep_hlc_drift_behind_threshold_us",
+                        "ep_ht_eviction_policy",
                         "ep_ht_locks",
                         "ep_ht_resize_interval",
                         "ep_ht_size",
@@ -6398,6 +6410,7 @@ static enum test_result test_mb19687_fixed(ENGINE_HANDLE* h,
                         "ep_warmup_batch_size",
                         "ep_warmup_min_items_threshold",
                         "ep_warmup_min_memory_threshold",
+                        "ep_warmup_tasks_per_shard",
                         "ep_xattr_enabled"}},
             {"workload",
              {"ep_workload:num_readers",
@@ -6449,6 +6462,7 @@ static enum test_result test_mb19687_fixed(ENGINE_HANDLE* h,
               "ep_active_datatype_xattr",
               "ep_active_hlc_drift",
               "ep_active_hlc_drift_count",
+              "ep_allocator_arena_per_bucket",
               "ep_backend",
               "ep_backfill_mem_threshold",
               "ep_bfilter_enabled",
@@ -6471,10 +6485,21 @@ static enum test_result test_mb19687_fixed(ENGINE_HANDLE* h,
               "ep_chk_persistence_remains",
               "ep_chk_remover_stime",
               "ep_clock_cas_drift_threshold_exceeded",
+              "ep_cold_metadata_enabled",
               "ep_collections_prototype_enabled",
               "ep_collections_max_size",
+              "ep_compaction_bg_wait_threshold",
+              "ep_compaction_concurrency_limit",
               "ep_compaction_exp_mem_threshold",
+              "ep_compaction_io_latency_target",
+              "ep_compaction_max_bytes_per_sec",
+              "ep_compaction_max_concurrent_ratio",
+              "ep_compaction_max_pause",
+              "ep_compaction_num_pauses",
+              "ep_compaction_paused_time",
+              "ep_compaction_throttled_time",
               "ep_compaction_write_queue_cap",
+              "ep_compactions_running",
               "ep_compression_mode",
               "ep_config_file",
               "ep_conflict_resolution_type",
@@ -6515,6 +6540,7 @@ static enum test_result test_mb19687_fixed(ENGINE_HANDLE* h,
               "ep_defragmenter_interval",
               "ep_defragmenter_num_moved",
               "ep_defragmenter_num_visited",
+              "ep_defragmenter_sv_num_moved",
               "ep_degraded_mode",
               "ep_diskqueue_drain",
               "ep_diskqueue_fill",
@@ -6526,6 +6552,7 @@ static enum test_result test_mb19687_fixed(ENGINE_HANDLE* h,
               "ep_exp_pager_enabled",
               "ep_exp_pager_initial_run_time",
               "ep_exp_pager_stime",
+              "ep_exp_pager_use_index",
               "ep_expired_access",
               "ep_expired_compactor",
               "ep_expired_pager",
@@ -6538,6 +6565,7 @@ static enum test_result test_mb19687_fixed(ENGINE_HANDLE* h,
               "ep_getl_max_timeout",
               "ep_hlc_drift_ahead_threshold_us",
               "ep_hlc_drift_behind_threshold_us",
+              "ep_ht_eviction_policy",
               "ep_ht_locks",
               "ep_ht_resize_interval",
               "ep_ht_size",
@@ -6661,6 +6689,7 @@ static enum test_result test_mb19687_fixed(ENGINE_HANDLE* h,
               "ep_warmup_batch_size",
               "ep_warmup_min_items_threshold",
               "ep_warmup_min_memory_threshold",
+              "ep_warmup_tasks_per_shard",
               "ep_workload_pattern",
               "ep_xattr_enabled",
               "mem_used",
@@ -0,0 +1,169 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2018 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "config.h"
+
+#include "cold_metadata.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+
+/*
+ * Unit tests for the ColdMetadataBlock class.
+ */
+
+static ColdMetadataBlock::Record makeRecord(const std::string& key,
+                                            int64_t bySeqno,
+                                            uint64_t cas) {
+    ColdMetadataBlock::Record record;
+    record.key = key;
+    record.bySeqno = bySeqno;
+    record.cas = cas;
+    record.revSeqno = bySeqno * 3;
+    record.exptime = 0xdeadbeef;
+    record.flags = uint32_t(bySeqno);
+    record.datatype = PROTOCOL_BINARY_DATATYPE_JSON;
+    return record;
+}
+
+// Records are kept in seqno order, and decode to exactly what was added
+// (including CAS values which go backwards).
+TEST(ColdMetadataBlockTest, roundTrip) {
+    ColdMetadataBlock block;
+    block.add(makeRecord("key3", 300, 1000));
+    block.add(makeRecord("key1", 100, 5000));
+    block.add(makeRecord("key2", 200, 0xffffffffffffull));
+    EXPECT_EQ(3, block.getNumRecords());
+
+    const auto records = block.decode();
+    ASSERT_EQ(3, records.size());
+    const std::vector<std::string> keys{"key1", "key2", "key3"};
+    const std::vector<uint64_t> cas{5000, 0xffffffffffffull, 1000};
+    for (size_t ii = 0; ii < records.size(); ++ii) {
+        EXPECT_EQ(keys[ii], records[ii].key);
+        EXPECT_EQ(int64_t(ii + 1) * 100, records[ii].bySeqno);
+        EXPECT_EQ(cas[ii], records[ii].cas);
+        EXPECT_EQ(uint64_t(ii + 1) * 300, records[ii].revSeqno);
+        EXPECT_EQ(0xdeadbeef, records[ii].exptime);
+        EXPECT_EQ((ii + 1) * 100, records[ii].flags);
+        EXPECT_EQ(PROTOCOL_BINARY_DATATYPE_JSON, records[ii].datatype);
+        EXPECT_EQ(DocNamespace::DefaultCollection, records[ii].docNamespace);
+    }
+}
+
+TEST(ColdMetadataBlockTest, remove) {
+    ColdMetadataBlock block;
+    std::vector<ColdMetadataBlock::Record> records;
+    for (int ii = 0; ii < 10; ++ii) {
+        records.push_back(makeRecord("key" + std::to_string(ii), ii + 1, ii));
+    }
+    block.add(std::move(records));
+    EXPECT_EQ(10, block.getNumRecords());
+
+    ColdMetadataBlock::Record record;
+    EXPECT_FALSE(block.remove(DocKey("missing", DocNamespace::DefaultCollection),
+                              record));
+    EXPECT_FALSE(block.remove(DocKey("key4", DocNamespace::System), record));
+
+    ASSERT_TRUE(block.remove(DocKey("key4", DocNamespace::DefaultCollection),
+                             record));
+    EXPECT_EQ("key4", record.key);
+    EXPECT_EQ(5, record.bySeqno);
+    EXPECT_EQ(9, block.getNumRecords());
+    EXPECT_FALSE(block.remove(DocKey("key4", DocNamespace::DefaultCollection),
+                              record));
+
+    // The remaining records are unaffected.
+    for (const auto& r : block.decode()) {
+        EXPECT_NE("key4", r.key);
+        EXPECT_EQ("key" + std::to_string(r.bySeqno - 1), r.key);
+    }
+}
+
+// Records added and removed one at a time (which splice the encoded data
+// rather than re-encoding the block) leave the same block as encoding the
+// remaining records in one go.
+TEST(ColdMetadataBlockTest, splice) {
+    ColdMetadataBlock block;
+    std::vector<ColdMetadataBlock::Record> expected;
+    // Add at the end, the front and in the middle, with CAS values going
+    // both ways.
+    for (int seqno : {50, 10, 30, 20, 60, 40, 5}) {
+        auto record =
+                makeRecord("key" + std::to_string(seqno), seqno, 1000 - seqno);
+        expected.push_back(record);
+        block.add(std::move(record));
+    }
+    EXPECT_EQ(expected.size(), block.getNumRecords());
+
+    // Remove the first, the last and one in the middle.
+    ColdMetadataBlock::Record record;
+    for (int seqno : {5, 60, 30}) {
+        const auto key = "key" + std::to_string(seqno);
+        ASSERT_TRUE(block.remove(
+                DocKey(reinterpret_cast<const uint8_t*>(key.data()),
+                       key.size(),
+                       DocNamespace::DefaultCollection),
+                record));
+        EXPECT_EQ(key, record.key);
+        EXPECT_EQ(seqno, record.bySeqno);
+        EXPECT_EQ(uint64_t(1000 - seqno), record.cas);
+        expected.erase(std::find_if(
+                expected.begin(),
+                expected.end(),
+                [seqno](const ColdMetadataBlock::Record& r) {
+                    return r.bySeqno == seqno;
+                }));
+    }
+
+    ColdMetadataBlock reference;
+    reference.add(expected);
+    EXPECT_EQ(reference.memorySize(), block.memorySize());
+
+    const auto records = block.decode();
+    const auto referenceRecords = reference.decode();
+    ASSERT_EQ(referenceRecords.size(), records.size());
+    for (size_t ii = 0; ii < records.size(); ++ii) {
+        EXPECT_EQ(referenceRecords[ii].key, records[ii].key);
+        EXPECT_EQ(referenceRecords[ii].bySeqno, records[ii].bySeqno);
+        EXPECT_EQ(referenceRecords[ii].cas, records[ii].cas);
+        EXPECT_EQ(referenceRecords[ii].revSeqno, records[ii].revSeqno);
+        EXPECT_EQ(referenceRecords[ii].flags, records[ii].flags);
+    }
+
+    // Removing everything leaves an empty block.
+    for (const auto& r : referenceRecords) {
+        ASSERT_TRUE(block.remove(r.getKey(), record));
+    }
+    EXPECT_EQ(0, block.getNumRecords());
+    EXPECT_TRUE(block.decode().empty());
+}
+
+// The block is a lot smaller than the StoredValues it replaces.
+TEST(ColdMetadataBlockTest, compact) {
+    ColdMetadataBlock block;
+    std::vector<ColdMetadataBlock::Record> records;
+    for (int ii = 0; ii < 16; ++ii) {
+        records.push_back(
+                makeRecord("key" + std::to_string(ii), 1000 + ii, 1000 + ii));
+    }
+    block.add(std::move(records));
+    // Each record is at most ~25 bytes (5 byte key, 2 bytes of seqno/CAS
+    // deltas, revSeqno, exptime, flags, datatype, namespace and length).
+    EXPECT_LT(block.memorySize(), sizeof(block) + 16 * 25);
+}
@@ -0,0 +1,104 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2018 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "compaction_governor.h"
+
+#include <gtest/gtest.h>
+
+class CompactionGovernorTest : public ::testing::Test {
+protected:
+    /// Update the governor one interval later, with the front end having
+    /// performed 100 I/Os with the given average latency
+    void update(std::chrono::microseconds latency, bool overloaded = false) {
+        now += CompactionGovernor::UpdateInterval;
+        io.ops += 100;
+        io.time += 100 * latency.count();
+        governor.update(now, io, overloaded, maxConcurrent, latencyTarget);
+    }
+
+    const size_t maxConcurrent = 4;
+    const std::chrono::microseconds latencyTarget{1000};
+    CompactionGovernor governor{maxConcurrent};
+    ProcessClock::time_point now;
+    CompactionGovernor::IOStats io;
+};
+
+// Up to maxConcurrent compactions may start.
+TEST_F(CompactionGovernorTest, Limit) {
+    EXPECT_EQ(4u, governor.getFreeSlots());
+    for (int ii = 0; ii < 4; ++ii) {
+        EXPECT_TRUE(governor.tryStart());
+    }
+    EXPECT_FALSE(governor.tryStart());
+    EXPECT_EQ(0u, governor.getFreeSlots());
+
+    governor.finished();
+    EXPECT_EQ(1u, governor.getFreeSlots());
+    EXPECT_TRUE(governor.tryStart());
+}
+
+// The limit is halved while the front end latency is above the target, and
+// then raised by one per interval (while all the slots are in use).
+TEST_F(CompactionGovernorTest, BackOffOnLatency) {
+    update(std::chrono::microseconds(500));
+    EXPECT_EQ(4u, governor.getLimit());
+
+    update(std::chrono::microseconds(2000));
+    EXPECT_EQ(std::chrono::microseconds(2000), governor.getLatency());
+    EXPECT_EQ(2u, governor.getLimit());
+    update(std::chrono::microseconds(2000));
+    EXPECT_EQ(1u, governor.getLimit());
+    update(std::chrono::microseconds(2000));
+    EXPECT_EQ(1u, governor.getLimit());
+
+    // Not raised unless the compactions need more slots
+    update(std::chrono::microseconds(500));
+    EXPECT_EQ(1u, governor.getLimit());
+
+    EXPECT_TRUE(governor.tryStart());
+    EXPECT_FALSE(governor.tryStart());
+    update(std::chrono::microseconds(500));
+    EXPECT_EQ(2u, governor.getLimit());
+    EXPECT_TRUE(governor.tryStart());
+    update(std::chrono::microseconds(500));
+    EXPECT_EQ(3u, governor.getLimit());
+}
+
+// A large disk write queue backs off regardless of the latency.
+TEST_F(CompactionGovernorTest, BackOffOnOverload) {
+    update(std::chrono::microseconds(0), true);
+    EXPECT_EQ(2u, governor.getLimit());
+}
+
+// The limit is only adjusted once per interval.
+TEST_F(CompactionGovernorTest, UpdateInterval) {
+    update(std::chrono::microseconds(2000));
+    EXPECT_EQ(2u, governor.getLimit());
+
+    governor.update(now, io, true, maxConcurrent, latencyTarget);
+    EXPECT_EQ(2u, governor.getLimit());
+}
+
+// Lowering maxConcurrent takes effect immediately.
+TEST_F(CompactionGovernorTest, MaxConcurrentChanged) {
+    governor.update(now, io, false, 2, latencyTarget);
+    EXPECT_EQ(2u, governor.getLimit());
+
+    // At least one compaction may always run
+    governor.update(now, io, false, 0, latencyTarget);
+    EXPECT_EQ(1u, governor.getLimit());
+}
@@ -0,0 +1,195 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2018 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "compaction_throttle.h"
+#include "stats.h"
+
+#include <gtest/gtest.h>
+
+#include <functional>
+
+/**
+ * A CompactionThrottle which doesn't sleep, but advances a fake clock
+ * instead.
+ */
+class MockCompactionThrottle : public CompactionThrottle {
+public:
+    MockCompactionThrottle(EPStats& stats, const Config& config)
+        : CompactionThrottle(stats, config) {
+    }
+
+    ProcessClock::time_point currentTime;
+    std::function<void()> sleepHook;
+
+protected:
+    ProcessClock::time_point now() override {
+        return currentTime;
+    }
+
+    void sleep(std::chrono::microseconds duration) override {
+        currentTime += duration;
+        if (sleepHook) {
+            sleepHook();
+        }
+    }
+};
+
+class CompactionThrottleTest : public ::testing::Test {
+protected:
+    EPStats stats;
+    CompactionThrottle::Config config;
+};
+
+// With no budget and no pauses configured the throttle never sleeps.
+TEST_F(CompactionThrottleTest, Unlimited) {
+    MockCompactionThrottle throttle(stats, config);
+    const auto start = throttle.currentTime;
+    for (int ii = 0; ii < 100; ++ii) {
+        throttle.addBytes(CompactionThrottle::ChunkSize);
+    }
+    EXPECT_EQ(start, throttle.currentTime);
+    EXPECT_EQ(100 * CompactionThrottle::ChunkSize, throttle.getTotalBytes());
+    EXPECT_EQ(0, throttle.getThrottledTime().count());
+}
+
+// The compaction is slowed down to the configured bytes/sec.
+TEST_F(CompactionThrottleTest, BytesPerSec) {
+    config.maxBytesPerSec = 4 * CompactionThrottle::ChunkSize;
+    MockCompactionThrottle throttle(stats, config);
+    const auto start = throttle.currentTime;
+
+    // Lots of small documents; only checked once per chunk
+    const size_t docSize = 1024;
+    for (size_t ii = 0; ii < (8 * CompactionThrottle::ChunkSize) / docSize;
+         ++ii) {
+        throttle.addBytes(docSize);
+    }
+
+    EXPECT_EQ(std::chrono::seconds(2), throttle.currentTime - start);
+    EXPECT_EQ(std::chrono::seconds(2), throttle.getThrottledTime());
+    EXPECT_EQ(2000000u, stats.compactionThrottledTime.load());
+}
+
+// Time spent outside of the throttle counts towards the budget.
+TEST_F(CompactionThrottleTest, SlowCompactionNotThrottled) {
+    config.maxBytesPerSec = CompactionThrottle::ChunkSize;
+    MockCompactionThrottle throttle(stats, config);
+
+    throttle.addBytes(CompactionThrottle::ChunkSize);
+    EXPECT_EQ(std::chrono::seconds(1), throttle.getThrottledTime());
+
+    // The next chunk took longer than the budget allows for
+    throttle.currentTime += std::chrono::seconds(3);
+    throttle.addBytes(CompactionThrottle::ChunkSize);
+    throttle.currentTime += std::chrono::seconds(3);
+    throttle.addBytes(CompactionThrottle::ChunkSize);
+
+    // The time saved isn't used to burst at full speed afterwards
+    throttle.addBytes(CompactionThrottle::ChunkSize);
+    EXPECT_EQ(std::chrono::seconds(2), throttle.getThrottledTime());
+}
+
+// Throttling sleeps in slices, and stops sleeping on shutdown.
+TEST_F(CompactionThrottleTest, ThrottleStopsOnShutdown) {
+    config.maxBytesPerSec = CompactionThrottle::ChunkSize / 10;
+    MockCompactionThrottle throttle(stats, config);
+    const auto start = throttle.currentTime;
+
+    int sleeps = 0;
+    throttle.sleepHook = [this, &sleeps]() {
+        if (++sleeps == 3) {
+            stats.isShutdown = true;
+        }
+    };
+
+    throttle.addBytes(CompactionThrottle::ChunkSize);
+    EXPECT_EQ(3, sleeps);
+    EXPECT_EQ(3 * CompactionThrottle::PauseInterval,
+              throttle.currentTime - start);
+    EXPECT_EQ(3 * CompactionThrottle::PauseInterval,
+              throttle.getThrottledTime());
+}
+
+// The compaction runs on a writer thread, so it isn't paused for a big disk
+// write queue (the flusher would need that thread to drain it).
+TEST_F(CompactionThrottleTest, NoPauseOnDiskQueue) {
+    config.maxPause = std::chrono::seconds(10);
+    MockCompactionThrottle throttle(stats, config);
+    stats.diskQueueSize = 1000000;
+
+    throttle.addBytes(CompactionThrottle::ChunkSize);
+    EXPECT_EQ(0u, throttle.getNumPauses());
+}
+
+// A pause never lasts longer than maxPause.
+TEST_F(CompactionThrottleTest, MaxPause) {
+    config.maxBgWait = std::chrono::microseconds(1000);
+    config.maxPause = std::chrono::milliseconds(100);
+    MockCompactionThrottle throttle(stats, config);
+
+    // The bg fetches keep on waiting too long
+    const auto slowBgFetches = [this]() {
+        stats.bgNumOperations += 10;
+        stats.bgWait += 10 * 5000;
+    };
+    slowBgFetches();
+    throttle.sleepHook = slowBgFetches;
+
+    throttle.addBytes(CompactionThrottle::ChunkSize);
+    EXPECT_EQ(std::chrono::milliseconds(100), throttle.getPausedTime());
+
+    // Every chunk is allowed through before pausing again
+    slowBgFetches();
+    throttle.addBytes(CompactionThrottle::ChunkSize);
+    EXPECT_EQ(2u, throttle.getNumPauses());
+    EXPECT_EQ(std::chrono::milliseconds(200), throttle.getPausedTime());
+}
+
+// Without maxPause the compaction is never paused.
+TEST_F(CompactionThrottleTest, PauseDisabled) {
+    config.maxBgWait = std::chrono::microseconds(1000);
+    MockCompactionThrottle throttle(stats, config);
+    stats.bgNumOperations = 10;
+    stats.bgWait = 10 * 5000;
+
+    throttle.addBytes(CompactionThrottle::ChunkSize);
+    EXPECT_EQ(0u, throttle.getNumPauses());
+}
+
+// The compaction is paused while the bg fetches wait too long.
+TEST_F(CompactionThrottleTest, PauseOnBgWait) {
+    config.maxBgWait = std::chrono::microseconds(1000);
+    config.maxPause = std::chrono::seconds(10);
+    MockCompactionThrottle throttle(stats, config);
+
+    // Only the bg fetches completed since the last check are considered
+    stats.bgNumOperations = 10;
+    stats.bgWait = 10 * 5000;
+    throttle.sleepHook = [this]() {
+        stats.bgNumOperations += 10;
+        stats.bgWait += 10 * 100;
+    };
+
+    throttle.addBytes(CompactionThrottle::ChunkSize);
+    EXPECT_EQ(1u, throttle.getNumPauses());
+    EXPECT_EQ(CompactionThrottle::PauseInterval, throttle.getPausedTime());
+
+    // No bg fetches at all isn't contention
+    throttle.sleepHook = nullptr;
+    throttle.addBytes(CompactionThrottle::ChunkSize);
+    EXPECT_EQ(1u, throttle.getNumPauses());
+}
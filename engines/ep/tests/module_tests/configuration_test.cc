@@ -94,6 +94,22 @@ TEST(SizeRangeValidatorTest, UnsignedBoundsWorks) {
     );
 }
 
+TEST(SizeRangeValidatorTest, AllowZero) {
+    SizeRangeValidator validator;
+    std::string key{"test_key"};
+
+    (&validator)->min(100)->max(1000)->allowZero();
+
+    EXPECT_NO_THROW(validator.validateSize(key, 0));
+    EXPECT_NO_THROW(validator.validateSize(key, 100));
+
+    CB_EXPECT_THROW_MSG(
+            validator.validateSize(key, 99),
+            std::range_error,
+            "Validation Error, test_key takes 0 or values between 100 and 1000 (Got: 99)"
+    );
+}
+
 TEST(SizeRangeValidatorTest, SignedBoundsWorks) {
     SizeRangeValidator validator;
     std::string key{"test_key"};
@@ -26,6 +26,8 @@
 
 #include <valgrind/valgrind.h>
 
+#include <limits>
+
 
 /* Return how many bytes the memory allocator has mapped in RAM - essentially
  * application-allocated bytes plus memory in allocators own data structures
@@ -338,6 +340,57 @@ TEST_P(DefragmenterTest, DISABLED_RefCountMemUsage) {
     EXPECT_LE(mem_used_after_defrag, mem_used_before_defrag);
 }
 
+/// Allocator utilisation query which reports every allocation as sparse.
+static allocation_utilization_t all_sparse(const void*) {
+    return ALLOCATION_UTILIZATION_SPARSE;
+}
+
+// Check that when the allocator reports allocations as being on sparse slabs
+// the defragmenter moves the StoredValues (as well as the values), and that
+// the documents are unchanged afterwards.
+TEST_P(DefragmenterTest, StoredValuesMovedWhenSparse) {
+    const size_t num_docs = 10;
+    setDocs(64, num_docs);
+
+    std::vector<const StoredValue*> before;
+    for (size_t i = 0; i < num_docs; i++) {
+        auto key = std::to_string(i);
+        before.push_back(vbucket->ht.find(
+                DocKey(key, DocNamespace::DefaultCollection),
+                TrackReference::No,
+                WantsDeleted::No));
+        ASSERT_NE(nullptr, before.back());
+    }
+
+    ALLOCATOR_HOOKS_API hooks = *get_mock_server_api()->alloc_hooks;
+    hooks.get_allocation_utilization = all_sparse;
+
+    PauseResumeVBAdapter prAdapter(std::make_unique<DefragmentVisitor>(
+            std::numeric_limits<uint8_t>::max(), 1024, &hooks));
+    prAdapter.visit(*vbucket);
+
+    auto& visitor = dynamic_cast<DefragmentVisitor&>(prAdapter.getHTVisitor());
+    EXPECT_EQ(num_docs, visitor.getVisitedCount());
+    EXPECT_EQ(num_docs, visitor.getStoredValueDefragCount());
+    // The CheckpointManager still references all of the values.
+    EXPECT_EQ(0, visitor.getDefragCount());
+    EXPECT_EQ(num_docs, vbucket->ht.getNumItems());
+
+    const std::string expected(64, 'x');
+    for (size_t i = 0; i < num_docs; i++) {
+        auto key = std::to_string(i);
+        auto* v = vbucket->ht.find(DocKey(key, DocNamespace::DefaultCollection),
+                                   TrackReference::No,
+                                   WantsDeleted::No);
+        ASSERT_NE(nullptr, v);
+        EXPECT_NE(before[i], v) << "StoredValue for key " << key
+                                << " not moved";
+        EXPECT_EQ(expected,
+                  std::string(v->getValue()->getData(),
+                              v->getValue()->valueSize()));
+    }
+}
+
 #if defined(HAVE_JEMALLOC)
 TEST_P(DefragmenterTest, MaxDefragValueSize) {
 #else
@@ -31,6 +31,8 @@
 #include "taskqueue.h"
 #include "tests/module_tests/test_helpers.h"
 #include "tests/module_tests/test_task.h"
+#include "tracing/trace_helpers.h"
+#include "warmup.h"
 
 #include <libcouchstore/couch_db.h>
 #include <string_utilities.h>
@@ -1716,6 +1718,47 @@ TEST_F(WarmupTest, MB_25197) {
     }
 }
 
+// Check that when each shard is scanned by multiple tasks, warmup still
+// loads all of the shard's vBuckets and reports the items loaded per phase.
+TEST_F(WarmupTest, MultipleTasksPerShard) {
+    const std::vector<uint16_t> vbids = {0, 1, 2, 3};
+    for (auto id : vbids) {
+        setVBucketStateAndRunPersistTask(id, vbucket_state_active);
+        store_item(id, makeStoredDocKey("key" + std::to_string(id)), "value");
+        flush_vbucket_to_disk(id);
+    }
+
+    // All of the vBuckets in a single shard, split over 3 tasks
+    config_string += ";max_num_shards=1;warmup_tasks_per_shard=3";
+    resetEngineAndWarmup();
+
+    for (auto id : vbids) {
+        auto key = makeStoredDocKey("key" + std::to_string(id));
+        auto gv = store->get(key, id, cookie, {});
+        EXPECT_EQ(ENGINE_SUCCESS, gv.getStatus()) << "vb:" << id;
+    }
+
+    struct StatMap : cb::tracing::Traceable {
+        std::map<std::string, std::string> map;
+    };
+    StatMap stats;
+    auto add_stats = [](const char* key,
+                        const uint16_t klen,
+                        const char* val,
+                        const uint32_t vlen,
+                        gsl::not_null<const void*> cookie) {
+        auto* stats =
+                reinterpret_cast<StatMap*>(const_cast<void*>(cookie.get()));
+        stats->map[std::string(key, klen)] = std::string(val, vlen);
+    };
+    engine->getKVBucket()->getWarmup()->addStats(add_stats, &stats);
+
+    EXPECT_EQ("4", stats.map["ep_warmup_key_dump_items"]);
+    EXPECT_NE(0, std::stoull(stats.map["ep_warmup_key_dump_bytes"]));
+    EXPECT_EQ(1, stats.map.count("ep_warmup_loading_data_items"));
+    EXPECT_EQ(0, stats.map.count("ep_warmup_loading_kv_pairs_items"));
+}
+
 // Test that we can push a DCP_DELETION which pretends to be from a delete
 // with xattrs, i.e. the delete has a value containing only system xattrs
 // The MB was created because this code would actually trigger an exception
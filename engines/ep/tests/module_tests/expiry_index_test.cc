@@ -0,0 +1,128 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2018 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "config.h"
+
+#include "expiry_index.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+
+/*
+ * Unit tests for the ExpiryIndex class.
+ */
+
+static StoredDocKey makeKey(const std::string& key) {
+    return StoredDocKey(key, DocNamespace::DefaultCollection);
+}
+
+// Keys are only taken once they are due (expiry time before now).
+TEST(ExpiryIndexTest, takeDue) {
+    ExpiryIndex index;
+    index.add(10, makeKey("a"));
+    index.add(20, makeKey("b"));
+    index.add(20, makeKey("c"));
+    index.add(30, makeKey("d"));
+    EXPECT_EQ(4, index.size());
+
+    EXPECT_TRUE(index.takeDue(10).empty());
+
+    auto due = index.takeDue(21);
+    ASSERT_EQ(3, due.size());
+    std::sort(due.begin(), due.end());
+    EXPECT_EQ(makeKey("a"), due[0]);
+    EXPECT_EQ(makeKey("b"), due[1]);
+    EXPECT_EQ(makeKey("c"), due[2]);
+    EXPECT_EQ(1, index.size());
+
+    EXPECT_TRUE(index.takeDue(21).empty());
+    due = index.takeDue(31);
+    ASSERT_EQ(1, due.size());
+    EXPECT_EQ(makeKey("d"), due[0]);
+    EXPECT_EQ(0, index.size());
+}
+
+// A key only ever has one entry; a new expiry time replaces the previous
+// one (whether earlier or later).
+TEST(ExpiryIndexTest, replace) {
+    ExpiryIndex index;
+    index.add(10, makeKey("a"));
+    index.add(10, makeKey("a"));
+    EXPECT_EQ(1, index.size());
+    index.add(20, makeKey("a"));
+    index.add(30, makeKey("b"));
+    EXPECT_EQ(2, index.size());
+
+    // "a" is no longer due at 10.
+    EXPECT_TRUE(index.takeDue(11).empty());
+
+    index.add(5, makeKey("b"));
+    auto due = index.takeDue(21);
+    ASSERT_EQ(2, due.size());
+    std::sort(due.begin(), due.end());
+    EXPECT_EQ(makeKey("a"), due[0]);
+    EXPECT_EQ(makeKey("b"), due[1]);
+    EXPECT_EQ(0, index.size());
+    EXPECT_TRUE(index.takeDue(100).empty());
+
+    // Once taken, a key may be added again.
+    index.add(50, makeKey("a"));
+    EXPECT_EQ(1, index.size());
+}
+
+TEST(ExpiryIndexTest, clear) {
+    ExpiryIndex index;
+    index.add(10, makeKey("a"));
+    index.add(20, makeKey("b"));
+    index.clear();
+    EXPECT_EQ(0, index.size());
+    EXPECT_TRUE(index.takeDue(100).empty());
+}
+
+// Removing a key drops its entry, so it is never returned as due.
+TEST(ExpiryIndexTest, remove) {
+    ExpiryIndex index;
+    EXPECT_TRUE(index.add(10, makeKey("a")));
+    EXPECT_TRUE(index.add(10, makeKey("b")));
+    EXPECT_FALSE(index.add(20, makeKey("b")));
+    EXPECT_FALSE(index.remove(makeKey("c")));
+
+    EXPECT_TRUE(index.remove(makeKey("a")));
+    EXPECT_FALSE(index.remove(makeKey("a")));
+    EXPECT_EQ(1, index.size());
+
+    EXPECT_TRUE(index.remove(makeKey("b")));
+    EXPECT_TRUE(index.empty());
+    EXPECT_TRUE(index.takeDue(100).empty());
+}
+
+// takeAll returns every entry with its expiry time and empties the index.
+TEST(ExpiryIndexTest, takeAll) {
+    ExpiryIndex index;
+    index.add(10, makeKey("a"));
+    index.add(20, makeKey("b"));
+
+    auto all = index.takeAll();
+    EXPECT_TRUE(index.empty());
+    ASSERT_EQ(2, all.size());
+    std::sort(all.begin(), all.end());
+    EXPECT_EQ(10, all[0].first);
+    EXPECT_EQ(makeKey("a"), all[0].second);
+    EXPECT_EQ(20, all[1].first);
+    EXPECT_EQ(makeKey("b"), all[1].second);
+}
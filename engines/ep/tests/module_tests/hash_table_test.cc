@@ -17,6 +17,7 @@
 
 #include "config.h"
 
+#include "ep_time.h"
 #include "item.h"
 #include "kv_bucket.h"
 #include "programs/engine_testapp/mock_server.h"
@@ -310,6 +311,40 @@ TEST_F(HashTableTest, AutoResize) {
     verifyFound(h, keys);
 }
 
+// Check that pre-sizing the table for a number of items picks the same size
+// as resize() would once the items are present.
+TEST_F(HashTableTest, ResizeForItemCount) {
+    HashTable h(global_stats, makeFactory(), 5, 3);
+
+    h.resizeForItemCount(1000);
+    EXPECT_EQ(769, h.getSize());
+
+    auto keys = generateKeys(1000);
+    storeMany(h, keys);
+    verifyFound(h, keys);
+
+    h.resize();
+    EXPECT_EQ(769, h.getSize());
+}
+
+// grow() keeps a pre-sized table (e.g. during warmup) until it is too small.
+TEST_F(HashTableTest, GrowOnly) {
+    HashTable h(global_stats, makeFactory(), 5, 3);
+
+    h.resizeForItemCount(1000);
+    ASSERT_EQ(769, h.getSize());
+    h.grow();
+    EXPECT_EQ(769, h.getSize());
+
+    h.resize();
+    ASSERT_EQ(5, h.getSize());
+    auto keys = generateKeys(1000);
+    storeMany(h, keys);
+    h.grow();
+    EXPECT_EQ(769, h.getSize());
+    verifyFound(h, keys);
+}
+
 TEST_F(HashTableTest, DepthCounting) {
     HashTable h(global_stats, makeFactory(), 5, 1);
     const int nkeys = 5000;
@@ -868,3 +903,255 @@ TEST_F(HashTableTest, PauseResumeHashBucket) {
     HashTable::Position start;
     ht.pauseResumeVisit(mockVisitor, start);
 }
+
+// Non-resident items can have their metadata demoted to the cold metadata
+// blocks; they remain counted, survive a resize and are promoted back to
+// (non-resident) StoredValues when looked up.
+TEST_F(HashTableTest, DemoteColdMetadata) {
+    HashTable ht(global_stats, makeFactory(), 5, 1);
+    auto keys = generateKeys(20);
+    int64_t seqno = 1;
+    for (const auto& key : keys) {
+        Item item(key, 0, 0, key.data(), key.size());
+        item.setBySeqno(seqno++);
+        ASSERT_EQ(MutationStatus::WasClean, ht.set(item));
+    }
+
+    for (const auto& key : keys) {
+        auto hbl = ht.getLockedBucket(key);
+        StoredValue* v = ht.unlocked_find(
+                key, hbl.getBucketNum(), WantsDeleted::No, TrackReference::No);
+        ASSERT_TRUE(v);
+        v->markClean();
+        // Only non-resident items can be demoted.
+        EXPECT_FALSE(ht.unlocked_demote(hbl, *v));
+        ASSERT_TRUE(ht.unlocked_ejectItem(v, VALUE_ONLY));
+        EXPECT_TRUE(ht.unlocked_demote(hbl, *v));
+    }
+
+    EXPECT_EQ(keys.size(), ht.getNumColdItems());
+    EXPECT_EQ(keys.size(), ht.getNumItems());
+    EXPECT_EQ(keys.size(), ht.getNumInMemoryNonResItems());
+    EXPECT_NE(0, ht.getColdMetaDataMemory());
+
+    ht.resize(47);
+
+    seqno = 1;
+    for (const auto& key : keys) {
+        StoredValue* v = ht.find(key, TrackReference::No, WantsDeleted::No);
+        ASSERT_TRUE(v) << "Cold item not found after resize";
+        EXPECT_FALSE(v->isResident());
+        EXPECT_FALSE(v->isDirty());
+        EXPECT_EQ(seqno++, v->getBySeqno());
+    }
+
+    EXPECT_EQ(0, ht.getNumColdItems());
+    EXPECT_EQ(0, ht.getColdMetaDataMemory());
+    EXPECT_EQ(keys.size(), ht.getNumItems());
+    EXPECT_EQ(keys.size(), ht.getNumInMemoryNonResItems());
+}
+
+// Demoting a batch of items only demotes those which are (still) eligible,
+// and the demoted items are promoted back when looked up.
+TEST_F(HashTableTest, DemoteColdMetadataBatch) {
+    HashTable ht(global_stats, makeFactory(), 47, 3);
+    auto keys = generateKeys(40);
+    int64_t seqno = 1;
+    for (const auto& key : keys) {
+        Item item(key, 0, 0, key.data(), key.size());
+        item.setBySeqno(seqno++);
+        ASSERT_EQ(MutationStatus::WasClean, ht.set(item));
+        auto hbl = ht.getLockedBucket(key);
+        StoredValue* v = ht.unlocked_find(
+                key, hbl.getBucketNum(), WantsDeleted::No, TrackReference::No);
+        ASSERT_TRUE(v);
+        v->markClean();
+    }
+
+    // Eject the values of the first half of the items only.
+    const size_t cold = keys.size() / 2;
+    for (size_t ii = 0; ii < cold; ++ii) {
+        auto hbl = ht.getLockedBucket(keys[ii]);
+        StoredValue* v = ht.unlocked_find(keys[ii],
+                                          hbl.getBucketNum(),
+                                          WantsDeleted::No,
+                                          TrackReference::No);
+        ASSERT_TRUE(ht.unlocked_ejectItem(v, VALUE_ONLY));
+    }
+
+    auto batch = keys;
+    batch.push_back(makeStoredDocKey("missing"));
+    EXPECT_EQ(cold, ht.demote(batch));
+    EXPECT_EQ(cold, ht.getNumColdItems());
+    EXPECT_EQ(keys.size(), ht.getNumItems());
+
+    // Items which are already cold aren't demoted again.
+    EXPECT_EQ(0, ht.demote(batch));
+    EXPECT_EQ(cold, ht.getNumColdItems());
+
+    for (size_t ii = 0; ii < keys.size(); ++ii) {
+        StoredValue* v =
+                ht.find(keys[ii], TrackReference::No, WantsDeleted::No);
+        ASSERT_TRUE(v);
+        EXPECT_EQ(ii >= cold, v->isResident());
+        EXPECT_EQ(int64_t(ii + 1), v->getBySeqno());
+    }
+    EXPECT_EQ(0, ht.getNumColdItems());
+    EXPECT_EQ(0, ht.getColdMetaDataMemory());
+}
+
+// Only the items due to expire are visited through the expiry index, and
+// the entries of deleted items are removed.
+TEST_F(HashTableTest, VisitExpired) {
+    HashTable ht(global_stats, makeFactory(), 5, 1);
+    ht.setExpiryIndexEnabled(true);
+    auto keys = generateKeys(10);
+    for (size_t ii = 0; ii < keys.size(); ++ii) {
+        // Keys 0-4 expire at times 100-104; keys 5-9 don't expire.
+        const time_t exptime = ii < 5 ? 100 + ii : 0;
+        Item item(keys[ii], 0, exptime, keys[ii].data(), keys[ii].size());
+        ASSERT_EQ(MutationStatus::WasClean, ht.set(item));
+    }
+    EXPECT_EQ(5, ht.getExpiryIndexSize());
+
+    // Setting the same item again doesn't add another entry.
+    Item again(keys[0], 0, 100, keys[0].data(), keys[0].size());
+    ASSERT_EQ(MutationStatus::WasDirty, ht.set(again));
+    EXPECT_EQ(5, ht.getExpiryIndexSize());
+
+    // Nor does pushing an item's expiry time back (e.g. a touch); its
+    // entry is replaced.
+    Item later(keys[4], 0, 110, keys[4].data(), keys[4].size());
+    ASSERT_EQ(MutationStatus::WasDirty, ht.set(later));
+    EXPECT_EQ(5, ht.getExpiryIndexSize());
+
+    ASSERT_TRUE(del(ht, keys[1]));
+    EXPECT_EQ(4, ht.getExpiryIndexSize());
+
+    // Items expiring at 100-102 are due at 103; key1 has gone.
+    Counter counter(false);
+    ht.visitExpired(counter, 103);
+    EXPECT_EQ(2, counter.count);
+    EXPECT_EQ(2, ht.getExpiryIndexSize());
+
+    counter.count = 0;
+    ht.visitExpired(counter, 103);
+    EXPECT_EQ(0, counter.count);
+
+    ht.visitExpired(counter, 1000);
+    EXPECT_EQ(2, counter.count);
+    EXPECT_EQ(0, ht.getExpiryIndexSize());
+}
+
+// Clearing an item's expiry time removes its entry.
+TEST_F(HashTableTest, ExpiryIndexClearedTtl) {
+    HashTable ht(global_stats, makeFactory(), 5, 1);
+    ht.setExpiryIndexEnabled(true);
+    StoredDocKey key = makeStoredDocKey("key");
+    Item item(key, 0, 100, key.data(), key.size());
+    ASSERT_EQ(MutationStatus::WasClean, ht.set(item));
+    EXPECT_EQ(1, ht.getExpiryIndexSize());
+
+    Item persistent(key, 0, 0, key.data(), key.size());
+    ASSERT_EQ(MutationStatus::WasDirty, ht.set(persistent));
+    EXPECT_EQ(0, ht.getExpiryIndexSize());
+
+    Counter counter(false);
+    ht.visitExpired(counter, 1000);
+    EXPECT_EQ(0, counter.count);
+}
+
+// The expiry index is split by hash table lock; its entries follow their
+// items to the lock of their new hash bucket on resize.
+TEST_F(HashTableTest, ExpiryIndexResize) {
+    HashTable ht(global_stats, makeFactory(), 5, 3);
+    ht.setExpiryIndexEnabled(true);
+    auto keys = generateKeys(20);
+    for (const auto& key : keys) {
+        Item item(key, 0, 100, key.data(), key.size());
+        ASSERT_EQ(MutationStatus::WasClean, ht.set(item));
+    }
+    EXPECT_EQ(keys.size(), ht.getExpiryIndexSize());
+
+    ht.resize(47);
+    EXPECT_EQ(keys.size(), ht.getExpiryIndexSize());
+
+    // Each entry must now be removable under its item's new lock.
+    for (size_t ii = 0; ii < keys.size() / 2; ++ii) {
+        ASSERT_TRUE(del(ht, keys[ii]));
+    }
+    EXPECT_EQ(keys.size() / 2, ht.getExpiryIndexSize());
+
+    Counter counter(false);
+    ht.visitExpired(counter, 1000);
+    EXPECT_EQ(keys.size() / 2, counter.count);
+    EXPECT_EQ(0, ht.getExpiryIndexSize());
+}
+
+// The expiry index is only maintained while enabled; it is cleared when
+// disabled, and rebuilt from the existing items when enabled again.
+TEST_F(HashTableTest, ExpiryIndexEnable) {
+    HashTable ht(global_stats, makeFactory(), 5, 1);
+    auto keys = generateKeys(4);
+    for (const auto& key : keys) {
+        Item item(key, 0, 100, key.data(), key.size());
+        ASSERT_EQ(MutationStatus::WasClean, ht.set(item));
+    }
+    EXPECT_EQ(0, ht.getExpiryIndexSize());
+
+    ht.setExpiryIndexEnabled(true);
+    EXPECT_EQ(keys.size(), ht.getExpiryIndexSize());
+
+    ht.setExpiryIndexEnabled(false);
+    EXPECT_EQ(0, ht.getExpiryIndexSize());
+
+    Item item(keys[0], 0, 200, keys[0].data(), keys[0].size());
+    ASSERT_EQ(MutationStatus::WasDirty, ht.set(item));
+    EXPECT_EQ(0, ht.getExpiryIndexSize());
+}
+
+// An item with an expiry time which is restored by a bgfetch (full
+// eviction) replaces the entry of the temp item it was fetched into.
+TEST_F(HashTableTest, ExpiryIndexRestoreValue) {
+    HashTable ht(global_stats, makeFactory(), 5, 1);
+    ht.setExpiryIndexEnabled(true);
+    StoredDocKey key = makeStoredDocKey("key");
+    const time_t now = ep_real_time();
+
+    Item tempInitItem(key,
+                      0,
+                      0,
+                      nullptr,
+                      0,
+                      PROTOCOL_BINARY_RAW_BYTES,
+                      0,
+                      StoredValue::state_temp_init);
+    Item item(key,
+              0,
+              now + 100,
+              key.data(),
+              key.size(),
+              PROTOCOL_BINARY_RAW_BYTES,
+              0,
+              /*bySeqno*/ 10);
+    {
+        auto hbl = ht.getLockedBucket(key);
+        auto* sv = ht.unlocked_addNewStoredValue(hbl, tempInitItem);
+        ASSERT_NE(nullptr, sv);
+        EXPECT_EQ(1, ht.getExpiryIndexSize());
+
+        EXPECT_TRUE(ht.unlocked_restoreValue(hbl.getHTLock(), item, *sv));
+    }
+    EXPECT_EQ(1, ht.getExpiryIndexSize());
+
+    // Not visited when the temp item would have been due ...
+    Counter counter(false);
+    ht.visitExpired(counter, now + 1);
+    EXPECT_EQ(0, counter.count);
+    EXPECT_EQ(1, ht.getExpiryIndexSize());
+
+    // ... but when the restored item expires.
+    ht.visitExpired(counter, now + 101);
+    EXPECT_EQ(1, counter.count);
+    EXPECT_EQ(0, ht.getExpiryIndexSize());
+}
@@ -0,0 +1,96 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2018 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "config.h"
+
+#include "item_eviction.h"
+
+#include <gtest/gtest.h>
+
+/*
+ * Unit tests for the ItemEviction class.
+ */
+
+// With no values in the histogram nothing should be evicted.
+TEST(ItemEvictionTest, emptyHistogram) {
+    ItemEviction itemEv;
+    itemEv.updateThreshold(0.5);
+    EXPECT_EQ(0, itemEv.getFreqThreshold());
+    EXPECT_FALSE(itemEv.shouldEvict(0, 0.0));
+}
+
+// The threshold is only recomputed for every value during the learning
+// phase, and then every requiredToUpdateInterval values.
+TEST(ItemEvictionTest, updateRequired) {
+    ItemEviction itemEv;
+    for (size_t ii = 0; ii < ItemEviction::learningPopulation; ++ii) {
+        itemEv.addValueToFreqHistogram(uint8_t(ii));
+        EXPECT_TRUE(itemEv.isUpdateRequired());
+    }
+    itemEv.addValueToFreqHistogram(0);
+    EXPECT_FALSE(itemEv.isUpdateRequired());
+    while (itemEv.getFreqHistogramValueCount() %
+                   ItemEviction::requiredToUpdateInterval !=
+           0) {
+        itemEv.addValueToFreqHistogram(0);
+    }
+    EXPECT_TRUE(itemEv.isUpdateRequired());
+}
+
+// Items below the threshold are always evicted, items above never are.
+TEST(ItemEvictionTest, threshold) {
+    ItemEviction itemEv;
+    // 100 values, 0..99
+    for (int ii = 0; ii < 100; ++ii) {
+        itemEv.addValueToFreqHistogram(uint8_t(ii));
+    }
+    itemEv.updateThreshold(0.25);
+    EXPECT_EQ(24, itemEv.getFreqThreshold());
+    EXPECT_TRUE(itemEv.shouldEvict(0, 0.99));
+    EXPECT_TRUE(itemEv.shouldEvict(23, 0.99));
+    EXPECT_TRUE(itemEv.shouldEvict(24, 0.5));
+    EXPECT_FALSE(itemEv.shouldEvict(25, 0.0));
+    EXPECT_FALSE(itemEv.shouldEvict(255, 0.0));
+}
+
+// When all items have the same counter value (e.g. after warmup) they should
+// be evicted with the requested probability, not all at once.
+TEST(ItemEvictionTest, sameValue) {
+    ItemEviction itemEv;
+    for (int ii = 0; ii < 1000; ++ii) {
+        itemEv.addValueToFreqHistogram(ItemEviction::initialFreqCount);
+    }
+    itemEv.updateThreshold(0.1);
+    EXPECT_EQ(ItemEviction::initialFreqCount, itemEv.getFreqThreshold());
+    EXPECT_TRUE(itemEv.shouldEvict(ItemEviction::initialFreqCount, 0.05));
+    EXPECT_FALSE(itemEv.shouldEvict(ItemEviction::initialFreqCount, 0.15));
+}
+
+// Evicting everything should evict the hottest item too, and reset clears
+// the distribution.
+TEST(ItemEvictionTest, evictAllAndReset) {
+    ItemEviction itemEv;
+    itemEv.addValueToFreqHistogram(1);
+    itemEv.addValueToFreqHistogram(255);
+    itemEv.updateThreshold(1.0);
+    EXPECT_TRUE(itemEv.shouldEvict(255, 0.99));
+
+    itemEv.reset();
+    EXPECT_EQ(0, itemEv.getFreqHistogramValueCount());
+    itemEv.updateThreshold(1.0);
+    EXPECT_FALSE(itemEv.shouldEvict(255, 0.0));
+}
@@ -294,6 +294,31 @@ TEST_P(STItemPagerTest, ServerQuotaReached) {
     }
 }
 
+// Test that items are also successfully paged out when the ItemPager uses the
+// frequency based (hifi_mfu) eviction policy.
+TEST_P(STItemPagerTest, ServerQuotaReachedHifiMfu) {
+    if (std::get<1>(GetParam()) == "fail_new_data") {
+        // Items are never paged out of fail_new_data buckets.
+        return;
+    }
+    engine->getConfiguration().setHtEvictionPolicy("hifi_mfu");
+
+    size_t count = populateUntilTmpFail(vbid);
+    ASSERT_GE(count, 50) << "Too few documents stored";
+
+    auto& stats = engine->getEpStats();
+    const auto memUsedBefore = stats.getTotalMemoryUsed();
+
+    runHighMemoryPager();
+
+    auto vb = engine->getVBucket(vbid);
+    EXPECT_LT(stats.getTotalMemoryUsed(), memUsedBefore)
+            << "Expected memory usage to drop after running item pager";
+    const auto numResidentItems =
+            vb->getNumItems() - vb->getNumNonResidentItems();
+    EXPECT_LT(numResidentItems, count);
+}
+
 TEST_P(STItemPagerTest, HighWaterMarkTriggersPager) {
     // Fill to just over HWM
     populateUntilAboveHighWaterMark(vbid);
@@ -1138,6 +1138,109 @@ TEST_F(StoreIfTest, store_if_basic) {
     EXPECT_EQ(cb::engine_errc::predicate_failed, rv.status);
 }
 
+class UpdateInPlaceTest : public StoreIfTest {
+public:
+    /// Mutator appending "-updated" to the current value
+    cb::InPlaceMutator appendMutator() {
+        return [this](const item_info& current,
+                      cb::const_char_buffer& value,
+                      protocol_binary_datatype_t& datatype) {
+            ++calls;
+            newValue.assign(static_cast<const char*>(current.value[0].iov_base),
+                            current.value[0].iov_len);
+            newValue.append("-updated");
+            value = {newValue.data(), newValue.size()};
+            datatype = PROTOCOL_BINARY_RAW_BYTES;
+            return cb::engine_errc::success;
+        };
+    }
+
+    std::string getValue(const DocKey& key) {
+        auto gv = store->get(key, vbid, cookie, QUEUE_BG_FETCH);
+        EXPECT_EQ(ENGINE_SUCCESS, gv.getStatus());
+        return {gv.item->getData(), gv.item->getNBytes()};
+    }
+
+    std::string newValue;
+    int calls = 0;
+};
+
+TEST_F(UpdateInPlaceTest, Update) {
+    auto key = makeStoredDocKey("key");
+    auto item = store_item(vbid, key, "value");
+
+    uint64_t cas = 0;
+    mutation_descr_t mut_info = {};
+    EXPECT_EQ(ENGINE_SUCCESS,
+              engine->updateInPlace(
+                      cookie, key, vbid, cas, 0, appendMutator(), mut_info));
+    EXPECT_EQ(1, calls);
+    EXPECT_NE(0u, cas);
+    EXPECT_NE(item.getCas(), cas);
+    EXPECT_EQ(item.getBySeqno() + 1, int64_t(mut_info.seqno));
+    EXPECT_EQ("value-updated", getValue(key));
+
+    // A matching CAS is accepted
+    EXPECT_EQ(ENGINE_SUCCESS,
+              engine->updateInPlace(
+                      cookie, key, vbid, cas, 0, appendMutator(), mut_info));
+    EXPECT_EQ("value-updated-updated", getValue(key));
+}
+
+TEST_F(UpdateInPlaceTest, CasMismatch) {
+    auto key = makeStoredDocKey("key");
+    auto item = store_item(vbid, key, "value");
+
+    uint64_t cas = item.getCas() + 1;
+    mutation_descr_t mut_info = {};
+    EXPECT_EQ(ENGINE_KEY_EEXISTS,
+              engine->updateInPlace(
+                      cookie, key, vbid, cas, 0, appendMutator(), mut_info));
+    EXPECT_EQ(0, calls);
+    EXPECT_EQ("value", getValue(key));
+}
+
+TEST_F(UpdateInPlaceTest, MutatorFailure) {
+    auto key = makeStoredDocKey("key");
+    store_item(vbid, key, "value");
+
+    uint64_t cas = 0;
+    mutation_descr_t mut_info = {};
+    EXPECT_EQ(ENGINE_FAILED,
+              engine->updateInPlace(cookie,
+                                    key,
+                                    vbid,
+                                    cas,
+                                    0,
+                                    [](const item_info&,
+                                       cb::const_char_buffer&,
+                                       protocol_binary_datatype_t&) {
+                                        return cb::engine_errc::failed;
+                                    },
+                                    mut_info));
+    EXPECT_EQ("value", getValue(key));
+}
+
+// Anything we can't update under the hash bucket lock is left for the
+// caller to deal with
+TEST_F(UpdateInPlaceTest, NotSupported) {
+    uint64_t cas = 0;
+    mutation_descr_t mut_info = {};
+    auto key = makeStoredDocKey("missing");
+    EXPECT_EQ(ENGINE_ENOTSUP,
+              engine->updateInPlace(
+                      cookie, key, vbid, cas, 0, appendMutator(), mut_info));
+
+    key = makeStoredDocKey("locked");
+    store_item(vbid, key, "value");
+    auto gv = store->getLocked(key, vbid, ep_current_time(), 10, cookie);
+    ASSERT_EQ(ENGINE_SUCCESS, gv.getStatus());
+    EXPECT_EQ(ENGINE_ENOTSUP,
+              engine->updateInPlace(
+                      cookie, key, vbid, cas, 0, appendMutator(), mut_info));
+    EXPECT_EQ(0, calls);
+}
+
 class ExpiryLimitTest : public KVBucketTest {
 public:
     void SetUp() override {
@@ -54,6 +54,15 @@ extern "C" {
     static size_t mock_get_allocation_size(const void*) {
         return 0;
     }
+
+    static allocation_utilization_t mock_get_allocation_utilization(
+            const void*) {
+        return ALLOCATION_UTILIZATION_UNKNOWN;
+    }
+
+    static bool mock_acquire_arena(unsigned*) {
+        return false;
+    }
 }
 
 ALLOCATOR_HOOKS_API* getHooksApi(void) {
@@ -65,5 +74,7 @@ ALLOCATOR_HOOKS_API* getHooksApi(void) {
     hooksApi.get_extra_stats_size = mock_get_extra_stats_size;
     hooksApi.get_allocator_stats = mock_get_allocator_stats;
     hooksApi.get_allocation_size = mock_get_allocation_size;
+    hooksApi.get_allocation_utilization = mock_get_allocation_utilization;
+    hooksApi.acquire_arena = mock_acquire_arena;
     return &hooksApi;
 }
@@ -506,6 +506,85 @@ TEST_F(MutationLogTest, BatchLoad) {
     }
 }
 
+// Test that keys sharing a prefix are read back intact when the log is
+// prefix compressed, including across block boundaries.
+TEST_F(MutationLogTest, PrefixCompressedKeys) {
+    const size_t items = 1000;
+    std::vector<std::string> keys;
+    {
+        MutationLog ml(tmp_log_filename.c_str());
+        ml.open();
+        for (size_t ii = 0; ii < items; ii++) {
+            keys.push_back("user::profile::" + std::to_string(ii));
+            ml.newItem(0, makeStoredDocKey(keys.back()), ii + 1);
+        }
+        // Also a key with nothing in common with the previous one
+        keys.push_back("k");
+        ml.newItem(0, makeStoredDocKey(keys.back()), items + 1);
+        ml.commit1();
+        ml.commit2();
+
+        // Should need fewer blocks than the uncompressed entries would
+        EXPECT_LT(ml.logSize,
+                  items * MutationLogEntry::len(keys.front().size()));
+    }
+
+    MutationLog ml(tmp_log_filename.c_str());
+    ml.open();
+    EXPECT_EQ(MutationLogVersion::V3, ml.header().version());
+    size_t ii = 0;
+    for (const auto& entry : ml) {
+        if (entry->type() != MutationLogType::New) {
+            continue;
+        }
+        ASSERT_LT(ii, keys.size());
+        EXPECT_EQ(0, entry->getPrefixLen());
+        EXPECT_EQ(ii + 1, entry->seqno());
+        EXPECT_EQ(makeStoredDocKey(keys[ii]), StoredDocKey(entry->key()));
+        ++ii;
+    }
+    EXPECT_EQ(keys.size(), ii);
+}
+
+static bool orderedLoaderFun(void* arg, uint16_t vb, const DocKey& k) {
+    auto* keys = reinterpret_cast<std::vector<StoredDocKey>*>(arg);
+    keys[vb].push_back(k);
+    return true;
+}
+
+// Test that the harvester applies the keys of each vBucket in seqno order,
+// regardless of the order they were logged in.
+TEST_F(MutationLogTest, ApplyInSeqnoOrder) {
+    {
+        MutationLog ml(tmp_log_filename.c_str());
+        ml.open();
+        ml.newItem(0, makeStoredDocKey("a"), 30);
+        ml.newItem(1, makeStoredDocKey("b"), 5);
+        ml.newItem(0, makeStoredDocKey("c"), 10);
+        ml.newItem(0, makeStoredDocKey("d"), 20);
+        ml.newItem(1, makeStoredDocKey("e"), 1);
+        ml.commit1();
+        ml.commit2();
+    }
+
+    MutationLog ml(tmp_log_filename.c_str());
+    ml.open();
+    MutationLogHarvester h(ml);
+    h.setVBucket(0);
+    h.setVBucket(1);
+    EXPECT_EQ(ml.end(), h.loadBatch(ml.begin(), 0));
+
+    std::vector<StoredDocKey> keys[2];
+    h.apply(&keys, orderedLoaderFun);
+    EXPECT_EQ(std::vector<StoredDocKey>({makeStoredDocKey("c"),
+                                         makeStoredDocKey("d"),
+                                         makeStoredDocKey("a")}),
+              keys[0]);
+    EXPECT_EQ(std::vector<StoredDocKey>(
+                      {makeStoredDocKey("e"), makeStoredDocKey("b")}),
+              keys[1]);
+}
+
 // @todo
 //   Test Read Only log
 //   Test close / open / close / open
@@ -24,6 +24,10 @@
 #include "tests/mock/mock_synchronous_ep_engine.h"
 
 #include <gtest/gtest.h>
+#include <memcached/allocator_hooks.h>
+
+#include <utility>
+#include <vector>
 
 class ObjectRegistryTest : public ::testing::Test {
 protected:
@@ -40,25 +44,84 @@ protected:
 // Check that constructing & destructing an Item is correctly tracked in
 // EpStats::numItem via ObjectRegistry::on{Create,Delete}Item.
 TEST_F(ObjectRegistryTest, NumItem) {
-    ASSERT_EQ(0, *engine.getEpStats().numItem);
+    ASSERT_EQ(0, engine.getEpStats().numItem.load());
 
     {
         auto item = make_item(0, makeStoredDocKey("key"), "value");
-        EXPECT_EQ(1, *engine.getEpStats().numItem);
+        EXPECT_EQ(1, engine.getEpStats().numItem.load());
     }
-    EXPECT_EQ(0, *engine.getEpStats().numItem);
+    EXPECT_EQ(0, engine.getEpStats().numItem.load());
 }
 
 // Check that constructing & destructing an Item is correctly tracked in
 // EpStats::memOverhead via ObjectRegistry::on{Create,Delete}Item.
 TEST_F(ObjectRegistryTest, MemOverhead) {
-    ASSERT_EQ(0, *engine.getEpStats().memOverhead);
+    ASSERT_EQ(0, engine.getEpStats().memOverhead.load());
 
     {
         auto item = make_item(0, makeStoredDocKey("key"), "value");
         // Currently just checking the overhead is non-zero; could expand
         // to calculate expected size based on the Item's size.
-        EXPECT_NE(0, *engine.getEpStats().memOverhead);
+        EXPECT_NE(0, engine.getEpStats().memOverhead.load());
     }
-    EXPECT_EQ(0, *engine.getEpStats().memOverhead);
+    EXPECT_EQ(0, engine.getEpStats().memOverhead.load());
+}
+
+// The calls made to the set_thread_arena hook
+static std::vector<std::pair<unsigned, bool>> arenaSwitches;
+
+extern "C" {
+static size_t mockGetAllocSize(const void*) {
+    return 0;
+}
+
+static bool mockSetThreadArena(unsigned arena, bool flush_thread_cache) {
+    arenaSwitches.emplace_back(arena, flush_thread_cache);
+    return true;
+}
+}
+
+// Check that a thread is moved onto (and off) the arena of an engine with
+// its own arena, and that its cache is only flushed when moving between
+// buckets.
+TEST_F(ObjectRegistryTest, SwitchArena) {
+    ObjectRegistry::onSwitchThread(nullptr);
+    ObjectRegistry::initialize(mockGetAllocSize, mockSetThreadArena);
+    arenaSwitches.clear();
+
+    SynchronousEPEngine other;
+    engine.getEpStats().arena = 1;
+    engine.getEpStats().arenaMemoryTracking = true;
+    other.getEpStats().arena = 2;
+    other.getEpStats().arenaMemoryTracking = true;
+
+    ObjectRegistry::onSwitchThread(&engine);
+    ObjectRegistry::onSwitchThread(&engine);
+    ObjectRegistry::onSwitchThread(nullptr);
+    ObjectRegistry::onSwitchThread(&engine);
+    ObjectRegistry::onSwitchThread(&other);
+    ObjectRegistry::onSwitchThread(nullptr);
+
+    // A bucket without an arena of its own uses the default arena.
+    other.getEpStats().arenaMemoryTracking = false;
+    ObjectRegistry::onSwitchThread(&other);
+    ObjectRegistry::onSwitchThread(&engine);
+    ObjectRegistry::onSwitchThread(nullptr);
+    ObjectRegistry::useDefaultArena();
+    ObjectRegistry::useDefaultArena();
+
+    const std::vector<std::pair<unsigned, bool>> expected = {
+            {1, true},
+            {ALLOCATOR_DEFAULT_ARENA, false},
+            {1, false},
+            {2, true},
+            {ALLOCATOR_DEFAULT_ARENA, false},
+            {1, true},
+            {ALLOCATOR_DEFAULT_ARENA, false},
+            {ALLOCATOR_DEFAULT_ARENA, true}};
+    EXPECT_EQ(expected, arenaSwitches);
+
+    engine.getEpStats().arenaMemoryTracking = false;
+    other.getEpStats().arenaMemoryTracking = false;
+    ObjectRegistry::reset();
 }
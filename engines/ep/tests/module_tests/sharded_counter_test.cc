@@ -0,0 +1,84 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2018 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "config.h"
+
+#include "sharded_counter.h"
+
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+/*
+ * Unit tests for the ShardedCounter class.
+ */
+
+TEST(ShardedCounterTest, basic) {
+    ShardedCounter counter;
+    EXPECT_EQ(0, counter.load());
+
+    counter.fetch_add(10);
+    ++counter;
+    counter++;
+    EXPECT_EQ(12, counter.load());
+
+    counter.fetch_sub(5);
+    --counter;
+    EXPECT_EQ(6, counter.load());
+
+    counter = 100;
+    EXPECT_EQ(100, counter.load());
+    EXPECT_EQ(100, size_t(counter));
+}
+
+// Updates made by many threads all end up in the total.
+TEST(ShardedCounterTest, multipleThreads) {
+    ShardedCounter counter;
+    const size_t numThreads = ShardedCounter::NumShards * 2;
+    const size_t numOps = 10000;
+
+    std::vector<std::thread> threads;
+    for (size_t ii = 0; ii < numThreads; ++ii) {
+        threads.emplace_back([&counter, numOps]() {
+            for (size_t jj = 0; jj < numOps; ++jj) {
+                counter.fetch_add(3);
+                counter.fetch_sub(1);
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    EXPECT_EQ(numThreads * numOps * 2, counter.load());
+}
+
+// A value added by one thread and subtracted by another leaves the total
+// unchanged (even though the individual shards don't balance), and the
+// total is never reported as negative.
+TEST(ShardedCounterTest, crossThread) {
+    ShardedCounter counter;
+    counter.fetch_add(10);
+
+    std::thread other([&counter]() { counter.fetch_sub(10); });
+    other.join();
+    EXPECT_EQ(0, counter.load());
+
+    std::thread under([&counter]() { counter.fetch_sub(1); });
+    under.join();
+    EXPECT_EQ(0, counter.load());
+}
@@ -0,0 +1,125 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2018 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "config.h"
+
+#include "sharded_rwlock.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+/*
+ * Unit tests for the ShardedRWLock class.
+ */
+
+/// Exposes the shard assignment of ShardedRWLock
+class MockShardedRWLock : public ShardedRWLock {
+public:
+    using ShardedRWLock::getThreadShard;
+};
+
+/// How long to wait before checking that a thread is (still) blocked
+static const auto blockedWait = std::chrono::milliseconds(20);
+
+static const size_t numShards = ShardedRWLock::NumShards;
+
+// A writer excludes the readers of every shard.
+TEST(ShardedRWLockTest, writerExcludesReaders) {
+    ShardedRWLock lock;
+    std::unique_lock<ShardedRWLock> wlh(lock);
+
+    // Enough threads for every shard to have a reader.
+    std::atomic<size_t> readers{0};
+    std::vector<std::thread> threads;
+    for (size_t ii = 0; ii < numShards; ++ii) {
+        threads.emplace_back([&lock, &readers]() {
+            std::unique_lock<cb::ReaderLock> rlh(lock.getReaderShard());
+            ++readers;
+        });
+    }
+
+    std::this_thread::sleep_for(blockedWait);
+    EXPECT_EQ(0, readers);
+
+    wlh.unlock();
+    for (auto& t : threads) {
+        t.join();
+    }
+    EXPECT_EQ(numShards, readers);
+}
+
+// Readers don't block each other (whichever shards they use), but a writer
+// has to wait for all of them.
+TEST(ShardedRWLockTest, readersShareButExcludeWriter) {
+    ShardedRWLock lock;
+    std::unique_lock<cb::ReaderLock> rlh(lock.getReaderShard());
+
+    // The other readers (including one on our own shard) get the lock while
+    // we hold ours; if they didn't, the joins would hang.
+    std::vector<std::thread> threads;
+    for (size_t ii = 0; ii < numShards; ++ii) {
+        threads.emplace_back([&lock]() {
+            std::unique_lock<cb::ReaderLock> rlh(lock.getReaderShard());
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    std::atomic<bool> written{false};
+    std::thread writer([&lock, &written]() {
+        std::unique_lock<ShardedRWLock> wlh(lock);
+        written = true;
+    });
+
+    std::this_thread::sleep_for(blockedWait);
+    EXPECT_FALSE(written);
+
+    rlh.unlock();
+    writer.join();
+    EXPECT_TRUE(written);
+}
+
+// A thread keeps the shard it was first assigned, and threads are assigned
+// the shards round robin.
+TEST(ShardedRWLockTest, shardAssignment) {
+    MockShardedRWLock lock;
+    const size_t shard = lock.getThreadShard();
+    EXPECT_LT(shard, numShards);
+    EXPECT_EQ(shard, lock.getThreadShard());
+    EXPECT_EQ(&lock.getReaderShard(), &lock.getReaderShard());
+
+    // Threads started one after another get a different shard each.
+    std::set<size_t> shards;
+    for (size_t ii = 0; ii < numShards; ++ii) {
+        std::thread t([&lock, &shards]() {
+            const size_t shard = lock.getThreadShard();
+            EXPECT_LT(shard, numShards);
+            // The assignment is per thread, not per lock.
+            EXPECT_EQ(shard, MockShardedRWLock().getThreadShard());
+            shards.insert(shard);
+        });
+        t.join();
+    }
+    EXPECT_EQ(numShards, shards.size());
+}
@@ -23,6 +23,7 @@
 
 #include "../../daemon/alloc_hooks.h"
 #include "hash_table.h"
+#include "item_eviction.h"
 #include "stats.h"
 #include "stored_value_factories.h"
 #include "tests/module_tests/test_helpers.h"
@@ -236,6 +237,21 @@ TYPED_TEST(ValueTest, nru) {
     EXPECT_EQ(INITIAL_NRU_VALUE, this->sv->getNRUValue());
 }
 
+/**
+ * Check that the frequency counter starts at the initial value (so new items
+ * aren't the first to be evicted by the hifi_mfu policy), and is independent
+ * of the NRU bits.
+ */
+TYPED_TEST(ValueTest, freqCounter) {
+    EXPECT_EQ(ItemEviction::initialFreqCount,
+              this->sv->getFreqCounterValue());
+    this->sv->setFreqCounterValue(255);
+    EXPECT_EQ(255, this->sv->getFreqCounterValue());
+    EXPECT_EQ(INITIAL_NRU_VALUE, this->sv->getNRUValue());
+    this->sv->setFreqCounterValue(0);
+    EXPECT_EQ(0, this->sv->getFreqCounterValue());
+}
+
 /// Check that StoredValue / OrderedStoredValue don't unexpectedly change in
 /// size (we've carefully crafted them to be as efficient as possible).
 TEST(StoredValueTest, expectedSize) {
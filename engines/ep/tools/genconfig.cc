@@ -127,6 +127,17 @@ static string getRangeValidatorCode(const std::string &key, cJSON *o) {
     }
 
     string out = "(new " + validator_type + "())->min(" + mins + ")->max(" + maxs + ")";
+
+    // "allow_zero" accepts 0 (e.g. meaning disabled) below the minimum
+    cJSON* allowZero = cJSON_GetObjectItem(n, "allow_zero");
+    if (allowZero && allowZero->type == cJSON_True) {
+        if (validator_type != "SizeRangeValidator") {
+            cerr << "allow_zero is only supported for size_t values ("
+                 << "\"" << key << "\")." << endl;
+            exit(1);
+        }
+        out += "->allowZero()";
+    }
     return out;
 }
 
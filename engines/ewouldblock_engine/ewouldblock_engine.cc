@@ -1351,6 +1351,10 @@ EWB_Engine::EWB_Engine(GET_SERVER_API gsa_)
 
     ENGINE_HANDLE_V1::isXattrEnabled = isXattrEnabled;
 
+    // Don't expose update_in_place; we want the core to use the
+    // individual get / store calls so we may inject errors into them.
+    ENGINE_HANDLE_V1::update_in_place = nullptr;
+
     std::memset(&info, 0, sizeof(info.buffer));
     info.eng_info.description = "EWOULDBLOCK Engine";
     info.eng_info.features[info.eng_info.num_features++].feature = ENGINE_FEATURE_LRU;
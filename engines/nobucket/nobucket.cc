@@ -74,6 +74,7 @@ public:
         ENGINE_HANDLE_V1::collections.set_manifest = collections_set_manifest;
         ENGINE_HANDLE_V1::collections.get_manifest = collections_get_manifest;
         ENGINE_HANDLE_V1::isXattrEnabled = isXattrEnabled;
+        ENGINE_HANDLE_V1::update_in_place = nullptr;
         info.description = "Disconnect engine v1.0";
     };
 
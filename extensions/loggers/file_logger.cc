@@ -1,8 +1,6 @@
 /* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
 /**
  * @todo "chain" the loggers - I should use the next logger instead of stderr
- * @todo don't format into a temporary buffer, but directly into the
- *       destination buffer
  */
 #include "config.h"
 #include <stdarg.h>
@@ -13,7 +11,13 @@
 #include <strings.h>
 #include <stdlib.h>
 #include <time.h>
+#include <algorithm>
+#include <atomic>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
 
 #ifdef WIN32
 #include <io.h>
@@ -30,7 +34,6 @@
 #include <memcached/engine.h>
 #include <memcached/extension.h>
 #include <memcached/isotime.h>
-#include <memcached/syslog.h>
 #include <phosphor/phosphor.h>
 #include <platform/strerror.h>
 
@@ -57,52 +60,212 @@ static const EXTENSION_LOG_LEVEL stderr_output_level = EXTENSION_LOG_WARNING;
  */
 static size_t cyclesz = 100 * 1024 * 1024;
 
+/* The maximum size of a single log entry (including the timestamp and
+ * severity). Longer messages are truncated */
+static const size_t max_entry_size = 2048;
+
 /*
- * We're using two buffers for logging. We'll be inserting data into one,
- * while we're working on writing the other one to disk. Given that the disk
- * is way slower than our CPU, we might end up in a situation that we'll be
- * blocking the frontend threads if you're logging too much.
+ * Each thread logging gets its own log buffer, which it formats the log
+ * entries straight into without any locking (the flusher thread is the
+ * only other user of the buffer, and it only reads the entries the thread
+ * has committed). If the buffer is full the entry is dropped (and the
+ * number of dropped entries is written to the log by the flusher) rather
+ * than blocking the thread, so that a noisy log never adds latency to the
+ * front end threads.
+ *
+ * The entries are stamped with a global sequence number so that the
+ * flusher may write the entries from the different threads in order.
  */
-static struct logbuffer {
-    /* Pointer to beginning of the datasegment of this buffer */
-    char *data;
-    /* The current offset of the buffer */
-    size_t offset;
-} buffers[2];
+class LogBuffer {
+public:
+    struct Entry {
+        uint64_t sequence;
+        /* The length of the text following the entry (or wrap_marker) */
+        uint32_t length;
+        /* The length of the timestamp / severity prefix of the text */
+        uint32_t prefixlen;
+
+        char* text() {
+            return reinterpret_cast<char*>(this + 1);
+        }
+
+        /* The number of bytes the entry occupies in the buffer */
+        size_t size() const {
+            return sizeof(Entry) + ((length + 7) & ~size_t(7));
+        }
+    };
 
-/* The index in the buffers where we're currently inserting more data */
-static int currbuffer = 0;
+    static const uint32_t wrap_marker = std::numeric_limits<uint32_t>::max();
+
+    explicit LogBuffer(size_t sz)
+        : size((sz + 7) & ~size_t(7)),
+          data(reinterpret_cast<char*>(cb_malloc(size))) {
+        if (data == nullptr) {
+            throw std::bad_alloc();
+        }
+    }
+
+    ~LogBuffer() {
+        cb_free(data);
+    }
+
+    /**
+     * Get the space for the next entry (room for max_entry_size bytes of
+     * text). Must only be called by the owning thread.
+     *
+     * @return the text area for the entry, or nullptr if the buffer is full
+     */
+    char* reserve() {
+        const size_t needed = sizeof(Entry) + max_entry_size;
+        size_t pos = head.load(std::memory_order_relaxed);
+        const size_t used = pos - tail.load(std::memory_order_acquire);
+        size_t offset = pos % size;
+        size_t skip = 0;
+
+        if (offset + needed > size) {
+            // Not enough room at the end; continue at the beginning
+            skip = size - offset;
+            offset = 0;
+        }
+
+        if (used + skip + needed > size) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        if (skip >= sizeof(Entry)) {
+            reinterpret_cast<Entry*>(data + (pos % size))->length =
+                    wrap_marker;
+        }
+        pending = pos + skip;
+        current = reinterpret_cast<Entry*>(data + offset);
+        return current->text();
+    }
+
+    /**
+     * Make the entry returned from the last reserve() available to the
+     * flusher.
+     *
+     * @return true if the buffer is getting full
+     */
+    bool commit(uint32_t length, uint32_t prefixlen) {
+        current->sequence = next_sequence.fetch_add(1,
+                                                    std::memory_order_relaxed);
+        current->length = length;
+        current->prefixlen = prefixlen;
+        const auto pos = pending + current->size();
+        head.store(pos, std::memory_order_release);
+        return (pos - tail.load(std::memory_order_relaxed)) > (size * 0.75);
+    }
+
+    /**
+     * Collect all of the committed entries. Must only be called by the
+     * flusher (and the entries must be released before the next call).
+     *
+     * @param entries where to add the entries
+     * @return the position to release once the entries are written
+     */
+    size_t collect(std::vector<Entry*>& entries) {
+        const size_t end = head.load(std::memory_order_acquire);
+        size_t pos = tail.load(std::memory_order_relaxed);
+        while (pos < end) {
+            const size_t offset = pos % size;
+            auto* entry = reinterpret_cast<Entry*>(data + offset);
+            if (size - offset < sizeof(Entry) ||
+                entry->length == wrap_marker) {
+                pos += size - offset;
+            } else {
+                entries.push_back(entry);
+                pos += entry->size();
+            }
+        }
+        return end;
+    }
+
+    /**
+     * Release the space used by the entries returned from collect()
+     */
+    void release(size_t pos) {
+        tail.store(pos, std::memory_order_release);
+    }
+
+    bool empty() const {
+        return head.load(std::memory_order_acquire) ==
+               tail.load(std::memory_order_relaxed);
+    }
+
+    /* The number of entries dropped because the buffer was full */
+    std::atomic<uint64_t> dropped{0};
+
+    /* Set when the owning thread exits (and the buffer may be removed
+     * once it is flushed) */
+    std::atomic<bool> orphaned{false};
+
+protected:
+    static std::atomic<uint64_t> next_sequence;
+
+    const size_t size;
+    char* const data;
+
+    /* The state of the entry being formatted (owning thread only) */
+    Entry* current = nullptr;
+    size_t pending = 0;
+
+    /* The number of bytes written to, and consumed from, the buffer */
+    std::atomic<size_t> head{0};
+    char padding[64];
+    std::atomic<size_t> tail{0};
+};
+
+std::atomic<uint64_t> LogBuffer::next_sequence{0};
 
 /* Are we running in a unit test (don't print warnings to stderr) */
 static bool unit_test = false;
 
-/* The size of the buffers (this may be tuned by the buffersize configuration
- * parameter */
-static size_t buffersz = 2048 * 1024;
+/* The size of each thread's log buffer. This is a fraction of the buffersize
+ * configuration parameter (which used to size the single shared buffer):
+ * every thread which logs anything gets a buffer, and a full sized buffer
+ * per thread would multiply the logger's memory by the number of threads.
+ */
+static const size_t thread_buffer_fraction = 16;
+static size_t buffersz = (2048 * 1024) / thread_buffer_fraction;
 
 /* The sleeptime between each forced flush of the buffer */
 static size_t sleeptime = 60;
 
-/* To avoid race condition we're protecting our shared resources with a
- * single mutex. */
-static cb_mutex_t mutex;
-
-/* The thread performing the disk IO will be waiting for the input buffers
- * to be filled by sleeping on the following condition variable. The
- * frontend threads will notify the condition variable when the buffer is
- * > 75% full
+/* The log buffers for all of the threads which have logged something. The
+ * mutex is only held while registering a new thread, and when the flusher
+ * picks up the list of buffers.
  */
-static cb_cond_t cond;
+static std::mutex log_buffers_mutex;
+static std::vector<std::shared_ptr<LogBuffer>> log_buffers;
+
+/* Bumped every time the logger is initialized (so that the threads create
+ * new buffers for the new instance). 0 means that the logger isn't
+ * running */
+static std::atomic<uint64_t> log_buffers_generation{0};
+static uint64_t next_log_buffers_generation = 0;
+
+/* The log buffer (for the current logger instance) of this thread */
+static thread_local struct ThreadLogBuffer {
+    ~ThreadLogBuffer() {
+        if (buffer) {
+            buffer->orphaned.store(true);
+        }
+    }
 
-/* In the "worst case scenarios" we're logging so much that the disk thread
- * can't keep up with the the frontend threads. In these rare situations
- * the frontend threads will block and wait for the flusher to free up log
- * space
- */
-static cb_cond_t space_cond;
+    std::shared_ptr<LogBuffer> buffer;
+    uint64_t generation = 0;
+} thread_log_buffer;
 
-static char hostname[256];
-static pid_t pid;
+/* The flusher thread will be sleeping on the following condition variable
+ * (protected by the mutex) between each time it flushes the buffers. The
+ * frontend threads set flush_requested and notify the condition variable
+ * when their buffer is > 75% full
+ */
+static cb_mutex_t mutex;
+static cb_cond_t cond;
+static std::atomic<bool> flush_requested{false};
 
 // mutex used to synchronize access to stderr
 std::mutex stderr_mutex;
@@ -110,93 +273,50 @@ std::mutex stderr_mutex;
 /* To avoid the logs beeing flooded by the same log messages we try to
  * de-duplicate the messages and instead print out:
  *   "message repeated xxx times"
+ *
+ * The de-duplication is performed by the flusher thread as it writes the
+ * entries to the file.
  */
 static struct {
-    /* The last message being added to the log */
-    char buffer[2048];
-    /* The number of times we've seen this message */
+    /* The last message being added to the log (without the timestamp) */
+    std::string message;
+    /* The number of times we've seen this message since it was added */
     int count;
-    /* The offset into the buffer for where the text start (after the
-     * timestamp)
-     */
-    int offset;
     /* The sec when the entry was added (used for flushing of the
      * dedupe log)
      */
     time_t created;
 } lastlog;
 
-static void do_add_log_entry(const char *msg, size_t size) {
-    /* wait until there is room in the current buffer */
-    while ((buffers[currbuffer].offset + size) >= buffersz) {
-        if (!unit_test) {
-            fprintf(stderr, "WARNING: waiting for log space to be available\n");
-        }
-        cb_cond_wait(&space_cond, &mutex);
+static LogBuffer* get_thread_log_buffer() {
+    const auto generation = log_buffers_generation.load();
+    if (generation == 0) {
+        return nullptr;
     }
 
-    /* We could have performed the memcpy outside the locked region,
-     * but then we would need to handle the situation where we're
-     * flipping the ownership of the buffer (otherwise we could be
-     * writing rubbish to the file) */
-    memcpy(buffers[currbuffer].data + buffers[currbuffer].offset,
-           msg, size);
-    buffers[currbuffer].offset += size;
-    if (buffers[currbuffer].offset > (buffersz * 0.75)) {
-        /* we're getting full.. time get the logger to start doing stuff! */
-        cb_cond_signal(&cond);
-    }
-}
-
-static void flush_last_log(bool timebased) {
-    if (lastlog.count > 1) {
-        ISOTime::ISO8601String timestamp;
-        ISOTime::generatetimestamp(timestamp);
-
-        char buffer[512];
-        int offset = snprintf(buffer, sizeof(buffer),
-                              "%s Message repeated %u times\n",
-                              timestamp.data(), lastlog.count);
-
-        if (offset < 0 || offset >= int(sizeof(buffer))) {
-            // Failed to format... ignore for now..
-            return;
+    if (thread_log_buffer.generation != generation) {
+        if (thread_log_buffer.buffer) {
+            thread_log_buffer.buffer->orphaned.store(true);
+            thread_log_buffer.buffer.reset();
         }
 
-        // Only try to flush if there is enough free space, otherwise
-        // we'll be causing a deadlock
-        if (timebased && ((buffers[currbuffer].offset + offset) >= buffersz)) {
-            return ;
+        std::shared_ptr<LogBuffer> buffer;
+        try {
+            buffer = std::make_shared<LogBuffer>(buffersz);
+        } catch (const std::bad_alloc&) {
+            return nullptr;
         }
 
-        do_add_log_entry(buffer, offset);
-        lastlog.buffer[0] = '\0';
-        lastlog.count = 0;
-        lastlog.offset = 0;
-        lastlog.created = 0;
-    }
-}
-
-static void add_log_entry(time_t now, const char *msg, int prefixlen, size_t size)
-{
-    cb_mutex_enter(&mutex);
-
-    if (size < sizeof(lastlog.buffer)) {
-        if (memcmp(lastlog.buffer + lastlog.offset, msg + prefixlen, size-prefixlen) == 0) {
-            ++lastlog.count;
-        } else {
-            flush_last_log(false);
-            do_add_log_entry(msg, size);
-            memcpy(lastlog.buffer, msg, size);
-            lastlog.offset = prefixlen;
-            lastlog.created = now;
+        std::lock_guard<std::mutex> guard(log_buffers_mutex);
+        if (log_buffers_generation.load() != generation) {
+            return nullptr;
         }
-    } else {
-        flush_last_log(false);
-        do_add_log_entry(msg, size);
+        log_buffers.push_back(buffer);
+        thread_log_buffer.buffer = buffer;
+        thread_log_buffer.generation = generation;
     }
 
-    cb_mutex_exit(&mutex);
+    return thread_log_buffer.buffer.get();
 }
 
 static const char *severity2string(EXTENSION_LOG_LEVEL sev) {
@@ -254,150 +374,89 @@ static int format_log_entry(char* buffer, size_t buf_len, time_t time,
     return prefix_len;
 }
 
-/* Takes the syslog compliant event and calls the native logging functionality */
-static void syslog_event_receiver(SyslogEvent *event) {
-    uint8_t syslog_severity = event->prival & 7; /* Mask out all but 3 least-significant bits */
-    EXTENSION_LOG_LEVEL severity = EXTENSION_LOG_WARNING;
-
-    switch (syslog_severity) {
-    case SYSLOG_CRITICAL:
-        severity = EXTENSION_LOG_FATAL;
-        break;
-    case SYSLOG_WARNING:
-        severity = EXTENSION_LOG_WARNING;
-        break;
-    case SYSLOG_NOTICE:
-        severity = EXTENSION_LOG_NOTICE;
-        break;
-    case SYSLOG_INFORMATIONAL:
-        severity = EXTENSION_LOG_INFO;
-        break;
-    case SYSLOG_DEBUG:
-        severity = EXTENSION_LOG_DEBUG;
-        break;
-    default:
-        fprintf(stderr, "ERROR: Unknown syslog_severity\n");
+/* Formats the log entry straight into the log buffer of the calling thread */
+static void logger_log_wrapper(EXTENSION_LOG_LEVEL severity,
+                               const void* client_cookie,
+                               const char *fmt, ...) {
+    (void)client_cookie;
+    const bool to_file = severity >= current_log_level;
+    const bool to_stderr = severity >= stderr_output_level;
+    if (!to_file && !to_stderr) {
+        return;
     }
 
-    char buffer[2048];
-    const int prefixlen = format_log_entry(buffer, sizeof(buffer),
-                                           event->time, event->time_secfrac,
-                                           severity, event->msg);
-
-    if (severity >= current_log_level || severity >= stderr_output_level) {
-        if (severity >= stderr_output_level) {
-            std::lock_guard<std::mutex> guard(stderr_mutex);
-            std::cerr << buffer;
-            std::cerr.flush();
-        }
-
-        if (severity >= current_log_level) {
-            add_log_entry(event->time, buffer, prefixlen, strlen(buffer));
+    char scratch[max_entry_size];
+    LogBuffer* buffer = to_file ? get_thread_log_buffer() : nullptr;
+    char* entry = (buffer == nullptr) ? nullptr : buffer->reserve();
+    if (entry == nullptr) {
+        if (!to_stderr) {
+            // The buffer is full (the flusher reports the dropped entries)
+            return;
         }
+        entry = scratch;
     }
-}
-
 
-/* Takes the current logging format and produces syslogd compliant event */
-static void logger_log_wrapper(EXTENSION_LOG_LEVEL severity,
-                               const void* client_cookie,
-                               const char *fmt, ...) {
-    (void)client_cookie;
-    SyslogEvent event;
-    size_t avail_char_in_msg = sizeof(event.msg) - 1; /*space excluding terminating char */
     struct timeval now;
-    va_list ap;
-    int len;
-    uint8_t facility = 16;  /* Facility - defaulting to local0 */
-    uint8_t syslog_severity;
+    if (cb_get_timeofday(&now) != 0) {
+        std::lock_guard<std::mutex> guard(stderr_mutex);
+        std::cerr << "gettimeofday failed in file_logger.cc: " << cb_strerror()
+                  << std::endl;
+        return;
+    }
 
-    /* RFC5424 uses version 1 of syslog protocol */
-    event.version = 1;
-    event.msgid = GENERIC_EVENT;
-    strcpy(event.app_name, "memcached");
-    strcpy(event.hostname, hostname);
-    event.procid = (uint64_t)pid;
+    ISOTime::ISO8601String timestamp;
+    ISOTime::generatetimestamp(timestamp, now.tv_sec, now.tv_usec);
+    const int prefixlen = snprintf(entry, max_entry_size, "%s %s ",
+                                   timestamp.data(),
+                                   severity2string(severity));
+    if (prefixlen < 0 || size_t(prefixlen) >= (max_entry_size / 2)) {
+        return;
+    }
 
+    char* message = entry + prefixlen;
+    const size_t avail = max_entry_size - prefixlen;
+    va_list ap;
     va_start(ap, fmt);
-    len = vsnprintf(event.msg, avail_char_in_msg, fmt, ap);
+    const int len = vsnprintf(message, avail, fmt, ap);
     va_end(ap);
 
-    /* array indices start from zero, so need to offset length by minus one */
-    auto index = len - 1;
     /* If an encoding error occurs with vsnprintf a -ive number is returned */
-    if (len >= 0) {
-        if (len < static_cast<int>(avail_char_in_msg)) {
-            /* add a new line to the message if not already there */
-            if (event.msg[index] != '\n') {
-                event.msg[index + 1] = '\n';
-                event.msg[index + 2] = '\0';
-            } else {
-                event.msg[index + 1] = '\0';
-            }
-        } else {
-            /* len is equal avail_char_in_msg */
-
-            /* index to array element containing last character
-             * (excluding terminating character)
-             */
-            index = avail_char_in_msg - 1;
-            if (event.msg[index] != '\n') {
-                std::lock_guard<std::mutex> guard(stderr_mutex);
-                std::cerr << "Syslog message being truncated... too big"
-                          << std::endl;
-                event.msg[index] = '\n';
-            }
-            event.msg[index + 1] = '\0';
-        }
-    } else {
+    if (len < 0) {
         std::lock_guard<std::mutex> guard(stderr_mutex);
-        std::cerr << "Syslog message dropped... too big" << std::endl;
+        std::cerr << "Log message dropped... encoding error" << std::endl;
         return;
     }
 
-    switch (severity) {
-    case EXTENSION_LOG_FATAL:
-        syslog_severity = SYSLOG_CRITICAL;
-        break;
-    case EXTENSION_LOG_WARNING:
-        syslog_severity = SYSLOG_WARNING;
-        break;
-    case EXTENSION_LOG_NOTICE:
-        syslog_severity = SYSLOG_NOTICE;
-        break;
-    case EXTENSION_LOG_INFO:
-        syslog_severity = SYSLOG_INFORMATIONAL;
-        break;
-    case EXTENSION_LOG_DEBUG:
-    case EXTENSION_LOG_DETAIL:
-        syslog_severity = SYSLOG_DEBUG;
-        break;
-    default: {
+    size_t msglen = size_t(len);
+    if (msglen > avail - 2) {
+        // Leave room for the newline
+        msglen = avail - 2;
+        if (message[msglen - 1] != '\n') {
             std::lock_guard<std::mutex> guard(stderr_mutex);
-            std::cerr << "Unknown severity: " << severity
-                      << " using SYSLOG_UNKNOWN" << std::endl;
+            std::cerr << "Log message being truncated... too big"
+                      << std::endl;
         }
-        syslog_severity = SYSLOG_UNKNOWN;
     }
+    /* add a new line to the message if not already there */
+    if (msglen == 0 || message[msglen - 1] != '\n') {
+        message[msglen++] = '\n';
+    }
+    message[msglen] = '\0';
+    const size_t length = size_t(prefixlen) + msglen;
 
-    /*
-       To produce the priority_value multiply facility by 8
-       i.e. shift to left 3 places. Then add the syslog_severity
-     */
-    event.prival = (facility << 3) + syslog_severity;
-
-    /* Fill-in date structure */
-    if (cb_get_timeofday(&now) == 0) {
-        event.time = (time_t)now.tv_sec;
-        event.time_secfrac = (uint32_t)now.tv_usec;
-    } else {
+    if (to_stderr) {
         std::lock_guard<std::mutex> guard(stderr_mutex);
-        std::cerr << "gettimeofday failed in file_logger.cc: " << cb_strerror()
-                  << std::endl;
-        return;
+        std::cerr.write(entry, length);
+        std::cerr.flush();
+    }
+
+    if (entry != scratch && buffer->commit(uint32_t(length), prefixlen) &&
+        !flush_requested.exchange(true)) {
+        /* we're getting full.. time get the logger to start doing stuff! */
+        cb_mutex_enter(&mutex);
+        cb_cond_signal(&cond);
+        cb_mutex_exit(&mutex);
     }
-    /* Send the syslog event */
-    syslog_event_receiver(&event);
 }
 
 static unsigned long next_file_id = 0;
@@ -470,130 +529,205 @@ static FILE *rotate_logfile(FILE *old, const char *fnm) {
     return new_log;
 }
 
-static size_t flush_pending_io(FILE *file, struct logbuffer *lb) {
-    size_t ret = 0;
-    if (lb->offset > 0) {
-        if (file) {
-            char *ptr = lb->data;
-            size_t towrite = ret = lb->offset;
-            while (towrite > 0) {
-                auto nw = fwrite(ptr, 1, towrite, file);
-                if (nw > 0) {
-                    ptr += nw;
-                    towrite -= nw;
-                }
-            }
-            lb->offset = 0;
-            fflush(file);
-        } else {
-            // Cannot write as have no FD, however we also don't want
-            // to leave the logbuffer as-is as that would result in it
-            // filling up and producers being deadlocked. Therefore
-            // discard the logbuffer contents.
-            // Note that any message at output_level is always logged
-            // to stderr (for babysitter) so those messages will not
-            // be lost.
-            lb->offset = 0;
-        }
-    }
-
-    return ret;
-}
-
-static void flush_all_buffers_to_file(FILE *file) {
-    while (buffers[currbuffer].offset) {
-        int curr  = currbuffer;
-        currbuffer = (currbuffer == 0) ? 1 : 0;
-        flush_pending_io(file, buffers + curr);
-    }
-}
-
 static volatile int run = 1;
 static cb_thread_t tid;
 static FILE *fp;
 
-static void logger_thread_main(void* arg)
-{
-    size_t currsize = 0;
+/* The number of bytes written to the current logfile */
+static size_t currsize;
 
-    struct timeval tp;
-    cb_get_timeofday(&tp);
-    time_t next = (time_t)tp.tv_sec;
+/* The entries being written to the file (kept to avoid reallocating it) */
+static std::string output;
 
-    cb_mutex_enter(&mutex);
-    while (run) {
-        cb_get_timeofday(&tp);
-
-        while ((time_t)tp.tv_sec >= next  ||
-               buffers[currbuffer].offset > (buffersz * 0.75)) {
-            int curr  = currbuffer;
-            next = (time_t)tp.tv_sec + 1;
-            currbuffer = (currbuffer == 0) ? 1 : 0;
-            /* Let people who is blocked for space continue */
-            cb_cond_broadcast(&space_cond);
-
-            /* Perform file IO without the lock */
-            cb_mutex_exit(&mutex);
-
-            /* In case we failed to open the log file last time (e.g. EMFILE),
-               re-attempt now. */
-            if (fp == NULL) {
-                fp = open_logfile(reinterpret_cast<const char*>(arg));
-                if (fp != NULL) {
-                    // Record that the log is back online.
-                    struct timeval now;
-                    cb_get_timeofday(&now);
-                    char log_entry[1024];
-                    format_log_entry(log_entry, sizeof(log_entry),
-                                     now.tv_sec, now.tv_usec,
-                                     EXTENSION_LOG_NOTICE,
-                                     "Restarting file logging\n");
-
-                    fwrite(log_entry, 1, strlen(log_entry), fp);
-                    // Send to stderr for good measure.
-                    std::lock_guard<std::mutex> guard(stderr_mutex);
-                    std::cerr << log_entry;
-                }
+static void write_output() {
+    if (output.empty()) {
+        return;
+    }
+
+    if (fp) {
+        const char* ptr = output.data();
+        size_t towrite = output.size();
+        while (towrite > 0) {
+            auto nw = fwrite(ptr, 1, towrite, fp);
+            if (nw == 0 && ferror(fp)) {
+                clearerr(fp);
+                break;
             }
+            ptr += nw;
+            towrite -= nw;
+        }
+        currsize += output.size();
+        fflush(fp);
+    }
+    // Cannot write as have no FD, however we also don't want to
+    // keep the entries as that would result in the log buffers filling
+    // up. Note that any message at output_level is always logged to
+    // stderr (for babysitter) so those messages will not be lost.
+    output.clear();
+}
 
-            currsize += flush_pending_io(fp, buffers + curr);
-            if (currsize > cyclesz) {
-                fp = rotate_logfile(fp, reinterpret_cast<const char*>(arg));
-                currsize = 0;
+static void flush_last_log() {
+    if (lastlog.count > 0) {
+        ISOTime::ISO8601String timestamp;
+        ISOTime::generatetimestamp(timestamp);
+
+        char buffer[512];
+        int offset = snprintf(buffer, sizeof(buffer),
+                              "%s Message repeated %u times\n",
+                              timestamp.data(), lastlog.count);
+        if (offset > 0 && offset < int(sizeof(buffer))) {
+            output.append(buffer, offset);
+        }
+    }
+    lastlog.message.clear();
+    lastlog.count = 0;
+    lastlog.created = 0;
+}
+
+/*
+ * Write all of the entries in the log buffers to the logfile (in the order
+ * they were logged).
+ *
+ * @param fname the name of the logfile (nullptr if we shouldn't try to
+ *              open a new logfile)
+ * @param force set to true when we can't wait for the other threads
+ */
+static void flush_log_buffers(const char* fname, bool force) {
+    std::vector<std::shared_ptr<LogBuffer>> buffers;
+    {
+        std::unique_lock<std::mutex> guard(log_buffers_mutex,
+                                           std::defer_lock);
+        if (force) {
+            if (!guard.try_lock()) {
+                return;
             }
-            cb_mutex_enter(&mutex);
+        } else {
+            guard.lock();
+        }
+
+        // Remove the buffers for the threads which have exited once
+        // they're empty
+        log_buffers.erase(
+                std::remove_if(log_buffers.begin(),
+                               log_buffers.end(),
+                               [](const std::shared_ptr<LogBuffer>& buffer) {
+                                   return buffer->orphaned.load() &&
+                                          buffer->empty();
+                               }),
+                log_buffers.end());
+        buffers = log_buffers;
+    }
+
+    /* In case we failed to open the log file last time (e.g. EMFILE),
+       re-attempt now. */
+    if (fp == NULL && fname != nullptr) {
+        fp = open_logfile(fname);
+        if (fp != NULL) {
+            // Record that the log is back online.
+            struct timeval now;
+            cb_get_timeofday(&now);
+            char log_entry[1024];
+            format_log_entry(log_entry, sizeof(log_entry),
+                             now.tv_sec, now.tv_usec,
+                             EXTENSION_LOG_NOTICE,
+                             "Restarting file logging\n");
+
+            fwrite(log_entry, 1, strlen(log_entry), fp);
+            // Send to stderr for good measure.
+            std::lock_guard<std::mutex> guard(stderr_mutex);
+            std::cerr << log_entry;
         }
+    }
 
-        // Only run dedupe for ~5 seconds
-        if (lastlog.count > 0 && (lastlog.created + 4 < tp.tv_sec)) {
-            flush_last_log(true);
+    std::vector<LogBuffer::Entry*> entries;
+    std::vector<size_t> positions(buffers.size());
+    uint64_t dropped = 0;
+    for (size_t ii = 0; ii < buffers.size(); ++ii) {
+        positions[ii] = buffers[ii]->collect(entries);
+        dropped += buffers[ii]->dropped.exchange(0);
+    }
+    std::sort(entries.begin(),
+              entries.end(),
+              [](const LogBuffer::Entry* a, const LogBuffer::Entry* b) {
+                  return a->sequence < b->sequence;
+              });
+
+    const time_t now = time(NULL);
+    if (dropped > 0) {
+        struct timeval tv;
+        cb_get_timeofday(&tv);
+        char log_entry[256];
+        const std::string msg = "Dropped " + std::to_string(dropped) +
+                                " log messages (log buffer full)\n";
+        format_log_entry(log_entry, sizeof(log_entry), tv.tv_sec,
+                         tv.tv_usec, EXTENSION_LOG_WARNING, msg.c_str());
+        output.append(log_entry);
+    }
+
+    for (auto* entry : entries) {
+        const char* message = entry->text() + entry->prefixlen;
+        const size_t msglen = entry->length - entry->prefixlen;
+        if (lastlog.created != 0 && lastlog.message.size() == msglen &&
+            memcmp(lastlog.message.data(), message, msglen) == 0) {
+            ++lastlog.count;
+            continue;
         }
 
-        cb_get_timeofday(&tp);
-        next = (time_t)tp.tv_sec + (time_t)sleeptime;
+        flush_last_log();
+        output.append(entry->text(), entry->length);
+        lastlog.message.assign(message, msglen);
+        lastlog.created = now;
 
-        if (unit_test) {
-            cb_cond_timedwait(&cond, &mutex, 100);
-        } else {
-            cb_cond_timedwait(&cond, &mutex, (unsigned int)(1000 * sleeptime));
+        if (fp != NULL && (currsize + output.size()) > cyclesz) {
+            write_output();
+            fp = rotate_logfile(fp, fname);
+            currsize = 0;
         }
     }
 
-    /* The log file might not be open, however we may have
-     * an event in the buffer that needs flushing to a file.
-     */
-    if (buffers[currbuffer].offset != 0 && !fp) {
-        fp = open_logfile(reinterpret_cast<const char*>(arg));
+    // Only run dedupe for ~5 seconds
+    if (lastlog.count > 0 && (lastlog.created + 4 < now)) {
+        flush_last_log();
     }
-    if (fp) {
-        flush_all_buffers_to_file(fp);
-        close_logfile(fp);
+
+    write_output();
+
+    for (size_t ii = 0; ii < buffers.size(); ++ii) {
+        buffers[ii]->release(positions[ii]);
     }
+}
+
+static void logger_thread_main(void* arg)
+{
+    const char* fname = reinterpret_cast<const char*>(arg);
+
+    cb_mutex_enter(&mutex);
+    while (run) {
+        if (!flush_requested.load()) {
+            if (unit_test) {
+                cb_cond_timedwait(&cond, &mutex, 100);
+            } else {
+                cb_cond_timedwait(&cond, &mutex,
+                                  (unsigned int)(1000 * sleeptime));
+            }
+        }
+        flush_requested.store(false);
 
+        /* Perform file IO without the lock */
+        cb_mutex_exit(&mutex);
+        flush_log_buffers(fname, false);
+        cb_mutex_enter(&mutex);
+    }
     cb_mutex_exit(&mutex);
+
+    /* Write whatever is left in the buffers */
+    flush_log_buffers(fname, false);
+    flush_last_log();
+    write_output();
+    close_logfile(fp);
+    fp = NULL;
+
     cb_free(arg);
-    cb_free(buffers[0].data);
-    cb_free(buffers[1].data);
 }
 
 static void exit_handler(void) {
@@ -627,10 +761,12 @@ static void on_log_level(const void *cookie, ENGINE_EVENT_TYPE type,
 
 static void logger_shutdown(bool force) {
     if (force) {
-        // Don't bother attempting to take any mutexes - other threads may
-        // never run again. Just flush the buffers asap.
+        // Don't bother waiting for the other threads - they may never run
+        // again. Just flush the buffers asap.
         if (fp) {
-            flush_all_buffers_to_file(fp);
+            flush_log_buffers(nullptr, true);
+            flush_last_log();
+            write_output();
             close_logfile(fp);
             fp = NULL;
         }
@@ -639,7 +775,6 @@ static void logger_shutdown(bool force) {
 
     int running;
     cb_mutex_enter(&mutex);
-    flush_last_log(false);
     running = run;
     run = 0;
     cb_cond_signal(&cond);
@@ -648,6 +783,10 @@ static void logger_shutdown(bool force) {
     if (running) {
         cb_join_thread(tid);
     }
+
+    std::lock_guard<std::mutex> guard(log_buffers_mutex);
+    log_buffers_generation.store(0);
+    log_buffers.clear();
 }
 
 MEMCACHED_PUBLIC_API
@@ -659,16 +798,16 @@ EXTENSION_ERROR_CODE file_logger_initialize(const LoggerConfig& logger_settings,
      */
     run = 1;
     fp = nullptr;
-    lastlog.buffer[0] = '\0';
+    currsize = 0;
+    lastlog.message.clear();
     lastlog.count = 0;
-    lastlog.offset = 0;
     lastlog.created = 0;
+    flush_requested.store(false);
 
     char* fname = NULL;
 
     cb_mutex_initialize(&mutex);
     cb_cond_initialize(&cond);
-    cb_cond_initialize(&space_cond);
 
     descriptor.get_name = get_name;
     descriptor.log = logger_log_wrapper;
@@ -683,16 +822,8 @@ EXTENSION_ERROR_CODE file_logger_initialize(const LoggerConfig& logger_settings,
         return EXTENSION_FATAL;
     }
 
-    pid = (pid_t)cb_getpid();
-
-    if (gethostname(hostname, sizeof(hostname))) {
-        std::cerr << "Could not get the hostname: " << cb_strerror()
-                  << std::endl;
-        strcpy(hostname, "unknown");
-    }
-
     fname = cb_strdup(logger_settings.filename.c_str());
-    buffersz = logger_settings.buffersize;
+    size_t total_buffersz = logger_settings.buffersize;
     cyclesz = logger_settings.cyclesize;
     sleeptime = logger_settings.sleeptime;
     unit_test = logger_settings.unit_test;
@@ -706,34 +837,37 @@ EXTENSION_ERROR_CODE file_logger_initialize(const LoggerConfig& logger_settings,
     }
 
     if (getenv("CB_MAXIMIZE_LOGGER_BUFFER_SIZE") != nullptr) {
-        buffersz = 8 * 1024 * 1024; // use two 8MB log buffers
+        total_buffersz = 8 * 1024 * 1024; // use 8MB log buffers
     }
 
+    // Each buffer must be able to hold a few entries of the maximum size
+    buffersz = std::max(total_buffersz / thread_buffer_fraction,
+                        4 * (sizeof(LogBuffer::Entry) + max_entry_size));
+
     if (fname == NULL || strcmp(fname, "") == 0) {
         fname = cb_strdup("memcached");
     }
 
-    buffers[0].data = reinterpret_cast<char*>(cb_malloc(buffersz));
-    buffers[1].data = reinterpret_cast<char*>(cb_malloc(buffersz));
-
-    if (buffers[0].data == NULL || buffers[1].data == NULL || fname == NULL ||
-        strcmp(fname, "") == 0) {
+    if (fname == NULL || strcmp(fname, "") == 0) {
         std::cerr << "Failed to allocate memory for the logger" << std::endl;
         cb_free(fname);
-        cb_free(buffers[0].data);
-        cb_free(buffers[1].data);
         return EXTENSION_FATAL;
     }
 
     next_file_id = find_first_logfile_id(fname);
 
+    {
+        std::lock_guard<std::mutex> guard(log_buffers_mutex);
+        log_buffers.clear();
+        log_buffers_generation.store(++next_log_buffers_generation);
+    }
+
     if (cb_create_named_thread(
                 &tid, logger_thread_main, fname, 0, "mc:file_logger") < 0) {
         std::cerr << "Failed to create the logger backend thread: "
                   << cb_strerror() << std::endl;
         cb_free(fname);
-        cb_free(buffers[0].data);
-        cb_free(buffers[1].data);
+        log_buffers_generation.store(0);
         return EXTENSION_FATAL;
     }
 
@@ -49,6 +49,27 @@ typedef struct allocator_stats {
 
 } allocator_stats;
 
+/**
+ * How well utilised the page(s) (slab) holding an allocation are, compared
+ * to the other slabs of the same size class.
+ */
+typedef enum {
+    /* The allocator can't tell (e.g. it doesn't support the query) */
+    ALLOCATION_UTILIZATION_UNKNOWN,
+    /* The allocation is on a slab at least as utilised as average (or
+       isn't on a slab at all), so moving it wouldn't reduce fragmentation */
+    ALLOCATION_UTILIZATION_DENSE,
+    /* The allocation is on a slab less utilised than average; moving it
+       (reallocating it) is likely to reduce fragmentation */
+    ALLOCATION_UTILIZATION_SPARSE
+} allocation_utilization_t;
+
+/**
+ * The arena threads allocate from unless they have been switched to another
+ * one with set_thread_arena().
+ */
+#define ALLOCATOR_DEFAULT_ARENA 0
+
 /**
  * Engine allocator hooks for memory tracking.
  */
@@ -132,6 +153,48 @@ typedef struct engine_allocator_hooks_v1 {
      */
     bool (*get_allocator_property)(const char* name, size_t* value);
 
+    /**
+     * Checks how well utilised the slab holding the given allocation is,
+     * so callers (e.g. a defragmenter) can only move the allocations which
+     * are on under-used pages.
+     * @param ptr start of an allocation returned by the allocator
+     */
+    allocation_utilization_t (*get_allocation_utilization)(const void* ptr);
+
+    /**
+     * Acquires an arena dedicated to the caller (e.g. a bucket), so its
+     * allocations aren't mixed up with anyone else's. Arenas are never
+     * destroyed; a released arena is handed out again by a later call.
+     * @param arena destination for the index of the arena
+     * @return whether the allocator supports dedicated arenas
+     */
+    bool (*acquire_arena)(unsigned* arena);
+
+    /**
+     * Returns an arena acquired with acquire_arena(), once everything
+     * allocated from it has been freed. The arena's unused pages are
+     * released back to the OS.
+     */
+    void (*release_arena)(unsigned arena);
+
+    /**
+     * Makes the calling thread allocate from the given arena.
+     * @param arena the arena to use (ALLOCATOR_DEFAULT_ARENA to go back to
+     *              the default)
+     * @param flush_thread_cache flush the calling thread's cache first, so
+     *                           memory cached from the previous arena isn't
+     *                           handed out for the new one
+     * @return whether the call was successful
+     */
+    bool (*set_thread_arena)(unsigned arena, bool flush_thread_cache);
+
+    /**
+     * Gets the number of bytes currently allocated from an arena. The
+     * value is as of the last time get_allocator_stats() was called.
+     * @return whether the call was successful
+     */
+    bool (*get_arena_allocated)(unsigned arena, size_t* allocated);
+
 } ALLOCATOR_HOOKS_API;
 
 #ifdef __cplusplus
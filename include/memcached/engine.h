@@ -172,6 +172,22 @@ struct EngineErrorCasPair {
     engine_errc status;
     uint64_t cas;
 };
+
+/**
+ * The function used by update_in_place to generate the new value of the
+ * document. It is called by the engine (while holding the lock protecting
+ * the document) with the item_info of the current version of the document
+ * (the value is only valid for the duration of the call).
+ *
+ * To update the document the function sets value and datatype to the new
+ * value of the document (which must stay valid until update_in_place
+ * returns) and returns success. Any other status aborts the update, and
+ * is returned from update_in_place.
+ */
+using InPlaceMutator =
+        std::function<engine_errc(const item_info& current,
+                                  cb::const_char_buffer& value,
+                                  protocol_binary_datatype_t& datatype)>;
 }
 
 /**
@@ -491,6 +507,43 @@ typedef struct engine_interface_v1 {
                                        cb::StoreIfPredicate predicate,
                                        DocumentState document_state);
 
+    /**
+     * Update an existing document in place by applying the mutator to the
+     * current value of the document while the engine holds the lock for
+     * the document. This allows the core to perform read-modify-write
+     * operations (like the subdoc mutations) without fetching a copy of
+     * the document and storing it back with CAS (and retrying if someone
+     * else modified the document in between).
+     *
+     * This method is optional (nullptr if not supported by the engine).
+     * The engine may also return ENGINE_ENOTSUP (without calling the
+     * mutator) if it can't perform the update in place for this document
+     * (for instance if the document isn't resident), in which case the
+     * core should fall back to fetching and storing the document.
+     *
+     * @param handle the engine handle
+     * @param cookie The cookie provided by the frontend
+     * @param key the key of the document to update
+     * @param vbucket the virtual bucket id
+     * @param cas the CAS value the document must have (0 for any). Set to
+     *            the CAS of the new document upon success
+     * @param expiration the expiration time for the updated document
+     * @param mutator the function generating the new document
+     * @param mut_info upon success, the sequence number and vBucket UUID
+     *                 of the update
+     *
+     * @return ENGINE_SUCCESS if the document was updated
+     */
+    ENGINE_ERROR_CODE(*update_in_place)
+    (gsl::not_null<ENGINE_HANDLE*> handle,
+     gsl::not_null<const void*> cookie,
+     const DocKey& key,
+     uint16_t vbucket,
+     uint64_t& cas,
+     uint32_t expiration,
+     cb::InPlaceMutator mutator,
+     mutation_descr_t& mut_info);
+
     /**
      * Flush the cache.
      *
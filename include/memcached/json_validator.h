@@ -0,0 +1,57 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2018 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#pragma once
+
+#include <memcached/visibility.h>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace cb {
+namespace json {
+
+/**
+ * Check if the provided buffer contains a valid JSON document encoded
+ * in UTF-8.
+ *
+ * Used instead of checkUTF8JSON() from JSON_checker to determine the
+ * datatype of a document. Unlike JSON_checker (which runs a state machine
+ * for every byte) the bodies of strings (where most of the bytes of a
+ * typical document live) are scanned 16 bytes at a time, and only escape
+ * sequences and multi-byte UTF-8 sequences are inspected one byte at a
+ * time.
+ *
+ * It validates against RFC 8259 and RFC 3629, which is not exactly what
+ * JSON_checker accepts, so the two may disagree on some documents:
+ *
+ *  - Any JSON value is accepted at the top level (not only objects and
+ *    arrays), surrounded by optional whitespace.
+ *  - There is no limit on the nesting depth.
+ *  - UTF-8 is validated strictly: overlong encodings, encoded surrogates
+ *    (U+D800..U+DFFF) and code points above U+10FFFF are rejected.
+ *  - A \u escape only needs to be followed by four hex digits, so
+ *    unpaired surrogate escapes (e.g. "\ud800") are accepted.
+ *
+ * @param data the data to check
+ * @param size the number of bytes in data
+ * @return true if the buffer contains valid JSON, false otherwise
+ */
+MEMCACHED_PUBLIC_API
+bool checkUTF8JSON(const uint8_t* data, size_t size);
+
+} // namespace json
+} // namespace cb
@@ -25,6 +25,7 @@
 #include <memcached/rbac/privileges.h>
 
 #include <cbsasl/cbsasl.h>
+#include <atomic>
 #include <bitset>
 #include <cstdint>
 #include <limits>
@@ -44,6 +45,17 @@ namespace rbac {
  */
 using PrivilegeMask = std::bitset<size_t(Privilege::Impersonate) + 1>;
 
+/**
+ * A flag shared by a user entry and all of the privilege contexts created
+ * from it. It is set once the user entry is replaced (or removed) by a new
+ * version of the privilege database, at which point all of the contexts
+ * created for the user is stale.
+ */
+using StaleFlag = std::shared_ptr<std::atomic<bool>>;
+
+class PrivilegeContext;
+class PrivilegeDatabase;
+
 /**
  * The UserEntry object is in an in-memory representation of the per-user
  * privileges.
@@ -91,7 +103,30 @@ public:
         return internal;
     }
 
+    /**
+     * Get the generation of this user entry. The generation is the
+     * generation of the privilege database where the entry was last
+     * modified (an entry which is identical in the next version of the
+     * database keeps its generation).
+     */
+    uint32_t getGeneration() const {
+        return generation;
+    }
+
+    /**
+     * Two user entries are equal if they grant the same privileges (the
+     * generation is not part of the comparison)
+     */
+    bool operator==(const UserEntry& other) const;
+
+    bool operator!=(const UserEntry& other) const {
+        return !(*this == other);
+    }
+
 protected:
+    friend class PrivilegeContext;
+    friend class PrivilegeDatabase;
+
     /**
      * Parse a JSON array containing a set of privileges.
      *
@@ -107,6 +142,11 @@ protected:
     PrivilegeMask privileges;
     cb::sasl::Domain domain;
     bool internal;
+
+    /// The generation of the privilege database the entry was created in
+    uint32_t generation = 0;
+    /// Set when the entry is replaced by a newer version of the database
+    StaleFlag stale;
 };
 
 /**
@@ -129,14 +169,14 @@ public:
     }
 
     /**
-     * Create a new instance of the privilege context from the
-     * given generation and assign it the given mask.
+     * Create a new instance of the privilege context for the given
+     * user entry and assign it the given mask.
      *
-     * @param gen the generation of the privilege database
+     * @param user the user entry the context is created from
      * @param m the mask to set it to.
      */
-    PrivilegeContext(uint32_t gen, const PrivilegeMask& m)
-        : generation(gen), mask(m) {
+    PrivilegeContext(const UserEntry& user, const PrivilegeMask& m)
+        : generation(user.getGeneration()), stale(user.stale), mask(m) {
         // empty
     }
 
@@ -149,9 +189,9 @@ public:
     PrivilegeAccess check(Privilege privilege) const;
 
     /**
-     * Get the generation of the Privilege Database this context maps
-     * to. If there is a mismatch with this number and the current number
-     * of the privilege database this context is no longer valid.
+     * Get the generation of the user entry this context was created
+     * from. The context is no longer valid once the user entry is
+     * modified or removed from the privilege database.
      */
     uint32_t getGeneration() const {
         return generation;
@@ -192,6 +232,8 @@ protected:
     void setBucketPrivilegeBits(bool value);
 
     uint32_t generation;
+    /// Shared with the user entry (empty for the initial context)
+    StaleFlag stale;
     PrivilegeMask mask;
 };
 
@@ -237,10 +279,14 @@ public:
      *
      * @param json A JSON representation of the privilege database as
      *             specified above (or null to create an empty database)
+     * @param previous The database this one replaces (if any). Users
+     *                 whose entries are unchanged keep their generation
+     *                 so that their privilege contexts stay valid.
      * @throws std::invalid_argument for invalid syntax
      * @throws std::bad_alloc if we run out of memory
      */
-    PrivilegeDatabase(const cJSON* json);
+    PrivilegeDatabase(const cJSON* json,
+                      const PrivilegeDatabase* previous = nullptr);
 
     /**
      * Try to look up a user in the privilege database
@@ -264,17 +310,13 @@ public:
      *
      * @param context The privilege context for the user
      * @param privilege The privilege to check
-     * @return PrivilegeAccess::Stale If the context was created by a
-     *                                different generation of the database
+     * @return PrivilegeAccess::Stale If the user entry the context was
+     *                                created from has been modified
      *         PrivilegeAccess::Ok If the context contains the privilege
      *         PrivilegeAccess::Fail If the context lacks the privilege
      */
     PrivilegeAccess check(const PrivilegeContext& context,
-                          Privilege privilege) {
-        if (context.getGeneration() != generation) {
-            return PrivilegeAccess::Stale;
-        }
-
+                          Privilege privilege) const {
         return context.check(privilege);
     }
 
@@ -304,11 +346,21 @@ public:
      * @throws cb::rbac::NoSuchUserException if the user doesn't exist
      */
     std::pair<PrivilegeContext, bool> createInitialContext(
-            const std::string& user, cb::sasl::Domain domain);
+            const std::string& user, cb::sasl::Domain domain) const;
+
+    /**
+     * Mark the privilege contexts for all of the users in this database
+     * whose entries was modified or removed in the provided database as
+     * stale. Called when the provided database replaces this one.
+     *
+     * @param next The database replacing this one
+     * @return The number of users invalidated
+     */
+    size_t invalidateChangedUsers(const PrivilegeDatabase& next) const;
 
     /**
-     * The generation for this PrivilegeDatabase (a privilege context must
-     * match this generation in order to be valid)
+     * The generation for this PrivilegeDatabase (user entries added or
+     * modified in this version of the database use this generation)
      */
     const uint32_t generation;
 
@@ -318,9 +370,8 @@ protected:
 
 /**
  * Create a new PrivilegeContext for the specified user in the specified
- * bucket.
- *
- * @todo this might starve the writers?
+ * bucket. The context is built from a snapshot of the current privilege
+ * database without blocking (or being blocked by) a reload.
  *
  * @param user The name of the user
  * @param bucket The name of the bucket (may be "" if you're not
@@ -349,7 +400,9 @@ std::pair<PrivilegeContext, bool> createInitialContext(const std::string& user,
                                                        cb::sasl::Domain domain);
 
 /**
- * Load the named file and install it as the current privilege database
+ * Load the named file and install it as the current privilege database.
+ * Only the privilege contexts for the users whose entries changed (or
+ * was removed) become stale.
  *
  * @param filename the name of the new file
  * @throws std::runtime_error
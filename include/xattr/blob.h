@@ -20,6 +20,8 @@
 #include <cstddef>
 #include <memory>
 #include <platform/sized_buffer.h>
+#include <utility>
+#include <vector>
 #include <xattr/visibility.h>
 
 namespace cb {
@@ -28,6 +30,13 @@ namespace xattr {
 /**
  * The cb::xattr::Blob is a class that provides easy access to the
  * binary format of the blob.
+ *
+ * Lookups scan the blob from the start, which is fine for the typical
+ * document with a handful of xattrs. For documents with many xattrs the
+ * Blob builds an index (the offset of each kv-pair, sorted by key) the
+ * first time a lookup has to walk past IndexThreshold pairs, and uses it
+ * for the following lookups until the blob is modified. The index only
+ * lives in memory; the encoded blob is unchanged.
  */
 class XATTR_PUBLIC_API Blob {
 public:
@@ -132,6 +141,24 @@ public:
         set(k, v);
     }
 
+    /**
+     * Apply a batch of changes to the blob, rewriting it once rather than
+     * once per key. Each element holds a key and its new value; an empty
+     * value removes the key. If a key is present multiple times the last
+     * one wins.
+     *
+     * Existing keys keep their position in the blob, and new keys are
+     * appended in the order they appear in the batch.
+     *
+     * @param changes The keys to set (or remove)
+     */
+    void update(const std::vector<std::pair<cb::const_byte_buffer,
+                                            cb::const_byte_buffer>>& changes);
+
+    /**
+     * Remove all of the user xattrs (the ones not starting with '_')
+     * from the blob
+     */
     void prune_user_keys();
 
     /**
@@ -215,7 +242,32 @@ public:
         return iterator(*this, blob.len);
     }
 
+    /**
+     * The number of kv-pairs a lookup must walk past before we build
+     * the index
+     */
+    static const size_t IndexThreshold = 8;
+
 protected:
+    /**
+     * Locate the kv-pair for the given key
+     *
+     * @param key The key to look up
+     * @param build_index Set to true to build the index if the lookup had
+     *                    to walk past IndexThreshold pairs
+     * @return the offset of the kv-pair (its length field), or blob.len if
+     *         the key isn't in the blob
+     */
+    size_t find_kvpair(const cb::const_byte_buffer& key,
+                       bool build_index) const;
+
+    /// Build the index of the kv-pairs in the blob
+    void build_index() const;
+
+    /// Drop the index (it needs to be rebuilt after the blob is modified)
+    void invalidate_index() {
+        index.clear();
+    }
 
     /**
      * Expand the buffer and write the kv-pair at the end of the buffer
@@ -276,6 +328,16 @@ private:
     std::unique_ptr<uint8_t[]>& allocator;
     std::unique_ptr<uint8_t[]> default_allocator;
     size_t alloc_size;
+
+    struct IndexEntry {
+        /// The offset of the kv-pair
+        uint32_t offset;
+        /// The length of the key
+        uint32_t keylen;
+    };
+
+    /// The kv-pairs sorted by key (empty if not built)
+    mutable std::vector<IndexEntry> index;
 };
 
 inline bool operator==(const Blob::iterator& lhs, const Blob::iterator& rhs) {
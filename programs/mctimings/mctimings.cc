@@ -28,6 +28,9 @@
 #include <cstdlib>
 #include <iostream>
 #include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
 
 static uint32_t getValue(cJSON *root, const char *key) {
     cJSON *obj = cJSON_GetObjectItem(root, key);
@@ -109,10 +112,50 @@ public:
             dump("s ", 80, 0, wayout[4]);
         }
         std::cout << "Total: " << total << " operations" << std::endl;
+        dumpPercentiles();
     }
 
 private:
 
+    /**
+     * Dump the percentiles calculated by the server from the high
+     * resolution (HDR) histogram (older servers don't provide it)
+     */
+    void dumpPercentiles() {
+        if (percentiles.empty()) {
+            return;
+        }
+
+        std::cout << std::endl
+                  << "Percentiles (" << precision
+                  << " significant figures):" << std::endl;
+        for (const auto& p : percentiles) {
+            char buffer[128];
+            snprintf(buffer,
+                     sizeof(buffer),
+                     "    p%-6s %10llu us",
+                     p.first.c_str(),
+                     (unsigned long long)p.second);
+            std::cout << buffer << std::endl;
+        }
+    }
+
+    void initializePercentiles(cJSON* root) {
+        auto* hdr = cJSON_GetObjectItem(root, "hdr");
+        if (hdr == nullptr) {
+            return;
+        }
+
+        precision = getValue(hdr, "precision");
+        auto* obj = cJSON_GetObjectItem(hdr, "percentiles");
+        if (obj == nullptr) {
+            return;
+        }
+        for (auto* i = obj->child; i != nullptr; i = i->next) {
+            percentiles.emplace_back(i->string, uint64_t(i->valuedouble));
+        }
+    }
+
     // Helper function for initialize
     static void update_max_and_total(uint32_t& max, uint64_t& total, Bin& bin) {
         total += bin.count;
@@ -181,6 +224,8 @@ private:
             oldwayout = true;
         }
 
+        initializePercentiles(root);
+
         // Calculate total and cumulative counts, and find the highest value.
         max = total = 0;
 
@@ -251,6 +296,12 @@ private:
     bool oldwayout;
 
     uint64_t total;
+
+    /// The number of significant figures used in the HDR histogram
+    uint32_t precision = 0;
+
+    /// The percentiles (name, value in µs) reported by the server
+    std::vector<std::pair<std::string, uint64_t>> percentiles;
 };
 
 std::string opcode2string(uint8_t opcode) {
@@ -19,7 +19,6 @@
 #include <cJSON_utils.h>
 #include <platform/make_unique.h>
 #include <platform/memorymap.h>
-#include <platform/rwlock.h>
 #include <strings.h>
 #include <atomic>
 #include <fstream>
@@ -32,13 +31,24 @@ namespace cb {
 namespace rbac {
 
 // Every time we create a new PrivilegeDatabase we bump the generation.
-// The PrivilegeContext contains the generation number it was generated
-// from so that we can easily detect if the PrivilegeContext is stale.
+// User entries which are added or modified in the new database get the
+// new generation, and entries which are unchanged keep the generation
+// (and stale flag) from the previous database so that only the privilege
+// contexts for the users which changed become stale.
 static std::atomic<uint32_t> generation{0};
 
-// The read write lock needed when you want to build a context
-cb::RWLock rwlock;
-std::unique_ptr<PrivilegeDatabase> db;
+// The current version of the privilege database. The front end threads
+// build the privilege contexts from a snapshot of the database (obtained
+// with std::atomic_load) so that they never wait for a reload.
+static std::shared_ptr<const PrivilegeDatabase> db;
+
+// Serialize the reloads so that each new database is diffed against the
+// one it replaces
+static std::mutex loadMutex;
+
+static std::shared_ptr<const PrivilegeDatabase> getDatabase() {
+    return std::atomic_load(&db);
+}
 
 UserEntry::UserEntry(const cJSON& root) {
     if (root.string == nullptr) {
@@ -81,6 +91,13 @@ UserEntry::UserEntry(const cJSON& root) {
                 "UserEntry::UserEntry::"
                 " \"domain\" should be a string");
     }
+
+    stale = std::make_shared<std::atomic<bool>>(false);
+}
+
+bool UserEntry::operator==(const UserEntry& other) const {
+    return internal == other.internal && domain == other.domain &&
+           privileges == other.privileges && buckets == other.buckets;
 }
 
 PrivilegeMask UserEntry::parsePrivileges(const cJSON* priv, bool buckets) {
@@ -127,16 +144,41 @@ PrivilegeMask UserEntry::parsePrivileges(const cJSON* priv, bool buckets) {
     return ret;
 }
 
-PrivilegeDatabase::PrivilegeDatabase(const cJSON* json)
+PrivilegeDatabase::PrivilegeDatabase(const cJSON* json,
+                                     const PrivilegeDatabase* previous)
     : generation(cb::rbac::generation.operator++()) {
 
     if (json != nullptr) {
         for (auto it = json->child; it != nullptr; it = it->next) {
-            userdb.emplace(it->string, UserEntry(*it));
+            UserEntry entry(*it);
+            entry.generation = generation;
+            if (previous != nullptr) {
+                auto iter = previous->userdb.find(it->string);
+                if (iter != previous->userdb.end() && iter->second == entry) {
+                    // Unchanged; the existing contexts remain valid
+                    entry.generation = iter->second.generation;
+                    entry.stale = iter->second.stale;
+                }
+            }
+            userdb.emplace(it->string, std::move(entry));
         }
     }
 }
 
+size_t PrivilegeDatabase::invalidateChangedUsers(
+        const PrivilegeDatabase& next) const {
+    size_t count = 0;
+    for (const auto& user : userdb) {
+        auto iter = next.userdb.find(user.first);
+        if (iter == next.userdb.end() ||
+            iter->second.stale != user.second.stale) {
+            user.second.stale->store(true);
+            ++count;
+        }
+    }
+    return count;
+}
+
 PrivilegeContext PrivilegeDatabase::createContext(
         const std::string& user, const std::string& bucket) const {
     PrivilegeMask mask;
@@ -155,20 +197,20 @@ PrivilegeContext PrivilegeDatabase::createContext(
 
     // Add the rest of the privileges
     mask |= ue.getPrivileges();
-    return PrivilegeContext(generation, mask);
+    return PrivilegeContext(ue, mask);
 }
 
 std::pair<PrivilegeContext, bool> PrivilegeDatabase::createInitialContext(
-        const std::string& user, cb::sasl::Domain domain) {
+        const std::string& user, cb::sasl::Domain domain) const {
     const auto& ue = lookup(user);
     if (ue.getDomain() != domain) {
         throw NoSuchUserException(user.c_str());
     }
-    return {PrivilegeContext(generation, ue.getPrivileges()), ue.isInternal()};
+    return {PrivilegeContext(ue, ue.getPrivileges()), ue.isInternal()};
 }
 
 PrivilegeAccess PrivilegeContext::check(Privilege privilege) const {
-    if (generation != cb::rbac::generation) {
+    if (!stale || stale->load()) {
         return PrivilegeAccess::Stale;
     }
 
@@ -242,14 +284,12 @@ void PrivilegeContext::setBucketPrivilegeBits(bool value) {
 
 PrivilegeContext createContext(const std::string& user,
                                const std::string& bucket) {
-    std::lock_guard<cb::ReaderLock> guard(rwlock.reader());
-    return db->createContext(user, bucket);
+    return getDatabase()->createContext(user, bucket);
 }
 
 std::pair<PrivilegeContext, bool> createInitialContext(
         const std::string& user, cb::sasl::Domain domain) {
-    std::lock_guard<cb::ReaderLock> guard(rwlock.reader());
-    return db->createInitialContext(user, domain);
+    return getDatabase()->createInitialContext(user, domain);
 }
 
 void loadPrivilegeDatabase(const std::string& filename) {
@@ -265,23 +305,27 @@ void loadPrivilegeDatabase(const std::string& filename) {
                 "PrivilegeDatabaseManager::load: Failed to parse json");
     }
 
-    auto database = std::make_unique<PrivilegeDatabase>(json.get());
+    std::lock_guard<std::mutex> guard(loadMutex);
+    auto current = getDatabase();
+    std::shared_ptr<const PrivilegeDatabase> database =
+            std::make_shared<PrivilegeDatabase>(json.get(), current.get());
+    std::atomic_store(&db, database);
 
-    std::lock_guard<cb::WriterLock> guard(rwlock.writer());
-    // Handle race conditions
-    if (db->generation < database->generation) {
-        db.swap(database);
-    }
+    // Contexts created from the old database after this point use the
+    // stale flag we're about to set, so they'll be rebuilt as well
+    current->invalidateChangedUsers(*database);
 }
 
 void initialize() {
     // Create an empty database to avoid having to add checks
     // if it exists or not...
-    db = std::make_unique<PrivilegeDatabase>(nullptr);
+    std::atomic_store(&db,
+                      std::shared_ptr<const PrivilegeDatabase>(
+                              std::make_shared<PrivilegeDatabase>(nullptr)));
 }
 
 void destroy() {
-    db.reset();
+    std::atomic_store(&db, std::shared_ptr<const PrivilegeDatabase>());
 }
 
 bool mayAccessBucket(const std::string& user, const std::string& bucket) {
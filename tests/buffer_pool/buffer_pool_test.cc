@@ -0,0 +1,90 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2018 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include <daemon/buffer_pool.h>
+#include <gtest/gtest.h>
+
+TEST(PipePoolTest, EmptyPool) {
+    PipePool pool;
+    EXPECT_FALSE(pool.get());
+    const auto stats = pool.getStats();
+    EXPECT_EQ(0, stats.count);
+    EXPECT_EQ(0, stats.bytes);
+}
+
+TEST(PipePoolTest, PutAndGet) {
+    PipePool pool;
+    auto pipe = PipePool::allocate();
+    const auto capacity = pipe->capacity();
+    EXPECT_TRUE(pool.put(std::move(pipe)));
+
+    auto stats = pool.getStats();
+    EXPECT_EQ(1, stats.count);
+    EXPECT_EQ(capacity, stats.bytes);
+
+    pipe = pool.get();
+    ASSERT_TRUE(pipe);
+    EXPECT_EQ(capacity, pipe->capacity());
+    stats = pool.getStats();
+    EXPECT_EQ(0, stats.count);
+    EXPECT_EQ(0, stats.bytes);
+}
+
+TEST(PipePoolTest, SmallestBufferFirst) {
+    PipePool pool;
+    auto big = PipePool::allocate();
+    big->ensureCapacity(PipePool::SizeClasses[1]);
+    const auto bigCapacity = big->capacity();
+    ASSERT_LE(bigCapacity, PipePool::SizeClasses.back());
+
+    EXPECT_TRUE(pool.put(std::move(big)));
+    EXPECT_TRUE(pool.put(PipePool::allocate()));
+
+    auto pipe = pool.get();
+    ASSERT_TRUE(pipe);
+    EXPECT_GT(bigCapacity, pipe->capacity());
+    pipe = pool.get();
+    ASSERT_TRUE(pipe);
+    EXPECT_EQ(bigCapacity, pipe->capacity());
+}
+
+TEST(PipePoolTest, OversizedBufferReleased) {
+    PipePool pool;
+    auto pipe = PipePool::allocate();
+    pipe->ensureCapacity(PipePool::SizeClasses.back() * 2);
+    EXPECT_FALSE(pool.put(std::move(pipe)));
+    EXPECT_EQ(0, pool.getStats().count);
+}
+
+TEST(PipePoolTest, SizeClassLimit) {
+    PipePool pool(2);
+    EXPECT_TRUE(pool.put(PipePool::allocate()));
+    EXPECT_TRUE(pool.put(PipePool::allocate()));
+    EXPECT_FALSE(pool.put(PipePool::allocate()));
+    EXPECT_EQ(2, pool.getStats().count);
+
+    pool.clear();
+    EXPECT_EQ(0, pool.getStats().count);
+    EXPECT_EQ(0, pool.getStats().bytes);
+}
+
+TEST(PipePoolTest, PutNonEmpty) {
+    PipePool pool;
+    auto pipe = PipePool::allocate();
+    pipe->produced(1);
+    EXPECT_THROW(pool.put(std::move(pipe)), std::logic_error);
+}
@@ -785,6 +785,25 @@ TEST_F(SettingsTest, max_packet_size) {
     }
 }
 
+TEST_F(SettingsTest, TracingSampleRate) {
+    nonNumericValuesShouldFail("tracing_sample_rate");
+
+    unique_cJSON_ptr obj(cJSON_CreateObject());
+    cJSON_AddNumberToObject(obj.get(), "tracing_sample_rate", 1000);
+    try {
+        Settings settings(obj);
+        EXPECT_EQ(1000, settings.getTracingSampleRate());
+        EXPECT_TRUE(settings.has.tracing_sample_rate);
+    } catch (std::exception& exception) {
+        FAIL() << exception.what();
+    }
+
+    // Negative values isn't allowed
+    obj.reset(cJSON_CreateObject());
+    cJSON_AddNumberToObject(obj.get(), "tracing_sample_rate", -1);
+    EXPECT_THROW(Settings settings(obj), std::invalid_argument);
+}
+
 TEST_F(SettingsTest, SaslMechanisms) {
     nonStringValuesShouldFail("sasl_mechanisms");
 
@@ -0,0 +1,104 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2018 Couchbase, Inc.
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include <daemon/hdr_histogram.h>
+#include <gtest/gtest.h>
+
+#include <cmath>
+
+TEST(HdrHistogramTest, InvalidPrecision) {
+    EXPECT_THROW(HdrHistogram(0), std::invalid_argument);
+    EXPECT_THROW(HdrHistogram(4), std::invalid_argument);
+}
+
+TEST(HdrHistogramTest, Empty) {
+    HdrHistogram histogram(2);
+    EXPECT_EQ(0, histogram.getTotal());
+    EXPECT_EQ(0, histogram.getValueAtPercentile(99.9));
+}
+
+TEST(HdrHistogramTest, SingleUnitResolution) {
+    HdrHistogram histogram(2);
+    for (uint64_t ii = 0; ii < 200; ++ii) {
+        histogram.add(ii);
+    }
+    EXPECT_EQ(200, histogram.getTotal());
+    EXPECT_EQ(99, histogram.getValueAtPercentile(50));
+    EXPECT_EQ(199, histogram.getValueAtPercentile(100));
+}
+
+// Verify that we keep the requested precision in the 1-20ms range
+TEST(HdrHistogramTest, Precision) {
+    for (int figures = 1; figures <= 3; ++figures) {
+        HdrHistogram histogram(figures);
+        const double maxError = 1.0 / std::pow(10, figures);
+        for (uint64_t value = 1000; value < 20000; value += 997) {
+            histogram.reset();
+            histogram.add(value);
+            const auto recorded = histogram.getValueAtPercentile(100);
+            EXPECT_GE(recorded, value);
+            EXPECT_LE(double(recorded - value) / value, maxError)
+                    << "figures:" << figures << " value:" << value;
+        }
+    }
+}
+
+TEST(HdrHistogramTest, Percentiles) {
+    HdrHistogram histogram(3);
+    for (uint64_t ii = 1; ii <= 10000; ++ii) {
+        histogram.add(ii);
+    }
+
+    EXPECT_NEAR(5000, histogram.getValueAtPercentile(50), 5);
+    EXPECT_NEAR(9900, histogram.getValueAtPercentile(99), 10);
+    EXPECT_NEAR(9990, histogram.getValueAtPercentile(99.9), 10);
+}
+
+TEST(HdrHistogramTest, ValuesAboveHighestTrackable) {
+    HdrHistogram histogram(1, 1000000);
+    histogram.add(uint64_t(10000000));
+    EXPECT_EQ(1, histogram.getTotal());
+    EXPECT_LE(1000000, histogram.getValueAtPercentile(100));
+}
+
+TEST(HdrHistogramTest, Merge) {
+    HdrHistogram a(2);
+    HdrHistogram b(2);
+    a.add(uint64_t(10));
+    b.add(uint64_t(10000));
+    a += b;
+    EXPECT_EQ(2, a.getTotal());
+    EXPECT_EQ(10, a.getValueAtPercentile(50));
+    EXPECT_NEAR(10000, a.getValueAtPercentile(100), 100);
+
+    HdrHistogram c(1);
+    EXPECT_THROW(c += a, std::invalid_argument);
+
+    HdrHistogram copy(a);
+    EXPECT_EQ(2, copy.getTotal());
+}
+
+TEST(HdrHistogramTest, Json) {
+    HdrHistogram histogram(2);
+    histogram.add(std::chrono::milliseconds(5));
+    auto json = histogram.to_json();
+    ASSERT_NE(nullptr, cJSON_GetObjectItem(json.get(), "percentiles"));
+    auto* buckets = cJSON_GetObjectItem(json.get(), "buckets");
+    ASSERT_NE(nullptr, buckets);
+    EXPECT_EQ(1, cJSON_GetArraySize(buckets));
+    EXPECT_EQ(2, cJSON_GetObjectItem(json.get(), "precision")->valueint);
+}
@@ -51,13 +51,13 @@ protected:
             remove_files(files);
         }
 
-        /* Note: Ensure buffer is at least 4* larger than the expected message
-         * length, otherwise the writer will be blocked waiting for the flusher
-         * thread to timeout and write (as we haven't actually hit the 75%
-         * watermark which would normally trigger an immediate flush).
+        /* Note: Ensure the buffer is big enough to hold all of the messages
+         * logged by the tests, as the messages are dropped (rather than
+         * blocking the writer) if the flusher thread can't keep up. The
+         * logging thread gets 1/16th of buffersize.
          */
         ret = memcached_extensions_initialize("unit_test=true;"
-                  "cyclesize=2048;buffersize=8192;"
+                  "cyclesize=2048;buffersize=33554432;"
                   "sleeptime=1;filename=logger_test", get_server_api);
         cb_assert(ret == EXTENSION_SUCCESS);
 
@@ -130,9 +130,9 @@ TEST_F(LoggerTest, Rotate) {
     files = cb::io::findFilesWithPrefix("logger_test");
 
     // The cyclesize isn't a hard limit. We don't truncate entries that
-    // won't fit to move to the next file. We'll rather dump the entire
-    // buffer to the file. This means that each file may in theory be
-    // up to a buffersize bigger than the cyclesize.. It is a bit hard
+    // won't fit to move to the next file. We'll rather write the entire
+    // entry to the file. This means that each file may in theory be
+    // up to an entry bigger than the cyclesize.. It is a bit hard
     // determine the exact number of files we should get here.. Testing
     // on MacOSX I'm logging 97 bytes in my timezone (summertime), but
     // on Windows it turned out to be a much longer timezone name etc..
@@ -141,6 +141,41 @@ TEST_F(LoggerTest, Rotate) {
     remove_files(files);
 }
 
+TEST_F(LoggerTest, DropWhenFull) {
+    // Restart the logger with a small buffer
+    logger->shutdown(false);
+    files = cb::io::findFilesWithPrefix("logger_test");
+    remove_files(files);
+
+    ret = memcached_extensions_initialize("unit_test=true;"
+              "cyclesize=104857600;buffersize=8192;"
+              "sleeptime=1;filename=logger_test", get_server_api);
+    cb_assert(ret == EXTENSION_SUCCESS);
+
+    // The buffer only holds a handful of entries, so most of these
+    // should be dropped (and reported) rather than block the thread
+    for (auto ii = 0; ii < 1024; ++ii) {
+        logger->log(EXTENSION_LOG_DETAIL, NULL, "Message %05u", ii);
+    }
+    logger->shutdown(false);
+
+    files = cb::io::findFilesWithPrefix("logger_test");
+    ASSERT_EQ(1, files.size());
+
+    FILE* fp = fopen(files[0].c_str(), "r");
+    ASSERT_NE(nullptr, fp);
+    char buffer[1024];
+    bool found = false;
+    while (fgets(buffer, sizeof(buffer), fp) != NULL) {
+        if (strstr(buffer, "log messages (log buffer full)") != NULL) {
+            found = true;
+        }
+    }
+    fclose(fp);
+    EXPECT_TRUE(found);
+    remove_files(files);
+}
+
 static bool my_fgets(char *buffer, size_t buffsize, FILE *fp) {
     if (fgets(buffer, (int)buffsize, fp) != NULL) {
         char *end = strchr(buffer, '\n');
@@ -184,7 +219,7 @@ TEST_F(LoggerTest, DISABLED_Dedupe) {
 
     std::string config("unit_test=true;"
                        "cyclesize=1024;"
-                       "buffersize=1024;"
+                       "buffersize=2097152;"
                        "sleeptime=1;"
                        "filename=");
     config.append(filename);
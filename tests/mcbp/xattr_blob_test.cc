@@ -243,3 +243,104 @@ TEST(XattrBlob, iterator_insert) {
         }
     }
 }
+
+/**
+ * Lookups in blobs with more than IndexThreshold keys use the index, which
+ * must be kept in sync as the blob is modified
+ */
+TEST(XattrBlob, IndexedLookup) {
+    cb::xattr::Blob blob;
+    const int nkeys = cb::xattr::Blob::IndexThreshold * 4;
+    for (int ii = 0; ii < nkeys; ++ii) {
+        blob.set("key" + std::to_string(ii), std::to_string(ii));
+    }
+
+    // The first lookups build the index, the rest use it
+    for (int pass = 0; pass < 2; ++pass) {
+        for (int ii = 0; ii < nkeys; ++ii) {
+            EXPECT_EQ(std::to_string(ii),
+                      to_string(blob.get("key" + std::to_string(ii))));
+        }
+        EXPECT_TRUE(blob.get("key").len == 0);
+        EXPECT_TRUE(blob.get("key" + std::to_string(nkeys)).len == 0);
+        EXPECT_TRUE(blob.get("key10000").len == 0);
+    }
+
+    // Same size replacement keeps the layout
+    blob.set("key7", "x");
+    EXPECT_EQ("x", to_string(blob.get("key7")));
+
+    // Growing, adding and removing keys change it
+    blob.set("key8", "\"a longer value\"");
+    blob.set("new", "true");
+    blob.remove(to_const_byte_buffer("key9"));
+    validate(blob.finalize());
+
+    EXPECT_EQ("\"a longer value\"", to_string(blob.get("key8")));
+    EXPECT_EQ("true", to_string(blob.get("new")));
+    EXPECT_TRUE(blob.get("key9").len == 0);
+    for (int ii = 10; ii < nkeys; ++ii) {
+        EXPECT_EQ(std::to_string(ii),
+                  to_string(blob.get("key" + std::to_string(ii))));
+    }
+}
+
+TEST(XattrBlob, BatchUpdate) {
+    cb::xattr::Blob blob;
+    blob.set("a", "1");
+    blob.set("b", "2");
+    blob.set("c", "3");
+
+    const std::string value = "{\"foo\":\"bar\"}";
+    blob.update({{to_const_byte_buffer("b"), to_const_byte_buffer(value.c_str())},
+                 {to_const_byte_buffer("c"), {}},
+                 {to_const_byte_buffer("d"), to_const_byte_buffer("4")},
+                 {to_const_byte_buffer("e"), to_const_byte_buffer("5")},
+                 {to_const_byte_buffer("e"), to_const_byte_buffer("6")},
+                 {to_const_byte_buffer("missing"), {}}});
+    validate(blob.finalize());
+
+    // Existing keys stay in place, new ones are appended
+    std::vector<std::pair<std::string, std::string>> expected = {
+            {"a", "1"}, {"b", value}, {"d", "4"}, {"e", "6"}};
+    std::vector<std::pair<std::string, std::string>> actual;
+    for (const auto& kv : blob) {
+        actual.emplace_back(to_string(kv.first), to_string(kv.second));
+    }
+    EXPECT_EQ(expected, actual);
+
+    // The values may refer to the blob itself
+    auto a = blob.get("a");
+    blob.update({{to_const_byte_buffer("f"), {a.buf, a.len}}});
+    EXPECT_EQ("1", to_string(blob.get("f")));
+
+    // Removing everything leaves an empty blob
+    blob.update({{to_const_byte_buffer("a"), {}},
+                 {to_const_byte_buffer("b"), {}},
+                 {to_const_byte_buffer("d"), {}},
+                 {to_const_byte_buffer("e"), {}},
+                 {to_const_byte_buffer("f"), {}}});
+    EXPECT_EQ(0, blob.finalize().len);
+}
+
+TEST(XattrBlob, PruneManyUserKeys) {
+    cb::xattr::Blob blob;
+    for (int ii = 0; ii < 32; ++ii) {
+        blob.set((ii % 3 == 0 ? "_sys" : "user") + std::to_string(ii),
+                 std::to_string(ii));
+    }
+    // Build the index so we know pruning drops it
+    EXPECT_EQ("31", to_string(blob.get("user31")));
+
+    blob.prune_user_keys();
+    validate(blob.finalize());
+    EXPECT_EQ(blob.get_system_size(), blob.finalize().len);
+    for (int ii = 0; ii < 32; ++ii) {
+        if (ii % 3 == 0) {
+            EXPECT_EQ(std::to_string(ii),
+                      to_string(blob.get("_sys" + std::to_string(ii))));
+        } else {
+            EXPECT_TRUE(blob.get("user" + std::to_string(ii)).len == 0);
+        }
+    }
+}
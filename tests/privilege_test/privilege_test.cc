@@ -88,3 +88,62 @@ TEST(PrivilegeDatabaseTest, GenerationCounter) {
     cb::rbac::PrivilegeDatabase db2(nullptr);
     EXPECT_GT(db2.generation, db1.generation);
 }
+
+static void addUser(cJSON* root,
+                    const char* name,
+                    const std::vector<const char*>& privileges) {
+    cJSON* user = cJSON_CreateObject();
+    cJSON_AddItemToObject(root, name, user);
+    cJSON* buckets = cJSON_CreateObject();
+    cJSON_AddItemToObject(user, "buckets", buckets);
+    cJSON* array = cJSON_CreateArray();
+    for (const auto* privilege : privileges) {
+        cJSON_AddItemToArray(array, cJSON_CreateString(privilege));
+    }
+    cJSON_AddItemToObject(buckets, "bucket", array);
+}
+
+TEST(PrivilegeDatabaseTest, IncrementalReload) {
+    unique_cJSON_ptr root(cJSON_CreateObject());
+    addUser(root.get(), "unchanged", {"Read"});
+    addUser(root.get(), "modified", {"Read"});
+    addUser(root.get(), "removed", {"Read"});
+    cb::rbac::PrivilegeDatabase db1(root.get());
+
+    const auto unchanged = db1.createContext("unchanged", "bucket");
+    const auto modified = db1.createContext("modified", "bucket");
+    const auto removed = db1.createContext("removed", "bucket");
+    EXPECT_EQ(cb::rbac::PrivilegeAccess::Ok,
+              modified.check(cb::rbac::Privilege::Read));
+
+    root.reset(cJSON_CreateObject());
+    addUser(root.get(), "unchanged", {"Read"});
+    addUser(root.get(), "modified", {"Read", "Upsert"});
+    addUser(root.get(), "added", {"Read"});
+    cb::rbac::PrivilegeDatabase db2(root.get(), &db1);
+
+    EXPECT_EQ(db1.lookup("unchanged").getGeneration(),
+              db2.lookup("unchanged").getGeneration());
+    EXPECT_EQ(db2.generation, db2.lookup("modified").getGeneration());
+    EXPECT_EQ(db2.generation, db2.lookup("added").getGeneration());
+
+    EXPECT_EQ(2, db1.invalidateChangedUsers(db2));
+
+    EXPECT_EQ(cb::rbac::PrivilegeAccess::Ok,
+              unchanged.check(cb::rbac::Privilege::Read));
+    EXPECT_EQ(cb::rbac::PrivilegeAccess::Stale,
+              modified.check(cb::rbac::Privilege::Read));
+    EXPECT_EQ(cb::rbac::PrivilegeAccess::Stale,
+              removed.check(cb::rbac::Privilege::Read));
+
+    // A context built from the new database is valid
+    EXPECT_EQ(cb::rbac::PrivilegeAccess::Ok,
+              db2.createContext("modified", "bucket")
+                      .check(cb::rbac::Privilege::Upsert));
+}
+
+TEST(PrivilegeDatabaseTest, InitialContextIsStale) {
+    cb::rbac::PrivilegeContext context;
+    EXPECT_EQ(cb::rbac::PrivilegeAccess::Stale,
+              context.check(cb::rbac::Privilege::Read));
+}
@@ -0,0 +1,132 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2018 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include <daemon/subdocument_index.h>
+#include <gtest/gtest.h>
+
+#include <string>
+
+class SubdocIndexTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        document = R"({"name":"Trond", "age" : 42, "address":{"city":"Oslo",)"
+                   R"("zip":[1,2,3]}, "tags":[{"a":true},[null, -1.5e3]],)"
+                   R"("a.b":{"c`d":"quoted"}, "empty":{}, "list":[],)"
+                   R"("esc\"aped":1, "last":true, "name":"duplicate"})";
+        ASSERT_TRUE(index.build({document.data(), document.size()}));
+    }
+
+    /// Look up the path, returning the located value (or "<fallback>" if
+    /// the index couldn't answer)
+    std::string lookup(const std::string& path) {
+        cb::const_char_buffer value;
+        if (!index.lookup({path.data(), path.size()}, value)) {
+            return "<fallback>";
+        }
+        return {value.buf, value.len};
+    }
+
+    std::string document;
+    SubdocIndex index;
+};
+
+TEST_F(SubdocIndexTest, Members) {
+    EXPECT_EQ(R"("Trond")", lookup("name"));
+    EXPECT_EQ("42", lookup("age"));
+    EXPECT_EQ(R"({"city":"Oslo","zip":[1,2,3]})", lookup("address"));
+    EXPECT_EQ(R"("Oslo")", lookup("address.city"));
+    EXPECT_EQ("{}", lookup("empty"));
+    EXPECT_EQ("[]", lookup("list"));
+}
+
+TEST_F(SubdocIndexTest, ArrayElements) {
+    EXPECT_EQ("1", lookup("address.zip[0]"));
+    EXPECT_EQ("3", lookup("address.zip[2]"));
+    EXPECT_EQ("3", lookup("address.zip[-1]"));
+    EXPECT_EQ("true", lookup("tags[0].a"));
+    EXPECT_EQ("null", lookup("tags[1][0]"));
+    EXPECT_EQ("-1.5e3", lookup("tags[1][-1]"));
+}
+
+TEST_F(SubdocIndexTest, QuotedKeys) {
+    EXPECT_EQ(R"({"c`d":"quoted"})", lookup("`a.b`"));
+    EXPECT_EQ(R"("quoted")", lookup("`a.b`.`c``d`"));
+}
+
+TEST_F(SubdocIndexTest, DuplicateKeysUseFirst) {
+    EXPECT_EQ(R"("Trond")", lookup("name"));
+}
+
+TEST_F(SubdocIndexTest, Fallback) {
+    // Missing paths and type mismatches are left for subjson to report
+    EXPECT_EQ("<fallback>", lookup("missing"));
+    EXPECT_EQ("<fallback>", lookup("address.zip[3]"));
+    EXPECT_EQ("<fallback>", lookup("list[-1]"));
+    EXPECT_EQ("<fallback>", lookup("name.first"));
+    EXPECT_EQ("<fallback>", lookup("address[0]"));
+    EXPECT_EQ("<fallback>", lookup("tags.a"));
+
+    // The index can't compare keys containing escape sequences, so it
+    // can't tell if any of the keys following them match
+    EXPECT_EQ("<fallback>", lookup("last"));
+
+    // Paths the index doesn't parse
+    EXPECT_EQ("<fallback>", lookup(""));
+    EXPECT_EQ("<fallback>", lookup(".name"));
+    EXPECT_EQ("<fallback>", lookup("name."));
+    EXPECT_EQ("<fallback>", lookup("address..city"));
+    EXPECT_EQ("<fallback>", lookup("address.[0]"));
+    EXPECT_EQ("<fallback>", lookup("address.zip[01]"));
+    EXPECT_EQ("<fallback>", lookup("address.zip[-2]"));
+    EXPECT_EQ("<fallback>", lookup("address.zip[1"));
+    EXPECT_EQ("<fallback>", lookup("`a.b"));
+}
+
+TEST(SubdocIndexBuildTest, ScalarRoot) {
+    SubdocIndex index;
+    const std::string doc = " 123 ";
+    EXPECT_TRUE(index.build({doc.data(), doc.size()}));
+    cb::const_char_buffer value;
+    EXPECT_FALSE(index.lookup({"a", 1}, value));
+}
+
+TEST(SubdocIndexBuildTest, InvalidDocuments) {
+    SubdocIndex index;
+    for (const std::string doc : {"",
+                                  "{",
+                                  R"({"a":})",
+                                  R"({"a":1,})",
+                                  "[1,]",
+                                  "[01]",
+                                  R"(["unterminated])",
+                                  "{} {}",
+                                  "nul"}) {
+        EXPECT_FALSE(index.build({doc.data(), doc.size()})) << doc;
+        cb::const_char_buffer value;
+        EXPECT_FALSE(index.lookup({"a", 1}, value)) << doc;
+    }
+}
+
+TEST(SubdocIndexBuildTest, MaxDepth) {
+    SubdocIndex index;
+    std::string doc(SubdocIndex::MaxDepth, '[');
+    doc.append(SubdocIndex::MaxDepth, ']');
+    EXPECT_TRUE(index.build({doc.data(), doc.size()}));
+
+    doc = "[" + doc + "]";
+    EXPECT_FALSE(index.build({doc.data(), doc.size()}));
+}
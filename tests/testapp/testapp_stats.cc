@@ -299,6 +299,22 @@ TEST_P(StatsTest, TestSchedulerInfo_InvalidSubcommand) {
     }
 }
 
+TEST_P(StatsTest, TestSaslAuth) {
+    // The connection is authenticated as part of the test setup
+    auto stats = getConnection().stats("sasl_auth");
+    EXPECT_NE(nullptr, cJSON_GetObjectItem(stats.get(), "execute"));
+    EXPECT_NE(nullptr, cJSON_GetObjectItem(stats.get(), "total"));
+}
+
+TEST_P(StatsTest, TestSaslAuth_InvalidSubcommand) {
+    try {
+        getConnection().stats("sasl_auth foo");
+        FAIL() << "Invalid subcommand";
+    } catch (const ConnectionError& error) {
+        EXPECT_TRUE(error.isInvalidArguments());
+    }
+}
+
 TEST_P(StatsTest, TestAggregate) {
     MemcachedConnection& conn = getConnection();
     auto stats = conn.stats("aggregate");
@@ -463,6 +479,20 @@ TEST_P(StatsTest, TestTracingStats) {
     EXPECT_NE(nullptr, enabled);
 }
 
+TEST_P(StatsTest, SlowTracesStatsIsPrivileged) {
+    MemcachedConnection& conn = getConnection();
+
+    try {
+        conn.stats("slow_traces");
+        FAIL() << "slow_traces is a privileged operation";
+    } catch (ConnectionError& error) {
+        EXPECT_TRUE(error.isAccessDenied());
+    }
+
+    conn.authenticate("@admin", "password", "PLAIN");
+    conn.stats("slow_traces");
+}
+
 /**
  * Subclass of StatsTest which doesn't have a default bucket; hence connections
  * will intially not be associated with any bucket.
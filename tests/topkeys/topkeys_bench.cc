@@ -18,6 +18,7 @@
 
 #include <gtest/gtest.h>
 #include <memory>
+#include <thread>
 
 
 class TopKeysTest : public ::testing::Test {
@@ -58,3 +59,41 @@ TEST_F(TopKeysTest, Basic) {
     topkeys->stats(&count, 0, dump_key);
     EXPECT_EQ(80, count);
 }
+
+static void collect_key(const char* key,
+                        const uint16_t klen,
+                        const char* val,
+                        const uint32_t vlen,
+                        gsl::not_null<const void*> cookie) {
+    auto* keys =
+            static_cast<std::vector<std::string>*>(const_cast<void*>(cookie.get()));
+    keys->emplace_back(key, klen);
+}
+
+// Verify that the most frequently accessed keys are reported even if
+// there is a lot more (infrequently accessed) keys than we track, and
+// that the accesses from multiple threads are merged.
+TEST_F(TopKeysTest, HeavyHitters) {
+    const std::string hot = "hot_key";
+    std::vector<std::thread> threads;
+    for (int tt = 0; tt < 4; ++tt) {
+        threads.emplace_back([this, &hot, tt]() {
+            for (int jj = 0; jj < 10000; jj++) {
+                const auto cold = "cold_" + std::to_string(tt) + "_" +
+                                  std::to_string(jj);
+                topkeys->updateKey(cold.c_str(), cold.size(), jj);
+                if ((jj % 10) == 0) {
+                    topkeys->updateKey(hot.c_str(), hot.size(), jj);
+                }
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    std::vector<std::string> keys;
+    topkeys->stats(&keys, 0, collect_key);
+    ASSERT_EQ(80, keys.size());
+    EXPECT_EQ(hot, keys.front());
+}
@@ -72,3 +72,34 @@ TEST_F(TracingTest, ErrorRate) {
         EXPECT_LE((micros - decoded) * 100.0 / micros, 0.5);
     }
 }
+
+TEST_F(TracingTest, EndMostRecentSpan) {
+    EXPECT_EQ(0, tracer.begin(cb::tracing::TraceCode::REQUEST));
+    EXPECT_EQ(1, tracer.begin(cb::tracing::TraceCode::GET));
+    EXPECT_EQ(2, tracer.begin(cb::tracing::TraceCode::GET));
+    usleep(1000);
+
+    // The innermost span should be ended first
+    EXPECT_TRUE(tracer.end(cb::tracing::TraceCode::GET));
+    auto spans = tracer.getDurations();
+    ASSERT_EQ(3, spans.size());
+    EXPECT_EQ(0, spans[1].duration.count());
+    EXPECT_GE(spans[2].duration.count(), 1000);
+}
+
+TEST_F(TracingTest, SpansBeyondMaxAreDropped) {
+    for (size_t ii = 0; ii < cb::tracing::Tracer::MaxSpans; ++ii) {
+        EXPECT_EQ(ii, tracer.begin(cb::tracing::TraceCode::GET));
+    }
+    EXPECT_EQ(cb::tracing::Tracer::invalidSpanId(),
+              tracer.begin(cb::tracing::TraceCode::STORE));
+    EXPECT_EQ(cb::tracing::Tracer::MaxSpans, tracer.size());
+    EXPECT_FALSE(tracer.end(cb::tracing::TraceCode::STORE));
+    EXPECT_FALSE(tracer.end(cb::tracing::Tracer::invalidSpanId()));
+
+    // Clearing the tracer makes room for new spans
+    tracer.clear();
+    EXPECT_EQ(0, tracer.size());
+    EXPECT_EQ(0, tracer.begin(cb::tracing::TraceCode::STORE));
+    EXPECT_TRUE(tracer.end(cb::tracing::TraceCode::STORE));
+}
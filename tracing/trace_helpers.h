@@ -40,11 +40,11 @@ public:
                  const void* ck,
                  const cb::tracing::TraceCode code)
         : api(api), ck(ck), code(code) {
-        if (api->tracing->is_tracing_enabled(ck)) {
+        if (ck && api->tracing->is_tracing_enabled(ck)) {
             api->tracing->begin_trace(ck, code);
         } else {
-            api = nullptr;
-            ck = nullptr;
+            this->api = nullptr;
+            this->ck = nullptr;
         }
     }
 
@@ -31,49 +31,52 @@ std::chrono::microseconds to_micros(const ProcessClock::time_point tp) {
 namespace cb {
 namespace tracing {
 
+const size_t Tracer::MaxSpans;
+
 Tracer::SpanId Tracer::invalidSpanId() {
     return std::numeric_limits<SpanId>::max();
 }
 
 Tracer::SpanId Tracer::begin(const TraceCode tracecode) {
-    std::lock_guard<std::mutex> lock(spanMutex);
-    auto t = to_micros(ProcessClock::now());
-    vecSpans.push_back(Span(tracecode, t));
-    return vecSpans.size() - 1;
+    const auto spanId = numSpans.load(std::memory_order_acquire);
+    if (spanId == MaxSpans) {
+        return invalidSpanId();
+    }
+    spans[spanId] = Span(tracecode, to_micros(ProcessClock::now()));
+    numSpans.store(spanId + 1, std::memory_order_release);
+    return spanId;
 }
 
 bool Tracer::end(SpanId spanId) {
-    std::lock_guard<std::mutex> lock(spanMutex);
-    if (spanId >= vecSpans.size())
+    if (spanId >= numSpans.load(std::memory_order_acquire)) {
         return false;
-    auto& span = vecSpans[spanId];
+    }
+    auto& span = spans[spanId];
     span.duration = to_micros(ProcessClock::now()) - span.start;
     return true;
 }
 
 bool Tracer::end(const TraceCode tracecode) {
-    SpanId spanId = 0;
-    {
-        std::lock_guard<std::mutex> lock(spanMutex);
-        for (const auto& span : vecSpans) {
-            if (span.code == tracecode) {
-                break;
-            }
-            spanId++;
+    // End the most recent span with the given code, so that nested (or
+    // repeated) spans with the same code are closed in the right order
+    for (SpanId spanId = numSpans.load(std::memory_order_acquire); spanId > 0;
+         --spanId) {
+        if (spans[spanId - 1].code == tracecode) {
+            return end(spanId - 1);
         }
     }
-    return end(spanId);
+    return false;
 }
 
-const std::vector<Span>& Tracer::getDurations() const {
-    return vecSpans;
+std::vector<Span> Tracer::getDurations() const {
+    return std::vector<Span>(spans.begin(), spans.begin() + size());
 }
 
 std::chrono::microseconds Tracer::getTotalMicros() const {
-    if (vecSpans.empty()) {
+    if (size() == 0) {
         return std::chrono::microseconds(0);
     }
-    return vecSpans[0].duration;
+    return spans[0].duration;
 }
 
 /**
@@ -97,7 +100,7 @@ std::chrono::microseconds Tracer::decodeMicros(uint16_t encoded) const {
 }
 
 void Tracer::clear() {
-    vecSpans.clear();
+    numSpans.store(0, std::memory_order_release);
 }
 
 } // end namespace tracing
@@ -110,7 +113,7 @@ MEMCACHED_PUBLIC_API std::ostream& operator<<(
 
 MEMCACHED_PUBLIC_API std::string to_string(const cb::tracing::Tracer& tracer,
                                            bool raw) {
-    const auto& vecSpans = tracer.getDurations();
+    const auto vecSpans = tracer.getDurations();
     std::ostringstream os;
     auto size = vecSpans.size();
     for (const auto& span : vecSpans) {
@@ -135,6 +138,8 @@ MEMCACHED_PUBLIC_API std::string to_string(
         return "allocate";
     case TraceCode::BGFETCH:
         return "bg.fetch";
+    case TraceCode::BG_WAIT:
+        return "bg.wait";
     case TraceCode::FLUSH:
         return "flush";
     case TraceCode::GAT:
@@ -149,6 +154,8 @@ MEMCACHED_PUBLIC_API std::string to_string(
         return "get.meta";
     case TraceCode::GETSTATS:
         return "get.stats";
+    case TraceCode::HASH_LOOKUP:
+        return "hash.lookup";
     case TraceCode::ITEMDELETE:
         return "item.delete";
     case TraceCode::LOCK:
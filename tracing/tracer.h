@@ -15,8 +15,9 @@
  *   limitations under the License.
  */
 #pragma once
+#include <array>
+#include <atomic>
 #include <cstddef>
-#include <mutex>
 #include <ostream>
 #include <stdexcept>
 #include <string>
@@ -47,6 +48,8 @@ namespace tracing {
 
 class MEMCACHED_PUBLIC_CLASS Span {
 public:
+    Span() : code(TraceCode::REQUEST), start(0), duration(0) {
+    }
     Span(TraceCode code,
          std::chrono::microseconds start,
          std::chrono::microseconds duration = std::chrono::microseconds(0))
@@ -58,13 +61,26 @@ public:
 };
 
 /**
- * Tracer maintains an ordered vector of tracepoints
+ * Tracer maintains an ordered list of tracepoints
  * with name:time(micros)
+ *
+ * The spans are kept in a fixed size array inside the tracer (which lives
+ * in the cookie) so recording a span never allocates or locks. Spans beyond
+ * MaxSpans are silently dropped.
+ *
+ * Only one thread may begin spans at the time, but other threads may end
+ * spans concurrently. This allows for a background task working on behalf
+ * of a blocked cookie (like a BG fetch) to record its spans while the
+ * front end thread is still unwinding (and ending its spans) after
+ * returning EWOULDBLOCK.
  */
 class MEMCACHED_PUBLIC_CLASS Tracer {
 public:
     using SpanId = std::size_t;
 
+    /// The maximum number of spans recorded for a single request
+    static const size_t MaxSpans = 16;
+
     static SpanId invalidSpanId();
 
     SpanId begin(const TraceCode tracecode);
@@ -72,7 +88,12 @@ public:
     bool end(const TraceCode tracecode);
 
     // get the tracepoints as ordered durations
-    const std::vector<Span>& getDurations() const;
+    std::vector<Span> getDurations() const;
+
+    // get the number of recorded tracepoints
+    size_t size() const {
+        return numSpans.load(std::memory_order_acquire);
+    }
 
     std::chrono::microseconds getTotalMicros() const;
 
@@ -89,8 +110,8 @@ public:
                                     bool raw);
 
 protected:
-    std::vector<Span> vecSpans;
-    std::mutex spanMutex;
+    std::array<Span, MaxSpans> spans;
+    std::atomic<size_t> numSpans{0};
 };
 
 struct MEMCACHED_PUBLIC_CLASS Traceable {
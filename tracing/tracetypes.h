@@ -27,7 +27,8 @@ enum class TraceCode {
     REQUEST, /* Whole Request */
 
     ALLOCATE,
-    BGFETCH,
+    BGFETCH, /* Reading the item from disk */
+    BG_WAIT, /* Waiting for the BG fetcher to pick up the request */
     FLUSH,
     GAT,
     GET,
@@ -35,6 +36,7 @@ enum class TraceCode {
     GETLOCKED,
     GETMETA,
     GETSTATS,
+    HASH_LOOKUP,
     ITEMDELETE,
     LOCK,
     OBSERVE,
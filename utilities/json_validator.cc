@@ -0,0 +1,366 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2018 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#include <memcached/json_validator.h>
+
+#include <string>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define JSON_VALIDATOR_SSE2 1
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+namespace cb {
+namespace json {
+
+namespace {
+
+#ifdef JSON_VALIDATOR_SSE2
+inline int countTrailingZeros(uint32_t mask) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return int(index);
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+#endif
+
+class Validator {
+public:
+    Validator(const uint8_t* data, size_t size)
+        : ptr(data), end(data + size) {
+    }
+
+    bool validate();
+
+private:
+    enum class State {
+        /// The next token must be a value
+        Value,
+        /// The next token must be the key of an object member
+        Key,
+        /// A value was just completed
+        AfterValue
+    };
+
+    void skipWhitespace() {
+        while (ptr < end &&
+               (*ptr == ' ' || *ptr == '\n' || *ptr == '\r' || *ptr == '\t')) {
+            ++ptr;
+        }
+    }
+
+    /**
+     * Move ptr forward to the first byte which needs special treatment
+     * inside a string: '"', '\\', a control character or a byte which
+     * is part of a multi-byte UTF-8 sequence.
+     */
+    void skipPlainStringChars() {
+#ifdef JSON_VALIDATOR_SSE2
+        const __m128i quote = _mm_set1_epi8('"');
+        const __m128i backslash = _mm_set1_epi8('\\');
+        const __m128i space = _mm_set1_epi8(0x20);
+        while (end - ptr >= 16) {
+            const __m128i chunk =
+                    _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr));
+            // The comparison is signed, so bytes >= 0x80 are negative and
+            // end up in the same bucket as the control characters
+            const __m128i special =
+                    _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote),
+                                              _mm_cmpeq_epi8(chunk, backslash)),
+                                 _mm_cmplt_epi8(chunk, space));
+            const auto mask = uint32_t(_mm_movemask_epi8(special));
+            if (mask != 0) {
+                ptr += countTrailingZeros(mask);
+                return;
+            }
+            ptr += 16;
+        }
+#endif
+        while (ptr < end && *ptr >= 0x20 && *ptr < 0x80 && *ptr != '"' &&
+               *ptr != '\\') {
+            ++ptr;
+        }
+    }
+
+    bool isContinuation(const uint8_t* p, uint8_t low = 0x80,
+                        uint8_t high = 0xbf) const {
+        return p < end && *p >= low && *p <= high;
+    }
+
+    /**
+     * Validate the multi-byte UTF-8 sequence starting at ptr (RFC 3629;
+     * overlong encodings and surrogates are rejected) and move past it.
+     */
+    bool consumeUTF8Sequence() {
+        const uint8_t c = *ptr;
+        if (c >= 0xc2 && c <= 0xdf) {
+            if (!isContinuation(ptr + 1)) {
+                return false;
+            }
+            ptr += 2;
+        } else if (c >= 0xe0 && c <= 0xef) {
+            const uint8_t low = (c == 0xe0) ? 0xa0 : 0x80;
+            const uint8_t high = (c == 0xed) ? 0x9f : 0xbf;
+            if (!isContinuation(ptr + 1, low, high) ||
+                !isContinuation(ptr + 2)) {
+                return false;
+            }
+            ptr += 3;
+        } else if (c >= 0xf0 && c <= 0xf4) {
+            const uint8_t low = (c == 0xf0) ? 0x90 : 0x80;
+            const uint8_t high = (c == 0xf4) ? 0x8f : 0xbf;
+            if (!isContinuation(ptr + 1, low, high) ||
+                !isContinuation(ptr + 2) || !isContinuation(ptr + 3)) {
+                return false;
+            }
+            ptr += 4;
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    static bool isHex(uint8_t c) {
+        return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') ||
+               (c >= 'A' && c <= 'F');
+    }
+
+    bool consumeEscape() {
+        // ptr points at the backslash
+        ++ptr;
+        if (ptr == end) {
+            return false;
+        }
+        switch (*ptr) {
+        case '"':
+        case '\\':
+        case '/':
+        case 'b':
+        case 'f':
+        case 'n':
+        case 'r':
+        case 't':
+            ++ptr;
+            return true;
+        case 'u':
+            if (end - ptr < 5) {
+                return false;
+            }
+            for (int ii = 1; ii < 5; ++ii) {
+                if (!isHex(ptr[ii])) {
+                    return false;
+                }
+            }
+            ptr += 5;
+            return true;
+        }
+        return false;
+    }
+
+    bool consumeString() {
+        // ptr points at the opening quote
+        ++ptr;
+        while (true) {
+            skipPlainStringChars();
+            if (ptr == end) {
+                return false;
+            }
+
+            const uint8_t c = *ptr;
+            if (c == '"') {
+                ++ptr;
+                return true;
+            } else if (c == '\\') {
+                if (!consumeEscape()) {
+                    return false;
+                }
+            } else if (c < 0x20) {
+                return false;
+            } else if (!consumeUTF8Sequence()) {
+                return false;
+            }
+        }
+    }
+
+    bool consumeDigits() {
+        const auto* start = ptr;
+        while (ptr < end && *ptr >= '0' && *ptr <= '9') {
+            ++ptr;
+        }
+        return ptr != start;
+    }
+
+    bool consumeNumber() {
+        if (*ptr == '-') {
+            ++ptr;
+        }
+        if (ptr == end) {
+            return false;
+        }
+        if (*ptr == '0') {
+            ++ptr;
+        } else if (!consumeDigits()) {
+            return false;
+        }
+        if (ptr < end && *ptr == '.') {
+            ++ptr;
+            if (!consumeDigits()) {
+                return false;
+            }
+        }
+        if (ptr < end && (*ptr == 'e' || *ptr == 'E')) {
+            ++ptr;
+            if (ptr < end && (*ptr == '+' || *ptr == '-')) {
+                ++ptr;
+            }
+            if (!consumeDigits()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool consumeLiteral(const char* literal, size_t length) {
+        if (size_t(end - ptr) < length ||
+            std::char_traits<char>::compare(
+                    reinterpret_cast<const char*>(ptr), literal, length) != 0) {
+            return false;
+        }
+        ptr += length;
+        return true;
+    }
+
+    bool consumeValue(State& next);
+
+    const uint8_t* ptr;
+    const uint8_t* const end;
+
+    /// The currently open containers ('{' or '['). The small string
+    /// optimization means we won't allocate for typical nesting levels.
+    std::string stack;
+};
+
+bool Validator::consumeValue(State& next) {
+    next = State::AfterValue;
+    switch (*ptr) {
+    case '{':
+        ++ptr;
+        skipWhitespace();
+        if (ptr < end && *ptr == '}') {
+            ++ptr;
+        } else {
+            stack.push_back('{');
+            next = State::Key;
+        }
+        return true;
+    case '[':
+        ++ptr;
+        skipWhitespace();
+        if (ptr < end && *ptr == ']') {
+            ++ptr;
+        } else {
+            stack.push_back('[');
+            next = State::Value;
+        }
+        return true;
+    case '"':
+        return consumeString();
+    case 't':
+        return consumeLiteral("true", 4);
+    case 'f':
+        return consumeLiteral("false", 5);
+    case 'n':
+        return consumeLiteral("null", 4);
+    case '-':
+    case '0':
+    case '1':
+    case '2':
+    case '3':
+    case '4':
+    case '5':
+    case '6':
+    case '7':
+    case '8':
+    case '9':
+        return consumeNumber();
+    }
+    return false;
+}
+
+bool Validator::validate() {
+    State state = State::Value;
+    while (true) {
+        skipWhitespace();
+        switch (state) {
+        case State::Value:
+            if (ptr == end || !consumeValue(state)) {
+                return false;
+            }
+            break;
+
+        case State::Key:
+            if (ptr == end || *ptr != '"' || !consumeString()) {
+                return false;
+            }
+            skipWhitespace();
+            if (ptr == end || *ptr != ':') {
+                return false;
+            }
+            ++ptr;
+            state = State::Value;
+            break;
+
+        case State::AfterValue:
+            if (stack.empty()) {
+                // Only trailing whitespace is allowed after the top level
+                // value
+                return ptr == end;
+            }
+            if (ptr == end) {
+                return false;
+            }
+            if (*ptr == ',') {
+                ++ptr;
+                state = (stack.back() == '{') ? State::Key : State::Value;
+            } else if (*ptr == (stack.back() == '{' ? '}' : ']')) {
+                ++ptr;
+                stack.pop_back();
+            } else {
+                return false;
+            }
+            break;
+        }
+    }
+}
+
+} // anonymous namespace
+
+bool checkUTF8JSON(const uint8_t* data, size_t size) {
+    if (data == nullptr || size == 0) {
+        return false;
+    }
+    Validator validator(data, size);
+    return validator.validate();
+}
+
+} // namespace json
+} // namespace cb
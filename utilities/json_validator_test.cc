@@ -0,0 +1,150 @@
+/* -*- Mode: C++; tab-width: 4; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*
+ *     Copyright 2018 Couchbase, Inc
+ *
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/*
+ * Unit tests for cb::json::checkUTF8JSON
+ */
+
+#include <memcached/json_validator.h>
+
+#include <gtest/gtest.h>
+#include <string>
+
+static bool isJSON(const std::string& doc) {
+    return cb::json::checkUTF8JSON(
+            reinterpret_cast<const uint8_t*>(doc.data()), doc.size());
+}
+
+TEST(JsonValidatorTest, Empty) {
+    EXPECT_FALSE(cb::json::checkUTF8JSON(nullptr, 0));
+    EXPECT_FALSE(isJSON(""));
+    EXPECT_FALSE(isJSON("   "));
+}
+
+TEST(JsonValidatorTest, TopLevelValues) {
+    EXPECT_TRUE(isJSON("{}"));
+    EXPECT_TRUE(isJSON("[]"));
+    EXPECT_TRUE(isJSON("\"string\""));
+    EXPECT_TRUE(isJSON("0"));
+    EXPECT_TRUE(isJSON("-12.5e+3"));
+    EXPECT_TRUE(isJSON("true"));
+    EXPECT_TRUE(isJSON("false"));
+    EXPECT_TRUE(isJSON("null"));
+    EXPECT_TRUE(isJSON(" \t\r\n{ } \t\r\n"));
+
+    EXPECT_FALSE(isJSON("{}{}"));
+    EXPECT_FALSE(isJSON("{},"));
+    EXPECT_FALSE(isJSON("tru"));
+    EXPECT_FALSE(isJSON("nulls"));
+    EXPECT_FALSE(isJSON("True"));
+}
+
+TEST(JsonValidatorTest, Numbers) {
+    for (const auto* number : {"0", "-0", "1", "123", "1.5", "0.25", "1e10",
+                               "1E10", "1e+1", "1e-1", "-1.5E-3"}) {
+        EXPECT_TRUE(isJSON(number)) << number;
+    }
+    for (const auto* number : {"-", "01", "+1", "1.", ".1", "1e", "1e+",
+                               "0x10", "1.e3", "--1", "Infinity", "NaN"}) {
+        EXPECT_FALSE(isJSON(number)) << number;
+    }
+}
+
+TEST(JsonValidatorTest, Containers) {
+    EXPECT_TRUE(isJSON(R"({"a":1,"b":[1,2,{"c":null}],"d":{}})"));
+    EXPECT_TRUE(isJSON(R"([[[[]]],{},[{"":""}]])"));
+
+    EXPECT_FALSE(isJSON("{"));
+    EXPECT_FALSE(isJSON("["));
+    EXPECT_FALSE(isJSON("{]"));
+    EXPECT_FALSE(isJSON("[}"));
+    EXPECT_FALSE(isJSON("[1,]"));
+    EXPECT_FALSE(isJSON("[,1]"));
+    EXPECT_FALSE(isJSON(R"({"a":1,})"));
+    EXPECT_FALSE(isJSON(R"({"a"})"));
+    EXPECT_FALSE(isJSON(R"({"a":})"));
+    EXPECT_FALSE(isJSON(R"({a:1})"));
+    EXPECT_FALSE(isJSON(R"({1:1})"));
+    EXPECT_FALSE(isJSON("[1 2]"));
+}
+
+TEST(JsonValidatorTest, DeepNesting) {
+    const std::string open(10000, '[');
+    const std::string close(10000, ']');
+    EXPECT_TRUE(isJSON(open + close));
+    EXPECT_FALSE(isJSON(open + close.substr(1)));
+    EXPECT_FALSE(isJSON(open + close + "]"));
+}
+
+TEST(JsonValidatorTest, Strings) {
+    EXPECT_TRUE(isJSON(R"("\"\\\/\b\f\n\r\t")"));
+    EXPECT_TRUE(isJSON(R"("\u0000ꯍꯍ")"));
+    // Surrogate escapes aren't checked for pairing
+    EXPECT_TRUE(isJSON(R"("\ud800")"));
+
+    EXPECT_FALSE(isJSON(R"("\x")"));
+    EXPECT_FALSE(isJSON(R"("\u12")"));
+    EXPECT_FALSE(isJSON(R"("\u12G4")"));
+    EXPECT_FALSE(isJSON(R"("unterminated)"));
+    EXPECT_FALSE(isJSON(R"("\")"));
+    EXPECT_FALSE(isJSON(std::string("\"a\nb\"")));
+    EXPECT_FALSE(isJSON(std::string("\"a\0b\"", 5)));
+}
+
+TEST(JsonValidatorTest, LongStrings) {
+    // Exercise the vectorised scanning with the special characters at
+    // every position within (and across) the 16 byte chunks
+    for (size_t ii = 0; ii < 64; ++ii) {
+        std::string plain(ii, 'x');
+        EXPECT_TRUE(isJSON("\"" + plain + "\"")) << ii;
+        EXPECT_TRUE(isJSON("\"" + plain + "\\n" + plain + "\"")) << ii;
+        EXPECT_TRUE(isJSON("\"" + plain + "\xc3\xa6" + plain + "\"")) << ii;
+        EXPECT_FALSE(isJSON("\"" + plain + "\x01" + plain + "\"")) << ii;
+        EXPECT_FALSE(isJSON("\"" + plain + "\xff" + plain + "\"")) << ii;
+        EXPECT_FALSE(isJSON("\"" + plain + "\"" + plain + "\"")) << ii;
+        EXPECT_FALSE(isJSON("\"" + plain)) << ii;
+    }
+}
+
+TEST(JsonValidatorTest, UTF8) {
+    // 2, 3 and 4 byte sequences
+    EXPECT_TRUE(isJSON("\"\xc3\xa6\""));
+    EXPECT_TRUE(isJSON("\"\xe2\x82\xac\""));
+    EXPECT_TRUE(isJSON("\"\xf0\x9f\x98\x80\""));
+    // Boundaries
+    EXPECT_TRUE(isJSON("\"\xc2\x80\""));
+    EXPECT_TRUE(isJSON("\"\xef\xbf\xbf\""));
+    EXPECT_TRUE(isJSON("\"\xf4\x8f\xbf\xbf\""));
+
+    // Stray continuation byte
+    EXPECT_FALSE(isJSON("\"\x80\""));
+    // Overlong encodings
+    EXPECT_FALSE(isJSON("\"\xc0\xaf\""));
+    EXPECT_FALSE(isJSON("\"\xe0\x80\xaf\""));
+    EXPECT_FALSE(isJSON("\"\xf0\x80\x80\xaf\""));
+    // UTF-16 surrogates
+    EXPECT_FALSE(isJSON("\"\xed\xa0\x80\""));
+    // Above U+10FFFF
+    EXPECT_FALSE(isJSON("\"\xf4\x90\x80\x80\""));
+    EXPECT_FALSE(isJSON("\"\xf5\x80\x80\x80\""));
+    // Truncated sequences
+    EXPECT_FALSE(isJSON("\"\xe2\x82\""));
+    EXPECT_FALSE(isJSON("\"\xe2\x82"));
+    // Non-ASCII is only allowed within strings
+    EXPECT_FALSE(isJSON("\xc3\xa6"));
+    EXPECT_FALSE(isJSON("[\xc3\xa6]"));
+}
@@ -17,6 +17,7 @@
 #include "config.h"
 
 #include <algorithm>
+#include <cstring>
 #include <stdexcept>
 #include <xattr/blob.h>
 
@@ -32,64 +33,243 @@ Blob::Blob(const Blob& other)
 }
 
 cb::byte_buffer Blob::get(const cb::const_byte_buffer& key) const {
+    const auto offset = find_kvpair(key, true);
+    if (offset == blob.len) {
+        // Not found!
+        return {nullptr, 0};
+    }
+
+    auto* value = blob.buf + offset + 4 + key.len + 1;
+    return {value, strlen(reinterpret_cast<char*>(value))};
+}
+
+size_t Blob::find_kvpair(const cb::const_byte_buffer& key,
+                         bool build) const {
+    if (!index.empty()) {
+        auto iter = std::lower_bound(
+                index.begin(),
+                index.end(),
+                key,
+                [this](const IndexEntry& entry,
+                       const cb::const_byte_buffer& k) {
+                    const auto* ptr = blob.buf + entry.offset + 4;
+                    const auto len = std::min(size_t(entry.keylen), k.len);
+                    const auto ret = std::memcmp(ptr, k.buf, len);
+                    return ret < 0 || (ret == 0 && entry.keylen < k.len);
+                });
+        if (iter != index.end() && iter->keylen == key.len &&
+            std::memcmp(blob.buf + iter->offset + 4, key.buf, key.len) == 0) {
+            return iter->offset;
+        }
+        return blob.len;
+    }
+
+    size_t pairs = 0;
     try {
         size_t current = 4;
         while (current < blob.len) {
             // Get the length of the next kv-pair
             const auto size = read_length(current);
-            current += 4;
-            if (size > key.len) {
-                // This may be the next key
-                if (blob.buf[current + key.len] == '\0' &&
-                    std::memcmp(blob.buf + current, key.buf, key.len) == 0) {
-                    // Yay this is the key!!!
-                    auto* value = blob.buf + current + key.len + 1;
-                    return {value, strlen(reinterpret_cast<char*>(value))};
-                } else {
-                    // jump to the next key!!
-                    current += size;
+            if (size > key.len &&
+                blob.buf[current + 4 + key.len] == '\0' &&
+                std::memcmp(blob.buf + current + 4, key.buf, key.len) == 0) {
+                // Yay this is the key!!!
+                if (build && pairs > IndexThreshold) {
+                    build_index();
                 }
-            } else {
-                current += size;
+                return current;
             }
+            // jump to the next key!!
+            current += 4 + size;
+            ++pairs;
         }
     } catch (const std::out_of_range& ex) {
+        return blob.len;
+    }
+
+    if (build && pairs > IndexThreshold) {
+        build_index();
     }
 
     // Not found!
-    return {nullptr, 0};
+    return blob.len;
 }
 
-void Blob::prune_user_keys() {
+void Blob::build_index() const {
+    index.clear();
     try {
         size_t current = 4;
         while (current < blob.len) {
-            // Get the length of the next kv-pair
             const auto size = read_length(current);
+            const auto* key = reinterpret_cast<const char*>(blob.buf) +
+                              current + 4;
+            index.push_back({uint32_t(current), uint32_t(strlen(key))});
+            current += 4 + size;
+        }
+    } catch (const std::out_of_range& ex) {
+        // Invalid blob, just use the linear scan
+        index.clear();
+        return;
+    }
+
+    // Keep the first occurrence of a key first so we return the same
+    // value as the linear scan would if the key is duplicated
+    std::stable_sort(index.begin(),
+                     index.end(),
+                     [this](const IndexEntry& a, const IndexEntry& b) {
+                         const auto len = std::min(a.keylen, b.keylen);
+                         const auto ret = std::memcmp(blob.buf + a.offset + 4,
+                                                      blob.buf + b.offset + 4,
+                                                      len);
+                         return ret < 0 || (ret == 0 && a.keylen < b.keylen);
+                     });
+}
+
+void Blob::prune_user_keys() {
+    invalidate_index();
 
-            if (blob.buf[current + 4] != '_') {
-                remove_segment(current, size + 4);
-            } else {
-                current += 4 + size;
+    // Move all of the system xattrs towards the start of the blob in a
+    // single pass
+    size_t current = 4;
+    size_t write = 4;
+    try {
+        while (current < blob.len) {
+            // Get the length of the next kv-pair
+            const auto size = read_length(current) + 4;
+            if (blob.buf[current + 4] == '_') {
+                if (write != current) {
+                    std::memmove(blob.buf + write, blob.buf + current, size);
+                }
+                write += size;
             }
+            current += size;
         }
     } catch (const std::out_of_range& ex) {
+        // Drop the rest of the (invalid) blob
+    }
+
+    if (blob.len == 0) {
+        return;
+    }
+
+    if (write == 4) {
+        // the last xattr removed... we could just nuke it..
+        blob.len = 0;
+    } else {
+        blob.len = write;
+        write_length(0, uint32_t(blob.len - 4));
     }
 }
 
+void Blob::update(const std::vector<std::pair<cb::const_byte_buffer,
+                                              cb::const_byte_buffer>>&
+                          changes) {
+    using Change = std::pair<cb::const_byte_buffer, cb::const_byte_buffer>;
+    auto less = [](const cb::const_byte_buffer& a,
+                   const cb::const_byte_buffer& b) {
+        const auto ret = std::memcmp(a.buf, b.buf, std::min(a.len, b.len));
+        return ret < 0 || (ret == 0 && a.len < b.len);
+    };
+
+    // Sort the changes by key, and only keep the last one for each key
+    std::vector<const Change*> sorted;
+    sorted.reserve(changes.size());
+    for (const auto& change : changes) {
+        sorted.push_back(&change);
+    }
+    std::stable_sort(sorted.begin(),
+                     sorted.end(),
+                     [&less](const Change* a, const Change* b) {
+                         return less(a->first, b->first);
+                     });
+    std::vector<const Change*> unique;
+    unique.reserve(sorted.size());
+    for (auto* change : sorted) {
+        if (!unique.empty() && !less(unique.back()->first, change->first)) {
+            unique.back() = change;
+        } else {
+            unique.push_back(change);
+        }
+    }
+
+    auto find = [&unique, &less](const cb::const_byte_buffer& key) {
+        auto iter = std::lower_bound(
+                unique.begin(),
+                unique.end(),
+                key,
+                [&less](const Change* change,
+                        const cb::const_byte_buffer& k) {
+                    return less(change->first, k);
+                });
+        if (iter != unique.end() && !less(key, (*iter)->first)) {
+            return iter;
+        }
+        return unique.end();
+    };
+
+    // Calculate the size of the new blob (and which of the changes
+    // refer to keys already in the blob)
+    std::vector<bool> existing(unique.size());
+    size_t newsize = 4;
+    for (const auto& kvpair : *this) {
+        auto iter = find(kvpair.first);
+        if (iter == unique.end()) {
+            newsize += 4 + kvpair.first.len + 1 + kvpair.second.len + 1;
+        } else {
+            existing[iter - unique.begin()] = true;
+            if ((*iter)->second.len != 0) {
+                newsize += 4 + kvpair.first.len + 1 + (*iter)->second.len + 1;
+            }
+        }
+    }
+    for (size_t ii = 0; ii < unique.size(); ++ii) {
+        if (!existing[ii] && unique[ii]->second.len != 0) {
+            newsize += 4 + unique[ii]->first.len + 1 +
+                       unique[ii]->second.len + 1;
+        }
+    }
+
+    // Build the new blob in a new buffer (the values may point into the
+    // current blob)
+    std::unique_ptr<uint8_t[]> temp(new uint8_t[newsize]);
+    cb::byte_buffer old = blob;
+    blob = {temp.get(), newsize};
+    size_t offset = 4;
+    Blob current(old);
+    for (const auto& kvpair : current) {
+        auto iter = find(kvpair.first);
+        if (iter == unique.end()) {
+            write_kvpair(offset, kvpair.first, kvpair.second);
+            offset += 4 + kvpair.first.len + 1 + kvpair.second.len + 1;
+        } else if ((*iter)->second.len != 0) {
+            write_kvpair(offset, kvpair.first, (*iter)->second);
+            offset += 4 + kvpair.first.len + 1 + (*iter)->second.len + 1;
+        }
+    }
+    for (size_t ii = 0; ii < unique.size(); ++ii) {
+        if (!existing[ii] && unique[ii]->second.len != 0) {
+            write_kvpair(offset, unique[ii]->first, unique[ii]->second);
+            offset += 4 + unique[ii]->first.len + 1 + unique[ii]->second.len +
+                      1;
+        }
+    }
+
+    allocator.swap(temp);
+    alloc_size = newsize;
+    blob = {allocator.get(), newsize == 4 ? 0 : newsize};
+    invalidate_index();
+}
+
 void Blob::remove(const cb::const_byte_buffer& key) {
     // Locate the old value
-    const auto old = get(key);
-    if (old.len == 0) {
+    const auto offset = find_kvpair(key, false);
+    if (offset == blob.len) {
         // it's not there
         return;
     }
 
     // there is no need to reallocate as we can just pack the buffer
-    const auto offset = old.buf - blob.buf - 1 - key.len - 4;
-    const auto size = 4 + key.len + 1 + old.len + 1;
-
-    remove_segment(offset, size);
+    remove_segment(offset, 4 + read_length(offset));
 }
 
 void Blob::set(const cb::const_byte_buffer& key,
@@ -100,7 +280,13 @@ void Blob::set(const cb::const_byte_buffer& key,
     }
 
     // Locate the old value
-    const auto old = get(key);
+    cb::byte_buffer old{nullptr, 0};
+    const auto offset = find_kvpair(key, false);
+    if (offset != blob.len) {
+        auto* ptr = blob.buf + offset + 4 + key.len + 1;
+        old = {ptr, strlen(reinterpret_cast<char*>(ptr))};
+    }
+
     if (old.len == value.len) {
         // lets do an in-place replacement
         std::copy(value.buf, value.buf + value.len, old.buf);
@@ -165,6 +351,7 @@ void Blob::write_kvpair(size_t offset,
 
 void Blob::append_kvpair(const cb::const_byte_buffer& key,
                          const cb::const_byte_buffer& value) {
+    invalidate_index();
     auto offset = blob.len;
     if (offset == 0) {
         offset += 4;
@@ -180,6 +367,7 @@ void Blob::append_kvpair(const cb::const_byte_buffer& key,
 }
 
 void Blob::remove_segment(const size_t offset, const size_t size) {
+    invalidate_index();
     if (offset + size == blob.len) {
         // No need to do anyting as this was the last thing in our blob..
         // just change the length